@@ -0,0 +1,153 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_BOUNDEDQUEUE_H
+#define LOAM_VELODYNE_BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace loam {
+
+//有界的无锁队列(每个槽位一个序号的环形缓冲区)，push与pop都不加锁，可以在多个线程中同时调用。
+//队列满时push返回false，由调用者决定丢弃新的还是先pop出最旧的元素
+template <typename T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity = 8)
+  {
+    reset(capacity);
+  }
+
+  //清空并重新设置容量，容量向上取整为2的幂，至少为2；不能与push/pop同时调用
+  void reset(size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    mask = size - 1;
+    cells.clear();
+    cells.resize(size);
+    for (size_t i = 0; i < size; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  //其他线程同时push/pop时只是近似值
+  bool empty() const
+  {
+    return dequeuePos.load(std::memory_order_acquire) == enqueuePos.load(std::memory_order_acquire);
+  }
+
+  //队列满时返回false
+  bool push(const T& value)
+  {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells[pos & mask];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos);
+      if (diff == 0) {
+        //槽位空闲，抢占写入位置
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  //队列空时返回false
+  bool pop(T& value)
+  {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells[pos & mask];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos + 1);
+      if (diff == 0) {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    //取出后清空槽位，不让队列继续持有共享指针
+    value = cell->data;
+    cell->data = T();
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Cell {
+    Cell() : sequence(0) {}
+    Cell(const Cell& other) : sequence(other.sequence.load(std::memory_order_relaxed)), data(other.data) {}
+
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  size_t mask;
+  std::vector<Cell> cells;
+  //读写位置之间与前后各填充一个缓存行，避免生产者与消费者之间的伪共享。
+  //不用alignas(64)：C++14的new只保证16字节对齐，持有队列的LaserMapping等对象是new出来的
+  char enqueuePadding[64];
+  std::atomic<size_t> enqueuePos;
+  char dequeuePadding[64];
+  std::atomic<size_t> dequeuePos;
+  char tailPadding[64];
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_BOUNDEDQUEUE_H
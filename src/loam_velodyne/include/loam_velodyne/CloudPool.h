@@ -0,0 +1,87 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_CLOUDPOOL_H
+#define LOAM_VELODYNE_CLOUDPOOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include <pcl/point_cloud.h>
+
+namespace loam {
+
+//可重复使用的点云池：发布出去的点云在订阅者全部释放之后(只剩池中的引用)再清空复用，
+//清空不释放内存，几帧之后每帧都不再需要分配内存。订阅者仍在使用的点云不会被改动
+template <typename PointT>
+class CloudPool {
+public:
+  typedef typename pcl::PointCloud<PointT>::Ptr CloudPtr;
+
+  //maxClouds为池中最多保存的点云数，reservePoints为新建点云预留的点数
+  explicit CloudPool(size_t cloudNum = 4, size_t pointNum = 0)
+    : maxClouds(cloudNum), reservePoints(pointNum), next(0)
+  {
+  }
+
+  void setReservePoints(size_t points) { reservePoints = points; }
+
+  //取一个空的点云，优先复用没有其他引用的点云
+  CloudPtr acquire()
+  {
+    for (size_t n = 0; n < clouds.size(); n++) {
+      CloudPtr& cloud = clouds[(next + n) % clouds.size()];
+      if (cloud.unique()) {
+        next = (next + n + 1) % clouds.size();
+        cloud->clear();
+        return cloud;
+      }
+    }
+
+    CloudPtr cloud(new pcl::PointCloud<PointT>());
+    cloud->reserve(reservePoints);
+    if (clouds.size() < maxClouds) {
+      clouds.push_back(cloud);
+    }
+    return cloud;
+  }
+
+private:
+  size_t maxClouds;
+  size_t reservePoints;
+  size_t next;
+  std::vector<CloudPtr> clouds;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_CLOUDPOOL_H
@@ -0,0 +1,204 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_CUBEMAP_H
+#define LOAM_VELODYNE_CUBEMAP_H
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/VoxelFilter.h>
+#include <pcl/point_cloud.h>
+#include <pcl/kdtree/kdtree_flann.h>
+
+namespace loam {
+
+//cube在世界坐标系下的整数坐标，cube(i, j, k)的中心位于(i, j, k) * cubeSize
+struct CubeIndex {
+  int i;
+  int j;
+  int k;
+
+  CubeIndex() : i(0), j(0), k(0) {}
+  CubeIndex(int i_, int j_, int k_) : i(i_), j(j_), k(k_) {}
+
+  bool operator==(const CubeIndex& other) const
+  {
+    return i == other.i && j == other.j && k == other.k;
+  }
+};
+
+struct CubeIndexHash {
+  size_t operator()(const CubeIndex& index) const
+  {
+    //三个大素数异或，邻近的cube分散到不同的桶
+    return (size_t(index.i) * 73856093u) ^ (size_t(index.j) * 19349663u) ^ (size_t(index.k) * 83492791u);
+  }
+};
+
+//一个cube内的地图特征点，边沿点与平面点分别保存，并缓存各自的kd-tree
+struct MapCube {
+  enum Feature {
+    CORNER = 0,
+    SURF = 1,
+    FEATURE_NUM = 2
+  };
+
+  MapCube();
+
+  //点云、体素索引与kd-tree占用的内存(字节)，kd-tree为估计值
+  size_t memoryBytes() const;
+
+  pcl::PointCloud<PointType>::Ptr cloud[FEATURE_NUM];
+  //cloud有变化之后需要重建，匹配前只重建脏的kd-tree
+  pcl::KdTreeFLANN<PointType>::Ptr kdtree[FEATURE_NUM];
+  bool kdtreeDirty[FEATURE_NUM];
+  //cloud前filteredNum个点是下采样过的，之后是新加入的点
+  size_t filteredNum[FEATURE_NUM];
+  //下采样过的点的体素索引，用于增量下采样，不写入磁盘，读回后按需重建
+  VoxelIndex voxels[FEATURE_NUM];
+  //最近一次被访问的帧号，内存超出预算时最久未访问的cube先换出
+  uint64_t lastUsed;
+  //最近一次加入新点时的地图更新序号，用于增量发布周围的地图，不写入磁盘
+  uint64_t lastModified;
+};
+
+//cube某一时刻的只读视图，只引用kd-tree(及其建树用的点云)。cube之后更新时若kd-tree仍被视图引用，
+//会先复制点云再修改(写时复制)，因此视图看到的内容不会改变，可以在地图更新的同时用于匹配
+struct MapCubeView {
+  MapCubeView() : pointNum{0, 0} {}
+
+  CubeIndex index;
+  size_t pointNum[MapCube::FEATURE_NUM];
+  pcl::KdTreeFLANN<PointType>::ConstPtr kdtree[MapCube::FEATURE_NUM];
+};
+
+class MapFileReader;
+class MapFileWriter;
+
+//以整数cube坐标为键的稀疏哈希地图，只保存走过的区域，地图范围不受限制，也不需要循环移位
+//设置内存预算后，超出预算时把最久未访问的cube写到磁盘上，再次访问时自动读回
+class CubeMap {
+public:
+  typedef std::unordered_map<CubeIndex, MapCube, CubeIndexHash> Container;
+  typedef Container::iterator iterator;
+  typedef Container::const_iterator const_iterator;
+
+  explicit CubeMap(float size = 50.0);
+
+  //只能在地图为空时修改cube边长
+  bool setCubeSize(float size);
+  float getCubeSize() const { return cubeSize; }
+
+  //坐标所在的cube，以cube中心四舍五入
+  CubeIndex cubeIndexOf(float x, float y, float z) const;
+  //cube在一个维度上的索引
+  int cubeIndexOf(float coordinate) const;
+
+  //内存预算(字节)，0表示不限制
+  void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+  size_t getMemoryBudget() const { return memoryBudget; }
+  //换出的cube保存的目录，不存在时自动创建
+  bool setSpillDirectory(const std::string& directory);
+  const std::string& getSpillDirectory() const { return spillDirectory; }
+
+  //以之前保存的地图为初始地图，只能在地图为空且cube边长一致时设置。
+  //先验地图的cube在第一次访问时才从文件解码，之后与新加入的点一样更新
+  bool setPriorMap(const std::shared_ptr<const MapFileReader>& map);
+  //还没有解码的先验地图cube数
+  size_t priorSize() const { return priorCubes.size(); }
+  //冻结的地图不再加入新点，先验地图的cube超出内存预算时直接丢弃，再次访问时重新从文件解码，不需要换出目录
+  void setFrozen(bool frozen) { this->frozen = frozen; }
+  bool isFrozen() const { return frozen; }
+
+  //逐个cube写入地图文件(包括换出到磁盘上和未解码的先验地图cube)，不改变地图的内容
+  bool write(MapFileWriter& writer) const;
+
+  //开始新的一帧，本帧访问过的cube不会被换出
+  void beginFrame() { frameStamp++; }
+
+  //不存在时返回NULL，已换出到磁盘的cube会被读回
+  MapCube* find(const CubeIndex& index);
+  //不存在时新建一个空的cube，已换出到磁盘的cube会被读回
+  MapCube& findOrCreate(const CubeIndex& index);
+  //只在内存中查找，不读回也不更新访问时间
+  MapCube* findResident(const CubeIndex& index);
+
+  //内存超出预算时按访问时间从旧到新换出cube，本帧访问过的除外，写文件失败时返回false
+  bool enforceMemoryBudget();
+
+  //内存中的cube数
+  size_t size() const { return cubes.size(); }
+  //换出到磁盘上的cube数
+  size_t spilledSize() const { return spilledCubes.size(); }
+  //内存中cube的点云、体素索引与kd-tree占用的内存(字节)
+  size_t residentBytes() const;
+  //累计换出与读回的次数
+  uint64_t getSpillCount() const { return spillCount; }
+  uint64_t getReloadCount() const { return reloadCount; }
+
+  void clear();
+
+  iterator begin() { return cubes.begin(); }
+  iterator end() { return cubes.end(); }
+  const_iterator begin() const { return cubes.begin(); }
+  const_iterator end() const { return cubes.end(); }
+
+private:
+  std::string cubeFileName(const CubeIndex& index) const;
+  bool writeCube(const CubeIndex& index, const MapCube& cube) const;
+  bool readCube(const CubeIndex& index, MapCube& cube) const;
+  //已换出或先验地图中的cube读回内存，不存在或读取失败时返回end()
+  iterator reload(const CubeIndex& index);
+
+  float cubeSize;
+  Container cubes;
+  std::unordered_set<CubeIndex, CubeIndexHash> spilledCubes;
+  std::shared_ptr<const MapFileReader> priorMap;
+  std::unordered_set<CubeIndex, CubeIndexHash> priorCubes;
+
+  bool frozen;
+  size_t memoryBudget;
+  std::string spillDirectory;
+  uint64_t frameStamp;
+  uint64_t spillCount;
+  uint64_t reloadCount;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_CUBEMAP_H
@@ -0,0 +1,209 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_IMURINGBUFFER_H
+#define LOAM_VELODYNE_IMURINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace loam {
+
+//按时间戳查找的IMU环形缓冲区，单生产者单消费者，无锁：IMU回调push，处理线程按时间查找。
+//每个测量有一个递增的序号，缓冲区只保留最近capacity个；满了之后覆盖最旧的测量，push从不等待。
+//T需要有double类型的time成员，时间戳按push的顺序递增
+template <typename T>
+class ImuRingBuffer {
+public:
+  //查找的结果
+  enum LookupResult {
+    //还没有测量
+    LOOKUP_EMPTY,
+    //时间晚于所有的测量，front为最新的测量
+    LOOKUP_LATEST,
+    //back.time <= time <= front.time，可以在两者之间插值
+    LOOKUP_BRACKET
+  };
+
+  explicit ImuRingBuffer(size_t capacity = 256)
+  {
+    reset(capacity);
+  }
+
+  //清空并重新设置容量，容量向上取整为2的幂，至少为2；不能与push/查找同时调用
+  void reset(size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    mask = size - 1;
+    cells.clear();
+    cells.resize(size);
+    head.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  //已经push的测量数，也是下一个测量的序号
+  uint64_t end() const { return head.load(std::memory_order_acquire); }
+  bool empty() const { return end() == 0; }
+
+  //只在生产者线程中调用
+  void push(const T& sample)
+  {
+    uint64_t pos = head.load(std::memory_order_relaxed);
+    Cell& cell = cells[pos & mask];
+    //先作废槽位再写入，读的一方据此发现被覆盖的测量
+    cell.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    cell.data = sample;
+    cell.sequence.store(pos + 1, std::memory_order_release);
+    head.store(pos + 1, std::memory_order_release);
+  }
+
+  //读取序号为pos的测量，不存在或者已被覆盖时返回false
+  bool read(uint64_t pos, T& sample) const
+  {
+    const Cell& cell = cells[pos & mask];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+    sample = cell.data;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return cell.sequence.load(std::memory_order_relaxed) == pos + 1;
+  }
+
+  //最新的测量，没有时返回false
+  bool latest(T& sample) const
+  {
+    uint64_t last = end();
+    return last > 0 && read(last - 1, sample);
+  }
+
+  //从cursor开始查找第一个时间晚于time的测量，找不到时为最新的测量；cursor更新为找到的位置，
+  //之后的查找从这里开始，时间递增地查找时与逐个向后比较的结果相同。
+  //front之前没有可用的测量时back为T()
+  LookupResult lookup(double time, uint64_t& cursor, T& front, T& back) const
+  {
+    for (;;) {
+      uint64_t last = end();
+      if (last == 0) {
+        return LOOKUP_EMPTY;
+      }
+
+      //cursor之前的测量已被覆盖时从最旧的测量开始
+      uint64_t first = last > capacity() ? last - capacity() : 0;
+      uint64_t low = cursor < first ? first : cursor;
+      if (low >= last) {
+        low = last - 1;
+      }
+
+      //二分查找[low, last - 1)中第一个time < sample.time的位置，都不满足时为last - 1
+      uint64_t high = last - 1;
+      bool valid = true;
+      while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        T sample;
+        if (!read(mid, sample)) {
+          valid = false;
+          break;
+        }
+        if (time < sample.time) {
+          high = mid;
+        } else {
+          low = mid + 1;
+        }
+      }
+
+      if (!valid || !read(low, front)) {
+        //查找过程中被生产者覆盖，重新查找
+        continue;
+      }
+      cursor = low;
+
+      if (time > front.time) {
+        return LOOKUP_LATEST;
+      }
+      //front之前的测量已被覆盖时与没有测量相同
+      if (low == 0 || !read(low - 1, back)) {
+        back = T();
+      }
+      return LOOKUP_BRACKET;
+    }
+  }
+
+  //time时刻的测量，查找方式与lookup相同：晚于所有的测量时为最新的测量，否则由front与它之前的测量back
+  //(没有时为T())调用interpolateSample(back, front, ratioFront, ratioBack)按时间比例插值，
+  //该函数与T定义在同一命名空间中。两者时间戳相同时为front；没有测量时返回false
+  bool interpolate(double time, uint64_t& cursor, T& sample) const
+  {
+    T front, back;
+    LookupResult result = lookup(time, cursor, front, back);
+    if (result == LOOKUP_EMPTY) {
+      return false;
+    }
+    if (result == LOOKUP_LATEST || front.time <= back.time) {
+      sample = front;
+      return true;
+    }
+
+    float ratioFront = (time - back.time) / (front.time - back.time);
+    float ratioBack = (front.time - time) / (front.time - back.time);
+    sample = interpolateSample(back, front, ratioFront, ratioBack);
+    return true;
+  }
+
+private:
+  struct Cell {
+    Cell() : sequence(0), data() {}
+    Cell(const Cell& other) : sequence(other.sequence.load(std::memory_order_relaxed)), data(other.data) {}
+
+    //槽位中测量的序号加一，0表示空或者正在写入
+    std::atomic<uint64_t> sequence;
+    T data;
+  };
+
+  size_t mask;
+  std::vector<Cell> cells;
+  //写入位置前后各填充一个缓存行，避免与其他成员伪共享；不用alignas，这样包含它的对象可以直接new
+  char headPadding[64];
+  std::atomic<uint64_t> head;
+  char tailPadding[64];
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_IMURINGBUFFER_H
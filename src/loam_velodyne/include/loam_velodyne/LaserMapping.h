@@ -0,0 +1,506 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_LASERMAPPING_H
+#define LOAM_VELODYNE_LASERMAPPING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/BoundedQueue.h>
+#include <loam_velodyne/CubeMap.h>
+#include <loam_velodyne/ImuRingBuffer.h>
+#include <loam_velodyne/SolverBudget.h>
+#include <loam_velodyne/StageTimers.h>
+#include <loam_velodyne/imu_integration.h>
+#include <opencv/cv.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/kdtree/kdtree_flann.h>
+
+namespace loam {
+
+//建图的参数，对应节点的私有参数
+struct LaserMappingParams {
+  LaserMappingParams()
+    : numThreads(0),
+      cubeSize(50.0),
+      mapMemoryBudgetMB(0),
+      mapSpillDirectory("/tmp/loam_velodyne_map"),
+      priorMapFile(""),
+      localizationOnly(false),
+      useFixedSizeFit(true),
+      maxIterations(10),
+      timeBudget(0),
+      reassociateRotation(0),
+      reassociateTranslation(0),
+      asyncMapping(true),
+      mappingQueueSize(8),
+      mappingDropPolicy("drop_oldest"),
+      pipelineMapUpdate(false),
+      asyncRegistration(false),
+      surroundDelta(false),
+      surroundKeyframeInterval(10) {}
+
+  //累加法方程使用的线程数，小于等于0时使用全部的核
+  int numThreads;
+  //地图cube的边长(米)
+  double cubeSize;
+  //地图内存预算(MB)，包括点云、体素索引与kd-tree，0表示不限制；超出预算时最久未访问的cube换出到mapSpillDirectory，再次经过时读回
+  int mapMemoryBudgetMB;
+  std::string mapSpillDirectory;
+  //之前保存的地图文件，不为空时以其为初始地图，cube在经过时才从文件中解码
+  std::string priorMapFile;
+  //只在先验地图中定位：地图只读，不加入新点也不再下采样，cube的kd-tree只在解码之后建一次
+  bool localizationOnly;
+  //特征点的直线/平面拟合方式：true使用固定大小的闭式解，false使用原来的OpenCV实现
+  bool useFixedSizeFit;
+  //L-M迭代预算：最大迭代次数，每帧的时间预算(秒，0为不限制)，
+  //以及重新查找对应点的位姿变化阈值(度、米，都为0时每次迭代都重新查找)
+  int maxIterations;
+  double timeBudget;
+  double reassociateRotation;
+  double reassociateTranslation;
+  //异步建图：接收回调只负责把对齐的帧放入有界队列，匹配与地图更新在独立的线程中进行
+  bool asyncMapping;
+  int mappingQueueSize;
+  std::string mappingDropPolicy;
+  //地图更新与下一帧的匹配流水线进行，匹配使用上一次地图更新的快照(地图比同步更新晚一帧)
+  bool pipelineMapUpdate;
+  //全部点转换到世界坐标系在单独的线程中进行，不占用匹配的时间；来不及处理时只转换最新的一帧
+  bool asyncRegistration;
+  //增量发布周围的地图：只给出自上次发布以来加入过新点的cube，每隔surroundKeyframeInterval次给出周围全部的cube
+  //(0表示只有第一次)
+  bool surroundDelta;
+  int surroundKeyframeInterval;
+};
+
+//一帧建图的结果，与/aft_mapped_to_init的内容相同
+struct MappingOutput {
+  MappingOutput() : time(0), transformAftMapped{0}, transformBefMapped{0} {}
+
+  double time;
+  //mapping微调之后的位姿，以及微调之前odometry给出的位姿
+  float transformAftMapped[6];
+  float transformBefMapped[6];
+};
+
+//周围地图的增量，各cube的点为cube中的边沿点与平面点，不再整体下采样
+struct SurroundDelta {
+  SurroundDelta() : time(0), keyframe(false) {}
+
+  double time;
+  //为true时包含周围全部的cube，之前收到的cube都应丢弃
+  bool keyframe;
+  std::vector<CubeIndex> cubes;
+  //第n个cube的点为points中从第pointStart[n]个点开始的pointSize[n]个点
+  std::vector<uint32_t> pointStart;
+  std::vector<uint32_t> pointSize;
+  pcl::PointCloud<PointType> points;
+};
+
+//一次地图更新的结果：每隔mapFrameNum帧给出下采样之后的周围的地图与地图内存的统计
+struct MapOutput {
+  MapOutput()
+    : time(0),
+      publishFrame(false),
+      solverReport(),
+      residentCubes(0),
+      residentBytes(0),
+      memoryBudget(0),
+      spilledCubes(0),
+      spillCount(0),
+      reloadCount(0),
+      bundleQueueCapacity(0),
+      droppedBundles(0)
+  {
+  }
+
+  double time;
+  //每隔mapFrameNum帧为true，周围的地图与统计只在这些帧给出
+  bool publishFrame;
+  //周围的地图，其余帧或者没有设置输出时为空
+  pcl::PointCloud<PointType>::ConstPtr surround;
+  //周围地图的增量，只在开启增量发布时给出
+  std::shared_ptr<const SurroundDelta> surroundDelta;
+  //本帧位姿优化的统计
+  SolverReport solverReport;
+  size_t residentCubes;
+  size_t residentBytes;
+  size_t memoryBudget;
+  size_t spilledCubes;
+  uint64_t spillCount;
+  uint64_t reloadCount;
+  size_t bundleQueueCapacity;
+  uint64_t droppedBundles;
+};
+
+//同一帧的边沿点、平面点、全部点与里程计位姿，时间戳对齐之后作为一个整体交给建图
+struct MappingBundle {
+  MappingBundle() : time(0), transformSum{0} {}
+
+  double time;
+  pcl::PointCloud<PointType>::ConstPtr cornerLast;
+  pcl::PointCloud<PointType>::ConstPtr surfLast;
+  pcl::PointCloud<PointType>::ConstPtr fullRes;
+  //odometry计算得到的到世界坐标系下的转移矩阵
+  float transformSum[6];
+};
+
+//一帧的全部点按匹配之后的位姿转换到世界坐标系，结果与/velodyne_cloud_registered的内容相同
+struct RegistrationJob {
+  RegistrationJob() : time(0), transformTobeMapped{0} {}
+
+  double time;
+  pcl::PointCloud<PointType>::ConstPtr fullRes;
+  float transformTobeMapped[6];
+};
+
+//一帧匹配之后对地图的更新：特征点加入地图、下采样、发布周围的地图
+struct MapUpdate {
+  MapUpdate()
+    : time(0),
+      cornerPoints(new pcl::PointCloud<PointType>()),
+      surfPoints(new pcl::PointCloud<PointType>()),
+      solverReport()
+  {
+  }
+
+  double time;
+  //本帧所在的cube
+  CubeIndex center;
+  //转换到世界坐标系下的特征点
+  pcl::PointCloud<PointType>::Ptr cornerPoints;
+  pcl::PointCloud<PointType>::Ptr surfPoints;
+  //本帧视域内的cube与周围的cube
+  std::vector<CubeIndex> validCubes;
+  std::vector<CubeIndex> surroundCubes;
+  //本帧位姿优化的统计
+  SolverReport solverReport;
+};
+
+//一次地图更新之后的只读快照，包含更新时所在cube附近的cube视图
+struct MapSnapshot {
+  CubeIndex center;
+  //按(i, j, k)的顺序排列，不存在或为空的cube点数为0
+  std::vector<MapCubeView> cubes;
+};
+
+//建图：将里程计输出的特征点与以50米立方体组织的地图匹配，低频微调位姿并更新地图
+//不涉及话题的订阅与发布，节点与nodelet由LaserMappingNode封装
+class LaserMapping {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //建图跟不上输入时队列中帧的处理方式，队列满时总是丢弃最旧的帧
+  enum DropPolicy {
+    //按顺序处理队列中的每一帧
+    DROP_OLDEST,
+    //只处理队列中最新的一帧，其余丢弃
+    PROCESS_LATEST,
+    //队列中的所有帧的特征点合并后做一次匹配
+    BATCH
+  };
+
+  LaserMapping();
+  ~LaserMapping();
+
+  typedef std::function<void(const MappingOutput&)> MappingCallback;
+  typedef std::function<void(const MapOutput&)> MapCallback;
+  typedef std::function<void(const pcl::PointCloud<PointType>::ConstPtr&)> RegisteredCloudCallback;
+
+  //按参数初始化；异步建图时在这里启动建图线程，回调需在此之前设置
+  bool configure(const LaserMappingParams& params);
+
+  //每帧匹配之后的结果，异步建图时在建图线程中调用
+  void setMappingCallback(const MappingCallback& callback) { mappingCallback = callback; }
+  //每次地图更新之后的结果，流水线模式下在地图更新线程中调用
+  void setMapCallback(const MapCallback& callback) { mapCallback = callback; }
+  //转换到世界坐标系下的全部点，没有设置时不做转换；帧中没有全部点时也不调用
+  //异步转换时在转换线程中调用，否则在每帧的结果之前调用
+  void setRegisteredCloudCallback(const RegisteredCloudCallback& callback) { registeredCloudCallback = callback; }
+  //是否给出整体下采样的周围的地图，没有人需要时省去拼接与下采样，可以在运行中切换
+  void setSurroundOutput(bool enabled) { surroundOutput = enabled; }
+
+  //处理对齐之后的一帧：放入建图队列，同步建图时立即处理，不会阻塞
+  void process(const MappingBundle& bundle);
+  //处理一个IMU测量，只使用了翻滚角和俯仰角
+  void processImu(const ImuSample& imu);
+
+  StageTimers& getMatchTimers() { return matchTimers; }
+  StageTimers& getMapTimers() { return mapTimers; }
+
+  //累计丢弃的帧数
+  uint64_t getDroppedBundles() const { return droppedBundles.load(); }
+
+  //把整个地图写入地图文件，写完之后返回。异步建图时在建图线程中两帧之间写入，
+  //否则在调用线程中直接写入，需与process在同一线程中调用
+  bool exportMap(const std::string& fileName, bool quantize);
+
+private:
+  //等待建图线程处理的地图导出请求
+  struct ExportRequest {
+    std::string fileName;
+    bool quantize;
+    std::promise<bool> result;
+  };
+
+  //处理等待中的地图导出请求
+  void processExports();
+  //等待正在进行的地图更新完成之后写入地图文件
+  bool writeMap(const std::string& fileName, bool quantize);
+  //把对齐的一帧放入队列，不会阻塞
+  void enqueueBundle(const MappingBundle& bundle);
+  //按丢帧策略处理队列中的帧
+  void processQueue();
+  //建图线程
+  void mappingLoop();
+  //optimize为false时只把特征点加入待匹配的点云，与之后的帧一起匹配
+  void mapBundle(const MappingBundle& bundle, bool optimize);
+  void transformAssociateToMap();
+  void transformUpdate();
+  //只在与point邻域相交、且在视域内的cube中查找最近的5个点，5个点都在1米以内时返回true
+  bool nearestKSearchCubes(int feature, const PointType& point,
+                           pcl::PointCloud<PointType>& nearestPoints,
+                           std::vector<float>& nearestSqDis);
+  //本帧视域内的cube视图，不在视域内时返回NULL
+  const MapCubeView* validCubeView(const CubeIndex& index) const;
+  //当前快照中的cube视图，不存在或为空时返回NULL
+  const MapCubeView* snapshotCubeView(const CubeIndex& index) const;
+  void updateCubeKdtree(MapCube& cube, int feature);
+  //cube的kd-tree仍被快照引用时，先复制点云再修改
+  void copyCubeOnWrite(MapCube& cube, int feature);
+  void downsizeCube(MapCube& cube, int feature, VoxelFilter& downSizeFilter);
+  //把特征点加入地图、下采样，每隔mapFrameNum帧给出周围的地图
+  void updateMap(const MapUpdate& update, MapOutput& output);
+  //周围的cube中自上次增量以来有变化的cube
+  void buildSurroundDelta(const MapUpdate& update, SurroundDelta& delta);
+  //地图更新完成之后结束计时并交给回调
+  void finishMapUpdate(const MapOutput& output);
+  //以center为中心建立地图快照
+  void buildMapSnapshot(const CubeIndex& center, MapSnapshot& snapshot);
+  //等待上一次地图更新完成，交换快照后把本帧的更新交给地图更新线程
+  void submitMapUpdate();
+  //地图更新线程
+  void mapUpdateLoop();
+  //把一帧的全部点交给转换线程，上一帧还在等待时替换掉
+  void submitRegistration(const RegistrationJob& job);
+  //全部点转换线程
+  void registrationLoop();
+  //由匹配点累加法方程matAtA * matX = matAtB
+  void accumulateNormalEquations(Eigen::Matrix<float, 6, 6>& matAtA, Eigen::Matrix<float, 6, 1>& matAtB);
+
+  static const int imuQueLength = 200;
+
+  //当前处理的帧的时间戳
+  double timeLaserOdometry;
+
+  //对齐之后等待建图的帧
+  BoundedQueue<MappingBundle> bundleQueue;
+  DropPolicy dropPolicy;
+  std::atomic<uint64_t> droppedBundles;
+
+  bool asyncMapping;
+  std::thread mappingThread;
+  std::atomic<bool> mappingThreadStop;
+  //只用于建图线程等待新帧与导出请求，建图过程中不持有
+  std::mutex bundleMutex;
+  std::condition_variable bundleCondition;
+  std::vector<std::shared_ptr<ExportRequest> > exportRequests;
+
+  //lidar视域范围内(FOV)的cube，匹配时只读
+  std::vector<MapCubeView> laserCloudValidViews;
+  //本帧所在cube附近5x5x5个cube在laserCloudValidViews中的位置，不在视域内为-1
+  std::vector<int> validViewLookup;
+  CubeIndex validViewCenter;
+  //本帧匹配之后对地图的更新
+  MapUpdate currentUpdate;
+
+  //流水线模式：地图更新在单独的线程中与下一帧的匹配同时进行，匹配使用上一次更新完成时的快照
+  bool pipelineMapUpdate;
+  std::thread mapUpdateThread;
+  std::mutex mapUpdateMutex;
+  std::condition_variable mapUpdateCondition;
+  bool mapUpdatePending;
+  bool mapUpdateThreadStop;
+  //地图更新线程正在处理的更新
+  MapUpdate mapUpdateJob;
+  //双缓冲的快照：匹配读front，地图更新线程写另一个
+  MapSnapshot mapSnapshots[2];
+  int frontSnapshot;
+
+  //全部点转换线程
+  bool asyncRegistration;
+  std::thread registrationThread;
+  std::mutex registrationMutex;
+  std::condition_variable registrationCondition;
+  bool registrationPending;
+  bool registrationThreadStop;
+  RegistrationJob pendingRegistration;
+
+  //最新接收到的边沿点
+  pcl::PointCloud<PointType>::ConstPtr laserCloudCornerLast;
+  //最新接收到的平面点
+  pcl::PointCloud<PointType>::ConstPtr laserCloudSurfLast;
+  //存放当前收到的下采样之后的边沿点(in the local frame)
+  pcl::PointCloud<PointType>::Ptr laserCloudCornerStack;
+  //存放当前收到的下采样之后的平面点(in the local frame)
+  pcl::PointCloud<PointType>::Ptr laserCloudSurfStack;
+  //存放当前收到的边沿点，作为下采样的数据源
+  pcl::PointCloud<PointType>::Ptr laserCloudCornerStack2;
+  //存放当前收到的平面点，作为下采样的数据源
+  pcl::PointCloud<PointType>::Ptr laserCloudSurfStack2;
+  //原始点云坐标
+  pcl::PointCloud<PointType>::Ptr laserCloudOri;
+  pcl::PointCloud<PointType>::Ptr coeffSel;
+  //匹配使用的特征点（下采样之前的）
+  pcl::PointCloud<PointType>::Ptr laserCloudSurround2;
+  //地图中查找到的最近点
+  pcl::PointCloud<PointType>::Ptr laserCloudNearest;
+  //点云全部点
+  pcl::PointCloud<PointType>::ConstPtr laserCloudFullRes;
+  //以cube为单位组织的稀疏地图，运行过程中会一直保存
+  CubeMap laserCloudCubes;
+  //只定位时地图只读，只做位姿优化
+  bool localizationOnly;
+  //地图更新的序号，cube加入新点时记录在lastModified中
+  uint64_t mapUpdateStamp;
+
+  std::atomic<bool> surroundOutput;
+  bool surroundDelta;
+  int surroundKeyframeInterval;
+  //已给出的增量数，上一次增量时的地图更新序号
+  uint64_t surroundDeltaCount;
+  uint64_t lastDeltaStamp;
+
+  //多个cube中查找最近点时的候选点(距离平方，点序)
+  std::vector<std::pair<float, int> > mapSearchCandidates;
+  pcl::PointCloud<PointType> mapSearchPoints;
+
+  /*************高频转换量**************/
+  //odometry计算得到的到世界坐标系下的转移矩阵
+  float transformSum[6] = {0};
+  //转移增量，只使用了后三个平移增量
+  float transformIncre[6] = {0};
+
+  /*************低频转换量*************/
+  //以起始位置为原点的世界坐标系下的转换矩阵（猜测与调整的对象）
+  float transformTobeMapped[6] = {0};
+  //存放mapping之前的Odometry计算的世界坐标系的转换矩阵（注：低频量，不一定与transformSum一样）
+  float transformBefMapped[6] = {0};
+  //存放mapping之后的经过mapping微调之后的转换矩阵
+  float transformAftMapped[6] = {0};
+
+  //imu时间戳大于当前帧时间戳的测量的序号
+  uint64_t imuPointerFront;
+  //IMU回调写入，建图线程按时间查找，只使用翻滚角和俯仰角
+  ImuRingBuffer<ImuState> imuBuffer;
+
+  std::vector<int> pointSearchInd;
+  std::vector<float> pointSearchSqDis;
+  std::vector<float> pointNearestSqDis;
+
+  PointType pointOri, pointSel, pointProj, coeff;
+
+  cv::Mat matA0;
+  cv::Mat matB0;
+  cv::Mat matX0;
+
+  cv::Mat matA1;
+  cv::Mat matD1;
+  cv::Mat matV1;
+
+  bool isDegenerate;
+  Eigen::Matrix<float, 6, 6> matP;
+
+  //累加法方程使用的线程数
+  int numThreads;
+  //直线/平面拟合使用固定大小的闭式解还是OpenCV
+  bool useFixedSizeFit;
+  //L-M迭代次数、时间预算与重新查找对应点的时机
+  SolverBudget solverBudget;
+  //上次查找对应点时每个特征点匹配到的直线(两个点，6个数)与平面(4个数)，是否匹配成功
+  std::vector<char> cornerMatched;
+  std::vector<float> cornerLines;
+  std::vector<char> surfMatched;
+  std::vector<float> surfPlanes;
+
+  //匹配与地图更新各阶段的耗时统计，流水线模式下两者在不同的线程中
+  enum MatchStage {
+    STAGE_CUBE_SELECT,
+    STAGE_KDTREE_BUILD,
+    STAGE_STACK_DOWNSAMPLE,
+    STAGE_OPTIMIZATION,
+    STAGE_UPDATE_WAIT,
+    STAGE_OUTPUT
+  };
+  enum MapStage {
+    STAGE_INSERT,
+    STAGE_CUBE_DOWNSAMPLE,
+    STAGE_SURROUND,
+    STAGE_SPILL,
+    STAGE_SNAPSHOT
+  };
+  StageTimers matchTimers;
+  StageTimers mapTimers;
+
+  //体素栅格滤波器，cube的滤波只合并新加入的点
+  VoxelFilter downSizeFilterCorner;
+  VoxelFilter downSizeFilterSurf;
+  VoxelFilter downSizeFilterMap;
+  //地图更新使用的滤波器，流水线模式下与匹配用的滤波器在不同的线程中使用
+  VoxelFilter cubeDownSizeFilterCorner;
+  VoxelFilter cubeDownSizeFilterSurf;
+
+  int frameCount;
+  int mapFrameCount;
+
+  MappingCallback mappingCallback;
+  MapCallback mapCallback;
+  RegisteredCloudCallback registeredCloudCallback;
+};
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_LASERMAPPING_H
@@ -0,0 +1,132 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_LASERMAPPINGNODE_H
+#define LOAM_VELODYNE_LASERMAPPINGNODE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <Eigen/Core>
+#include <loam_velodyne/LaserMapping.h>
+#include <loam_velodyne/SaveMap.h>
+#include <loam_velodyne/SurroundDelta.h>
+#include <loam_velodyne/StampSynchronizer.h>
+#include <loam_velodyne/TimingPublisher.h>
+#include <nav_msgs/Odometry.h>
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <tf/transform_broadcaster.h>
+
+namespace loam {
+
+//laserMapping的ROS封装：按时间戳对齐里程计的输出，发布建图之后的位姿、tf、点云与地图诊断，独立节点与nodelet共用
+//异步建图与流水线模式下发布在建图线程与地图更新线程中进行
+class LaserMappingNode {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  LaserMappingNode();
+
+  //订阅/发布话题
+  bool setup(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+  //接收边沿点
+  void laserCloudCornerLastHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudCornerLast2);
+  //接收平面点
+  void laserCloudSurfLastHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudSurfLast2);
+  //接收点云全部点
+  void laserCloudFullResHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudFullRes2);
+  //接收旋转平移信息
+  void laserOdometryHandler(const nav_msgs::Odometry::ConstPtr& laserOdometry);
+  //接收IMU信息
+  void imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn);
+
+private:
+  typedef pcl::PointCloud<PointType>::ConstPtr CloudConstPtr;
+
+  //同一时间戳的四路输入都到齐时调用
+  void synchronizedHandler(const CloudConstPtr& laserCloudCornerLast2,
+                           const CloudConstPtr& laserCloudSurfLast2,
+                           const CloudConstPtr& laserCloudFullRes2,
+                           const nav_msgs::Odometry::ConstPtr& laserOdometry);
+  //发布一帧匹配的结果
+  void publishMapping(const MappingOutput& output);
+  //发布转换到世界坐标系下的全部点
+  void publishRegisteredCloud(const CloudConstPtr& registeredCloud);
+  //按/velodyne_cloud_registered是否有订阅者订阅或取消订阅/velodyne_cloud_3
+  void updateFullResSubscription();
+  //发布周围的地图与地图内存使用情况
+  void publishMap(const MapOutput& output);
+  //按/laser_cloud_surround是否有订阅者开关整体下采样的周围地图
+  void updateSurroundOutput();
+  //~save_map服务：把当前的地图写入地图文件
+  bool saveMapHandler(loam_velodyne::SaveMap::Request& request, loam_velodyne::SaveMap::Response& response);
+
+  LaserMapping laserMapping;
+
+  //按时间戳对齐四路输入
+  StampSynchronizer<CloudConstPtr, CloudConstPtr, CloudConstPtr, nav_msgs::Odometry::ConstPtr> inputSynchronizer;
+
+  nav_msgs::Odometry odomAftMapped;
+  //setup时创建，没有ROS master时不能构造
+  std::unique_ptr<tf::TransformBroadcaster> tfBroadcaster;
+  tf::StampedTransform aftMappedTrans;
+
+  ros::Subscriber subLaserCloudCornerLast;
+  ros::Subscriber subLaserCloudSurfLast;
+  ros::Subscriber subLaserOdometry;
+  ros::Subscriber subLaserCloudFullRes;
+  ros::Subscriber subImu;
+  //全部点只在有人订阅/velodyne_cloud_registered时订阅，没有订阅时以空指针补齐这一路输入
+  ros::NodeHandle subscribeNode;
+  std::mutex fullResMutex;
+  std::atomic<bool> fullResSubscribed;
+
+  ros::Publisher pubLaserCloudSurround;
+  ros::Publisher pubSurroundDelta;
+  ros::Publisher pubLaserCloudFullRes;
+  ros::Publisher pubOdomAftMapped;
+  ros::Publisher pubDiagnostics;
+
+  ros::ServiceServer saveMapService;
+
+  float cubeSize;
+
+  TimingPublisher matchTimingPublisher;
+  TimingPublisher mapTimingPublisher;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_LASERMAPPINGNODE_H
@@ -0,0 +1,232 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_LASERODOMETRY_H
+#define LOAM_VELODYNE_LASERODOMETRY_H
+
+#include <string>
+#include <vector>
+
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/ScanLineIndex.h>
+#include <loam_velodyne/ScanRegistration.h>
+#include <loam_velodyne/SolverBudget.h>
+#include <loam_velodyne/SweepPoseTable.h>
+#include <loam_velodyne/StageTimers.h>
+#include <opencv/cv.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/kdtree/kdtree_flann.h>
+
+namespace loam {
+
+//激光里程计的参数
+struct LaserOdometryParams {
+  LaserOdometryParams()
+    : numThreads(0),
+      maxIterations(25),
+      timeBudget(0),
+      reassociateRotation(0),
+      reassociateTranslation(0),
+      correspondenceSearch("kdtree"),
+      skipFrameNum(1),
+      interpolationBins(0),
+      fullResDecimation(1) {}
+
+  //特征匹配使用的线程数，小于等于0时使用全部的核
+  int numThreads;
+  //L-M迭代预算：最大迭代次数，每帧的时间预算(秒，0为不限制)，
+  //以及重新查找对应点的位姿变化阈值(度、米，都为0时每迭代五次重新查找一次)
+  int maxIterations;
+  double timeBudget;
+  double reassociateRotation;
+  double reassociateTranslation;
+  //kdtree：kd-tree查找最近点后沿点序线性查找相邻线上的点；scanline：按线号与方位角的索引直接查找，不建kd-tree
+  std::string correspondenceSearch;
+  //跳帧数，控制发给laserMapping的频率：每skipFrameNum + 1帧发一次
+  int skipFrameNum;
+  //去除运动畸变时插值位姿的份数：0为逐点计算插值位姿的正余弦，
+  //大于0时每次迭代预先计算interpolationBins + 1个时刻的旋转矩阵，点的旋转在相邻时刻之间线性插值
+  int interpolationBins;
+  //发给laserMapping的全部点每fullResDecimation个点取一个，1为全部保留
+  int fullResDecimation;
+};
+
+//一帧里程计的结果，与/laser_odom_to_init及发给laserMapping的点云内容相同
+struct OdometryOutput {
+  OdometryOutput() : time(0), transformSum{0} {}
+
+  double time;
+  //当前帧相对于第一帧的状态转移量(rx, ry, rz, tx, ty, tz)
+  float transformSum[6];
+  //按跳帧数每隔一帧给出，其余帧为空；不需要全部点时fullRes也为空
+  pcl::PointCloud<PointType>::ConstPtr cornerLast;
+  pcl::PointCloud<PointType>::ConstPtr surfLast;
+  pcl::PointCloud<PointType>::ConstPtr fullRes;
+};
+
+//激光里程计：匹配相邻两帧的特征点，估计雷达在一个扫描周期内的运动
+//不涉及话题的订阅与发布，节点与nodelet由LaserOdometryNode封装
+class LaserOdometry {
+public:
+  LaserOdometry();
+
+  //按参数初始化
+  bool configure(const LaserOdometryParams& params);
+
+  //处理scanRegistration给出的一帧特征点，估计出位姿时返回true
+  //第一帧只用于初始化，返回false，但仍给出发给laserMapping的边沿点与平面点
+  bool process(const FeatureSweep& sweep, OdometryOutput& output);
+
+  StageTimers& getStageTimers() { return stageTimers; }
+
+  //是否给出投影到扫描结束位置的全部点，没有人需要时跳过全部点的投影
+  void setFullResOutput(bool enabled) { fullResOutput = enabled; }
+
+private:
+  //各阶段的耗时统计
+  enum Stage {
+    STAGE_TREE_BUILD,
+    STAGE_ASSOCIATION,
+    STAGE_SOLVE,
+    STAGE_OUTPUT
+  };
+
+  //进行一次里程计计算
+  bool processSweep(OdometryOutput& output);
+  //将整个点云每step个点取一个投影到扫描结束位置，结果写入新的点云，接收到的点云保持只读
+  void TransformToEnd(const pcl::PointCloud<PointType>& cloudIn, pcl::PointCloud<PointType>& cloudOut,
+                      int step = 1);
+  //去除last点云中的空点
+  void removeNaNLastSweep();
+  //为last点云建立查找对应点用的kd-tree或线号索引
+  void buildLastSweepIndex();
+  void PluginIMURotation(float bcx, float bcy, float bcz, float blx, float bly, float blz,
+                         float alx, float aly, float alz, float &acx, float &acy, float &acz);
+  void AccumulateRotation(float cx, float cy, float cz, float lx, float ly, float lz,
+                          float &ox, float &oy, float &oz);
+  //设置点云的时间戳为当前处理的点云时间
+  void stampCloud(const pcl::PointCloud<PointType>::Ptr& cloud);
+
+  bool systemInited;
+
+  //当前处理的点云时间戳
+  double timeSurfPointsLessFlat;
+
+  //receive sharp points
+  pcl::PointCloud<PointType>::ConstPtr cornerPointsSharp;
+  //receive less sharp points
+  pcl::PointCloud<PointType>::ConstPtr cornerPointsLessSharp;
+  //receive flat points
+  pcl::PointCloud<PointType>::ConstPtr surfPointsFlat;
+  //receive less flat points
+  pcl::PointCloud<PointType>::ConstPtr surfPointsLessFlat;
+  //less sharp points of last frame
+  pcl::PointCloud<PointType>::Ptr laserCloudCornerLast;
+  //less flat points of last frame
+  pcl::PointCloud<PointType>::Ptr laserCloudSurfLast;
+  //保存前一个节点发过来的未经处理过的特征点
+  pcl::PointCloud<PointType>::Ptr laserCloudOri;
+  pcl::PointCloud<PointType>::Ptr coeffSel;
+  //receive all points
+  pcl::PointCloud<PointType>::ConstPtr laserCloudFullRes;
+  //receive imu info
+  pcl::PointCloud<pcl::PointXYZ>::ConstPtr imuTrans;
+  //kd-tree built by less sharp points of last frame
+  pcl::KdTreeFLANN<PointType>::Ptr kdtreeCornerLast;
+  //kd-tree built by less flat points of last frame
+  pcl::KdTreeFLANN<PointType>::Ptr kdtreeSurfLast;
+  //按线号与方位角组织的上一帧特征点索引，scanLineSearch时代替kd-tree
+  bool scanLineSearch;
+  ScanLineIndex scanIndexCornerLast;
+  ScanLineIndex scanIndexSurfLast;
+
+  //L-M迭代次数、时间预算与重新查找对应点的时机
+  SolverBudget solverBudget;
+
+  StageTimers stageTimers;
+
+  int laserCloudCornerLastNum;
+  int laserCloudSurfLastNum;
+
+  //unused
+  int pointSelCornerInd[40000];
+  //save 2 corner points index searched
+  float pointSearchCornerInd1[40000];
+  float pointSearchCornerInd2[40000];
+
+  //unused
+  int pointSelSurfInd[40000];
+  //save 3 surf points index searched
+  float pointSearchSurfInd1[40000];
+  float pointSearchSurfInd2[40000];
+  float pointSearchSurfInd3[40000];
+
+  //当前帧相对上一帧的状态转移量，in the local frame
+  float transform[6] = {0};
+  //当前帧相对于第一帧的状态转移量，in the global frame
+  float transformSum[6] = {0};
+  //由transform得到的扫描周期内各点的插值位姿，每次迭代查找对应点之前更新
+  SweepPoseTable sweepPose;
+
+  //点云第一个点的RPY
+  float imuRollStart = 0, imuPitchStart = 0, imuYawStart = 0;
+  //点云最后一个点的RPY
+  float imuRollLast = 0, imuPitchLast = 0, imuYawLast = 0;
+  //点云最后一个点相对于第一个点由于加减速产生的畸变位移
+  float imuShiftFromStartX = 0, imuShiftFromStartY = 0, imuShiftFromStartZ = 0;
+  //点云最后一个点相对于第一个点由于加减速产生的畸变速度
+  float imuVeloFromStartX = 0, imuVeloFromStartY = 0, imuVeloFromStartZ = 0;
+
+  //特征匹配使用的线程数
+  int numThreads;
+  //每个线程匹配得到的特征点与系数，前numThreads个存放边沿点，后numThreads个存放平面点
+  std::vector<pcl::PointCloud<PointType> > laserCloudOriThread;
+  std::vector<pcl::PointCloud<PointType> > coeffSelThread;
+
+  //退化标志
+  bool isDegenerate;
+  //P矩阵，预测矩阵
+  cv::Mat matP;
+
+  //跳帧数与跳帧计数
+  int skipFrameNum;
+  int frameCount;
+
+  //全部点的输出与抽取间隔
+  bool fullResOutput;
+  int fullResDecimation;
+};
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_LASERODOMETRY_H
@@ -0,0 +1,111 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_LASERODOMETRYNODE_H
+#define LOAM_VELODYNE_LASERODOMETRYNODE_H
+
+#include <memory>
+#include <stdint.h>
+
+#include <loam_velodyne/FeatureFrame.h>
+#include <loam_velodyne/LaserOdometry.h>
+#include <loam_velodyne/StampSynchronizer.h>
+#include <loam_velodyne/TimingPublisher.h>
+#include <nav_msgs/Odometry.h>
+#include <ros/ros.h>
+#include <tf/transform_broadcaster.h>
+
+namespace loam {
+
+//laserOdometry的ROS封装：按时间戳对齐特征点云，发布里程计、tf与发给laserMapping的点云，独立节点与nodelet共用
+class LaserOdometryNode {
+public:
+  LaserOdometryNode();
+
+  //订阅/发布话题
+  bool setup(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+  void laserCloudSharpHandler(const pcl::PointCloud<PointType>::ConstPtr& cornerPointsSharp2);
+  void laserCloudLessSharpHandler(const pcl::PointCloud<PointType>::ConstPtr& cornerPointsLessSharp2);
+  void laserCloudFlatHandler(const pcl::PointCloud<PointType>::ConstPtr& surfPointsFlat2);
+  void laserCloudLessFlatHandler(const pcl::PointCloud<PointType>::ConstPtr& surfPointsLessFlat2);
+  //接收全部点
+  void laserCloudFullResHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudFullRes2);
+  //接收imu消息
+  void imuTransHandler(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr& imuTrans2);
+  //接收合并的特征帧，代替以上六路输入
+  void featureFrameHandler(const loam_velodyne::FeatureFrame::ConstPtr& featureFrame);
+
+private:
+  typedef pcl::PointCloud<PointType>::ConstPtr CloudConstPtr;
+  typedef pcl::PointCloud<pcl::PointXYZ>::ConstPtr ImuTransConstPtr;
+
+  //同一时间戳的六路输入都到齐时调用
+  void synchronizedHandler(const CloudConstPtr& cornerPointsSharp2,
+                           const CloudConstPtr& cornerPointsLessSharp2,
+                           const CloudConstPtr& surfPointsFlat2,
+                           const CloudConstPtr& surfPointsLessFlat2,
+                           const CloudConstPtr& laserCloudFullRes2,
+                           const ImuTransConstPtr& imuTrans2);
+
+  LaserOdometry laserOdometry;
+
+  //按时间戳对齐六路输入
+  StampSynchronizer<CloudConstPtr, CloudConstPtr, CloudConstPtr, CloudConstPtr,
+                    CloudConstPtr, ImuTransConstPtr> inputSynchronizer;
+  //上次报告时的丢帧数
+  uint64_t reportedDroppedFrames;
+
+  nav_msgs::Odometry laserOdometryMsg;
+  //setup时创建，没有ROS master时不能构造
+  std::unique_ptr<tf::TransformBroadcaster> tfBroadcaster;
+  tf::StampedTransform laserOdometryTrans;
+
+  ros::Subscriber subCornerPointsSharp;
+  ros::Subscriber subCornerPointsLessSharp;
+  ros::Subscriber subSurfPointsFlat;
+  ros::Subscriber subSurfPointsLessFlat;
+  ros::Subscriber subLaserCloudFullRes;
+  ros::Subscriber subImuTrans;
+  ros::Subscriber subFeatureFrame;
+
+  ros::Publisher pubLaserCloudCornerLast;
+  ros::Publisher pubLaserCloudSurfLast;
+  ros::Publisher pubLaserCloudFullRes;
+  ros::Publisher pubLaserOdometry;
+
+  TimingPublisher timingPublisher;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_LASERODOMETRYNODE_H
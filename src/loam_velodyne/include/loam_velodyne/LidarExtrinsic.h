@@ -0,0 +1,67 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_LIDAREXTRINSIC_H
+#define LOAM_VELODYNE_LIDAREXTRINSIC_H
+
+#include <Eigen/Core>
+#include <loam_velodyne/common.h>
+#include <pcl/point_cloud.h>
+
+namespace loam {
+
+//雷达之间的外参：把一个雷达的点转换到主雷达坐标系下，两者都是scanRegistration交换坐标轴之后的
+//z轴向前,x轴向左,y轴向上的坐标系
+class LidarExtrinsic {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  LidarExtrinsic();
+
+  //(x, y, z, roll, pitch, yaw)：雷达在主雷达的x轴向前,y轴向左,z轴向上的坐标系下的位置(米)与姿态(弧度)，
+  //R = Rz(yaw)*Ry(pitch)*Rx(roll)，与URDF/tf的约定相同
+  void set(const double extrinsic[6]);
+
+  bool isIdentity() const { return identity; }
+
+  //结果写入cloudOut，可以与cloudIn相同
+  void transformCloud(const pcl::PointCloud<PointType>& cloudIn, pcl::PointCloud<PointType>& cloudOut) const;
+
+private:
+  bool identity;
+  Eigen::Matrix3f rotation;
+  Eigen::Vector3f translation;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_LIDAREXTRINSIC_H
@@ -0,0 +1,128 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_MAPFILE_H
+#define LOAM_VELODYNE_MAPFILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <loam_velodyne/CubeMap.h>
+
+namespace loam {
+
+/******************************读前须知*****************************************/
+/*地图文件：文件头之后每个cube一个数据块(边沿点 + 平面点)，文件末尾是cube坐标到数据块的索引表。
+  写入时逐个cube写出，不需要把整个地图放在内存中；读取时整个文件映射到内存，只解析索引表，
+  cube在第一次用到时才解码。点保存为x, y, z, intensity四个float，或者以cube中心为原点
+  量化为16位整数(精度约为cubeSize / 65536)，intensity量化为1/256
+*******************************************************************************/
+
+//地图文件中一个cube的数据块
+struct MapChunk {
+  CubeIndex index;
+  uint32_t pointNum[MapCube::FEATURE_NUM];
+  //有未下采样的点，读回之后需要重新对整个cube下采样
+  bool filterDirty[MapCube::FEATURE_NUM];
+  //数据块在文件中的位置
+  uint64_t offset;
+};
+
+//逐个cube写入地图文件，全部写完之后调用close写入索引表。
+//写入过程中使用临时文件fileName.tmp，close成功后才替换fileName，原来的文件(如正在使用的先验地图)
+//在此之前不受影响，已映射的内存在替换之后仍然有效；没有close成功时删除临时文件
+class MapFileWriter {
+public:
+  MapFileWriter();
+  ~MapFileWriter();
+  MapFileWriter(const MapFileWriter&) = delete;
+  MapFileWriter& operator=(const MapFileWriter&) = delete;
+
+  bool open(const std::string& fileName, float cubeSize, bool quantize);
+  //写入一个cube的点，cube的点需要在cube的范围内
+  bool write(const CubeIndex& index, const MapCube& cube);
+  bool close();
+
+  //已写入的cube数
+  size_t size() const { return chunks.size(); }
+
+private:
+  //关闭并删除没有写完的临时文件
+  void discard();
+
+  std::ofstream file;
+  std::string fileName;
+  std::string tempFileName;
+  float cubeSize;
+  bool quantize;
+  uint64_t offset;
+  std::vector<MapChunk> chunks;
+};
+
+//只读地图文件，打开时映射到内存并读取索引表
+class MapFileReader {
+public:
+  typedef std::unordered_map<CubeIndex, MapChunk, CubeIndexHash> ChunkTable;
+
+  MapFileReader();
+  ~MapFileReader();
+  //映射的内存只由一个对象持有
+  MapFileReader(const MapFileReader&) = delete;
+  MapFileReader& operator=(const MapFileReader&) = delete;
+
+  bool open(const std::string& fileName);
+  void close();
+
+  float getCubeSize() const { return cubeSize; }
+  bool isQuantized() const { return quantized; }
+  //文件中的cube数
+  size_t size() const { return chunks.size(); }
+  const ChunkTable& getChunks() const { return chunks; }
+
+  //解码一个cube的点，不存在时返回false
+  bool read(const CubeIndex& index, MapCube& cube) const;
+
+private:
+  const uint8_t* data;
+  size_t dataSize;
+  float cubeSize;
+  bool quantized;
+  ChunkTable chunks;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_MAPFILE_H
@@ -0,0 +1,166 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_MULTILIDARFRONTEND_H
+#define LOAM_VELODYNE_MULTILIDARFRONTEND_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+#include <loam_velodyne/BoundedQueue.h>
+#include <loam_velodyne/LaserOdometry.h>
+#include <loam_velodyne/LidarExtrinsic.h>
+#include <loam_velodyne/ScanRegistration.h>
+
+namespace loam {
+
+//一个雷达的前端参数
+struct LidarFrontEndParams {
+  LidarFrontEndParams() : extrinsic{0} {}
+
+  ScanRegistrationParams scanRegistration;
+  LaserOdometryParams laserOdometry;
+  //相对于主雷达的外参(x, y, z, roll, pitch, yaw)，主雷达的外参不使用
+  double extrinsic[6];
+};
+
+//多雷达前端的参数
+struct MultiLidarParams {
+  MultiLidarParams()
+    : mergeWindow(0.05),
+      cloudQueueSize(2) {}
+
+  //第一个为主雷达，位姿与发给laserMapping的频率都以主雷达为准
+  std::vector<LidarFrontEndParams> lidars;
+  //其他雷达的特征点与主雷达的帧的时间差不超过mergeWindow(秒)时合并，否则这一帧不合并该雷达
+  double mergeWindow;
+  //每个雷达等待处理的点云帧数，满时丢弃最旧的帧
+  int cloudQueueSize;
+};
+
+//多雷达前端：每个雷达在独立的线程中运行scanRegistration与laserOdometry，
+//其他雷达的特征点按外参转换到主雷达坐标系，与主雷达同一时间窗口内的帧合并之后交给laserMapping，
+//一个mapper与一份地图服务所有雷达
+class MultiLidarFrontEnd {
+public:
+  typedef std::function<void(const OdometryOutput&)> OutputCallback;
+  typedef std::function<void(size_t lidar)> FrameCallback;
+
+  MultiLidarFrontEnd();
+  ~MultiLidarFrontEnd();
+
+  //主雷达每估计出一个位姿时调用，不带点云，在主雷达的线程中调用
+  void setOdometryCallback(const OutputCallback& callback) { odometryCallback = callback; }
+  //合并之后的特征点与全部点，时间与位姿为主雷达的帧，可能在任一雷达的线程中调用，调用之间互斥
+  void setFeatureCallback(const OutputCallback& callback) { featureCallback = callback; }
+  //每个雷达处理完一帧之后在该雷达的线程中调用，可以在其中读取这个雷达的耗时统计
+  void setFrameCallback(const FrameCallback& callback) { frameCallback = callback; }
+
+  //按参数初始化并启动各雷达的线程，回调需在此之前设置
+  bool configure(const MultiLidarParams& params);
+
+  size_t lidarNum() const { return frontEnds.size(); }
+
+  //把一帧点云交给第lidar个雷达的线程，不会阻塞
+  void processCloud(size_t lidar, const std::shared_ptr<const RawSweep>& cloud);
+  //IMU只用于主雷达，与其安装在一起
+  void processImu(const ImuSample& imu);
+  //是否给出合并之后的全部点，各雷达的线程在处理下一帧时生效
+  void setFullResOutput(bool enabled) { fullResOutput = enabled; }
+
+  //转换第lidar个雷达的消息时使用
+  const ScanRegistration& getScanRegistration(size_t lidar) const { return frontEnds[lidar]->scanRegistration; }
+  StageTimers& getScanRegistrationTimers(size_t lidar) { return frontEnds[lidar]->scanRegistration.getStageTimers(); }
+  StageTimers& getOdometryTimers(size_t lidar) { return frontEnds[lidar]->laserOdometry.getStageTimers(); }
+
+  //队列满时丢弃的点云帧数
+  uint64_t getDroppedClouds() const { return droppedClouds.load(); }
+  //主雷达的帧没有合并到某个雷达的特征点的次数
+  uint64_t getUnmergedFrames() const { return unmergedFrames.load(); }
+
+private:
+  struct FrontEnd {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    FrontEnd() : cloudQueue(2), imuQueue(256) {}
+
+    ScanRegistration scanRegistration;
+    LaserOdometry laserOdometry;
+    LidarExtrinsic extrinsic;
+
+    BoundedQueue<std::shared_ptr<const RawSweep> > cloudQueue;
+    //只有主雷达使用，在处理点云之前按顺序交给scanRegistration
+    BoundedQueue<ImuSample> imuQueue;
+    std::thread thread;
+    //只用于线程等待新的点云
+    std::mutex cloudMutex;
+    std::condition_variable cloudCondition;
+  };
+
+  //一个雷达的处理线程
+  void frontEndLoop(size_t lidar);
+  void processFrame(size_t lidar, const RawSweep& cloud);
+  //把主雷达的帧与其他雷达的特征点合并，各雷达都已处理到该帧的时间或等待的帧太多时交出，调用时需持有mergeMutex
+  void releaseMerged();
+  void stopThreads();
+
+  std::vector<std::unique_ptr<FrontEnd> > frontEnds;
+  std::atomic<bool> threadStop;
+  std::atomic<uint64_t> droppedClouds;
+  std::atomic<uint64_t> unmergedFrames;
+  std::atomic<bool> fullResOutput;
+  double mergeWindow;
+
+  //合并状态，在各雷达的线程之间共享
+  std::mutex mergeMutex;
+  //主雷达等待合并的帧
+  std::deque<OdometryOutput> pendingFrames;
+  //其他雷达转换到主雷达坐标系之后的特征点，以及最近处理的一帧的时间
+  std::vector<std::deque<OdometryOutput> > lidarFrames;
+  std::vector<double> lidarLatestTime;
+
+  OutputCallback odometryCallback;
+  OutputCallback featureCallback;
+  FrameCallback frameCallback;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_MULTILIDARFRONTEND_H
@@ -0,0 +1,90 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_MULTILIDARNODE_H
+#define LOAM_VELODYNE_MULTILIDARNODE_H
+
+#include <memory>
+#include <vector>
+
+#include <loam_velodyne/MultiLidarFrontEnd.h>
+#include <loam_velodyne/TimingPublisher.h>
+#include <nav_msgs/Odometry.h>
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf/transform_broadcaster.h>
+
+namespace loam {
+
+//多雷达前端的ROS封装：订阅~lidarTopics中的各路点云，代替scanRegistration与laserOdometry，
+//以相同的话题发布主雷达的里程计与合并之后的特征点，laserMapping与transformMaintenance不需要改动
+class MultiLidarNode {
+public:
+  MultiLidarNode();
+
+  //订阅/发布话题
+  bool setup(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+  //接收第lidar个雷达的点云
+  void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg, size_t lidar);
+  //接收imu消息
+  void imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn);
+
+private:
+  void publishOdometry(const OdometryOutput& output);
+  void publishFeatures(const OdometryOutput& output);
+  void publishTimings(size_t lidar);
+
+  MultiLidarFrontEnd frontEnd;
+
+  nav_msgs::Odometry laserOdometryMsg;
+  //setup时创建，没有ROS master时不能构造
+  std::unique_ptr<tf::TransformBroadcaster> tfBroadcaster;
+  tf::StampedTransform laserOdometryTrans;
+
+  std::vector<ros::Subscriber> subLaserClouds;
+  ros::Subscriber subImu;
+
+  ros::Publisher pubLaserCloudCornerLast;
+  ros::Publisher pubLaserCloudSurfLast;
+  ros::Publisher pubLaserCloudFullRes;
+  ros::Publisher pubLaserOdometry;
+
+  //每个雷达的特征提取与里程计各一个，只在该雷达的线程中使用
+  std::vector<TimingPublisher> scanTimingPublishers;
+  std::vector<TimingPublisher> odometryTimingPublishers;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_MULTILIDARNODE_H
@@ -0,0 +1,80 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SCANLINEINDEX_H
+#define LOAM_VELODYNE_SCANLINEINDEX_H
+
+#include <vector>
+
+#include <loam_velodyne/common.h>
+#include <pcl/point_cloud.h>
+
+namespace loam {
+
+//按线号与方位角组织的点云索引，代替laserOdometry中的kd-tree查找对应点
+//点的intensity整数部分为线号，每条线上的点按方位角(绕camera坐标系y轴)排序，
+//查找时在目标线上二分定位方位角，再向两侧扩展，直到方位角之差决定的距离下界超过当前最近距离
+class ScanLineIndex {
+public:
+  ScanLineIndex();
+
+  //建立索引，只保存cloud的共享指针，cloud在使用期间不能修改
+  void setInputCloud(const pcl::PointCloud<PointType>::ConstPtr& cloud);
+
+  //所有线上距离point最近的点，平方距离小于maxSqDis时返回true
+  bool nearest(const PointType& point, float maxSqDis, int& pointInd, float& pointSqDis) const;
+
+  //第scanId条线上距离point最近的点(跳过excludeInd)，平方距离小于maxSqDis时返回true
+  bool nearestOnScan(int scanId, const PointType& point, float maxSqDis, int excludeInd,
+                     int& pointInd, float& pointSqDis) const;
+
+  //边沿点的对应点：最近点A，以及线号与A相差不超过2的其它线上距离最近的点B，未找到时为-1
+  void findLineCorrespondence(const PointType& point, float maxSqDis, int& closestPointInd, int& minPointInd2) const;
+
+  //平面点的对应点：最近点A，A所在线上的另一个最近点B，以及线号与A相差不超过2的其它线上距离最近的点C，未找到时为-1
+  void findPlaneCorrespondence(const PointType& point, float maxSqDis,
+                               int& closestPointInd, int& minPointInd2, int& minPointInd3) const;
+
+  int getScanNum() const { return int(scanStart.size()) - 1; }
+
+private:
+  pcl::PointCloud<PointType>::ConstPtr cloud;
+
+  //第i条线的点为序号scanStart[i]到scanStart[i + 1]之间的元素，按方位角从小到大排列
+  std::vector<int> scanStart;
+  std::vector<float> azimuths;
+  std::vector<int> pointIndices;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_SCANLINEINDEX_H
@@ -0,0 +1,229 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SCANREGISTRATION_H
+#define LOAM_VELODYNE_SCANREGISTRATION_H
+
+#include <string>
+#include <vector>
+
+#include <loam_velodyne/CloudPool.h>
+#include <loam_velodyne/ImuRingBuffer.h>
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/feature_selection.h>
+#include <loam_velodyne/imu_integration.h>
+#include <loam_velodyne/SensorModel.h>
+#include <loam_velodyne/StageTimers.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/filters/voxel_grid.h>
+
+namespace loam {
+
+//特征提取的参数
+struct ScanRegistrationParams {
+  ScanRegistrationParams()
+    : sensorModel("VLP-16"),
+      useRingField(true),
+      useTimeField(true),
+      indexRelativeTime(false) {}
+
+  //激光雷达型号：VLP-16, HDL-32, HDL-64, OS1-64, OS1-128
+  std::string sensorModel;
+  //标定得到的每条激光线的仰角(度)，非空时代替型号的标称值
+  std::vector<float> ringElevations;
+  //点云带有驱动给出的ring/time字段时，直接使用其确定线号与点的相对时间。
+  //没有time字段时(如VLP-16的默认驱动)仍需对每个点计算方位角(atan2)，除非设置indexRelativeTime
+  bool useRingField;
+  bool useTimeField;
+  //没有time字段时按点在其扫描线中的位置(线内点序 / 该线的点数)估计相对时间，不再逐点计算方位角，
+  //要求驱动按发射顺序输出每条线上的点。默认按方位角计算，与原来的结果一致
+  bool indexRelativeTime;
+};
+
+//一帧输入的点云，由节点从驱动的消息转换得到(见ros_conversions.h)
+struct RawSweep {
+  RawSweep() : time(0), stamp(0) {}
+
+  //点云时间戳(秒)，以及对应的pcl时间戳(微秒)
+  double time;
+  uint64_t stamp;
+  //已移除空点的点云，雷达坐标系
+  pcl::PointCloud<pcl::PointXYZ> points;
+  //驱动给出的每个点的线号与时间字段(未换算单位)，消息中没有该字段或不使用时为空
+  std::vector<int> rings;
+  std::vector<double> times;
+};
+
+//一帧点云的特征提取结果，与各特征话题的内容相同
+struct FeatureSweep {
+  FeatureSweep() : time(0) {}
+
+  //点云时间戳(秒，pcl时间戳的微秒精度)
+  double time;
+  pcl::PointCloud<PointType>::ConstPtr fullRes;
+  pcl::PointCloud<PointType>::ConstPtr cornerSharp;
+  pcl::PointCloud<PointType>::ConstPtr cornerLessSharp;
+  pcl::PointCloud<PointType>::ConstPtr surfFlat;
+  pcl::PointCloud<PointType>::ConstPtr surfLessFlat;
+  //起始点与最后一个点的欧拉角，最后一个点相对于第一个点的畸变位移和速度
+  pcl::PointCloud<pcl::PointXYZ>::ConstPtr imuTrans;
+};
+
+//点云特征提取：按线号整理点云，计算曲率，挑选边沿点与平面点，并利用IMU去除非匀速运动畸变
+//不涉及话题的订阅与发布，节点与nodelet由ScanRegistrationNode封装
+class ScanRegistration {
+public:
+  ScanRegistration();
+
+  //按参数初始化
+  bool configure(const ScanRegistrationParams& params);
+
+  //处理一帧点云，velodyne雷达坐标系安装为x轴向前，y轴向左，z轴向上的右手坐标系
+  //丢弃的初始帧与没有有效点的帧返回false
+  bool process(const RawSweep& laserCloudIn, FeatureSweep& sweep);
+
+  //处理一个IMU测量
+  void processImu(const ImuSample& imu);
+
+  //转换消息时需要读取的线号与时间字段，不使用时为空
+  std::string getRingField() const { return useRingField ? "ring" : ""; }
+  std::string getTimeField() const { return useTimeField ? sensorModel.getTimeField() : ""; }
+  const SensorModel& getSensorModel() const { return sensorModel; }
+
+  StageTimers& getStageTimers() { return stageTimers; }
+
+private:
+  //各阶段的耗时统计
+  enum Stage {
+    STAGE_RING_SPLIT,
+    STAGE_CURVATURE,
+    STAGE_SELECTION,
+    STAGE_DOWNSAMPLE,
+    STAGE_OUTPUT
+  };
+
+  //一帧点云的特征提取
+  bool processSweep(const RawSweep& laserCloudIn, FeatureSweep& sweep);
+  void ShiftToStartIMU(float pointTime);
+  void VeloToStartIMU();
+  void TransformToStartIMU(PointType *p);
+  void AccumulateIMUShift(ImuState& imu);
+  void reserveCloudBuffers(size_t size);
+  pcl::PointCloud<pcl::PointXYZ>::Ptr makeImuTrans(uint64_t cloudStamp);
+  float relativeTimeOf(const PointType& point, float startOri, float endOri, bool& halfPassed);
+
+  //imu循环队列长度
+  static const int imuQueLength = 200;
+
+  //初始化控制变量
+  int systemInitCount;
+  bool systemInited;
+
+  //激光雷达型号，决定线数与线号的计算方式
+  SensorModel sensorModel;
+  //是否使用驱动给出的ring/time字段
+  bool useRingField;
+  bool useTimeField;
+  bool indexRelativeTime;
+
+  //以下点云缓存按一帧点云中点的最大数量扩容
+  //点云曲率
+  std::vector<float> cloudCurvature;
+  //曲率点对应的序号
+  std::vector<int> cloudSortInd;
+  //按x, y, z分开存放的点云(SoA)
+  std::vector<float> cloudX;
+  std::vector<float> cloudY;
+  std::vector<float> cloudZ;
+  //点深度的平方与深度
+  std::vector<float> cloudRangeSq;
+  std::vector<float> cloudRange;
+  //与后一个点距离的平方
+  std::vector<float> cloudGapSq;
+  //点是否筛选过标志：0-未筛选过，1-筛选过
+  std::vector<int> cloudNeighborPicked;
+  //点分类标号:2-代表曲率很大，1-代表曲率比较大,-1-代表曲率很小，0-曲率比较小(其中1包含了2,0包含了1,0和1构成了点云全部的点)
+  std::vector<int> cloudLabel;
+  //一个分段挑选出的特征点，每个分段复用
+  SegmentFeatures segmentFeatures;
+  //按点序估计相对时间时，预先确定的每个输入点的线号，每条线的点数以及已处理的点数
+  std::vector<int> cloudScanIds;
+  std::vector<int> ringPointNum;
+  std::vector<int> ringPointInd;
+
+  //每帧复用的缓存
+  //矫正后按原始顺序暂存的点及其线号
+  pcl::PointCloud<PointType> sweepPoints;
+  std::vector<int> sweepScanIds;
+  //每条线的点数，以及按线号写入整帧点云时每条线的写入位置
+  std::vector<int> scanPointNum;
+  std::vector<int> scanWriteInd;
+  //每个scan有曲率的点的开始和结束索引
+  std::vector<int> scanStartInd;
+  std::vector<int> scanEndInd;
+  //一条线上的less flat点及其下采样结果
+  pcl::PointCloud<PointType>::Ptr surfPointsLessFlatScan;
+  pcl::PointCloud<PointType> surfPointsLessFlatScanDS;
+  pcl::VoxelGrid<PointType> downSizeFilter;
+  //发布的点云，订阅者释放之后复用
+  CloudPool<PointType> laserCloudPool;
+  CloudPool<PointType> featureCloudPool;
+  CloudPool<pcl::PointXYZ> imuTransPool;
+
+  //imu时间戳大于当前点云时间戳的测量的序号，下一个点从这里开始查找
+  uint64_t imuPointerFront;
+
+  //点云数据开始第一个点的位移/速度/欧拉角
+  float imuRollStart = 0, imuPitchStart = 0, imuYawStart = 0;
+  float imuRollCur = 0, imuPitchCur = 0, imuYawCur = 0;
+
+  float imuVeloXStart = 0, imuVeloYStart = 0, imuVeloZStart = 0;
+  float imuShiftXStart = 0, imuShiftYStart = 0, imuShiftZStart = 0;
+
+  //当前点的速度，位移信息
+  float imuVeloXCur = 0, imuVeloYCur = 0, imuVeloZCur = 0;
+  float imuShiftXCur = 0, imuShiftYCur = 0, imuShiftZCur = 0;
+
+  //每次点云数据当前点相对于开始第一个点的畸变位移，速度
+  float imuShiftFromStartXCur = 0, imuShiftFromStartYCur = 0, imuShiftFromStartZCur = 0;
+  float imuVeloFromStartXCur = 0, imuVeloFromStartYCur = 0, imuVeloFromStartZCur = 0;
+
+  //IMU信息，IMU回调写入，处理点云时按时间查找
+  ImuRingBuffer<ImuState> imuBuffer;
+
+  StageTimers stageTimers;
+};
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_SCANREGISTRATION_H
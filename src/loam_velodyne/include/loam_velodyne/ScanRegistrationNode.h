@@ -0,0 +1,87 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SCANREGISTRATIONNODE_H
+#define LOAM_VELODYNE_SCANREGISTRATIONNODE_H
+
+#include <vector>
+
+#include <loam_velodyne/ScanRegistration.h>
+#include <loam_velodyne/TimingPublisher.h>
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/PointCloud2.h>
+
+namespace loam {
+
+//scanRegistration的ROS封装：订阅点云与IMU，发布特征点云或合并的特征帧，独立节点与nodelet共用
+class ScanRegistrationNode {
+public:
+  //订阅/发布话题
+  bool setup(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+  //接收点云数据
+  void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg);
+  //接收imu消息
+  void imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn);
+
+private:
+  //把五类点集与IMU状态作为一条消息发布
+  void publishFeatureFrame(const FeatureSweep& sweep);
+
+  ScanRegistration scanRegistration;
+
+  //由消息转换得到的点云，以及移除空点后每个点在原始消息中的序号，每帧复用
+  RawSweep laserCloudIn;
+  std::vector<int> laserCloudInIndices;
+
+  //按~featureOutput发布分开的特征点云、合并的特征帧或两者
+  bool publishClouds;
+  bool publishFrame;
+
+  ros::Subscriber subLaserCloud;
+  ros::Subscriber subImu;
+
+  ros::Publisher pubLaserCloud;
+  ros::Publisher pubCornerPointsSharp;
+  ros::Publisher pubCornerPointsLessSharp;
+  ros::Publisher pubSurfPointsFlat;
+  ros::Publisher pubSurfPointsLessFlat;
+  ros::Publisher pubImuTrans;
+  ros::Publisher pubFeatureFrame;
+
+  TimingPublisher timingPublisher;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_SCANREGISTRATIONNODE_H
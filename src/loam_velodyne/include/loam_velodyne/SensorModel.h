@@ -0,0 +1,92 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SENSORMODEL_H
+#define LOAM_VELODYNE_SENSORMODEL_H
+
+#include <string>
+#include <vector>
+
+namespace loam {
+
+//多线激光雷达的模型：每条激光线的仰角、线号的排列方式以及驱动提供的逐点字段
+//由仰角预先计算线与线之间的分界，查表确定线号，不再对每个点计算atan/sqrt
+class SensorModel {
+public:
+  //默认为VLP-16
+  SensorModel();
+
+  //按名称设置："VLP-16", "HDL-32", "HDL-64", "OS1-64", "OS1-128"，名称未知时返回false
+  bool setModel(const std::string& modelName);
+  //直接给出每条激光线的仰角(度，任意顺序)，线号按仰角从小到大排列
+  bool setElevations(const std::vector<float>& ringElevations);
+
+  const std::string& getName() const { return name; }
+  int numRings() const { return int(elevations.size()); }
+  //一帧点云中点的数量上限(估计值)，用于预先分配缓存
+  int maxPointsPerSweep() const { return numRings() * pointsPerRing; }
+
+  //由点坐标(z轴向前，x轴向左，y轴向上)确定线号，超出视场范围时返回-1
+  int scanIdOf(float x, float y, float z) const;
+  //由驱动给出的ring字段确定线号，超出范围时返回-1
+  int scanIdOfRing(int ring) const;
+
+  //驱动逐点时间字段的名称，以及换算成秒的比例
+  const std::string& getTimeField() const { return timeField; }
+  double getTimeScale() const { return timeScale; }
+
+private:
+  //由仰角重新计算分界与线号映射
+  void buildTables();
+
+  std::string name;
+  //按从小到大排列的仰角(度)
+  std::vector<float> elevations;
+  //相邻两条线之间的分界以及视场上下界(共numRings + 1个)，保存tan值的符号与平方
+  std::vector<float> boundaryTanSq;
+  std::vector<bool> boundaryNegative;
+  //按仰角排列的线序到线号的映射
+  std::vector<int> scanIds;
+  //VLP-16的线号沿用原来的交错排列(-15度为0，1度为1，-13度为2...)，与驱动的laser id一致
+  bool legacyInterleave;
+  //驱动的ring字段是否从最上面的一条线开始编号(Ouster)
+  bool ringTopDown;
+  //10Hz时每条线一周的点数
+  int pointsPerRing;
+
+  std::string timeField;
+  double timeScale;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_SENSORMODEL_H
@@ -0,0 +1,99 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SOLVERBUDGET_H
+#define LOAM_VELODYNE_SOLVERBUDGET_H
+
+#include <chrono>
+
+namespace loam {
+
+//一帧位姿优化结束的原因
+enum SolverStopReason {
+  SOLVER_NOT_RUN,        //特征点不足，没有优化
+  SOLVER_CONVERGED,      //调整量小于阈值
+  SOLVER_MAX_ITERATIONS, //达到最大迭代次数
+  SOLVER_DEADLINE,       //超过一帧的时间预算
+  SOLVER_TOO_FEW_POINTS  //沿用上次的匹配时有效的特征点不足，继续迭代不会有变化
+};
+
+const char* solverStopReasonName(SolverStopReason reason);
+
+//一帧位姿优化的统计
+struct SolverReport {
+  int iterations;
+  int associations;
+  SolverStopReason reason;
+  double elapsed;
+};
+
+//laserOdometry与laserMapping的L-M迭代预算：最大迭代次数、每帧的时间预算，以及何时重新查找对应点
+//默认每reassociateInterval次迭代重新查找一次；给出位姿变化阈值后改为只在位姿相对上次查找时的变化超过阈值时重新查找
+class SolverBudget {
+public:
+  SolverBudget(int maxIterations, int reassociateInterval);
+
+  void setMaxIterations(int iterations) { maxIterations = iterations; }
+  int getMaxIterations() const { return maxIterations; }
+  //每帧的时间预算(秒)，小于等于0时不限制
+  void setTimeBudget(double seconds) { timeBudget = seconds; }
+  //重新查找对应点的位姿变化阈值(度、米)，都小于等于0时按固定的间隔查找
+  void setReassociateThreshold(float rotation, float translation);
+  bool adaptiveReassociation() const { return reassociateRotation > 0 || reassociateTranslation > 0; }
+
+  //一帧开始优化时调用，开始计时
+  void start();
+  //第iterCount次迭代是否需要重新查找对应点，transform为当前位姿(rx, ry, rz, tx, ty, tz)
+  bool needReassociate(int iterCount, const float transform[6]);
+  //已超过时间预算
+  bool deadlineReached() const;
+  //一帧优化结束时调用，记录迭代次数与结束原因
+  void finish(int iterations, SolverStopReason reason);
+
+  const SolverReport& getReport() const { return report; }
+
+private:
+  int maxIterations;
+  int reassociateInterval;
+  double timeBudget;
+  float reassociateRotation;
+  float reassociateTranslation;
+
+  //上次查找对应点时的位姿
+  float associatedTransform[6];
+  std::chrono::steady_clock::time_point startTime;
+  SolverReport report;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_SOLVERBUDGET_H
@@ -0,0 +1,117 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_STAGETIMERS_H
+#define LOAM_VELODYNE_STAGETIMERS_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <initializer_list>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace loam {
+
+//耗时的对数直方图：1微秒到约16秒，每个2倍区间分4个桶，记录只做一次原子加，可在其它线程读取
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+
+  void record(double seconds);
+  void reset();
+
+  uint64_t count() const { return pointNum.load(std::memory_order_relaxed); }
+  //分位数(0~1)，取所在桶的上界，相对误差不超过19%
+  double percentile(double quantile) const;
+  double max() const;
+  double mean() const;
+
+private:
+  static const int bucketNum = 97;
+
+  std::atomic<uint64_t> buckets[bucketNum];
+  std::atomic<uint64_t> pointNum;
+  std::atomic<uint64_t> sumNanoseconds;
+  std::atomic<uint64_t> maxNanoseconds;
+};
+
+//一个处理流程中各阶段的耗时统计：一帧内同一阶段的耗时先累加，finishFrame时记入直方图
+//除直方图外只应在一个线程中使用
+class StageTimers {
+public:
+  explicit StageTimers(std::initializer_list<const char*> stageNames);
+
+  //累加本帧第stage阶段的耗时
+  void add(int stage, double seconds);
+  //本帧结束，把本帧各阶段的累计耗时记入直方图
+  void finishFrame();
+  //不按帧累计，直接记入直方图(例如端到端延迟)
+  void record(int stage, double seconds) { histograms[stage].record(seconds); }
+
+  size_t stageNum() const { return names.size(); }
+  const std::string& stageName(int stage) const { return names[stage]; }
+  const LatencyHistogram& histogram(int stage) const { return histograms[stage]; }
+  void resetHistograms();
+
+  //每个阶段的p50/p99/max(毫秒)与帧数
+  std::string summary() const;
+
+private:
+  std::vector<std::string> names;
+  std::deque<LatencyHistogram> histograms;
+  std::vector<double> frameSeconds;
+  std::vector<char> frameTouched;
+};
+
+//作用域计时：构造时开始计时第stage阶段，next切换到下一个阶段，析构或stop时把耗时累加到StageTimers
+class ScopedTimer {
+public:
+  ScopedTimer(StageTimers& timers, int stage);
+  ~ScopedTimer() { stop(); }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  void next(int stage);
+  void stop();
+
+private:
+  StageTimers& timers;
+  int stage;
+  std::chrono::steady_clock::time_point startTime;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_STAGETIMERS_H
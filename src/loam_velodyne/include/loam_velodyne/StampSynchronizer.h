@@ -0,0 +1,169 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_STAMPSYNCHRONIZER_H
+#define LOAM_VELODYNE_STAMPSYNCHRONIZER_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <stdint.h>
+#include <tuple>
+#include <utility>
+
+#include <ros/time.h>
+
+namespace loam {
+
+//消息时间戳截断到微秒作为对齐的键，与pcl_conversions::toPCL及点云的pcl时间戳(pclStampFromSec)一致。
+//不能四舍五入：时间经过toSec()/fromSec()往返后可能比原来的微秒略小，点云一侧截断为前一微秒，
+//两侧用同一种取整才能对齐
+inline uint64_t stampKeyOf(const ros::Time& stamp)
+{
+  return stamp.toNSec() / 1000;
+}
+
+//按时间戳精确对齐多路消息：每个时间戳一个槽位，某个时间戳的消息全部到齐时在最后一条消息的回调中立即处理，
+//不需要轮询。比它更早的、没有到齐的槽位不会再到齐，直接丢弃并计数；槽位超过queueSize时丢弃最早的。
+//只有收到了dropChannels中某一路消息的槽位丢弃时才计数，其他路可以比这些路更频繁(如每帧都有的里程计)。
+//同一路的消息按时间戳递增到达，各路之间的顺序任意。不加锁，所有add需要在同一个回调队列中调用
+template <typename... Messages>
+class StampSynchronizer {
+public:
+  typedef std::function<void(const Messages&...)> Callback;
+  typedef std::tuple<Messages...> MessageTuple;
+
+  explicit StampSynchronizer(size_t size = 4)
+    : queueSize(size), dropChannels(allReceived), lastMatchedStamp(0), matchedCount(0), droppedCount(0)
+  {
+  }
+
+  void setQueueSize(size_t size) { queueSize = size < 1 ? 1 : size; }
+  //第I路对应第I位，默认为所有路
+  void setDropChannels(unsigned channels) { dropChannels = channels & allReceived; }
+  void registerCallback(const Callback& cb) { callback = cb; }
+
+  //第I路收到时间戳为stamp的消息
+  template <size_t I>
+  void add(uint64_t stamp, const typename std::tuple_element<I, MessageTuple>::type& message)
+  {
+    //已经处理过或丢弃过的时间戳，迟到的消息无法再对齐
+    if (matchedCount > 0 && stamp <= lastMatchedStamp) {
+      if (dropChannels & (1u << I)) {
+        droppedCount++;
+      }
+      return;
+    }
+
+    typename std::deque<Slot>::iterator slot = slots.begin();
+    while (slot != slots.end() && slot->stamp < stamp) {
+      ++slot;
+    }
+    if (slot == slots.end() || slot->stamp != stamp) {
+      slot = slots.insert(slot, Slot(stamp));
+      if (slots.size() > queueSize) {
+        bool oldest = slot == slots.begin();
+        //新建的槽位还没有收到消息，按这条消息计数
+        unsigned received = oldest ? 1u << I : slots.front().received;
+        slots.pop_front();
+        if (received & dropChannels) {
+          droppedCount++;
+        }
+        if (oldest) {
+          return;
+        }
+      }
+    }
+
+    std::get<I>(slot->messages) = message;
+    slot->received |= 1u << I;
+    if (slot->received == allReceived) {
+      fire(slot);
+    }
+  }
+
+  //对齐成功的帧数
+  uint64_t getMatchedCount() const { return matchedCount.load(); }
+  //没有对齐而丢弃的帧数
+  uint64_t getDroppedCount() const { return droppedCount.load(); }
+
+private:
+  static_assert(sizeof...(Messages) < 32, "too many synchronized channels");
+  static const unsigned allReceived = (1u << sizeof...(Messages)) - 1;
+
+  struct Slot {
+    explicit Slot(uint64_t stampIn) : stamp(stampIn), received(0) {}
+
+    uint64_t stamp;
+    MessageTuple messages;
+    unsigned received;
+  };
+
+  void fire(typename std::deque<Slot>::iterator slot)
+  {
+    //先移出槽位再回调，回调中可以继续add
+    MessageTuple messages;
+    messages.swap(slot->messages);
+    lastMatchedStamp = slot->stamp;
+    for (typename std::deque<Slot>::iterator it = slots.begin(); it != slot; ++it) {
+      if (it->received & dropChannels) {
+        droppedCount++;
+      }
+    }
+    slots.erase(slots.begin(), slot + 1);
+    matchedCount++;
+
+    if (callback) {
+      invoke(messages, std::index_sequence_for<Messages...>());
+    }
+  }
+
+  template <size_t... Is>
+  void invoke(const MessageTuple& messages, std::index_sequence<Is...>)
+  {
+    callback(std::get<Is>(messages)...);
+  }
+
+  size_t queueSize;
+  unsigned dropChannels;
+  std::deque<Slot> slots;
+  Callback callback;
+  uint64_t lastMatchedStamp;
+  //计数可以在其他线程中读取
+  std::atomic<uint64_t> matchedCount;
+  std::atomic<uint64_t> droppedCount;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_STAMPSYNCHRONIZER_H
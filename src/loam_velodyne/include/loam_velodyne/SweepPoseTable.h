@@ -0,0 +1,100 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SWEEPPOSETABLE_H
+#define LOAM_VELODYNE_SWEEPPOSETABLE_H
+
+#include <vector>
+
+#include <loam_velodyne/common.h>
+
+namespace loam {
+
+//匀速运动模型下一个扫描周期内各点相对扫描开始时刻的位姿，由帧间运动transform[6]构造，
+//点的插值系数s = 10 * (intensity - int(intensity))为点在扫描周期内的相对时间
+//插值份数bins为0时逐点计算插值位姿的正余弦，与原实现结果一致；
+//大于0时每次reset预先计算bins + 1个时刻的旋转矩阵，点的旋转在相邻两个时刻之间线性插值，不再逐点计算正余弦
+class SweepPoseTable {
+public:
+  explicit SweepPoseTable(int bins = 0) : bins(bins), transform{0} {}
+
+  void setBins(int value) { bins = value; }
+  int getBins() const { return bins; }
+
+  //帧间运动估计更新之后调用
+  void reset(const float transform[6]);
+
+  //将点校正到扫描开始时刻，效果相当于得到在点云扫描开始位置静止扫描得到的点
+  void toStart(const PointType& pi, PointType& po) const
+  {
+    if (bins <= 0) {
+      exactToStart(pi, po);
+      return;
+    }
+
+    float s = 10 * (pi.intensity - int(pi.intensity));
+
+    float f = s * bins;
+    int bin = f > 0 ? int(f) : 0;
+    if (bin >= bins) {
+      bin = bins - 1;
+    }
+    float w = f - bin;
+    const float* r0 = &rotations[9 * bin];
+    const float* r1 = r0 + 9;
+
+    float dx = pi.x - s * transform[3];
+    float dy = pi.y - s * transform[4];
+    float dz = pi.z - s * transform[5];
+
+    float r[9];
+    for (int k = 0; k < 9; k++) {
+      r[k] = r0[k] + w * (r1[k] - r0[k]);
+    }
+    po.x = r[0] * dx + r[1] * dy + r[2] * dz;
+    po.y = r[3] * dx + r[4] * dy + r[5] * dz;
+    po.z = r[6] * dx + r[7] * dy + r[8] * dz;
+    po.intensity = pi.intensity;
+  }
+
+private:
+  void exactToStart(const PointType& pi, PointType& po) const;
+
+  int bins;
+  float transform[6];
+  //每个时刻按行存放的3x3旋转矩阵
+  std::vector<float> rotations;
+};
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_SWEEPPOSETABLE_H
@@ -0,0 +1,63 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_TIMINGPUBLISHER_H
+#define LOAM_VELODYNE_TIMINGPUBLISHER_H
+
+#include <string>
+
+#include <loam_velodyne/StageTimers.h>
+#include <ros/ros.h>
+
+namespace loam {
+
+//按固定的周期把StageTimers的统计发布到/diagnostics，发布后清空，可选同时打印到日志
+class TimingPublisher {
+public:
+  TimingPublisher();
+
+  //~timingPeriod为发布周期(秒，小于等于0时不发布)，~logTimings为true时同时打印；未调用setup时不发布
+  void setup(ros::NodeHandle& node, ros::NodeHandle& privateNode, const std::string& statusName);
+  //每帧结束时调用，到达发布周期时发布
+  void update(StageTimers& timers);
+
+private:
+  std::string statusName;
+  double period;
+  bool logTimings;
+  ros::WallTime lastPublish;
+  ros::Publisher pubDiagnostics;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_TIMINGPUBLISHER_H
@@ -0,0 +1,116 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_TRANSFORMMAINTENANCE_H
+#define LOAM_VELODYNE_TRANSFORMMAINTENANCE_H
+
+#include <Eigen/Core>
+#include <loam_velodyne/ImuRingBuffer.h>
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/imu_integration.h>
+
+namespace loam {
+
+//位姿融合的参数，对应节点的私有参数
+struct TransformMaintenanceParams {
+  TransformMaintenanceParams()
+    : imuMaxPropagation(0.5) {}
+
+  //IMU积分的位姿最多从最近一次融合的位姿向后传播的时间(秒)，超过之后不再输出，避免积分漂移
+  double imuMaxPropagation;
+};
+
+//位姿融合：将高频的odometry位姿与低频的mapping矫正量融合，输出最终的位姿
+//可选地在两次odometry之间用IMU积分传播最近一次融合的位姿，以IMU的频率输出
+//不涉及话题的订阅与发布，节点与nodelet由TransformMaintenanceNode封装
+class TransformMaintenance {
+public:
+  TransformMaintenance();
+
+  bool configure(const TransformMaintenanceParams& params);
+
+  //输入odometry的位姿及其时间戳，输出融合mapping矫正量之后的位姿
+  void processOdometry(double time, const float transformSum[6], float transformMapped[6]);
+
+  //输入mapping优化前后的位姿，作为之后odometry位姿的矫正量
+  void processMapping(const float transformAftMapped[6], const float transformBefMapped[6]);
+
+  //输入一个IMU测量，由最近一次融合的位姿积分到IMU的时刻，给出位姿与世界坐标系下的速度
+  //还没有融合的位姿、IMU早于融合的位姿或者超出最长传播时间时返回false
+  bool processImu(const ImuSample& imu, float transformPropagated[6], float velocity[3]);
+
+private:
+  void transformAssociateToMap();
+  //以最近一次融合的位姿为起点，重新积分之后已经收到的IMU测量
+  void resetPropagation(double time);
+  //积分到一个IMU测量的时刻
+  void propagateTo(const ImuState& imu);
+
+  //imu循环队列长度
+  static const int imuQueLength = 512;
+
+  //odometry计算的转移矩阵(实时高频量)
+  float transformSum[6] = {0};
+  //平移增量
+  float transformIncre[6] = {0};
+  //经过mapping矫正过后的最终的世界坐标系下的位姿
+  float transformMapped[6] = {0};
+  //mapping传递过来的优化前的位姿
+  float transformBefMapped[6] = {0};
+  //mapping传递过来的优化后的位姿
+  float transformAftMapped[6] = {0};
+
+  double imuMaxPropagation;
+
+  //最近收到的IMU测量，加速度已去除重力并旋转到IMU的世界坐标系下，与scanRegistration使用同样的缓冲区
+  ImuRingBuffer<ImuState> imuBuffer;
+
+  //上一次融合的位姿的时间与位置，用于估计传播的初速度
+  bool hasLastMapped;
+  double lastMappedTime;
+  float lastMappedPosition[3];
+
+  //传播的起点：融合位姿的时间、位置与速度，IMU世界坐标系到地图世界坐标系的旋转
+  bool propagating;
+  double propagationStart;
+  float startPosition[3];
+  float startVelocity[3];
+  Eigen::Matrix3f imuToMap;
+  //已积分到的时间，以及相对起点的位移与当前速度
+  double propagatedTime;
+  float imuShift[3];
+  float imuVelo[3];
+};
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_TRANSFORMMAINTENANCE_H
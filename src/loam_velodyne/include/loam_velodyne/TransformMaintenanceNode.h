@@ -0,0 +1,92 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_TRANSFORMMAINTENANCENODE_H
+#define LOAM_VELODYNE_TRANSFORMMAINTENANCENODE_H
+
+#include <memory>
+#include <mutex>
+
+#include <loam_velodyne/StageTimers.h>
+#include <loam_velodyne/TimingPublisher.h>
+#include <loam_velodyne/TransformMaintenance.h>
+#include <nav_msgs/Odometry.h>
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <tf/transform_broadcaster.h>
+
+namespace loam {
+
+//transformMaintenance的ROS封装：订阅两路位姿，发布融合之后的/integrated_to_init与tf，独立节点与nodelet共用
+//~imuPropagation为true时还订阅/imu/data，以IMU的频率发布积分传播的位姿/imu_integrated_to_init
+class TransformMaintenanceNode {
+public:
+  TransformMaintenanceNode();
+
+  //订阅/发布话题
+  bool setup(ros::NodeHandle& node, ros::NodeHandle& privateNode);
+
+  //接收laserOdometry的信息
+  void laserOdometryHandler(const nav_msgs::Odometry::ConstPtr& laserOdometry);
+
+  //接收laserMapping的转换信息
+  void odomAftMappedHandler(const nav_msgs::Odometry::ConstPtr& odomAftMapped);
+
+  //接收IMU信息，传播最近一次融合的位姿
+  void imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn);
+
+private:
+  TransformMaintenance transformMaintenance;
+  //多线程的nodelet manager中三路输入的回调可能同时调用
+  std::mutex transformMutex;
+
+  nav_msgs::Odometry laserOdometry2;
+  nav_msgs::Odometry imuOdometry;
+  //setup时创建，没有ROS master时不能构造
+  std::unique_ptr<tf::TransformBroadcaster> tfBroadcaster2;
+  tf::StampedTransform laserOdometryTrans2;
+
+  ros::Subscriber subLaserOdometry;
+  ros::Subscriber subOdomAftMapped;
+  ros::Subscriber subImu;
+
+  ros::Publisher pubLaserOdometry2;
+  ros::Publisher pubImuOdometry;
+
+  //从雷达时间戳到发布/integrated_to_init的端到端延迟
+  StageTimers latencyTimers;
+  TimingPublisher timingPublisher;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_TRANSFORMMAINTENANCENODE_H
@@ -0,0 +1,103 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_VOXELFILTER_H
+#define LOAM_VELODYNE_VOXELFILTER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <loam_velodyne/common.h>
+#include <pcl/point_cloud.h>
+
+namespace loam {
+
+//已滤波点云中每个体素对应的点的序号，以体素编码为键
+typedef std::unordered_map<uint64_t, size_t> VoxelIndex;
+
+//针对PointType的哈希体素栅格滤波器，与pcl::VoxelGrid的结果一致：体素按全局的栅格划分，
+//每个体素输出所有点(含intensity)的均值，输出按体素编码排序
+//除全量滤波外还可以增量滤波：已滤波的点云只把新加入的点合并到已有的体素中，不再整体重新滤波。
+//体素坐标每一维超出±2^20(边长0.2米时约±200公里)的点无法编码，丢弃并给出警告
+class VoxelFilter {
+public:
+  explicit VoxelFilter(float size = 0.2);
+
+  void setLeafSize(float size);
+  float getLeafSize() const { return leafSize; }
+
+  //全量滤波，input与output不能是同一个点云
+  void filter(const pcl::PointCloud<PointType>& input, pcl::PointCloud<PointType>& output);
+
+  //增量滤波：cloud的前filteredNum个点是已经滤波过的结果，voxels是它们的体素索引(为空时重建)，
+  //把之后新加入的点合并进去，cloud与voxels原地更新，返回滤波后的点数。
+  //与对整个cloud重新滤波等价：已有的点在体素均值中和新点一样按一个点计
+  size_t merge(pcl::PointCloud<PointType>& cloud, size_t filteredNum, VoxelIndex& voxels);
+
+  //点所在体素的编码，每一维21位，按z、y、x的顺序排列，与pcl::VoxelGrid的输出顺序相同；
+  //超出编码范围时返回false
+  bool voxelKeyOf(const PointType& point, uint64_t& key) const;
+
+private:
+  //一个体素内点的累加和
+  struct VoxelSum {
+    float x;
+    float y;
+    float z;
+    float intensity;
+    int pointNum;
+    //增量滤波时体素已有的点在cloud中的序号，新体素为-1
+    long target;
+  };
+
+  //点所在体素的累加和，体素第一次出现时新建，seed不为空时以已有的点作为体素的第一个点
+  VoxelSum& voxelSumOf(uint64_t key, const PointType* seed, long target);
+  //把新建的体素(增量滤波时只取没有已有点的体素)按体素编码排序，结果存入voxelOrder
+  void sortVoxels(bool newOnly);
+  //滤波时丢弃了超出编码范围的点
+  void warnOutOfRange(size_t pointNum) const;
+
+  float leafSize;
+  float inverseLeafSize;
+
+  //每次滤波复用的缓存
+  std::unordered_map<uint64_t, size_t> voxelSlots;
+  std::vector<VoxelSum> voxelSums;
+  std::vector<std::pair<uint64_t, size_t> > voxelOrder;
+};
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_VOXELFILTER_H
@@ -30,7 +30,11 @@
 //   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
 //     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
 
+#ifndef LOAM_VELODYNE_COMMON_H
+#define LOAM_VELODYNE_COMMON_H
+
 #include <cmath>
+#include <stdint.h>
 
 #include <pcl/point_types.h>
 
@@ -45,3 +49,34 @@ inline double deg2rad(double degrees)
 {
   return degrees * M_PI / 180.0;
 }
+
+namespace loam {
+
+//一个IMU测量：imu坐标系为x轴向前，y轴向右，z轴向上的右手坐标系
+struct ImuSample {
+  ImuSample() : time(0), roll(0), pitch(0), yaw(0), accX(0), accY(0), accZ(0) {}
+
+  double time;
+  //全局坐标系下的欧拉角，R = Rz(yaw)*Ry(pitch)*Rx(roll)
+  double roll, pitch, yaw;
+  //未去除重力的加速度
+  double accX, accY, accZ;
+};
+
+//秒与pcl时间戳(微秒)之间的转换，与ros::Time::fromSec/toSec经pcl_conversions转换的结果相同
+inline uint64_t pclStampFromSec(double time)
+{
+  uint64_t sec = uint64_t(std::floor(time));
+  uint64_t nsec = uint64_t(std::round((time - sec) * 1e9));
+  return (sec * 1000000000ull + nsec) / 1000ull;
+}
+
+inline double secFromPclStamp(uint64_t stamp)
+{
+  uint64_t nsec = stamp * 1000ull;
+  return double(nsec / 1000000000ull) + 1e-9 * double(nsec % 1000000000ull);
+}
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_COMMON_H
@@ -0,0 +1,89 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_FEATURE_FRAME_H
+#define LOAM_VELODYNE_FEATURE_FRAME_H
+
+#include <cstddef>
+
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/FeatureFrame.h>
+#include <pcl/point_cloud.h>
+
+namespace loam {
+
+//把点云作为第set类点集追加到frame的缓存末尾
+inline void appendFeatureSet(loam_velodyne::FeatureFrame& frame, int set, const pcl::PointCloud<PointType>& cloud)
+{
+  size_t start = frame.points.size() / 4;
+  size_t pointNum = cloud.points.size();
+  frame.setStart[set] = start;
+  frame.setSize[set] = pointNum;
+
+  frame.points.resize(4 * (start + pointNum));
+  //前面的点集都为空时缓存仍可能为空，不能取&points[0]
+  float* data = frame.points.data() + 4 * start;
+  for (size_t i = 0; i < pointNum; i++) {
+    const PointType& point = cloud.points[i];
+    data[4 * i] = point.x;
+    data[4 * i + 1] = point.y;
+    data[4 * i + 2] = point.z;
+    data[4 * i + 3] = point.intensity;
+  }
+}
+
+//取出frame中的第set类点集，范围超出缓存时返回false
+inline bool extractFeatureSet(const loam_velodyne::FeatureFrame& frame, int set, pcl::PointCloud<PointType>& cloud)
+{
+  size_t start = frame.setStart[set];
+  size_t pointNum = frame.setSize[set];
+  if (4 * (start + pointNum) > frame.points.size()) {
+    cloud.clear();
+    return false;
+  }
+
+  cloud.resize(pointNum);
+  const float* data = frame.points.data() + 4 * start;
+  for (size_t i = 0; i < pointNum; i++) {
+    PointType& point = cloud.points[i];
+    point.x = data[4 * i];
+    point.y = data[4 * i + 1];
+    point.z = data[4 * i + 2];
+    point.intensity = data[4 * i + 3];
+  }
+
+  return true;
+}
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_FEATURE_FRAME_H
@@ -0,0 +1,173 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_FEATURE_SELECTION_H
+#define LOAM_VELODYNE_FEATURE_SELECTION_H
+
+#include <algorithm>
+#include <vector>
+
+namespace loam {
+
+//按曲率比较点序，曲率相同时比较点序，与原来稳定的插入排序(初始为点序)给出的顺序一致
+struct CurvatureLess {
+  const float* curvature;
+
+  explicit CurvatureLess(const float* curvature_) : curvature(curvature_) {}
+
+  bool operator()(int a, int b) const
+  {
+    return curvature[a] < curvature[b] || (curvature[a] == curvature[b] && a < b);
+  }
+};
+
+struct CurvatureGreater {
+  CurvatureLess less;
+
+  explicit CurvatureGreater(const float* curvature_) : less(curvature_) {}
+
+  bool operator()(int a, int b) const
+  {
+    return less(b, a);
+  }
+};
+
+//一个分段挑选出的特征点的点序，按被选中的顺序排列
+struct SegmentFeatures {
+  //曲率最大的前2个点
+  std::vector<int> sharp;
+  //曲率最大的前20个点，包括sharp
+  std::vector<int> lessSharp;
+  //曲率最小的前4个点
+  std::vector<int> flat;
+
+  void clear()
+  {
+    sharp.clear();
+    lessSharp.clear();
+    flat.clear();
+  }
+};
+
+//将选中点前后各5个连续距离比较近的点筛选出去，防止特征点聚集，使得特征点在每个方向上尽量分布均匀
+inline void markFeatureNeighbors(int ind, const float* gapSq, int* neighborPicked)
+{
+  for (int l = 1; l <= 5; l++) {
+    if (gapSq[ind + l - 1] > 0.05) {
+      break;
+    }
+
+    neighborPicked[ind + l] = 1;
+  }
+  for (int l = -1; l >= -5; l--) {
+    if (gapSq[ind + l] > 0.05) {
+      break;
+    }
+
+    neighborPicked[ind + l] = 1;
+  }
+}
+
+//在分段[sp, ep](sp <= ep)中挑选边沿点与平面点，设置label并追加到features，选中点附近的点标记为已筛选。
+//不再对整个分段排序：以分段的点序建堆，每次弹出曲率最大(最小)的点，只需取出少数几个点即可。
+//sortInd在[sp, ep]内的顺序会被打乱
+inline void selectSegmentFeatures(int sp, int ep, const float* curvature, const float* gapSq,
+                                  int* sortInd, int* neighborPicked, int* label,
+                                  SegmentFeatures& features)
+{
+  int* segmentBegin = sortInd + sp;
+  int* segmentEnd = sortInd + ep + 1;
+  CurvatureLess curvatureLess(curvature);
+  CurvatureGreater curvatureGreater(curvature);
+
+  //挑选每个分段的曲率很大和比较大的点
+  int largestPickedNum = 0;
+  std::make_heap(segmentBegin, segmentEnd, curvatureLess);
+  for (int* heapEnd = segmentEnd; heapEnd > segmentBegin; heapEnd--) {
+    std::pop_heap(segmentBegin, heapEnd, curvatureLess);
+    int ind = *(heapEnd - 1);  //曲率最大点的点序
+
+    //剩余点的曲率都不大于该点，不会再有被选中的点
+    if (curvature[ind] <= 0.1) {
+      break;
+    }
+
+    //如果曲率大的点，曲率的确比较大，并且未被筛选过滤掉
+    if (neighborPicked[ind] == 0) {
+      largestPickedNum++;
+      if (largestPickedNum <= 2) {//挑选曲率最大的前2个点放入sharp点集合
+        label[ind] = 2;//2代表点曲率很大
+        features.sharp.push_back(ind);
+        features.lessSharp.push_back(ind);
+      } else if (largestPickedNum <= 20) {//挑选曲率最大的前20个点放入less sharp点集合
+        label[ind] = 1;//1代表点曲率比较尖锐
+        features.lessSharp.push_back(ind);
+      } else {
+        break;
+      }
+
+      neighborPicked[ind] = 1;//筛选标志置位
+      markFeatureNeighbors(ind, gapSq, neighborPicked);
+    }
+  }
+
+  //挑选每个分段的曲率很小比较小的点
+  int smallestPickedNum = 0;
+  std::make_heap(segmentBegin, segmentEnd, curvatureGreater);
+  for (int* heapEnd = segmentEnd; heapEnd > segmentBegin; heapEnd--) {
+    std::pop_heap(segmentBegin, heapEnd, curvatureGreater);
+    int ind = *(heapEnd - 1);  //曲率最小点的点序
+
+    //剩余点的曲率都不小于该点，不会再有被选中的点
+    if (curvature[ind] >= 0.1) {
+      break;
+    }
+
+    //如果曲率的确比较小，并且未被筛选出
+    if (neighborPicked[ind] == 0) {
+      label[ind] = -1;//-1代表曲率很小的点
+      features.flat.push_back(ind);
+
+      smallestPickedNum++;
+      if (smallestPickedNum >= 4) {//只选最小的四个，剩下的Label==0,就都是曲率比较小的
+        break;
+      }
+
+      neighborPicked[ind] = 1;
+      markFeatureNeighbors(ind, gapSq, neighborPicked);//同样防止特征点聚集
+    }
+  }
+}
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_FEATURE_SELECTION_H
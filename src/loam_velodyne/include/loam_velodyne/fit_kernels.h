@@ -0,0 +1,69 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_FIT_KERNELS_H
+#define LOAM_VELODYNE_FIT_KERNELS_H
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+
+/******************************读前须知*****************************************/
+/*laserMapping中每个特征点都要对5个近邻点做一次直线或平面拟合，
+  这里是固定大小的闭式解，全部在栈上计算，不涉及动态内存分配
+*******************************************************************************/
+
+namespace loam {
+
+//3x3对称矩阵的闭式特征值分解，特征值按从大到小排列（与cv::eigen一致），direction为最大特征值对应的单位特征向量
+inline void symmetricEigen3x3(const Eigen::Matrix3f& covariance,
+                              Eigen::Vector3f& eigenValues, Eigen::Vector3f& direction)
+{
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> eigenSolver;
+  eigenSolver.computeDirect(covariance);
+
+  //computeDirect的结果为从小到大排列
+  eigenValues = eigenSolver.eigenvalues().reverse();
+  direction = eigenSolver.eigenvectors().col(2);
+}
+
+//平面拟合：求解 pa * x + pb * y + pc * z + 1 = 0 的最小二乘解，使用3x3的法方程
+inline void fitPlaneNormalEquations(const Eigen::Matrix<float, 5, 3>& matA0, Eigen::Vector3f& matX0)
+{
+  Eigen::Matrix3f matAtA = matA0.transpose() * matA0;
+  Eigen::Vector3f matAtB = -matA0.colwise().sum().transpose();
+  matX0 = matAtA.ldlt().solve(matAtB);
+}
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_FIT_KERNELS_H
@@ -0,0 +1,136 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_IMU_INTEGRATION_H
+#define LOAM_VELODYNE_IMU_INTEGRATION_H
+
+#include <cmath>
+
+#include <loam_velodyne/common.h>
+
+/******************************读前须知*****************************************/
+/*scanRegistration与transformMaintenance共用的IMU积分：加速度去除重力并交换坐标轴，
+  按IMU的欧拉角旋转到世界坐标系，两个测量之间视为匀加速直线运动积分位移与速度。
+  坐标轴交换之后为z轴向前,x轴向左,y轴向上的右手坐标系，R = Ry(yaw)*Rx(pitch)*Rz(roll)
+*******************************************************************************/
+
+namespace loam {
+
+//重力加速度
+const double gravity = 9.81;
+
+//IMU队列中的一个测量：欧拉角，去除重力并交换坐标轴之后的加速度，以及积分得到的速度与位移
+struct ImuState {
+  ImuState()
+    : time(0), roll(0), pitch(0), yaw(0),
+      accX(0), accY(0), accZ(0),
+      veloX(0), veloY(0), veloZ(0),
+      shiftX(0), shiftY(0), shiftZ(0) {}
+
+  double time;
+  float roll, pitch, yaw;
+  float accX, accY, accZ;
+  float veloX, veloY, veloZ;
+  float shiftX, shiftY, shiftZ;
+};
+
+//两个测量之间按时间比例线性插值(ImuRingBuffer::interpolate使用)，ratioFront + ratioBack = 1。
+//偏航角在±π处跳变时先将back的偏航角加减2π
+inline ImuState interpolateSample(const ImuState& back, const ImuState& front, float ratioFront, float ratioBack)
+{
+  ImuState sample;
+  sample.time = front.time * ratioFront + back.time * ratioBack;
+
+  sample.roll = front.roll * ratioFront + back.roll * ratioBack;
+  sample.pitch = front.pitch * ratioFront + back.pitch * ratioBack;
+  if (front.yaw - back.yaw > M_PI) {
+    sample.yaw = front.yaw * ratioFront + (back.yaw + 2 * M_PI) * ratioBack;
+  } else if (front.yaw - back.yaw < -M_PI) {
+    sample.yaw = front.yaw * ratioFront + (back.yaw - 2 * M_PI) * ratioBack;
+  } else {
+    sample.yaw = front.yaw * ratioFront + back.yaw * ratioBack;
+  }
+
+  sample.accX = front.accX * ratioFront + back.accX * ratioBack;
+  sample.accY = front.accY * ratioFront + back.accY * ratioBack;
+  sample.accZ = front.accZ * ratioFront + back.accZ * ratioBack;
+
+  //本质:veloX = back.veloX + (front.veloX - back.veloX) * ratioFront
+  sample.veloX = front.veloX * ratioFront + back.veloX * ratioBack;
+  sample.veloY = front.veloY * ratioFront + back.veloY * ratioBack;
+  sample.veloZ = front.veloZ * ratioFront + back.veloZ * ratioBack;
+
+  sample.shiftX = front.shiftX * ratioFront + back.shiftX * ratioBack;
+  sample.shiftY = front.shiftY * ratioFront + back.shiftY * ratioBack;
+  sample.shiftZ = front.shiftZ * ratioFront + back.shiftZ * ratioBack;
+  return sample;
+}
+
+//减去重力的影响，求出xyz方向的加速度实际值，并交换坐标轴
+inline void imuAccelerationToCamera(const ImuSample& imu, float& accX, float& accY, float& accZ)
+{
+  double roll = imu.roll;
+  double pitch = imu.pitch;
+
+  accX = imu.accY - std::sin(roll) * std::cos(pitch) * gravity;
+  accY = imu.accZ - std::cos(roll) * std::cos(pitch) * gravity;
+  accZ = imu.accX + std::sin(pitch) * gravity;
+}
+
+//将加速度绕交换过的ZXY固定轴（原XYZ）分别旋转(roll, pitch, yaw)角，得到世界坐标系下的加速度(right hand rule)
+inline void rotateImuToWorld(float roll, float pitch, float yaw, float& accX, float& accY, float& accZ)
+{
+  //绕z轴旋转(roll)
+  float x1 = std::cos(roll) * accX - std::sin(roll) * accY;
+  float y1 = std::sin(roll) * accX + std::cos(roll) * accY;
+  float z1 = accZ;
+  //绕x轴旋转(pitch)
+  float x2 = x1;
+  float y2 = std::cos(pitch) * y1 - std::sin(pitch) * z1;
+  float z2 = std::sin(pitch) * y1 + std::cos(pitch) * z1;
+  //绕y轴旋转(yaw)
+  accX = std::cos(yaw) * x2 + std::sin(yaw) * z2;
+  accY = y2;
+  accZ = -std::sin(yaw) * x2 + std::cos(yaw) * z2;
+}
+
+//一个维度上由上一个测量的位移与速度积分到当前测量，两点之间视为匀加速直线运动
+inline void accumulateImuShift(float shiftBack, float veloBack, float acc, double timeDiff,
+                               float& shift, float& velo)
+{
+  shift = shiftBack + veloBack * timeDiff + acc * timeDiff * timeDiff / 2;
+  velo = veloBack + acc * timeDiff;
+}
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_IMU_INTEGRATION_H
@@ -0,0 +1,73 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_LOGGING_H
+#define LOAM_VELODYNE_LOGGING_H
+
+namespace loam {
+
+//不依赖ROS的核心模块的日志：默认输出到stderr，节点把它转发给rosconsole
+enum LogLevel {
+  LOG_DEBUG,
+  LOG_INFO,
+  LOG_WARN,
+  LOG_ERROR
+};
+
+typedef void (*LogHandler)(LogLevel level, const char* message);
+
+//设置日志的输出与最低级别，需在各模块的线程启动之前设置
+void setLogHandler(LogHandler handler, LogLevel minLevel);
+
+//格式化之后交给日志的输出，低于最低级别的不格式化
+void logMessage(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+//距同一位置上一次输出超过period秒时返回true，并记下这次的时间(单调时钟)
+bool logThrottle(double period, double& lastTime);
+
+} // end namespace loam
+
+#define LOAM_DEBUG(...) ::loam::logMessage(::loam::LOG_DEBUG, __VA_ARGS__)
+#define LOAM_INFO(...) ::loam::logMessage(::loam::LOG_INFO, __VA_ARGS__)
+#define LOAM_WARN(...) ::loam::logMessage(::loam::LOG_WARN, __VA_ARGS__)
+#define LOAM_ERROR(...) ::loam::logMessage(::loam::LOG_ERROR, __VA_ARGS__)
+
+//每个调用位置最多每period秒输出一次
+#define LOAM_WARN_THROTTLE(period, ...) \
+  do { \
+    static double loamLastLogTime = -1e300; \
+    if (::loam::logThrottle(period, loamLastLogTime)) { \
+      ::loam::logMessage(::loam::LOG_WARN, __VA_ARGS__); \
+    } \
+  } while (0)
+
+#endif //LOAM_VELODYNE_LOGGING_H
@@ -0,0 +1,217 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_POINT_TRANSFORMS_H
+#define LOAM_VELODYNE_POINT_TRANSFORMS_H
+
+#include <cmath>
+
+#include <loam_velodyne/common.h>
+
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#define LOAM_POINT_TRANSFORMS_SIMD
+#endif
+
+/******************************读前须知*****************************************/
+/*LOAM的位姿(rx, ry, rz, tx, ty, tz)以三次欧拉旋转的形式作用在点上，逐点变换时每个点都要重新计算六个正余弦。
+  这里每次变换一批点之前计算一次正余弦，四个点为一组(SSE)转置为x[], y[], z[]后同时计算，
+  剩余的点使用标量计算。每个点的运算顺序与逐点版本完全相同，结果逐位一致。
+  编译器把乘加合并为FMA时舍入不同，因此包含本文件的源文件以-ffp-contract=off编译(见CMakeLists.txt)
+*******************************************************************************/
+
+namespace loam {
+
+//一组欧拉角的正余弦
+struct EulerSinCos {
+  EulerSinCos(float rx, float ry, float rz)
+    : sinX(std::sin(rx)), cosX(std::cos(rx)),
+      sinY(std::sin(ry)), cosY(std::cos(ry)),
+      sinZ(std::sin(rz)), cosZ(std::cos(rz)) {}
+
+  float sinX, cosX;
+  float sinY, cosY;
+  float sinZ, cosZ;
+};
+
+//由LOAM位姿transform[6]得到的旋转的正余弦与平移量，每次变换之前构造一次
+struct EulerPose {
+  explicit EulerPose(const float transform[6])
+    : rotation(transform[0], transform[1], transform[2]),
+      tx(transform[3]), ty(transform[4]), tz(transform[5]) {}
+
+  EulerSinCos rotation;
+  float tx, ty, tz;
+};
+
+namespace point_transforms_detail {
+
+template <typename T> T set1(float v);
+template <> inline float set1<float>(float v) { return v; }
+inline float add(float a, float b) { return a + b; }
+inline float sub(float a, float b) { return a - b; }
+inline float mul(float a, float b) { return a * b; }
+
+#ifdef LOAM_POINT_TRANSFORMS_SIMD
+//包装为结构体，以便作为模板参数
+struct Batch { __m128 v; };
+const int batchSize = 4;
+template <> inline Batch set1<Batch>(float v) { return Batch{_mm_set1_ps(v)}; }
+inline Batch add(Batch a, Batch b) { return Batch{_mm_add_ps(a.v, b.v)}; }
+inline Batch sub(Batch a, Batch b) { return Batch{_mm_sub_ps(a.v, b.v)}; }
+inline Batch mul(Batch a, Batch b) { return Batch{_mm_mul_ps(a.v, b.v)}; }
+#endif
+
+//位姿的各个量，标量版本为float，SIMD版本为每个分量相同的Batch
+template <typename T>
+struct PoseConstants {
+  T sinX, cosX, sinY, cosY, sinZ, cosZ;
+  T tx, ty, tz;
+};
+
+//局部坐标系到世界坐标系：绕z轴旋转（rz），绕x轴旋转（rx），绕y轴旋转（ry），再平移
+struct ToMap {
+  template <typename T>
+  void operator()(const PoseConstants<T>& c, T x, T y, T z, T& ox, T& oy, T& oz) const
+  {
+    T x1 = sub(mul(c.cosZ, x), mul(c.sinZ, y));
+    T y1 = add(mul(c.sinZ, x), mul(c.cosZ, y));
+    T z1 = z;
+
+    T x2 = x1;
+    T y2 = sub(mul(c.cosX, y1), mul(c.sinX, z1));
+    T z2 = add(mul(c.sinX, y1), mul(c.cosX, z1));
+
+    ox = add(add(mul(c.cosY, x2), mul(c.sinY, z2)), c.tx);
+    oy = add(y2, c.ty);
+    oz = add(sub(mul(c.cosY, z2), mul(c.sinY, x2)), c.tz);
+  }
+};
+
+//世界坐标系到局部坐标系：平移后绕y轴旋转（-ry），绕x轴旋转（-rx），绕z轴旋转（-rz）
+struct FromMap {
+  template <typename T>
+  void operator()(const PoseConstants<T>& c, T x, T y, T z, T& ox, T& oy, T& oz) const
+  {
+    T dx = sub(x, c.tx);
+    T dy = sub(y, c.ty);
+    T dz = sub(z, c.tz);
+
+    T x1 = sub(mul(c.cosY, dx), mul(c.sinY, dz));
+    T y1 = dy;
+    T z1 = add(mul(c.sinY, dx), mul(c.cosY, dz));
+
+    T x2 = x1;
+    T y2 = add(mul(c.cosX, y1), mul(c.sinX, z1));
+    T z2 = sub(mul(c.cosX, z1), mul(c.sinX, y1));
+
+    ox = add(mul(c.cosZ, x2), mul(c.sinZ, y2));
+    oy = sub(mul(c.cosZ, y2), mul(c.sinZ, x2));
+    oz = z2;
+  }
+};
+
+template <typename T>
+inline PoseConstants<T> poseConstants(const EulerPose& pose)
+{
+  PoseConstants<T> c;
+  c.sinX = set1<T>(pose.rotation.sinX);
+  c.cosX = set1<T>(pose.rotation.cosX);
+  c.sinY = set1<T>(pose.rotation.sinY);
+  c.cosY = set1<T>(pose.rotation.cosY);
+  c.sinZ = set1<T>(pose.rotation.sinZ);
+  c.cosZ = set1<T>(pose.rotation.cosZ);
+  c.tx = set1<T>(pose.tx);
+  c.ty = set1<T>(pose.ty);
+  c.tz = set1<T>(pose.tz);
+  return c;
+}
+
+//对size个点逐个调用变换kernel，in与out可以相同
+template <typename Kernel>
+inline void transformPoints(const EulerPose& pose, const PointType* in, PointType* out, int size,
+                            const Kernel& kernel)
+{
+  int i = 0;
+#ifdef LOAM_POINT_TRANSFORMS_SIMD
+  //点的data[4]依次为x, y, z, 1，四个点转置后每个寄存器存放同一个坐标分量
+  const PoseConstants<Batch> batchPose = poseConstants<Batch>(pose);
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; i + batchSize <= size; i += batchSize) {
+    Batch x{_mm_loadu_ps(in[i].data)};
+    Batch y{_mm_loadu_ps(in[i + 1].data)};
+    Batch z{_mm_loadu_ps(in[i + 2].data)};
+    __m128 w = _mm_loadu_ps(in[i + 3].data);
+    _MM_TRANSPOSE4_PS(x.v, y.v, z.v, w);
+
+    Batch ox, oy, oz;
+    kernel(batchPose, x, y, z, ox, oy, oz);
+    __m128 ow = one;
+    _MM_TRANSPOSE4_PS(ox.v, oy.v, oz.v, ow);
+
+    _mm_storeu_ps(out[i].data, ox.v);
+    _mm_storeu_ps(out[i + 1].data, oy.v);
+    _mm_storeu_ps(out[i + 2].data, oz.v);
+    _mm_storeu_ps(out[i + 3].data, ow);
+    for (int j = i; j < i + batchSize; j++) {
+      out[j].intensity = in[j].intensity;
+    }
+  }
+#endif
+  const PoseConstants<float> scalarPose = poseConstants<float>(pose);
+  for (; i < size; i++) {
+    float ox, oy, oz;
+    kernel(scalarPose, in[i].x, in[i].y, in[i].z, ox, oy, oz);
+    out[i].x = ox;
+    out[i].y = oy;
+    out[i].z = oz;
+    out[i].intensity = in[i].intensity;
+  }
+}
+
+} // end namespace point_transforms_detail
+
+//将size个点由局部坐标系变换到世界坐标系，in与out可以相同
+inline void transformPointsToMap(const EulerPose& pose, const PointType* in, PointType* out, int size)
+{
+  point_transforms_detail::transformPoints(pose, in, out, size, point_transforms_detail::ToMap());
+}
+
+//将size个点由世界坐标系变换回局部坐标系，in与out可以相同
+inline void transformPointsFromMap(const EulerPose& pose, const PointType* in, PointType* out, int size)
+{
+  point_transforms_detail::transformPoints(pose, in, out, size, point_transforms_detail::FromMap());
+}
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_POINT_TRANSFORMS_H
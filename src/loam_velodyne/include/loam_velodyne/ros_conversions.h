@@ -0,0 +1,185 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_ROS_CONVERSIONS_H
+#define LOAM_VELODYNE_ROS_CONVERSIONS_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <loam_velodyne/common.h>
+#include <loam_velodyne/logging.h>
+#include <loam_velodyne/ScanRegistration.h>
+#include <geometry_msgs/Pose.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl/filters/filter.h>
+#include <ros/console.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf/transform_datatypes.h>
+
+namespace loam {
+
+//核心模块的日志转发给rosconsole，由rosconsole按级别过滤
+inline void rosLogHandler(LogLevel level, const char* message)
+{
+  switch (level) {
+    case LOG_DEBUG: ROS_DEBUG("%s", message); break;
+    case LOG_INFO:  ROS_INFO("%s", message); break;
+    case LOG_WARN:  ROS_WARN("%s", message); break;
+    case LOG_ERROR: ROS_ERROR("%s", message); break;
+  }
+}
+
+inline void setupRosLogging()
+{
+  setLogHandler(rosLogHandler, LOG_DEBUG);
+}
+
+//查找PointCloud2中的字段，不存在时返回NULL
+inline const sensor_msgs::PointField* findPointField(const sensor_msgs::PointCloud2& msg, const std::string& name)
+{
+  if (name.empty()) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i < msg.fields.size(); i++) {
+    if (msg.fields[i].name == name) {
+      return &msg.fields[i];
+    }
+  }
+
+  return NULL;
+}
+
+//读取PointCloud2中第index个点的字段值，按字段的数值类型转换为double
+inline double readPointField(const sensor_msgs::PointCloud2& msg, const sensor_msgs::PointField& field, int index)
+{
+  const uint8_t* data = &msg.data[(index / msg.width) * msg.row_step
+                                  + (index % msg.width) * msg.point_step + field.offset];
+  switch (field.datatype) {
+    case sensor_msgs::PointField::INT8:    { int8_t value;   memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::UINT8:   { uint8_t value;  memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::INT16:   { int16_t value;  memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::UINT16:  { uint16_t value; memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::INT32:   { int32_t value;  memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::UINT32:  { uint32_t value; memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::FLOAT32: { float value;    memcpy(&value, data, sizeof(value)); return value; }
+    case sensor_msgs::PointField::FLOAT64: { double value;   memcpy(&value, data, sizeof(value)); return value; }
+  }
+
+  return 0;
+}
+
+//点云消息转换为scanRegistration的输入：移除空点，读取ringField/timeField字段(为空时不读取)，
+//indices为移除空点后每个点在原始消息中的序号，与sweep一样可以每帧复用
+inline void rawSweepFromMsg(const sensor_msgs::PointCloud2& msg, const std::string& ringField,
+                            const std::string& timeField, RawSweep& sweep, std::vector<int>& indices)
+{
+  sweep.time = msg.header.stamp.toSec();
+  sweep.stamp = pcl_conversions::toPCL(msg.header.stamp);
+  pcl::fromROSMsg(msg, sweep.points);
+  pcl::removeNaNFromPointCloud(sweep.points, sweep.points, indices);
+
+  sweep.rings.clear();
+  const sensor_msgs::PointField* ring = findPointField(msg, ringField);
+  if (ring != NULL) {
+    sweep.rings.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      sweep.rings[i] = int(readPointField(msg, *ring, indices[i]));
+    }
+  }
+
+  sweep.times.clear();
+  const sensor_msgs::PointField* time = findPointField(msg, timeField);
+  if (time != NULL) {
+    sweep.times.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      sweep.times[i] = readPointField(msg, *time, indices[i]);
+    }
+  }
+}
+
+//IMU消息转换为欧拉角与加速度
+inline ImuSample imuSampleFromMsg(const sensor_msgs::Imu& imuIn)
+{
+  ImuSample imu;
+  imu.time = imuIn.header.stamp.toSec();
+
+  tf::Quaternion orientation;
+  //convert Quaternion msg to Quaternion
+  tf::quaternionMsgToTF(imuIn.orientation, orientation);
+  //This will get the roll pitch and yaw from the matrix about fixed axes X, Y, Z respectively. That's R = Rz(yaw)*Ry(pitch)*Rx(roll).
+  //Here roll pitch yaw is in the global frame
+  tf::Matrix3x3(orientation).getRPY(imu.roll, imu.pitch, imu.yaw);
+
+  imu.accX = imuIn.linear_acceleration.x;
+  imu.accY = imuIn.linear_acceleration.y;
+  imu.accZ = imuIn.linear_acceleration.z;
+  return imu;
+}
+
+//位姿(rx, ry, rz, tx, ty, tz)转换为消息中的四元数与平移量，旋转按z轴向前,x轴向左的坐标系的(rz, -rx, -ry)转换
+inline void transformToPose(const float transform[6], geometry_msgs::Pose& pose)
+{
+  geometry_msgs::Quaternion geoQuat = tf::createQuaternionMsgFromRollPitchYaw
+                                      (transform[2], -transform[0], -transform[1]);
+
+  pose.orientation.x = -geoQuat.y;
+  pose.orientation.y = -geoQuat.z;
+  pose.orientation.z = geoQuat.x;
+  pose.orientation.w = geoQuat.w;
+  pose.position.x = transform[3];
+  pose.position.y = transform[4];
+  pose.position.z = transform[5];
+}
+
+//transformToPose的逆变换
+inline void poseToTransform(const geometry_msgs::Pose& pose, float transform[6])
+{
+  double roll, pitch, yaw;
+  const geometry_msgs::Quaternion& geoQuat = pose.orientation;
+  tf::Matrix3x3(tf::Quaternion(geoQuat.z, -geoQuat.x, -geoQuat.y, geoQuat.w)).getRPY(roll, pitch, yaw);
+
+  transform[0] = -pitch;
+  transform[1] = -yaw;
+  transform[2] = roll;
+
+  transform[3] = pose.position.x;
+  transform[4] = pose.position.y;
+  transform[5] = pose.position.z;
+}
+
+} // end namespace loam
+
+#endif //LOAM_VELODYNE_ROS_CONVERSIONS_H
@@ -0,0 +1,182 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#ifndef LOAM_VELODYNE_SCAN_KERNELS_H
+#define LOAM_VELODYNE_SCAN_KERNELS_H
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LOAM_SCAN_KERNELS_SIMD
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LOAM_SCAN_KERNELS_SIMD
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define LOAM_SCAN_KERNELS_SIMD
+#endif
+
+/******************************读前须知*****************************************/
+/*scanRegistration对每一帧的每个点都要计算曲率以及与相邻点的距离，
+  这里在按x[], y[], z[]分开存放的点云(SoA)上计算，一次处理多个点(AVX 8个，SSE/NEON 4个)，
+  剩余的点使用标量计算。每个点的运算顺序与标量版本完全相同，结果逐位一致。
+  编译器把乘加合并为FMA时舍入不同，因此包含本文件的源文件以-ffp-contract=off编译(见CMakeLists.txt)
+*******************************************************************************/
+
+namespace loam {
+
+namespace scan_kernels_detail {
+
+#if defined(__AVX__)
+typedef __m256 Batch;
+const int batchSize = 8;
+inline Batch load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, Batch v) { _mm256_storeu_ps(p, v); }
+inline Batch set1(float v) { return _mm256_set1_ps(v); }
+inline Batch add(Batch a, Batch b) { return _mm256_add_ps(a, b); }
+inline Batch sub(Batch a, Batch b) { return _mm256_sub_ps(a, b); }
+inline Batch mul(Batch a, Batch b) { return _mm256_mul_ps(a, b); }
+inline Batch sqrt(Batch v) { return _mm256_sqrt_ps(v); }
+#elif defined(__SSE2__)
+typedef __m128 Batch;
+const int batchSize = 4;
+inline Batch load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Batch v) { _mm_storeu_ps(p, v); }
+inline Batch set1(float v) { return _mm_set1_ps(v); }
+inline Batch add(Batch a, Batch b) { return _mm_add_ps(a, b); }
+inline Batch sub(Batch a, Batch b) { return _mm_sub_ps(a, b); }
+inline Batch mul(Batch a, Batch b) { return _mm_mul_ps(a, b); }
+inline Batch sqrt(Batch v) { return _mm_sqrt_ps(v); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+typedef float32x4_t Batch;
+const int batchSize = 4;
+inline Batch load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, Batch v) { vst1q_f32(p, v); }
+inline Batch set1(float v) { return vdupq_n_f32(v); }
+inline Batch add(Batch a, Batch b) { return vaddq_f32(a, b); }
+inline Batch sub(Batch a, Batch b) { return vsubq_f32(a, b); }
+inline Batch mul(Batch a, Batch b) { return vmulq_f32(a, b); }
+inline Batch sqrt(Batch v) { return vsqrtq_f32(v); }
+#endif
+
+//前后各5个点之和减去10倍的当前点
+inline float stencil(const float* v)
+{
+  return v[-5] + v[-4] + v[-3] + v[-2] + v[-1] - 10 * v[0] + v[1] + v[2] + v[3] + v[4] + v[5];
+}
+
+#ifdef LOAM_SCAN_KERNELS_SIMD
+inline Batch stencil(const float* v, Batch ten)
+{
+  Batch sum = add(load(v - 5), load(v - 4));
+  sum = add(sum, load(v - 3));
+  sum = add(sum, load(v - 2));
+  sum = add(sum, load(v - 1));
+  sum = sub(sum, mul(ten, load(v)));
+  sum = add(sum, load(v + 1));
+  sum = add(sum, load(v + 2));
+  sum = add(sum, load(v + 3));
+  sum = add(sum, load(v + 4));
+  sum = add(sum, load(v + 5));
+  return sum;
+}
+#endif
+
+} // end namespace scan_kernels_detail
+
+//计算[begin, end)内点的曲率，使用每个点的前后五个点，要求begin >= 5且end + 5 <= 点数
+inline void computeCurvature(const float* x, const float* y, const float* z,
+                             int begin, int end, float* curvature)
+{
+  using namespace scan_kernels_detail;
+
+  int i = begin;
+#ifdef LOAM_SCAN_KERNELS_SIMD
+  Batch ten = set1(10.0f);
+  for (; i + batchSize <= end; i += batchSize) {
+    Batch diffX = stencil(x + i, ten);
+    Batch diffY = stencil(y + i, ten);
+    Batch diffZ = stencil(z + i, ten);
+    store(curvature + i, add(add(mul(diffX, diffX), mul(diffY, diffY)), mul(diffZ, diffZ)));
+  }
+#endif
+  for (; i < end; i++) {
+    float diffX = stencil(x + i);
+    float diffY = stencil(y + i);
+    float diffZ = stencil(z + i);
+    curvature[i] = diffX * diffX + diffY * diffY + diffZ * diffZ;
+  }
+}
+
+//计算每个点深度的平方rangeSq、深度range，以及与后一个点距离的平方gapSq(最后一个点没有)
+inline void computeRangeAndGap(const float* x, const float* y, const float* z, int size,
+                               float* rangeSq, float* range, float* gapSq)
+{
+  using namespace scan_kernels_detail;
+
+  int i = 0;
+#ifdef LOAM_SCAN_KERNELS_SIMD
+  for (; i + batchSize <= size; i += batchSize) {
+    Batch px = load(x + i);
+    Batch py = load(y + i);
+    Batch pz = load(z + i);
+    Batch squared = add(add(mul(px, px), mul(py, py)), mul(pz, pz));
+    store(rangeSq + i, squared);
+    store(range + i, sqrt(squared));
+  }
+#endif
+  for (; i < size; i++) {
+    rangeSq[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+    range[i] = std::sqrt(rangeSq[i]);
+  }
+
+  i = 0;
+#ifdef LOAM_SCAN_KERNELS_SIMD
+  for (; i + batchSize < size; i += batchSize) {
+    Batch diffX = sub(load(x + i + 1), load(x + i));
+    Batch diffY = sub(load(y + i + 1), load(y + i));
+    Batch diffZ = sub(load(z + i + 1), load(z + i));
+    store(gapSq + i, add(add(mul(diffX, diffX), mul(diffY, diffY)), mul(diffZ, diffZ)));
+  }
+#endif
+  for (; i + 1 < size; i++) {
+    float diffX = x[i + 1] - x[i];
+    float diffY = y[i + 1] - y[i];
+    float diffZ = z[i + 1] - z[i];
+    gapSq[i] = diffX * diffX + diffY * diffY + diffZ * diffZ;
+  }
+}
+
+} // end namespace loam
+
+#endif // LOAM_VELODYNE_SCAN_KERNELS_H
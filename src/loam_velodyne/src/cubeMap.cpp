@@ -0,0 +1,409 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <loam_velodyne/CubeMap.h>
+#include <loam_velodyne/MapFile.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace loam {
+
+//换出文件的格式：文件头 + 边沿点 + 平面点，每个点依次保存x, y, z, intensity四个float
+static const uint32_t cubeFileMagic = 0x4255434c;//"LCUB"
+static const uint32_t cubeFileVersion = 1;
+
+struct CubeFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t i;
+  int32_t j;
+  int32_t k;
+  uint32_t pointNum[MapCube::FEATURE_NUM];
+  uint8_t filterDirty[MapCube::FEATURE_NUM];
+  uint8_t reserved[2];
+};
+
+//KdTreeFLANN建树时把点复制成紧凑的xyz数组，FLANN的单索引树按叶子重排后再复制一份，
+//另外各有一个点序号数组；叶子最多15个点，节点数约为点数的2/15
+static size_t kdtreeBytes(size_t pointNum)
+{
+  const size_t nodeBytes = 2 * sizeof(void*) + 2 * sizeof(float) + 2 * sizeof(int);
+  return pointNum * (2 * 3 * sizeof(float) + 2 * sizeof(int)) + pointNum * 2 / 15 * nodeBytes;
+}
+
+//逐级创建目录
+static bool makeDirectories(const std::string& directory)
+{
+  for (size_t pos = 1; pos <= directory.size(); pos++) {
+    if (pos == directory.size() || directory[pos] == '/') {
+      std::string path = directory.substr(0, pos);
+      if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+      }
+    }
+  }
+
+  struct stat info;
+  return stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+MapCube::MapCube()
+  : lastUsed(0),
+    lastModified(0)
+{
+  for (int i = 0; i < FEATURE_NUM; i++) {
+    cloud[i].reset(new pcl::PointCloud<PointType>());
+    kdtreeDirty[i] = true;
+    filteredNum[i] = 0;
+  }
+}
+
+size_t MapCube::memoryBytes() const
+{
+  size_t bytes = sizeof(MapCube);
+  for (int i = 0; i < FEATURE_NUM; i++) {
+    bytes += cloud[i]->points.capacity() * sizeof(PointType);
+    //哈希表每个元素一个节点，另加一个桶指针
+    bytes += voxels[i].size() * (sizeof(VoxelIndex::value_type) + 2 * sizeof(void*));
+    bytes += voxels[i].bucket_count() * sizeof(void*);
+    //脏的kd-tree在重建之前仍占用内存，以当前点数估计
+    if (kdtree[i]) {
+      bytes += sizeof(pcl::KdTreeFLANN<PointType>) + kdtreeBytes(cloud[i]->points.size());
+    }
+  }
+
+  return bytes;
+}
+
+CubeMap::CubeMap(float size)
+  : cubeSize(size),
+    frozen(false),
+    memoryBudget(0),
+    frameStamp(0),
+    spillCount(0),
+    reloadCount(0)
+{
+}
+
+bool CubeMap::setCubeSize(float size)
+{
+  if (size <= 0 || !cubes.empty() || !spilledCubes.empty() || !priorCubes.empty()) {
+    return false;
+  }
+
+  cubeSize = size;
+  return true;
+}
+
+bool CubeMap::setPriorMap(const std::shared_ptr<const MapFileReader>& map)
+{
+  if (!map || map->getCubeSize() != cubeSize ||
+      !cubes.empty() || !spilledCubes.empty() || !priorCubes.empty()) {
+    return false;
+  }
+
+  priorMap = map;
+  for (MapFileReader::ChunkTable::const_iterator it = map->getChunks().begin();
+       it != map->getChunks().end(); ++it) {
+    priorCubes.insert(it->first);
+  }
+
+  return true;
+}
+
+bool CubeMap::write(MapFileWriter& writer) const
+{
+  for (const_iterator it = cubes.begin(); it != cubes.end(); ++it) {
+    if (!writer.write(it->first, it->second)) {
+      return false;
+    }
+  }
+
+  //换出的与未解码的cube逐个读出再写入，不放回内存
+  for (std::unordered_set<CubeIndex, CubeIndexHash>::const_iterator it = spilledCubes.begin();
+       it != spilledCubes.end(); ++it) {
+    MapCube cube;
+    if (!readCube(*it, cube) || !writer.write(*it, cube)) {
+      return false;
+    }
+  }
+  for (std::unordered_set<CubeIndex, CubeIndexHash>::const_iterator it = priorCubes.begin();
+       it != priorCubes.end(); ++it) {
+    MapCube cube;
+    if (!priorMap->read(*it, cube) || !writer.write(*it, cube)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool CubeMap::setSpillDirectory(const std::string& directory)
+{
+  if (directory.empty() || !makeDirectories(directory)) {
+    return false;
+  }
+
+  spillDirectory = directory;
+  return true;
+}
+
+int CubeMap::cubeIndexOf(float coordinate) const
+{
+  //过半取一，负数向下取整，使(-cubeSize/2, cubeSize/2)都落在0号cube
+  return int(std::floor((coordinate + 0.5 * cubeSize) / cubeSize));
+}
+
+CubeIndex CubeMap::cubeIndexOf(float x, float y, float z) const
+{
+  return CubeIndex(cubeIndexOf(x), cubeIndexOf(y), cubeIndexOf(z));
+}
+
+MapCube* CubeMap::find(const CubeIndex& index)
+{
+  iterator it = cubes.find(index);
+  if (it == cubes.end()) {
+    it = reload(index);
+    if (it == cubes.end()) {
+      return NULL;
+    }
+  }
+
+  it->second.lastUsed = frameStamp;
+  return &it->second;
+}
+
+MapCube& CubeMap::findOrCreate(const CubeIndex& index)
+{
+  iterator it = cubes.find(index);
+  if (it == cubes.end()) {
+    it = reload(index);
+    if (it == cubes.end()) {
+      it = cubes.insert(std::make_pair(index, MapCube())).first;
+    }
+  }
+
+  it->second.lastUsed = frameStamp;
+  return it->second;
+}
+
+MapCube* CubeMap::findResident(const CubeIndex& index)
+{
+  iterator it = cubes.find(index);
+  return it == cubes.end() ? NULL : &it->second;
+}
+
+size_t CubeMap::residentBytes() const
+{
+  size_t bytes = 0;
+  for (const_iterator it = cubes.begin(); it != cubes.end(); ++it) {
+    bytes += it->second.memoryBytes();
+  }
+
+  return bytes;
+}
+
+void CubeMap::clear()
+{
+  for (std::unordered_set<CubeIndex, CubeIndexHash>::const_iterator it = spilledCubes.begin();
+       it != spilledCubes.end(); ++it) {
+    std::remove(cubeFileName(*it).c_str());
+  }
+
+  cubes.clear();
+  spilledCubes.clear();
+  priorCubes.clear();
+  priorMap.reset();
+}
+
+bool CubeMap::enforceMemoryBudget()
+{
+  if (memoryBudget == 0 || (spillDirectory.empty() && !frozen)) {
+    return true;
+  }
+
+  size_t bytes = residentBytes();
+  if (bytes <= memoryBudget) {
+    return true;
+  }
+
+  //本帧之前访问的cube按访问时间从旧到新排列
+  std::vector<std::pair<uint64_t, CubeIndex> > candidates;
+  for (const_iterator it = cubes.begin(); it != cubes.end(); ++it) {
+    if (it->second.lastUsed < frameStamp) {
+      candidates.push_back(std::make_pair(it->second.lastUsed, it->first));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<uint64_t, CubeIndex>& a, const std::pair<uint64_t, CubeIndex>& b) {
+              return a.first < b.first;
+            });
+
+  for (size_t n = 0; n < candidates.size() && bytes > memoryBudget; n++) {
+    iterator it = cubes.find(candidates[n].second);
+    //冻结的地图中先验地图的cube与文件中的内容相同，放回未解码的集合即可
+    if (frozen && priorMap && priorMap->getChunks().count(it->first) > 0) {
+      priorCubes.insert(it->first);
+    } else if (spillDirectory.empty()) {
+      continue;
+    } else if (!writeCube(it->first, it->second)) {
+      return false;
+    } else {
+      spilledCubes.insert(it->first);
+    }
+
+    bytes -= it->second.memoryBytes();
+    cubes.erase(it);
+    spillCount++;
+  }
+
+  return true;
+}
+
+std::string CubeMap::cubeFileName(const CubeIndex& index) const
+{
+  char name[64];
+  snprintf(name, sizeof(name), "/cube_%d_%d_%d.bin", index.i, index.j, index.k);
+  return spillDirectory + name;
+}
+
+bool CubeMap::writeCube(const CubeIndex& index, const MapCube& cube) const
+{
+  CubeFileHeader header;
+  header.magic = cubeFileMagic;
+  header.version = cubeFileVersion;
+  header.i = index.i;
+  header.j = index.j;
+  header.k = index.k;
+  header.reserved[0] = header.reserved[1] = 0;
+
+  std::vector<float> buffer;
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    const pcl::PointCloud<PointType>::VectorType& points = cube.cloud[f]->points;
+    header.pointNum[f] = points.size();
+    header.filterDirty[f] = cube.filteredNum[f] < points.size();
+    for (size_t n = 0; n < points.size(); n++) {
+      buffer.push_back(points[n].x);
+      buffer.push_back(points[n].y);
+      buffer.push_back(points[n].z);
+      buffer.push_back(points[n].intensity);
+    }
+  }
+
+  std::ofstream file(cubeFileName(index).c_str(), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!buffer.empty()) {
+    file.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size() * sizeof(float));
+  }
+  file.close();
+
+  return !file.fail();
+}
+
+bool CubeMap::readCube(const CubeIndex& index, MapCube& cube) const
+{
+  std::ifstream file(cubeFileName(index).c_str(), std::ios::binary);
+  CubeFileHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != cubeFileMagic || header.version != cubeFileVersion ||
+      header.i != index.i || header.j != index.j || header.k != index.k) {
+    return false;
+  }
+
+  std::vector<float> buffer;
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    buffer.resize(4 * size_t(header.pointNum[f]));
+    if (!buffer.empty() &&
+        !file.read(reinterpret_cast<char*>(&buffer[0]), buffer.size() * sizeof(float))) {
+      return false;
+    }
+
+    pcl::PointCloud<PointType>& points = *cube.cloud[f];
+    points.resize(header.pointNum[f]);
+    for (size_t n = 0; n < points.points.size(); n++) {
+      points.points[n].x = buffer[4 * n];
+      points.points[n].y = buffer[4 * n + 1];
+      points.points[n].z = buffer[4 * n + 2];
+      points.points[n].intensity = buffer[4 * n + 3];
+    }
+
+    //有未下采样的点时重新对整个cube下采样
+    cube.filteredNum[f] = header.filterDirty[f] != 0 ? 0 : points.points.size();
+    cube.voxels[f].clear();
+    cube.kdtreeDirty[f] = true;
+  }
+
+  return true;
+}
+
+CubeMap::iterator CubeMap::reload(const CubeIndex& index)
+{
+  std::unordered_set<CubeIndex, CubeIndexHash>::iterator spilled = spilledCubes.find(index);
+  if (spilled == spilledCubes.end()) {
+    //先验地图的cube只解码一次，之后与其它cube一样换出和读回
+    std::unordered_set<CubeIndex, CubeIndexHash>::iterator prior = priorCubes.find(index);
+    if (prior == priorCubes.end()) {
+      return cubes.end();
+    }
+
+    MapCube cube;
+    bool loaded = priorMap->read(index, cube);
+    priorCubes.erase(prior);
+    if (!loaded) {
+      return cubes.end();
+    }
+
+    reloadCount++;
+    return cubes.insert(std::make_pair(index, cube)).first;
+  }
+
+  //读取失败时丢弃该cube，当作没有走过的区域
+  MapCube cube;
+  bool loaded = readCube(index, cube);
+  spilledCubes.erase(spilled);
+  std::remove(cubeFileName(index).c_str());
+  if (!loaded) {
+    return cubes.end();
+  }
+
+  reloadCount++;
+  return cubes.insert(std::make_pair(index, cube)).first;
+}
+
+} // end namespace loam
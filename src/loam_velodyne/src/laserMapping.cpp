@@ -31,20 +31,22 @@
 //     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
 
 #include <math.h>
-
-#include <loam_velodyne/common.h>
-#include <nav_msgs/Odometry.h>
-#include <opencv/cv.h>
-#include <pcl_conversions/pcl_conversions.h>
-#include <pcl/point_cloud.h>
-#include <pcl/point_types.h>
-#include <pcl/filters/voxel_grid.h>
-#include <pcl/kdtree/kdtree_flann.h>
-#include <ros/ros.h>
-#include <sensor_msgs/Imu.h>
-#include <sensor_msgs/PointCloud2.h>
-#include <tf/transform_datatypes.h>
-#include <tf/transform_broadcaster.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include <loam_velodyne/LaserMapping.h>
+#include <loam_velodyne/fit_kernels.h>
+#include <loam_velodyne/logging.h>
+#include <loam_velodyne/MapFile.h>
+#include <loam_velodyne/point_transforms.h>
+#include <Eigen/Eigenvalues>
+#include <Eigen/QR>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace loam {
 
 //扫描周期
 const float scanPeriod = 0.1;
@@ -53,96 +55,268 @@ const float scanPeriod = 0.1;
 const int stackFrameNum = 1;
 //控制处理得到的点云map，每隔几次publich给rviz显示
 const int mapFrameNum = 5;
+//匹配时在所在cube每一维前后各2个cube中查找
+const int searchCubeRadius = 2;
+const int searchCubeWidth = 2 * searchCubeRadius + 1;
+//地图快照每一维前后各3个cube，匹配时比更新时的位置最多偏移一个cube也能覆盖查找范围
+const int snapshotCubeRadius = 3;
+const int snapshotCubeWidth = 2 * snapshotCubeRadius + 1;
+
+//cube当前的视图，使用之前需要先更新kd-tree
+static MapCubeView makeCubeView(const CubeIndex& index, const MapCube& cube)
+{
+  MapCubeView view;
+  view.index = index;
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    view.pointNum[f] = cube.cloud[f]->points.size();
+    view.kdtree[f] = cube.kdtree[f];
+  }
+
+  return view;
+}
+
+//将点云转换到世界坐标系后追加到cloudOut的末尾
+static void appendToMap(const EulerPose& pose, const pcl::PointCloud<PointType>& cloudIn,
+                        pcl::PointCloud<PointType>& cloudOut)
+{
+  int offset = cloudOut.points.size();
+  int cloudSize = cloudIn.points.size();
+  cloudOut.resize(offset + cloudSize);
+  transformPointsToMap(pose, cloudIn.points.data(), cloudOut.points.data() + offset, cloudSize);
+}
+
+//接收到的点云是共享的只读数据，结果写入新的点云
+static pcl::PointCloud<PointType>::Ptr registerCloud(const RegistrationJob& job)
+{
+  int cloudSize = job.fullRes->points.size();
+  pcl::PointCloud<PointType>::Ptr registered(new pcl::PointCloud<PointType>());
+  registered->resize(cloudSize);
+  transformPointsToMap(EulerPose(job.transformTobeMapped), job.fullRes->points.data(),
+                       registered->points.data(), cloudSize);
+
+  registered->header.stamp = pclStampFromSec(job.time);
+  registered->header.frame_id = "/camera_init";
+  return registered;
+}
+
+const int LaserMapping::imuQueLength;
+
+LaserMapping::LaserMapping()
+  : timeLaserOdometry(0),
+    dropPolicy(DROP_OLDEST),
+    droppedBundles(0),
+    asyncMapping(true),
+    mappingThreadStop(false),
+    validViewLookup(searchCubeWidth * searchCubeWidth * searchCubeWidth, -1),
+    pipelineMapUpdate(false),
+    mapUpdatePending(false),
+    mapUpdateThreadStop(false),
+    frontSnapshot(0),
+    asyncRegistration(false),
+    registrationPending(false),
+    registrationThreadStop(false),
+    laserCloudCornerLast(new pcl::PointCloud<PointType>()),
+    laserCloudSurfLast(new pcl::PointCloud<PointType>()),
+    laserCloudCornerStack(new pcl::PointCloud<PointType>()),
+    laserCloudSurfStack(new pcl::PointCloud<PointType>()),
+    laserCloudCornerStack2(new pcl::PointCloud<PointType>()),
+    laserCloudSurfStack2(new pcl::PointCloud<PointType>()),
+    laserCloudOri(new pcl::PointCloud<PointType>()),
+    coeffSel(new pcl::PointCloud<PointType>()),
+    laserCloudSurround2(new pcl::PointCloud<PointType>()),
+    laserCloudNearest(new pcl::PointCloud<PointType>()),
+    laserCloudFullRes(new pcl::PointCloud<PointType>()),
+    localizationOnly(false),
+    mapUpdateStamp(0),
+    surroundOutput(true),
+    surroundDelta(false),
+    surroundKeyframeInterval(10),
+    surroundDeltaCount(0),
+    lastDeltaStamp(0),
+    imuPointerFront(0),
+    imuBuffer(imuQueLength),
+    matA0(5, 3, CV_32F, cv::Scalar::all(0)),
+    matB0(5, 1, CV_32F, cv::Scalar::all(-1)),
+    matX0(3, 1, CV_32F, cv::Scalar::all(0)),
+    matA1(3, 3, CV_32F, cv::Scalar::all(0)),
+    matD1(1, 3, CV_32F, cv::Scalar::all(0)),
+    matV1(3, 3, CV_32F, cv::Scalar::all(0)),
+    isDegenerate(false),
+    matP(Eigen::Matrix<float, 6, 6>::Zero()),
+    numThreads(1),
+    useFixedSizeFit(true),
+    solverBudget(10, 1),
+    matchTimers({"cube select", "kd-tree build", "stack downsample", "optimization", "map update wait", "output"}),
+    mapTimers({"insert", "cube downsample", "surround", "spill", "snapshot"}),
+    frameCount(stackFrameNum - 1),   //0
+    mapFrameCount(mapFrameNum - 1)   //4
+{
+  //设置体素大小
+  downSizeFilterCorner.setLeafSize(0.2);
+  downSizeFilterSurf.setLeafSize(0.4);
+  downSizeFilterMap.setLeafSize(0.6);
+  cubeDownSizeFilterCorner.setLeafSize(0.2);
+  cubeDownSizeFilterSurf.setLeafSize(0.4);
+}
+
+LaserMapping::~LaserMapping()
+{
+  if (mappingThread.joinable()) {
+    mappingThreadStop = true;
+    {
+      std::lock_guard<std::mutex> lock(bundleMutex);
+    }
+    bundleCondition.notify_one();
+    mappingThread.join();
 
-//时间戳
-double timeLaserCloudCornerLast = 0;
-double timeLaserCloudSurfLast = 0;
-double timeLaserCloudFullRes = 0;
-double timeLaserOdometry = 0;
-
-//接收标志
-bool newLaserCloudCornerLast = false;
-bool newLaserCloudSurfLast = false;
-bool newLaserCloudFullRes = false;
-bool newLaserOdometry = false;
-
-int laserCloudCenWidth = 10;
-int laserCloudCenHeight = 5;
-int laserCloudCenDepth = 10;
-const int laserCloudWidth = 21;
-const int laserCloudHeight = 11;
-const int laserCloudDepth = 21;
-//点云方块集合最大数量
-const int laserCloudNum = laserCloudWidth * laserCloudHeight * laserCloudDepth;//4851
-
-//lidar视域范围内(FOV)的点云集索引
-int laserCloudValidInd[125];
-//lidar周围的点云集索引
-int laserCloudSurroundInd[125];
-
-//最新接收到的边沿点
-pcl::PointCloud<PointType>::Ptr laserCloudCornerLast(new pcl::PointCloud<PointType>());
-//最新接收到的平面点
-pcl::PointCloud<PointType>::Ptr laserCloudSurfLast(new pcl::PointCloud<PointType>());
-//存放当前收到的下采样之后的边沿点(in the local frame)
-pcl::PointCloud<PointType>::Ptr laserCloudCornerStack(new pcl::PointCloud<PointType>());
-//存放当前收到的下采样之后的平面点(in the local frame)
-pcl::PointCloud<PointType>::Ptr laserCloudSurfStack(new pcl::PointCloud<PointType>());
-//存放当前收到的边沿点，作为下采样的数据源
-pcl::PointCloud<PointType>::Ptr laserCloudCornerStack2(new pcl::PointCloud<PointType>());
-//存放当前收到的平面点，作为下采样的数据源
-pcl::PointCloud<PointType>::Ptr laserCloudSurfStack2(new pcl::PointCloud<PointType>());
-//原始点云坐标
-pcl::PointCloud<PointType>::Ptr laserCloudOri(new pcl::PointCloud<PointType>());
-pcl::PointCloud<PointType>::Ptr coeffSel(new pcl::PointCloud<PointType>());
-//匹配使用的特征点（下采样之后的）
-pcl::PointCloud<PointType>::Ptr laserCloudSurround(new pcl::PointCloud<PointType>());
-//匹配使用的特征点（下采样之前的）
-pcl::PointCloud<PointType>::Ptr laserCloudSurround2(new pcl::PointCloud<PointType>());
-//map中提取的匹配使用的边沿点
-pcl::PointCloud<PointType>::Ptr laserCloudCornerFromMap(new pcl::PointCloud<PointType>());
-//map中提取的匹配使用的平面点
-pcl::PointCloud<PointType>::Ptr laserCloudSurfFromMap(new pcl::PointCloud<PointType>());
-//点云全部点
-pcl::PointCloud<PointType>::Ptr laserCloudFullRes(new pcl::PointCloud<PointType>());
-//array都是以50米为单位的立方体地图，运行过程中会一直保存(有需要的话可考虑优化，只保存近邻的，或者直接数组开小一点)
-//存放边沿点的cube
-pcl::PointCloud<PointType>::Ptr laserCloudCornerArray[laserCloudNum];
-//存放平面点的cube
-pcl::PointCloud<PointType>::Ptr laserCloudSurfArray[laserCloudNum];
-//中间变量，存放下采样过的边沿点
-pcl::PointCloud<PointType>::Ptr laserCloudCornerArray2[laserCloudNum];
-//中间变量，存放下采样过的平面点
-pcl::PointCloud<PointType>::Ptr laserCloudSurfArray2[laserCloudNum];
-
-//kd-tree
-pcl::KdTreeFLANN<PointType>::Ptr kdtreeCornerFromMap(new pcl::KdTreeFLANN<PointType>());
-pcl::KdTreeFLANN<PointType>::Ptr kdtreeSurfFromMap(new pcl::KdTreeFLANN<PointType>());
-
-/*************高频转换量**************/
-//odometry计算得到的到世界坐标系下的转移矩阵
-float transformSum[6] = {0};
-//转移增量，只使用了后三个平移增量
-float transformIncre[6] = {0};
-
-/*************低频转换量*************/
-//以起始位置为原点的世界坐标系下的转换矩阵（猜测与调整的对象）
-float transformTobeMapped[6] = {0};
-//存放mapping之前的Odometry计算的世界坐标系的转换矩阵（注：低频量，不一定与transformSum一样）
-float transformBefMapped[6] = {0};
-//存放mapping之后的经过mapping微调之后的转换矩阵
-float transformAftMapped[6] = {0};
-
-int imuPointerFront = 0;
-int imuPointerLast = -1;
-const int imuQueLength = 200;
-
-double imuTime[imuQueLength] = {0};
-float imuRoll[imuQueLength] = {0};
-float imuPitch[imuQueLength] = {0};
+    //建图线程退出之后不再处理导出请求
+    for (size_t n = 0; n < exportRequests.size(); n++) {
+      exportRequests[n]->result.set_value(false);
+    }
+    exportRequests.clear();
+  }
+
+  if (mapUpdateThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mapUpdateMutex);
+      mapUpdateThreadStop = true;
+    }
+    mapUpdateCondition.notify_all();
+    mapUpdateThread.join();
+  }
+
+  if (registrationThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(registrationMutex);
+      registrationThreadStop = true;
+    }
+    registrationCondition.notify_all();
+    registrationThread.join();
+  }
+}
+
+bool LaserMapping::configure(const LaserMappingParams& params)
+{
+  numThreads = params.numThreads;
+  if (numThreads <= 0) {
+#ifdef _OPENMP
+    numThreads = omp_get_max_threads();
+#else
+    numThreads = 1;
+#endif
+  }
+
+  if (!laserCloudCubes.setCubeSize(params.cubeSize)) {
+    LOAM_ERROR("Invalid cubeSize parameter: %f (expected > 0)", params.cubeSize);
+    return false;
+  }
+
+  if (!params.priorMapFile.empty()) {
+    std::shared_ptr<MapFileReader> priorMap(new MapFileReader());
+    if (!priorMap->open(params.priorMapFile)) {
+      LOAM_ERROR("Invalid priorMapFile parameter: %s (cannot read map file)", params.priorMapFile.c_str());
+      return false;
+    }
+    if (!laserCloudCubes.setPriorMap(priorMap)) {
+      LOAM_ERROR("Invalid priorMapFile parameter: %s (cube size %f, expected %f)",
+                 params.priorMapFile.c_str(), priorMap->getCubeSize(), params.cubeSize);
+      return false;
+    }
+  }
+
+  localizationOnly = params.localizationOnly;
+  if (localizationOnly && params.priorMapFile.empty()) {
+    LOAM_ERROR("Invalid localizationOnly parameter: true (expected a priorMapFile to localize against)");
+    return false;
+  }
+  laserCloudCubes.setFrozen(localizationOnly);
+
+  if (params.mapMemoryBudgetMB < 0) {
+    LOAM_ERROR("Invalid mapMemoryBudgetMB parameter: %d (expected >= 0)", params.mapMemoryBudgetMB);
+    return false;
+  }
+  if (params.mapMemoryBudgetMB > 0) {
+    if (!laserCloudCubes.setSpillDirectory(params.mapSpillDirectory)) {
+      LOAM_ERROR("Invalid mapSpillDirectory parameter: %s (cannot create directory)",
+                 params.mapSpillDirectory.c_str());
+      return false;
+    }
+    laserCloudCubes.setMemoryBudget(size_t(params.mapMemoryBudgetMB) * 1024 * 1024);
+  }
+
+  useFixedSizeFit = params.useFixedSizeFit;
+
+  if (params.maxIterations < 1) {
+    LOAM_ERROR("Invalid maxIterations parameter: %d (expected at least 1)", params.maxIterations);
+    return false;
+  }
+  solverBudget.setMaxIterations(params.maxIterations);
+  solverBudget.setTimeBudget(params.timeBudget);
+  solverBudget.setReassociateThreshold(params.reassociateRotation, params.reassociateTranslation);
+
+  asyncMapping = params.asyncMapping;
+  if (params.mappingQueueSize < 1) {
+    LOAM_ERROR("Invalid mappingQueueSize parameter: %d (expected >= 1)", params.mappingQueueSize);
+    return false;
+  }
+  if (params.mappingDropPolicy == "drop_oldest") {
+    dropPolicy = DROP_OLDEST;
+  } else if (params.mappingDropPolicy == "latest") {
+    dropPolicy = PROCESS_LATEST;
+  } else if (params.mappingDropPolicy == "batch") {
+    dropPolicy = BATCH;
+  } else {
+    LOAM_ERROR("Invalid mappingDropPolicy parameter: %s (expected drop_oldest, latest or batch)",
+               params.mappingDropPolicy.c_str());
+    return false;
+  }
+  bundleQueue.reset(params.mappingQueueSize);
+
+  pipelineMapUpdate = params.pipelineMapUpdate;
+  asyncRegistration = params.asyncRegistration;
+
+  surroundDelta = params.surroundDelta;
+  if (params.surroundKeyframeInterval < 0) {
+    LOAM_ERROR("Invalid surroundKeyframeInterval parameter: %d (expected >= 0)", params.surroundKeyframeInterval);
+    return false;
+  }
+  surroundKeyframeInterval = params.surroundKeyframeInterval;
+
+  if (asyncRegistration) {
+    registrationThread = std::thread(&LaserMapping::registrationLoop, this);
+  }
+  if (pipelineMapUpdate) {
+    mapUpdateThread = std::thread(&LaserMapping::mapUpdateLoop, this);
+  }
+  if (asyncMapping) {
+    mappingThread = std::thread(&LaserMapping::mappingLoop, this);
+  }
+
+  return true;
+}
+
+void LaserMapping::process(const MappingBundle& bundle)
+{
+  enqueueBundle(bundle);
+
+  //同步建图时立即处理
+  if (!asyncMapping) {
+    processQueue();
+  }
+}
+
+//只使用了翻滚角和俯仰角
+void LaserMapping::processImu(const ImuSample& imu)
+{
+  ImuState imuState;
+  imuState.time = imu.time;
+  imuState.roll = imu.roll;
+  imuState.pitch = imu.pitch;
+  imuBuffer.push(imuState);
+}
 
 //基于匀速模型，根据上次微调的结果和odometry这次与上次计算的结果，猜测一个新的世界坐标系的转换矩阵transformTobeMapped
-void transformAssociateToMap()
+void LaserMapping::transformAssociateToMap()
 {
   float x1 = cos(transformSum[1]) * (transformBefMapped[3] - transformSum[3]) 
            - sin(transformSum[1]) * (transformBefMapped[5] - transformSum[5]);
@@ -231,32 +405,13 @@ void transformAssociateToMap()
 }
 
 //记录odometry发送的转换矩阵与mapping之后的转换矩阵，下一帧点云会使用(有IMU的话会使用IMU进行补偿)
-void transformUpdate()
+void LaserMapping::transformUpdate()
 {
-  if (imuPointerLast >= 0) {
-    float imuRollLast = 0, imuPitchLast = 0;
-    //查找点云时间戳小于imu时间戳的imu位置
-    while (imuPointerFront != imuPointerLast) {
-      if (timeLaserOdometry + scanPeriod < imuTime[imuPointerFront]) {
-        break;
-      }
-      imuPointerFront = (imuPointerFront + 1) % imuQueLength;
-    }
-
-    if (timeLaserOdometry + scanPeriod > imuTime[imuPointerFront]) {//未找到,此时imuPointerFront==imuPointerLast
-      imuRollLast = imuRoll[imuPointerFront];
-      imuPitchLast = imuPitch[imuPointerFront];
-    } else {
-      int imuPointerBack = (imuPointerFront + imuQueLength - 1) % imuQueLength;
-      float ratioFront = (timeLaserOdometry + scanPeriod - imuTime[imuPointerBack]) 
-                       / (imuTime[imuPointerFront] - imuTime[imuPointerBack]);
-      float ratioBack = (imuTime[imuPointerFront] - timeLaserOdometry - scanPeriod) 
-                      / (imuTime[imuPointerFront] - imuTime[imuPointerBack]);
-
-      //按时间比例求翻滚角和俯仰角
-      imuRollLast = imuRoll[imuPointerFront] * ratioFront + imuRoll[imuPointerBack] * ratioBack;
-      imuPitchLast = imuPitch[imuPointerFront] * ratioFront + imuPitch[imuPointerBack] * ratioBack;
-    }
+  //一帧结束时刻的IMU姿态，晚于所有测量时为最新的测量
+  ImuState imuLast;
+  if (imuBuffer.interpolate(timeLaserOdometry + scanPeriod, imuPointerFront, imuLast)) {
+    float imuRollLast = imuLast.roll;
+    float imuPitchLast = imuLast.pitch;
 
     //imu稍微补偿俯仰角和翻滚角
     transformTobeMapped[0] = 0.998 * transformTobeMapped[0] + 0.002 * imuPitchLast;
@@ -270,582 +425,806 @@ void transformUpdate()
   }
 }
 
-//根据调整计算后的转移矩阵，将点注册到全局世界坐标系下
-void pointAssociateToMap(PointType const * const pi, PointType * const po)
+void LaserMapping::accumulateNormalEquations(Eigen::Matrix<float, 6, 6>& matAtA,
+                                             Eigen::Matrix<float, 6, 1>& matAtB)
 {
-  //绕z轴旋转（transformTobeMapped[2]）
-  float x1 = cos(transformTobeMapped[2]) * pi->x
-           - sin(transformTobeMapped[2]) * pi->y;
-  float y1 = sin(transformTobeMapped[2]) * pi->x
-           + cos(transformTobeMapped[2]) * pi->y;
-  float z1 = pi->z;
-
-  //绕x轴旋转（transformTobeMapped[0]）
-  float x2 = x1;
-  float y2 = cos(transformTobeMapped[0]) * y1 - sin(transformTobeMapped[0]) * z1;
-  float z2 = sin(transformTobeMapped[0]) * y1 + cos(transformTobeMapped[0]) * z1;
-
-  //绕y轴旋转（transformTobeMapped[1]），再平移
-  po->x = cos(transformTobeMapped[1]) * x2 + sin(transformTobeMapped[1]) * z2
-        + transformTobeMapped[3];
-  po->y = y2 + transformTobeMapped[4];
-  po->z = -sin(transformTobeMapped[1]) * x2 + cos(transformTobeMapped[1]) * z2
-        + transformTobeMapped[5];
-  po->intensity = pi->intensity;
+  float srx = sin(transformTobeMapped[0]);
+  float crx = cos(transformTobeMapped[0]);
+  float sry = sin(transformTobeMapped[1]);
+  float cry = cos(transformTobeMapped[1]);
+  float srz = sin(transformTobeMapped[2]);
+  float crz = cos(transformTobeMapped[2]);
+
+  int laserCloudSelNum = laserCloudOri->points.size();
+
+  //每个线程各自累加一部分点，最后按线程顺序求和，保证结果与线程调度无关
+  std::vector<Eigen::Matrix<float, 6, 6>, Eigen::aligned_allocator<Eigen::Matrix<float, 6, 6> > >
+    matAtAThread(numThreads, Eigen::Matrix<float, 6, 6>::Zero());
+  std::vector<Eigen::Matrix<float, 6, 1>, Eigen::aligned_allocator<Eigen::Matrix<float, 6, 1> > >
+    matAtBThread(numThreads, Eigen::Matrix<float, 6, 1>::Zero());
+
+  #pragma omp parallel num_threads(numThreads)
+  {
+    int threadId = 0;
+#ifdef _OPENMP
+    threadId = omp_get_thread_num();
+#endif
+    Eigen::Matrix<float, 6, 6> matAtALocal = Eigen::Matrix<float, 6, 6>::Zero();
+    Eigen::Matrix<float, 6, 1> matAtBLocal = Eigen::Matrix<float, 6, 1>::Zero();
+    //matA的一行
+    Eigen::Matrix<float, 6, 1> matARow;
+
+    #pragma omp for schedule(static)
+    for (int i = 0; i < laserCloudSelNum; i++) {
+      const PointType& pointOri = laserCloudOri->points[i];
+      const PointType& coeff = coeffSel->points[i];
+
+      float arx = (crx*sry*srz*pointOri.x + crx*crz*sry*pointOri.y - srx*sry*pointOri.z) * coeff.x
+                + (-srx*srz*pointOri.x - crz*srx*pointOri.y - crx*pointOri.z) * coeff.y
+                + (crx*cry*srz*pointOri.x + crx*cry*crz*pointOri.y - cry*srx*pointOri.z) * coeff.z;
+
+      float ary = ((cry*srx*srz - crz*sry)*pointOri.x 
+                + (sry*srz + cry*crz*srx)*pointOri.y + crx*cry*pointOri.z) * coeff.x
+                + ((-cry*crz - srx*sry*srz)*pointOri.x 
+                + (cry*srz - crz*srx*sry)*pointOri.y - crx*sry*pointOri.z) * coeff.z;
+
+      float arz = ((crz*srx*sry - cry*srz)*pointOri.x + (-cry*crz-srx*sry*srz)*pointOri.y)*coeff.x
+                + (crx*crz*pointOri.x - crx*srz*pointOri.y) * coeff.y
+                + ((sry*srz + cry*crz*srx)*pointOri.x + (crz*sry-cry*srx*srz)*pointOri.y)*coeff.z;
+
+      matARow << arx, ary, arz, coeff.x, coeff.y, coeff.z;
+
+      //固定大小的矩阵运算由Eigen展开并向量化
+      matAtALocal.noalias() += matARow * matARow.transpose();
+      matAtBLocal.noalias() += matARow * (-coeff.intensity);
+    }
+
+    matAtAThread[threadId] = matAtALocal;
+    matAtBThread[threadId] = matAtBLocal;
+  }
+
+  matAtA.setZero();
+  matAtB.setZero();
+  for (int t = 0; t < numThreads; t++) {
+    matAtA += matAtAThread[t];
+    matAtB += matAtBThread[t];
+  }
 }
 
-//点转移到局部坐标系下
-void pointAssociateTobeMapped(PointType const * const pi, PointType * const po)
+//cube内容变化之后重建其kd-tree，空的cube不建树
+void LaserMapping::updateCubeKdtree(MapCube& cube, int feature)
 {
-  //平移后绕y轴旋转（-transformTobeMapped[1]）
-  float x1 = cos(transformTobeMapped[1]) * (pi->x - transformTobeMapped[3]) 
-           - sin(transformTobeMapped[1]) * (pi->z - transformTobeMapped[5]);
-  float y1 = pi->y - transformTobeMapped[4];
-  float z1 = sin(transformTobeMapped[1]) * (pi->x - transformTobeMapped[3]) 
-           + cos(transformTobeMapped[1]) * (pi->z - transformTobeMapped[5]);
-
-  //绕x轴旋转（-transformTobeMapped[0]）
-  float x2 = x1;
-  float y2 = cos(transformTobeMapped[0]) * y1 + sin(transformTobeMapped[0]) * z1;
-  float z2 = -sin(transformTobeMapped[0]) * y1 + cos(transformTobeMapped[0]) * z1;
-
-  //绕z轴旋转（-transformTobeMapped[2]）
-  po->x = cos(transformTobeMapped[2]) * x2
-        + sin(transformTobeMapped[2]) * y2;
-  po->y = -sin(transformTobeMapped[2]) * x2
-        + cos(transformTobeMapped[2]) * y2;
-  po->z = z2;
-  po->intensity = pi->intensity;
+  if (!cube.kdtreeDirty[feature] || cube.cloud[feature]->points.empty()) {
+    return;
+  }
+
+  //仍被快照引用的kd-tree不能重建，新建一个
+  if (!cube.kdtree[feature] || !cube.kdtree[feature].unique()) {
+    cube.kdtree[feature].reset(new pcl::KdTreeFLANN<PointType>());
+  }
+  cube.kdtree[feature]->setInputCloud(cube.cloud[feature]);
+  cube.kdtreeDirty[feature] = false;
 }
 
-//接收边沿点
-void laserCloudCornerLastHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudCornerLast2)
+//kd-tree只被cube自己引用时可以直接修改点云，否则点云仍被快照中的kd-tree使用
+void LaserMapping::copyCubeOnWrite(MapCube& cube, int feature)
 {
-  timeLaserCloudCornerLast = laserCloudCornerLast2->header.stamp.toSec();
+  if (!cube.kdtree[feature] || cube.kdtree[feature].unique()) {
+    return;
+  }
 
-  laserCloudCornerLast->clear();
-  pcl::fromROSMsg(*laserCloudCornerLast2, *laserCloudCornerLast);
+  cube.cloud[feature].reset(new pcl::PointCloud<PointType>(*cube.cloud[feature]));
+  cube.kdtree[feature].reset();
+  cube.kdtreeDirty[feature] = true;
+}
 
-  newLaserCloudCornerLast = true;
+//把cube中新加入的点合并到已经下采样过的体素中，不再对整个cube重新滤波
+void LaserMapping::downsizeCube(MapCube& cube, int feature, VoxelFilter& downSizeFilter)
+{
+  if (cube.filteredNum[feature] == cube.cloud[feature]->points.size()) {
+    return;
+  }
+
+  copyCubeOnWrite(cube, feature);
+  cube.filteredNum[feature] = downSizeFilter.merge(*cube.cloud[feature], cube.filteredNum[feature],
+                                                   cube.voxels[feature]);
+  cube.kdtreeDirty[feature] = true;
 }
 
-//接收平面点
-void laserCloudSurfLastHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudSurfLast2)
+bool LaserMapping::nearestKSearchCubes(int feature, const PointType& point,
+                                       pcl::PointCloud<PointType>& nearestPoints,
+                                       std::vector<float>& nearestSqDis)
 {
-  timeLaserCloudSurfLast = laserCloudSurfLast2->header.stamp.toSec();
+  //最近的5个点都要在1米以内才被接受,1米以内的点只可能落在与该点1米邻域相交的cube中(至多8个)，
+  //因此只查询这些cube，被接受的结果与在全部视域cube拼接成的点云上查找一致
+  const int searchNum = 5;
+  const float searchRadius = 1.0;
+
+  CubeIndex minIndex = laserCloudCubes.cubeIndexOf(point.x - searchRadius,
+                                                   point.y - searchRadius, point.z - searchRadius);
+  CubeIndex maxIndex = laserCloudCubes.cubeIndexOf(point.x + searchRadius,
+                                                   point.y + searchRadius, point.z + searchRadius);
+
+  nearestPoints.clear();
+  nearestSqDis.clear();
+  mapSearchCandidates.clear();
+  for (int i = minIndex.i; i <= maxIndex.i; i++) {
+    for (int j = minIndex.j; j <= maxIndex.j; j++) {
+      for (int k = minIndex.k; k <= maxIndex.k; k++) {
+        const MapCubeView* view = validCubeView(CubeIndex(i, j, k));
+        if (view == NULL || view->pointNum[feature] == 0) {
+          continue;
+        }
+
+        const pcl::KdTreeFLANN<PointType>& kdtree = *view->kdtree[feature];
+        kdtree.nearestKSearch(point, searchNum, pointSearchInd, pointSearchSqDis);
+        const pcl::PointCloud<PointType>& cloud = *kdtree.getInputCloud();
+        for (size_t n = 0; n < pointSearchInd.size(); n++) {
+          if (pointSearchSqDis[n] < searchRadius * searchRadius) {
+            mapSearchCandidates.push_back(std::make_pair(pointSearchSqDis[n], nearestPoints.points.size()));
+            nearestPoints.push_back(cloud.points[pointSearchInd[n]]);
+          }
+        }
+      }
+    }
+  }
 
-  laserCloudSurfLast->clear();
-  pcl::fromROSMsg(*laserCloudSurfLast2, *laserCloudSurfLast);
+  if (mapSearchCandidates.size() < searchNum) {
+    return false;
+  }
+
+  //按距离从小到大取前5个
+  std::partial_sort(mapSearchCandidates.begin(), mapSearchCandidates.begin() + searchNum,
+                    mapSearchCandidates.end());
+  mapSearchPoints.clear();
+  for (int n = 0; n < searchNum; n++) {
+    mapSearchPoints.push_back(nearestPoints.points[mapSearchCandidates[n].second]);
+    nearestSqDis.push_back(mapSearchCandidates[n].first);
+  }
+  nearestPoints.swap(mapSearchPoints);
+
+  return true;
+}
+
+const MapCubeView* LaserMapping::validCubeView(const CubeIndex& index) const
+{
+  int di = index.i - validViewCenter.i + searchCubeRadius;
+  int dj = index.j - validViewCenter.j + searchCubeRadius;
+  int dk = index.k - validViewCenter.k + searchCubeRadius;
+  if (di < 0 || di >= searchCubeWidth || dj < 0 || dj >= searchCubeWidth || dk < 0 || dk >= searchCubeWidth) {
+    return NULL;
+  }
 
-  newLaserCloudSurfLast = true;
+  int n = validViewLookup[(di * searchCubeWidth + dj) * searchCubeWidth + dk];
+  return n >= 0 ? &laserCloudValidViews[n] : NULL;
 }
 
-//接收点云全部点
-void laserCloudFullResHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudFullRes2)
+const MapCubeView* LaserMapping::snapshotCubeView(const CubeIndex& index) const
 {
-  timeLaserCloudFullRes = laserCloudFullRes2->header.stamp.toSec();
+  const MapSnapshot& snapshot = mapSnapshots[frontSnapshot];
+  int di = index.i - snapshot.center.i + snapshotCubeRadius;
+  int dj = index.j - snapshot.center.j + snapshotCubeRadius;
+  int dk = index.k - snapshot.center.k + snapshotCubeRadius;
+  if (snapshot.cubes.empty() || di < 0 || di >= snapshotCubeWidth ||
+      dj < 0 || dj >= snapshotCubeWidth || dk < 0 || dk >= snapshotCubeWidth) {
+    return NULL;
+  }
 
-  laserCloudFullRes->clear();
-  pcl::fromROSMsg(*laserCloudFullRes2, *laserCloudFullRes);
+  const MapCubeView& view = snapshot.cubes[(di * snapshotCubeWidth + dj) * snapshotCubeWidth + dk];
+  if (view.pointNum[MapCube::CORNER] == 0 && view.pointNum[MapCube::SURF] == 0) {
+    return NULL;
+  }
 
-  newLaserCloudFullRes = true;
+  return &view;
 }
 
-//接收旋转平移信息
-void laserOdometryHandler(const nav_msgs::Odometry::ConstPtr& laserOdometry)
+void LaserMapping::updateMap(const MapUpdate& update, MapOutput& output)
 {
-  timeLaserOdometry = laserOdometry->header.stamp.toSec();
+  output = MapOutput();
+  output.time = update.time;
+
+  ScopedTimer timer(mapTimers, STAGE_INSERT);
+  mapUpdateStamp++;
+
+  //只定位时地图只读，不加入新点也不再下采样
+  if (!localizationOnly) {
+    //将corner points按距离（比例尺缩小）归入相应的立方体，没有走过的cube新建
+    int cornerPointNum = update.cornerPoints->points.size();
+    for (int i = 0; i < cornerPointNum; i++) {
+      const PointType& point = update.cornerPoints->points[i];
+      MapCube& cube = laserCloudCubes.findOrCreate(laserCloudCubes.cubeIndexOf(point.x, point.y, point.z));
+      copyCubeOnWrite(cube, MapCube::CORNER);
+      cube.cloud[MapCube::CORNER]->push_back(point);
+      cube.kdtreeDirty[MapCube::CORNER] = true;
+      cube.lastModified = mapUpdateStamp;
+    }
 
-  double roll, pitch, yaw;
-  //四元数转换为欧拉角
-  geometry_msgs::Quaternion geoQuat = laserOdometry->pose.pose.orientation;
-  tf::Matrix3x3(tf::Quaternion(geoQuat.z, -geoQuat.x, -geoQuat.y, geoQuat.w)).getRPY(roll, pitch, yaw);
+    //将surf points按距离（比例尺缩小）归入相应的立方体
+    int surfPointNum = update.surfPoints->points.size();
+    for (int i = 0; i < surfPointNum; i++) {
+      const PointType& point = update.surfPoints->points[i];
+      MapCube& cube = laserCloudCubes.findOrCreate(laserCloudCubes.cubeIndexOf(point.x, point.y, point.z));
+      copyCubeOnWrite(cube, MapCube::SURF);
+      cube.cloud[MapCube::SURF]->push_back(point);
+      cube.kdtreeDirty[MapCube::SURF] = true;
+      cube.lastModified = mapUpdateStamp;
+    }
 
-  transformSum[0] = -pitch;
-  transformSum[1] = -yaw;
-  transformSum[2] = roll;
+    //特征点下采样，只把视域内有新点加入的cube中的新点合并到已有的体素中
+    timer.next(STAGE_CUBE_DOWNSAMPLE);
+    for (size_t i = 0; i < update.validCubes.size(); i++) {
+      MapCube* cube = laserCloudCubes.find(update.validCubes[i]);
+      if (cube != NULL) {
+        downsizeCube(*cube, MapCube::CORNER, cubeDownSizeFilterCorner);
+        downsizeCube(*cube, MapCube::SURF, cubeDownSizeFilterSurf);
+      }
+    }
+  }
 
-  transformSum[3] = laserOdometry->pose.pose.position.x;
-  transformSum[4] = laserOdometry->pose.pose.position.y;
-  transformSum[5] = laserOdometry->pose.pose.position.z;
+  timer.next(STAGE_SURROUND);
+  mapFrameCount++;
+  //特征点汇总下采样，每隔五帧输出一次，从第一次开始
+  if (mapFrameCount >= mapFrameNum) {
+    mapFrameCount = 0;
+    output.publishFrame = true;
+
+    //没有人需要时省去拼接与整体下采样
+    if (surroundOutput) {
+      laserCloudSurround2->clear();
+      for (size_t i = 0; i < update.surroundCubes.size(); i++) {
+        MapCube* cube = laserCloudCubes.find(update.surroundCubes[i]);
+        if (cube != NULL) {
+          *laserCloudSurround2 += *cube->cloud[MapCube::CORNER];
+          *laserCloudSurround2 += *cube->cloud[MapCube::SURF];
+        }
+      }
+
+      pcl::PointCloud<PointType>::Ptr laserCloudSurround(new pcl::PointCloud<PointType>());
+      cubeDownSizeFilterCorner.filter(*laserCloudSurround2, *laserCloudSurround);
+
+      laserCloudSurround->header.stamp = pclStampFromSec(update.time);
+      laserCloudSurround->header.frame_id = "/camera_init";
+      output.surround = laserCloudSurround;
+    }
+
+    if (surroundDelta) {
+      std::shared_ptr<SurroundDelta> delta(new SurroundDelta());
+      buildSurroundDelta(update, *delta);
+      output.surroundDelta = delta;
+    }
+  }
+
+  //地图内存超出预算时换出最久未访问的cube，本帧用到的cube都已更新过访问时间
+  timer.next(STAGE_SPILL);
+  if (!laserCloudCubes.enforceMemoryBudget()) {
+    LOAM_WARN_THROTTLE(10.0, "Failed to spill map cubes to %s, map memory exceeds the budget",
+                       laserCloudCubes.getSpillDirectory().c_str());
+  }
 
-  newLaserOdometry = true;
+  //与周围的地图一起给出地图内存使用情况
+  if (output.publishFrame) {
+    output.solverReport = update.solverReport;
+    output.residentCubes = laserCloudCubes.size();
+    output.residentBytes = laserCloudCubes.residentBytes();
+    output.memoryBudget = laserCloudCubes.getMemoryBudget();
+    output.spilledCubes = laserCloudCubes.spilledSize();
+    output.spillCount = laserCloudCubes.getSpillCount();
+    output.reloadCount = laserCloudCubes.getReloadCount();
+    output.bundleQueueCapacity = bundleQueue.capacity();
+    output.droppedBundles = droppedBundles.load();
+  }
 }
 
-//接收IMU信息，只使用了翻滚角和俯仰角
-void imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn)
+void LaserMapping::buildSurroundDelta(const MapUpdate& update, SurroundDelta& delta)
 {
-  double roll, pitch, yaw;
-  tf::Quaternion orientation;
-  tf::quaternionMsgToTF(imuIn->orientation, orientation);
-  tf::Matrix3x3(orientation).getRPY(roll, pitch, yaw);
+  //第一次与每隔surroundKeyframeInterval次给出周围全部的cube，接收方借此丢弃离开周围的cube
+  delta.time = update.time;
+  delta.keyframe = surroundDeltaCount == 0 ||
+                   (surroundKeyframeInterval > 0 && surroundDeltaCount % surroundKeyframeInterval == 0);
+  surroundDeltaCount++;
+
+  for (size_t i = 0; i < update.surroundCubes.size(); i++) {
+    const MapCube* cube = laserCloudCubes.find(update.surroundCubes[i]);
+    if (cube == NULL || (!delta.keyframe && cube->lastModified <= lastDeltaStamp)) {
+      continue;
+    }
 
-  imuPointerLast = (imuPointerLast + 1) % imuQueLength;
+    delta.cubes.push_back(update.surroundCubes[i]);
+    delta.pointStart.push_back(delta.points.size());
+    delta.points += *cube->cloud[MapCube::CORNER];
+    delta.points += *cube->cloud[MapCube::SURF];
+    delta.pointSize.push_back(delta.points.size() - delta.pointStart.back());
+  }
 
-  imuTime[imuPointerLast] = imuIn->header.stamp.toSec();
-  imuRoll[imuPointerLast] = roll;
-  imuPitch[imuPointerLast] = pitch;
+  lastDeltaStamp = mapUpdateStamp;
 }
 
-int main(int argc, char** argv)
+void LaserMapping::finishMapUpdate(const MapOutput& output)
 {
-  ros::init(argc, argv, "laserMapping");
-  ros::NodeHandle nh;
+  mapTimers.finishFrame();
+  if (mapCallback) {
+    mapCallback(output);
+  }
+}
 
-  ros::Subscriber subLaserCloudCornerLast = nh.subscribe<sensor_msgs::PointCloud2>
-                                            ("/laser_cloud_corner_last", 2, laserCloudCornerLastHandler);
+//快照中的cube都重建好kd-tree，匹配时不需要再访问地图
+void LaserMapping::buildMapSnapshot(const CubeIndex& center, MapSnapshot& snapshot)
+{
+  ScopedTimer timer(mapTimers, STAGE_SNAPSHOT);
+  snapshot.center = center;
+  snapshot.cubes.assign(snapshotCubeWidth * snapshotCubeWidth * snapshotCubeWidth, MapCubeView());
+
+  int n = 0;
+  for (int i = center.i - snapshotCubeRadius; i <= center.i + snapshotCubeRadius; i++) {
+    for (int j = center.j - snapshotCubeRadius; j <= center.j + snapshotCubeRadius; j++) {
+      for (int k = center.k - snapshotCubeRadius; k <= center.k + snapshotCubeRadius; k++, n++) {
+        CubeIndex cubeIndex(i, j, k);
+        MapCube* cube = laserCloudCubes.find(cubeIndex);
+        if (cube == NULL) {
+          continue;
+        }
 
-  ros::Subscriber subLaserCloudSurfLast = nh.subscribe<sensor_msgs::PointCloud2>
-                                          ("/laser_cloud_surf_last", 2, laserCloudSurfLastHandler);
+        updateCubeKdtree(*cube, MapCube::CORNER);
+        updateCubeKdtree(*cube, MapCube::SURF);
+        snapshot.cubes[n] = makeCubeView(cubeIndex, *cube);
+      }
+    }
+  }
+}
 
-  ros::Subscriber subLaserOdometry = nh.subscribe<nav_msgs::Odometry> 
-                                     ("/laser_odom_to_init", 5, laserOdometryHandler);
+void LaserMapping::submitMapUpdate()
+{
+  std::unique_lock<std::mutex> lock(mapUpdateMutex);
+  //上一次更新完成时快照也已经建好，之后的匹配使用这个快照
+  mapUpdateCondition.wait(lock, [this] { return !mapUpdatePending; });
+  frontSnapshot = 1 - frontSnapshot;
+
+  //交换缓存，不拷贝点云
+  std::swap(currentUpdate, mapUpdateJob);
+  mapUpdatePending = true;
+  lock.unlock();
+  mapUpdateCondition.notify_all();
+}
 
-  ros::Subscriber subLaserCloudFullRes = nh.subscribe<sensor_msgs::PointCloud2> 
-                                         ("/velodyne_cloud_3", 2, laserCloudFullResHandler);
+void LaserMapping::mapUpdateLoop()
+{
+  std::unique_lock<std::mutex> lock(mapUpdateMutex);
+  for (;;) {
+    mapUpdateCondition.wait(lock, [this] { return mapUpdateThreadStop || mapUpdatePending; });
+    if (mapUpdateThreadStop) {
+      return;
+    }
+    lock.unlock();
+
+    //快照写入匹配没有使用的那一个
+    laserCloudCubes.beginFrame();
+    MapOutput output;
+    updateMap(mapUpdateJob, output);
+    buildMapSnapshot(mapUpdateJob.center, mapSnapshots[1 - frontSnapshot]);
+    finishMapUpdate(output);
+
+    lock.lock();
+    mapUpdatePending = false;
+    mapUpdateCondition.notify_all();
+  }
+}
 
-  ros::Subscriber subImu = nh.subscribe<sensor_msgs::Imu> ("/imu/data", 50, imuHandler);
+void LaserMapping::submitRegistration(const RegistrationJob& job)
+{
+  {
+    std::lock_guard<std::mutex> lock(registrationMutex);
+    pendingRegistration = job;
+    registrationPending = true;
+  }
+  registrationCondition.notify_one();
+}
+
+void LaserMapping::registrationLoop()
+{
+  std::unique_lock<std::mutex> lock(registrationMutex);
+  for (;;) {
+    registrationCondition.wait(lock, [this] { return registrationThreadStop || registrationPending; });
+    if (registrationThreadStop) {
+      return;
+    }
+    RegistrationJob job = pendingRegistration;
+    pendingRegistration = RegistrationJob();
+    registrationPending = false;
+    lock.unlock();
+
+    registeredCloudCallback(registerCloud(job));
+
+    lock.lock();
+  }
+}
 
-  ros::Publisher pubLaserCloudSurround = nh.advertise<sensor_msgs::PointCloud2> 
-                                         ("/laser_cloud_surround", 1);
+void LaserMapping::enqueueBundle(const MappingBundle& bundle)
+{
+  //队列满时丢弃最旧的帧，接收回调从不等待建图
+  while (!bundleQueue.push(bundle)) {
+    MappingBundle dropped;
+    if (bundleQueue.pop(dropped)) {
+      droppedBundles++;
+    }
+  }
 
-  ros::Publisher pubLaserCloudFullRes = nh.advertise<sensor_msgs::PointCloud2> 
-                                        ("/velodyne_cloud_registered", 2);
+  if (asyncMapping) {
+    //空的临界区保证建图线程要么还没检查队列，要么已经在等待，不会错过通知
+    {
+      std::lock_guard<std::mutex> lock(bundleMutex);
+    }
+    bundleCondition.notify_one();
+  }
+}
 
-  ros::Publisher pubOdomAftMapped = nh.advertise<nav_msgs::Odometry> ("/aft_mapped_to_init", 5);
-  nav_msgs::Odometry odomAftMapped;
-  odomAftMapped.header.frame_id = "/camera_init";
-  odomAftMapped.child_frame_id = "/aft_mapped";
+void LaserMapping::mappingLoop()
+{
+  while (!mappingThreadStop) {
+    {
+      std::unique_lock<std::mutex> lock(bundleMutex);
+      bundleCondition.wait_for(lock, std::chrono::milliseconds(100), [this] {
+        return mappingThreadStop || !bundleQueue.empty() || !exportRequests.empty();
+      });
+    }
 
-  tf::TransformBroadcaster tfBroadcaster;
-  tf::StampedTransform aftMappedTrans;
-  aftMappedTrans.frame_id_ = "/camera_init";
-  aftMappedTrans.child_frame_id_ = "/aft_mapped";
+    processQueue();
+    processExports();
+  }
+}
 
-  std::vector<int> pointSearchInd;
-  std::vector<float> pointSearchSqDis;
+bool LaserMapping::exportMap(const std::string& fileName, bool quantize)
+{
+  if (!asyncMapping) {
+    return writeMap(fileName, quantize);
+  }
 
-  PointType pointOri, pointSel, pointProj, coeff;
+  std::shared_ptr<ExportRequest> request(new ExportRequest());
+  request->fileName = fileName;
+  request->quantize = quantize;
+  std::future<bool> result = request->result.get_future();
+  {
+    std::lock_guard<std::mutex> lock(bundleMutex);
+    if (mappingThreadStop || !mappingThread.joinable()) {
+      return false;
+    }
+    exportRequests.push_back(request);
+  }
+  bundleCondition.notify_one();
 
-  cv::Mat matA0(5, 3, CV_32F, cv::Scalar::all(0));
-  cv::Mat matB0(5, 1, CV_32F, cv::Scalar::all(-1));
-  cv::Mat matX0(3, 1, CV_32F, cv::Scalar::all(0));
+  return result.get();
+}
 
-  cv::Mat matA1(3, 3, CV_32F, cv::Scalar::all(0));
-  cv::Mat matD1(1, 3, CV_32F, cv::Scalar::all(0));
-  cv::Mat matV1(3, 3, CV_32F, cv::Scalar::all(0));
+void LaserMapping::processExports()
+{
+  std::vector<std::shared_ptr<ExportRequest> > requests;
+  {
+    std::lock_guard<std::mutex> lock(bundleMutex);
+    requests.swap(exportRequests);
+  }
 
-  bool isDegenerate = false;
-  cv::Mat matP(6, 6, CV_32F, cv::Scalar::all(0));
+  for (size_t n = 0; n < requests.size(); n++) {
+    requests[n]->result.set_value(writeMap(requests[n]->fileName, requests[n]->quantize));
+  }
+}
 
-  //创建VoxelGrid滤波器（体素栅格滤波器）
-  pcl::VoxelGrid<PointType> downSizeFilterCorner;
-  //设置体素大小
-  downSizeFilterCorner.setLeafSize(0.2, 0.2, 0.2);
+bool LaserMapping::writeMap(const std::string& fileName, bool quantize)
+{
+  //流水线模式下地图由地图更新线程修改，等它空闲之后再读；新的更新只会由本线程提交
+  if (pipelineMapUpdate) {
+    std::unique_lock<std::mutex> lock(mapUpdateMutex);
+    mapUpdateCondition.wait(lock, [this] { return !mapUpdatePending; });
+  }
 
-  pcl::VoxelGrid<PointType> downSizeFilterSurf;
-  downSizeFilterSurf.setLeafSize(0.4, 0.4, 0.4);
+  MapFileWriter writer;
+  if (!writer.open(fileName, laserCloudCubes.getCubeSize(), quantize)) {
+    LOAM_ERROR("Cannot open map file %s for writing", fileName.c_str());
+    return false;
+  }
+  //没有全部写入时不替换原来的文件，writer析构时删除临时文件
+  if (!laserCloudCubes.write(writer) || !writer.close()) {
+    LOAM_ERROR("Failed to write map file %s", fileName.c_str());
+    return false;
+  }
 
-  pcl::VoxelGrid<PointType> downSizeFilterMap;
-  downSizeFilterMap.setLeafSize(0.6, 0.6, 0.6);
+  return true;
+}
 
-  //指针初始化
-  for (int i = 0; i < laserCloudNum; i++) {
-    laserCloudCornerArray[i].reset(new pcl::PointCloud<PointType>());
-    laserCloudSurfArray[i].reset(new pcl::PointCloud<PointType>());
-    laserCloudCornerArray2[i].reset(new pcl::PointCloud<PointType>());
-    laserCloudSurfArray2[i].reset(new pcl::PointCloud<PointType>());
+void LaserMapping::processQueue()
+{
+  MappingBundle bundle;
+  if (!bundleQueue.pop(bundle)) {
+    return;
   }
 
-  int frameCount = stackFrameNum - 1;   //0
-  int mapFrameCount = mapFrameNum - 1;  //4
-  ros::Rate rate(100);
-  bool status = ros::ok();
-  while (status) {
-    ros::spinOnce();
-
-    if (newLaserCloudCornerLast && newLaserCloudSurfLast && newLaserCloudFullRes && newLaserOdometry &&
-        fabs(timeLaserCloudCornerLast - timeLaserOdometry) < 0.005 &&
-        fabs(timeLaserCloudSurfLast - timeLaserOdometry) < 0.005 &&
-        fabs(timeLaserCloudFullRes - timeLaserOdometry) < 0.005) {
-      newLaserCloudCornerLast = false;
-      newLaserCloudSurfLast = false;
-      newLaserCloudFullRes = false;
-      newLaserOdometry = false;
-
-      frameCount++;
-      //控制跳帧数，>=这里实际并没有跳帧，只取>或者增大stackFrameNum才能实现相应的跳帧处理
-      if (frameCount >= stackFrameNum) {
-        //获取世界坐标系转换矩阵
-        transformAssociateToMap();
-
-        //将最新接收到的平面点和边沿点进行旋转平移转换到世界坐标系下(这里和后面的逆转换应无必要)
-        int laserCloudCornerLastNum = laserCloudCornerLast->points.size();
-        for (int i = 0; i < laserCloudCornerLastNum; i++) {
-          pointAssociateToMap(&laserCloudCornerLast->points[i], &pointSel);
-          laserCloudCornerStack2->push_back(pointSel);
-        }
+  MappingBundle next;
+  switch (dropPolicy) {
+    case DROP_OLDEST:
+      mapBundle(bundle, true);
+      while (!mappingThreadStop && bundleQueue.pop(bundle)) {
+        mapBundle(bundle, true);
+      }
+      break;
 
-        int laserCloudSurfLastNum = laserCloudSurfLast->points.size();
-        for (int i = 0; i < laserCloudSurfLastNum; i++) {
-          pointAssociateToMap(&laserCloudSurfLast->points[i], &pointSel);
-          laserCloudSurfStack2->push_back(pointSel);
-        }
+    case PROCESS_LATEST:
+      while (bundleQueue.pop(next)) {
+        bundle = next;
+        droppedBundles++;
       }
+      mapBundle(bundle, true);
+      break;
+
+    case BATCH:
+      //前面的帧只转换到地图坐标系下累加，最后一帧一起匹配
+      while (bundleQueue.pop(next)) {
+        mapBundle(bundle, false);
+        bundle = next;
+      }
+      mapBundle(bundle, true);
+      break;
+  }
+}
 
-      if (frameCount >= stackFrameNum) {
-        frameCount = 0;
-
-        PointType pointOnYAxis;
-        pointOnYAxis.x = 0.0;
-        pointOnYAxis.y = 10.0;
-        pointOnYAxis.z = 0.0;
-        //获取y方向上10米高位置的点在世界坐标系下的坐标
-        pointAssociateToMap(&pointOnYAxis, &pointOnYAxis);
-
-        //立方体中点在世界坐标系下的（原点）位置
-        //过半取一（以50米进行四舍五入的效果），由于数组下标只能为正数，而地图可能建立在原点前后，因此
-        //每一维偏移一个laserCloudCenWidth（该值会动态调整，以使得数组利用最大化，初始值为该维数组长度1/2）的量
-        int centerCubeI = int((transformTobeMapped[3] + 25.0) / 50.0) + laserCloudCenWidth;
-        int centerCubeJ = int((transformTobeMapped[4] + 25.0) / 50.0) + laserCloudCenHeight;
-        int centerCubeK = int((transformTobeMapped[5] + 25.0) / 50.0) + laserCloudCenDepth;
-
-        //由于计算机求余是向零取整，为了不使（-50.0,50.0）求余后都向零偏移，当被求余数为负数时求余结果统一向左偏移一个单位，也即减一
-        if (transformTobeMapped[3] + 25.0 < 0) centerCubeI--;
-        if (transformTobeMapped[4] + 25.0 < 0) centerCubeJ--;
-        if (transformTobeMapped[5] + 25.0 < 0) centerCubeK--;
-
-        //调整之后取值范围:3 < centerCubeI < 18， 3 < centerCubeJ < 8, 3 < centerCubeK < 18
-        //如果处于下边界，表明地图向负方向延伸的可能性比较大，则循环移位，将数组中心点向上边界调整一个单位
-        while (centerCubeI < 3) {
-          for (int j = 0; j < laserCloudHeight; j++) {
-            for (int k = 0; k < laserCloudDepth; k++) {//实现一次循环移位效果
-              int i = laserCloudWidth - 1;
-              //指针赋值，保存最后一个指针位置
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeCornerPointer =
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];//that's [i + 21 * j + 231 * k]
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeSurfPointer =
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              //循环移位，I维度上依次后移
-              for (; i >= 1; i--) {
-                laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudCornerArray[i - 1 + laserCloudWidth*j + laserCloudWidth * laserCloudHeight * k];
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudSurfArray[i - 1 + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              }
-              //将开始点赋值为最后一个点
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeCornerPointer;
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeSurfPointer;
-              laserCloudCubeCornerPointer->clear();
-              laserCloudCubeSurfPointer->clear();
-            }
-          }
+void LaserMapping::mapBundle(const MappingBundle& bundle, bool optimize)
+{
+  timeLaserOdometry = bundle.time;
+  laserCloudCornerLast = bundle.cornerLast;
+  laserCloudSurfLast = bundle.surfLast;
+  laserCloudFullRes = bundle.fullRes;
+  for (int i = 0; i < 6; i++) {
+    transformSum[i] = bundle.transformSum[i];
+  }
 
-          centerCubeI++;
-          laserCloudCenWidth++;
-        }
+  frameCount++;
+  //控制跳帧数，>=这里实际并没有跳帧，只取>或者增大stackFrameNum才能实现相应的跳帧处理
+  if (frameCount >= stackFrameNum) {
+    //获取世界坐标系转换矩阵
+    transformAssociateToMap();
 
-        //如果处于上边界，表明地图向正方向延伸的可能性比较大，则循环移位，将数组中心点向下边界调整一个单位
-        while (centerCubeI >= laserCloudWidth - 3) {//18
-          for (int j = 0; j < laserCloudHeight; j++) {
-            for (int k = 0; k < laserCloudDepth; k++) {
-              int i = 0;
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeCornerPointer =
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeSurfPointer =
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              //I维度上依次前移
-              for (; i < laserCloudWidth - 1; i++) {
-                laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudCornerArray[i + 1 + laserCloudWidth*j + laserCloudWidth * laserCloudHeight * k];
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudSurfArray[i + 1 + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              }
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeCornerPointer;
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeSurfPointer;
-              laserCloudCubeCornerPointer->clear();
-              laserCloudCubeSurfPointer->clear();
-            }
-          }
+    //将最新接收到的平面点和边沿点进行旋转平移转换到世界坐标系下(这里和后面的逆转换应无必要)
+    const EulerPose pose(transformTobeMapped);
+    appendToMap(pose, *laserCloudCornerLast, *laserCloudCornerStack2);
+    appendToMap(pose, *laserCloudSurfLast, *laserCloudSurfStack2);
+  }
 
-          centerCubeI--;
-          laserCloudCenWidth--;
-        }
+  if (optimize && frameCount >= stackFrameNum) {
+    frameCount = 0;
+    //时间预算从本帧开始处理时计算，包括选取cube与下采样
+    solverBudget.start();
+    ScopedTimer timer(matchTimers, STAGE_CUBE_SELECT);
+    //流水线模式下地图只由地图更新线程访问
+    if (!pipelineMapUpdate) {
+      laserCloudCubes.beginFrame();
+    }
 
-        while (centerCubeJ < 3) {
-          for (int i = 0; i < laserCloudWidth; i++) {
-            for (int k = 0; k < laserCloudDepth; k++) {
-              int j = laserCloudHeight - 1;
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeCornerPointer =
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeSurfPointer =
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              //J维度上，依次后移
-              for (; j >= 1; j--) {
-                laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudCornerArray[i + laserCloudWidth*(j - 1) + laserCloudWidth * laserCloudHeight*k];
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudSurfArray[i + laserCloudWidth * (j - 1) + laserCloudWidth * laserCloudHeight*k];
-              }
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeCornerPointer;
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeSurfPointer;
-              laserCloudCubeCornerPointer->clear();
-              laserCloudCubeSurfPointer->clear();
-            }
+    PointType pointOnYAxis;
+    pointOnYAxis.x = 0.0;
+    pointOnYAxis.y = 10.0;
+    pointOnYAxis.z = 0.0;
+    //获取y方向上10米高位置的点在世界坐标系下的坐标
+    transformPointsToMap(EulerPose(transformTobeMapped), &pointOnYAxis, &pointOnYAxis, 1);
+
+    //当前位置所在的cube，cube以整数坐标为键保存在哈希表中，地图范围不受数组大小的限制，也不需要循环移位
+    CubeIndex centerCube = laserCloudCubes.cubeIndexOf(transformTobeMapped[3],
+                                                       transformTobeMapped[4],
+                                                       transformTobeMapped[5]);
+    float cubeSize = laserCloudCubes.getCubeSize();
+    float cubeHalfSize = 0.5 * cubeSize;
+
+    laserCloudValidViews.clear();
+    std::fill(validViewLookup.begin(), validViewLookup.end(), -1);
+    validViewCenter = centerCube;
+    currentUpdate.center = centerCube;
+    currentUpdate.validCubes.clear();
+    currentUpdate.surroundCubes.clear();
+    //在每一维附近5个cube(前2个，后2个，中间1个)里进行查找，三个维度总共125个cube
+    //在这125个cube里面进一步筛选在视域范围内的cube，没有走过的cube不在表中，直接跳过
+    //流水线模式下从快照中取cube，否则直接取地图中的cube
+    int lookupInd = 0;
+    for (int i = centerCube.i - searchCubeRadius; i <= centerCube.i + searchCubeRadius; i++) {
+      for (int j = centerCube.j - searchCubeRadius; j <= centerCube.j + searchCubeRadius; j++) {
+        for (int k = centerCube.k - searchCubeRadius; k <= centerCube.k + searchCubeRadius; k++, lookupInd++) {
+          CubeIndex cubeIndex(i, j, k);
+          MapCube* cube = NULL;
+          const MapCubeView* snapshotView = NULL;
+          if (pipelineMapUpdate) {
+            snapshotView = snapshotCubeView(cubeIndex);
+          } else {
+            cube = laserCloudCubes.find(cubeIndex);
           }
- 
-          centerCubeJ++;
-          laserCloudCenHeight++;
-        } 
-
-        while (centerCubeJ >= laserCloudHeight - 3) {
-          for (int i = 0; i < laserCloudWidth; i++) {
-            for (int k = 0; k < laserCloudDepth; k++) {
-              int j = 0;
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeCornerPointer =
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeSurfPointer =
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              //J维度上一次前移
-              for (; j < laserCloudHeight - 1; j++) {
-                laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudCornerArray[i + laserCloudWidth*(j + 1) + laserCloudWidth * laserCloudHeight*k];
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudSurfArray[i + laserCloudWidth * (j + 1) + laserCloudWidth * laserCloudHeight*k];
-              }
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeCornerPointer;
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeSurfPointer;
-              laserCloudCubeCornerPointer->clear();
-              laserCloudCubeSurfPointer->clear();
-            }
+          if (cube == NULL && snapshotView == NULL) {
+            continue;
           }
 
-          centerCubeJ--;
-          laserCloudCenHeight--;
-        }
-
-        while (centerCubeK < 3) {
-          for (int i = 0; i < laserCloudWidth; i++) {
-            for (int j = 0; j < laserCloudHeight; j++) {
-              int k = laserCloudDepth - 1;
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeCornerPointer =
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeSurfPointer =
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              //K维度上依次后移
-              for (; k >= 1; k--) {
-                laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudCornerArray[i + laserCloudWidth*j + laserCloudWidth * laserCloudHeight*(k - 1)];
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight*(k - 1)];
+          //换算成实际比例，在世界坐标系下的坐标
+          float centerX = cubeSize * i;
+          float centerY = cubeSize * j;
+          float centerZ = cubeSize * k;
+
+          bool isInLaserFOV = false;//判断是否在lidar视线范围的标志（Field of View）
+          for (int ii = -1; ii <= 1; ii += 2) {
+            for (int jj = -1; jj <= 1; jj += 2) {
+              for (int kk = -1; kk <= 1; kk += 2) {
+                //上下左右八个顶点坐标
+                float cornerX = centerX + cubeHalfSize * ii;
+                float cornerY = centerY + cubeHalfSize * jj;
+                float cornerZ = centerZ + cubeHalfSize * kk;
+
+                //原点到顶点距离的平方和
+                float squaredSide1 = (transformTobeMapped[3] - cornerX) 
+                                   * (transformTobeMapped[3] - cornerX) 
+                                   + (transformTobeMapped[4] - cornerY) 
+                                   * (transformTobeMapped[4] - cornerY)
+                                   + (transformTobeMapped[5] - cornerZ) 
+                                   * (transformTobeMapped[5] - cornerZ);
+
+                //pointOnYAxis到顶点距离的平方和
+                float squaredSide2 = (pointOnYAxis.x - cornerX) * (pointOnYAxis.x - cornerX) 
+                                   + (pointOnYAxis.y - cornerY) * (pointOnYAxis.y - cornerY)
+                                   + (pointOnYAxis.z - cornerZ) * (pointOnYAxis.z - cornerZ);
+
+                float check1 = 100.0 + squaredSide1 - squaredSide2
+                             - 10.0 * sqrt(3.0) * sqrt(squaredSide1);
+
+                float check2 = 100.0 + squaredSide1 - squaredSide2
+                             + 10.0 * sqrt(3.0) * sqrt(squaredSide1);
+
+                if (check1 < 0 && check2 > 0) {//if |100 + squaredSide1 - squaredSide2| < 10.0 * sqrt(3.0) * sqrt(squaredSide1)
+                  isInLaserFOV = true;
+                }
               }
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeCornerPointer;
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeSurfPointer;
-              laserCloudCubeCornerPointer->clear();
-              laserCloudCubeSurfPointer->clear();
             }
           }
 
-          centerCubeK++;
-          laserCloudCenDepth++;
-        }
-      
-        while (centerCubeK >= laserCloudDepth - 3) {
-          for (int i = 0; i < laserCloudWidth; i++) {
-            for (int j = 0; j < laserCloudHeight; j++) {
-              int k = 0;
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeCornerPointer =
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              pcl::PointCloud<PointType>::Ptr laserCloudCubeSurfPointer =
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k];
-              //K维度上依次前移
-              for (; k < laserCloudDepth - 1; k++) {
-                laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudCornerArray[i + laserCloudWidth*j + laserCloudWidth * laserCloudHeight*(k + 1)];
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] =
-                laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight*(k + 1)];
-              }
-              laserCloudCornerArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeCornerPointer;
-              laserCloudSurfArray[i + laserCloudWidth * j + laserCloudWidth * laserCloudHeight * k] = 
-              laserCloudCubeSurfPointer;
-              laserCloudCubeCornerPointer->clear();
-              laserCloudCubeSurfPointer->clear();
+          //记住视域范围内的cube，匹配用，只重建内容有变化的cube的kd-tree
+          if (isInLaserFOV) {
+            validViewLookup[lookupInd] = laserCloudValidViews.size();
+            if (cube != NULL) {
+              timer.next(STAGE_KDTREE_BUILD);
+              updateCubeKdtree(*cube, MapCube::CORNER);
+              updateCubeKdtree(*cube, MapCube::SURF);
+              timer.next(STAGE_CUBE_SELECT);
+              laserCloudValidViews.push_back(makeCubeView(cubeIndex, *cube));
+            } else {
+              laserCloudValidViews.push_back(*snapshotView);
             }
+            currentUpdate.validCubes.push_back(cubeIndex);
           }
-
-          centerCubeK--;
-          laserCloudCenDepth--;
+          //记住附近所有cube，显示用
+          currentUpdate.surroundCubes.push_back(cubeIndex);
         }
+      }
+    }
 
-        int laserCloudValidNum = 0;
-        int laserCloudSurroundNum = 0;
-        //在每一维附近5个cube(前2个，后2个，中间1个)里进行查找（前后250米范围内，总共500米范围），三个维度总共125个cube
-        //在这125个cube里面进一步筛选在视域范围内的cube
-        for (int i = centerCubeI - 2; i <= centerCubeI + 2; i++) {
-          for (int j = centerCubeJ - 2; j <= centerCubeJ + 2; j++) {
-            for (int k = centerCubeK - 2; k <= centerCubeK + 2; k++) {
-              if (i >= 0 && i < laserCloudWidth && 
-                  j >= 0 && j < laserCloudHeight && 
-                  k >= 0 && k < laserCloudDepth) {//如果索引合法
-
-                //换算成实际比例，在世界坐标系下的坐标
-                float centerX = 50.0 * (i - laserCloudCenWidth);
-                float centerY = 50.0 * (j - laserCloudCenHeight);
-                float centerZ = 50.0 * (k - laserCloudCenDepth);
-
-                bool isInLaserFOV = false;//判断是否在lidar视线范围的标志（Field of View）
-                for (int ii = -1; ii <= 1; ii += 2) {
-                  for (int jj = -1; jj <= 1; jj += 2) {
-                    for (int kk = -1; kk <= 1; kk += 2) {
-                      //上下左右八个顶点坐标
-                      float cornerX = centerX + 25.0 * ii;
-                      float cornerY = centerY + 25.0 * jj;
-                      float cornerZ = centerZ + 25.0 * kk;
-
-                      //原点到顶点距离的平方和
-                      float squaredSide1 = (transformTobeMapped[3] - cornerX) 
-                                         * (transformTobeMapped[3] - cornerX) 
-                                         + (transformTobeMapped[4] - cornerY) 
-                                         * (transformTobeMapped[4] - cornerY)
-                                         + (transformTobeMapped[5] - cornerZ) 
-                                         * (transformTobeMapped[5] - cornerZ);
-
-                      //pointOnYAxis到顶点距离的平方和
-                      float squaredSide2 = (pointOnYAxis.x - cornerX) * (pointOnYAxis.x - cornerX) 
-                                         + (pointOnYAxis.y - cornerY) * (pointOnYAxis.y - cornerY)
-                                         + (pointOnYAxis.z - cornerZ) * (pointOnYAxis.z - cornerZ);
-
-                      float check1 = 100.0 + squaredSide1 - squaredSide2
-                                   - 10.0 * sqrt(3.0) * sqrt(squaredSide1);
-
-                      float check2 = 100.0 + squaredSide1 - squaredSide2
-                                   + 10.0 * sqrt(3.0) * sqrt(squaredSide1);
-
-                      if (check1 < 0 && check2 > 0) {//if |100 + squaredSide1 - squaredSide2| < 10.0 * sqrt(3.0) * sqrt(squaredSide1)
-                        isInLaserFOV = true;
-                      }
-                    }
-                  }
-                }
+    //视域内cube的特征点即为匹配使用的地图，不再拼接成一个点云，每个cube使用各自缓存的kd-tree
+    int laserCloudCornerFromMapNum = 0;
+    int laserCloudSurfFromMapNum = 0;
+    for (size_t i = 0; i < laserCloudValidViews.size(); i++) {
+      laserCloudCornerFromMapNum += laserCloudValidViews[i].pointNum[MapCube::CORNER];
+      laserCloudSurfFromMapNum += laserCloudValidViews[i].pointNum[MapCube::SURF];
+    }
 
-                //记住视域范围内的cube索引，匹配用
-                if (isInLaserFOV) {
-                  laserCloudValidInd[laserCloudValidNum] = i + laserCloudWidth * j 
-                                                       + laserCloudWidth * laserCloudHeight * k;
-                  laserCloudValidNum++;
-                }
-                //记住附近所有cube的索引，显示用
-                laserCloudSurroundInd[laserCloudSurroundNum] = i + laserCloudWidth * j 
-                                                             + laserCloudWidth * laserCloudHeight * k;
-                laserCloudSurroundNum++;
-              }
-            }
-          }
+    timer.next(STAGE_STACK_DOWNSAMPLE);
+    /***********************************************************************
+      此处将特征点转移回local坐标系，是为了voxel grid filter的下采样操作不越
+      界？好像不是！后面还会转移回世界坐标系，这里是前面的逆转换，和前面一样
+      应无必要，可直接对laserCloudCornerLast和laserCloudSurfLast进行下采样
+    ***********************************************************************/
+    const EulerPose stackPose(transformTobeMapped);
+    transformPointsFromMap(stackPose, laserCloudCornerStack2->points.data(), laserCloudCornerStack2->points.data(),
+                           laserCloudCornerStack2->points.size());
+    transformPointsFromMap(stackPose, laserCloudSurfStack2->points.data(), laserCloudSurfStack2->points.data(),
+                           laserCloudSurfStack2->points.size());
+
+    downSizeFilterCorner.filter(*laserCloudCornerStack2, *laserCloudCornerStack);//执行滤波处理
+    int laserCloudCornerStackNum = laserCloudCornerStack->points.size();//获取滤波后体素点尺寸
+
+    downSizeFilterSurf.filter(*laserCloudSurfStack2, *laserCloudSurfStack);
+    int laserCloudSurfStackNum = laserCloudSurfStack->points.size();
+
+    laserCloudCornerStack2->clear();
+    laserCloudSurfStack2->clear();
+
+    timer.next(STAGE_OPTIMIZATION);
+    int iterations = 0;
+    SolverStopReason stopReason = SOLVER_NOT_RUN;
+    if (laserCloudCornerFromMapNum > 10 && laserCloudSurfFromMapNum > 100) {
+      //每个特征点匹配到的直线(两个点)与平面参数，不重新查找对应点的迭代直接使用
+      cornerMatched.resize(laserCloudCornerStackNum);
+      cornerLines.resize(6 * laserCloudCornerStackNum);
+      surfMatched.resize(laserCloudSurfStackNum);
+      surfPlanes.resize(4 * laserCloudSurfStackNum);
+      //每次迭代按当前位姿转换到世界坐标系的特征点
+      pcl::PointCloud<PointType>::Ptr laserCloudCornerSel(new pcl::PointCloud<PointType>());
+      pcl::PointCloud<PointType>::Ptr laserCloudSurfSel(new pcl::PointCloud<PointType>());
+      laserCloudCornerSel->resize(laserCloudCornerStackNum);
+      laserCloudSurfSel->resize(laserCloudSurfStackNum);
+
+      stopReason = SOLVER_MAX_ITERATIONS;
+      for (int iterCount = 0; iterCount < solverBudget.getMaxIterations(); iterCount++) {//默认最多迭代10次
+        if (iterCount > 0 && solverBudget.deadlineReached()) {
+          stopReason = SOLVER_DEADLINE;
+          break;
         }
+        iterations++;
 
-        laserCloudCornerFromMap->clear();
-        laserCloudSurfFromMap->clear();
-        //构建特征点地图，查找匹配使用
-        for (int i = 0; i < laserCloudValidNum; i++) {
-          *laserCloudCornerFromMap += *laserCloudCornerArray[laserCloudValidInd[i]];
-          *laserCloudSurfFromMap += *laserCloudSurfArray[laserCloudValidInd[i]];
-        }
-        int laserCloudCornerFromMapNum = laserCloudCornerFromMap->points.size();
-        int laserCloudSurfFromMapNum = laserCloudSurfFromMap->points.size();
-
-        /***********************************************************************
-          此处将特征点转移回local坐标系，是为了voxel grid filter的下采样操作不越
-          界？好像不是！后面还会转移回世界坐标系，这里是前面的逆转换，和前面一样
-          应无必要，可直接对laserCloudCornerLast和laserCloudSurfLast进行下采样
-        ***********************************************************************/
-        int laserCloudCornerStackNum2 = laserCloudCornerStack2->points.size();
-        for (int i = 0; i < laserCloudCornerStackNum2; i++) {
-          pointAssociateTobeMapped(&laserCloudCornerStack2->points[i], &laserCloudCornerStack2->points[i]);
-        }
+        //默认每次迭代都重新查找最近点
+        const bool reassociate = solverBudget.needReassociate(iterCount, transformTobeMapped);
 
-        int laserCloudSurfStackNum2 = laserCloudSurfStack2->points.size();
-        for (int i = 0; i < laserCloudSurfStackNum2; i++) {
-          pointAssociateTobeMapped(&laserCloudSurfStack2->points[i], &laserCloudSurfStack2->points[i]);
-        }
+        laserCloudOri->clear();
+        coeffSel->clear();
 
-        laserCloudCornerStack->clear();
-        downSizeFilterCorner.setInputCloud(laserCloudCornerStack2);//设置滤波对象
-        downSizeFilterCorner.filter(*laserCloudCornerStack);//执行滤波处理
-        int laserCloudCornerStackNum = laserCloudCornerStack->points.size();//获取滤波后体素点尺寸
-
-        laserCloudSurfStack->clear();
-        downSizeFilterSurf.setInputCloud(laserCloudSurfStack2);
-        downSizeFilterSurf.filter(*laserCloudSurfStack);
-        int laserCloudSurfStackNum = laserCloudSurfStack->points.size();
-
-        laserCloudCornerStack2->clear();
-        laserCloudSurfStack2->clear();
-
-        if (laserCloudCornerFromMapNum > 10 && laserCloudSurfFromMapNum > 100) {
-          kdtreeCornerFromMap->setInputCloud(laserCloudCornerFromMap);//构建kd-tree
-          kdtreeSurfFromMap->setInputCloud(laserCloudSurfFromMap);
-
-          for (int iterCount = 0; iterCount < 10; iterCount++) {//最多迭代10次
-            laserCloudOri->clear();
-            coeffSel->clear();
-
-            for (int i = 0; i < laserCloudCornerStackNum; i++) {
-              pointOri = laserCloudCornerStack->points[i];
-              //转换回世界坐标系
-              pointAssociateToMap(&pointOri, &pointSel);
-              kdtreeCornerFromMap->nearestKSearch(pointSel, 5, pointSearchInd, pointSearchSqDis);//寻找最近距离五个点
-              
-              if (pointSearchSqDis[4] < 1.0) {//5个点中最大距离不超过1才处理
-                //将五个最近点的坐标加和求平均
-                float cx = 0;
-                float cy = 0; 
-                float cz = 0;
-                for (int j = 0; j < 5; j++) {
-                  cx += laserCloudCornerFromMap->points[pointSearchInd[j]].x;
-                  cy += laserCloudCornerFromMap->points[pointSearchInd[j]].y;
-                  cz += laserCloudCornerFromMap->points[pointSearchInd[j]].z;
-                }
-                cx /= 5;
-                cy /= 5; 
-                cz /= 5;
-
-                //求均方差
-                float a11 = 0;
-                float a12 = 0; 
-                float a13 = 0;
-                float a22 = 0;
-                float a23 = 0; 
-                float a33 = 0;
-                for (int j = 0; j < 5; j++) {
-                  float ax = laserCloudCornerFromMap->points[pointSearchInd[j]].x - cx;
-                  float ay = laserCloudCornerFromMap->points[pointSearchInd[j]].y - cy;
-                  float az = laserCloudCornerFromMap->points[pointSearchInd[j]].z - cz;
-
-                  a11 += ax * ax;
-                  a12 += ax * ay;
-                  a13 += ax * az;
-                  a22 += ay * ay;
-                  a23 += ay * az;
-                  a33 += az * az;
-                }
-                a11 /= 5;
-                a12 /= 5; 
-                a13 /= 5;
-                a22 /= 5;
-                a23 /= 5; 
-                a33 /= 5;
+        const EulerPose pose(transformTobeMapped);
+        transformPointsToMap(pose, laserCloudCornerStack->points.data(), laserCloudCornerSel->points.data(),
+                             laserCloudCornerStackNum);
+        transformPointsToMap(pose, laserCloudSurfStack->points.data(), laserCloudSurfSel->points.data(),
+                             laserCloudSurfStackNum);
 
+        for (int i = 0; i < laserCloudCornerStackNum; i++) {
+          pointOri = laserCloudCornerStack->points[i];
+          //转换回世界坐标系的点
+          pointSel = laserCloudCornerSel->points[i];
+          //寻找最近距离五个点，5个点中最大距离不超过1才处理
+          if (reassociate) {
+            cornerMatched[i] = 0;
+            if (nearestKSearchCubes(MapCube::CORNER, pointSel, *laserCloudNearest, pointNearestSqDis)) {
+              //将五个最近点的坐标加和求平均
+              float cx = 0;
+              float cy = 0; 
+              float cz = 0;
+              for (int j = 0; j < 5; j++) {
+                cx += laserCloudNearest->points[j].x;
+                cy += laserCloudNearest->points[j].y;
+                cz += laserCloudNearest->points[j].z;
+              }
+              cx /= 5;
+              cy /= 5; 
+              cz /= 5;
+
+              //求均方差
+              float a11 = 0;
+              float a12 = 0; 
+              float a13 = 0;
+              float a22 = 0;
+              float a23 = 0; 
+              float a33 = 0;
+              for (int j = 0; j < 5; j++) {
+                float ax = laserCloudNearest->points[j].x - cx;
+                float ay = laserCloudNearest->points[j].y - cy;
+                float az = laserCloudNearest->points[j].z - cz;
+
+                a11 += ax * ax;
+                a12 += ax * ay;
+                a13 += ax * az;
+                a22 += ay * ay;
+                a23 += ay * az;
+                a33 += az * az;
+              }
+              a11 /= 5;
+              a12 /= 5; 
+              a13 /= 5;
+              a22 /= 5;
+              a23 /= 5; 
+              a33 /= 5;
+
+              //特征值从大到小排列，lineDir为最大特征值对应的特征向量
+              float eigenValue0, eigenValue1;
+              float lineDirX, lineDirY, lineDirZ;
+              if (useFixedSizeFit) {
+                Eigen::Matrix3f covariance;
+                covariance << a11, a12, a13,
+                              a12, a22, a23,
+                              a13, a23, a33;
+
+                //闭式特征值分解
+                Eigen::Vector3f eigenValues, lineDir;
+                symmetricEigen3x3(covariance, eigenValues, lineDir);
+
+                eigenValue0 = eigenValues(0);
+                eigenValue1 = eigenValues(1);
+                lineDirX = lineDir(0);
+                lineDirY = lineDir(1);
+                lineDirZ = lineDir(2);
+              } else {
                 //构建矩阵
                 matA1.at<float>(0, 0) = a11;
                 matA1.at<float>(0, 1) = a12;
@@ -860,360 +1239,303 @@ int main(int argc, char** argv)
                 //特征值分解
                 cv::eigen(matA1, matD1, matV1);
 
-                if (matD1.at<float>(0, 0) > 3 * matD1.at<float>(0, 1)) {//如果最大的特征值大于第二大的特征值三倍以上
-
-                  float x0 = pointSel.x;
-                  float y0 = pointSel.y;
-                  float z0 = pointSel.z;
-                  float x1 = cx + 0.1 * matV1.at<float>(0, 0);
-                  float y1 = cy + 0.1 * matV1.at<float>(0, 1);
-                  float z1 = cz + 0.1 * matV1.at<float>(0, 2);
-                  float x2 = cx - 0.1 * matV1.at<float>(0, 0);
-                  float y2 = cy - 0.1 * matV1.at<float>(0, 1);
-                  float z2 = cz - 0.1 * matV1.at<float>(0, 2);
-
-                  float a012 = sqrt(((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1))
-                             * ((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1)) 
-                             + ((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1))
-                             * ((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1)) 
-                             + ((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1))
-                             * ((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1)));
-
-                  float l12 = sqrt((x1 - x2)*(x1 - x2) + (y1 - y2)*(y1 - y2) + (z1 - z2)*(z1 - z2));
-
-                  float la = ((y1 - y2)*((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1)) 
-                           + (z1 - z2)*((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1))) / a012 / l12;
-
-                  float lb = -((x1 - x2)*((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1)) 
-                           - (z1 - z2)*((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1))) / a012 / l12;
-
-                  float lc = -((x1 - x2)*((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1)) 
-                           + (y1 - y2)*((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1))) / a012 / l12;
-
-                  float ld2 = a012 / l12;
-
-                  //unused
-                  pointProj = pointSel;
-                  pointProj.x -= la * ld2;
-                  pointProj.y -= lb * ld2;
-                  pointProj.z -= lc * ld2;
-
-                  //权重系数计算
-                  float s = 1 - 0.9 * fabs(ld2);
-
-                  coeff.x = s * la;
-                  coeff.y = s * lb;
-                  coeff.z = s * lc;
-                  coeff.intensity = s * ld2;
+                eigenValue0 = matD1.at<float>(0, 0);
+                eigenValue1 = matD1.at<float>(0, 1);
+                lineDirX = matV1.at<float>(0, 0);
+                lineDirY = matV1.at<float>(0, 1);
+                lineDirZ = matV1.at<float>(0, 2);
+              }
 
-                  if (s > 0.1) {//距离足够小才使用
-                    laserCloudOri->push_back(pointOri);
-                    coeffSel->push_back(coeff);
-                  }
-                }
+              if (eigenValue0 > 3 * eigenValue1) {//如果最大的特征值大于第二大的特征值三倍以上
+                //保存直线上的两个点，位姿变化不大时之后的迭代直接使用
+                float* line = &cornerLines[6 * i];
+                line[0] = cx + 0.1 * lineDirX;
+                line[1] = cy + 0.1 * lineDirY;
+                line[2] = cz + 0.1 * lineDirZ;
+                line[3] = cx - 0.1 * lineDirX;
+                line[4] = cy - 0.1 * lineDirY;
+                line[5] = cz - 0.1 * lineDirZ;
+                cornerMatched[i] = 1;
               }
             }
+          }
+
+          if (cornerMatched[i]) {
+            const float* line = &cornerLines[6 * i];
+            float x0 = pointSel.x;
+            float y0 = pointSel.y;
+            float z0 = pointSel.z;
+            float x1 = line[0];
+            float y1 = line[1];
+            float z1 = line[2];
+            float x2 = line[3];
+            float y2 = line[4];
+            float z2 = line[5];
+
+            float a012 = sqrt(((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1))
+                       * ((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1)) 
+                       + ((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1))
+                       * ((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1)) 
+                       + ((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1))
+                       * ((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1)));
+
+            float l12 = sqrt((x1 - x2)*(x1 - x2) + (y1 - y2)*(y1 - y2) + (z1 - z2)*(z1 - z2));
+
+            float la = ((y1 - y2)*((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1)) 
+                     + (z1 - z2)*((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1))) / a012 / l12;
+
+            float lb = -((x1 - x2)*((x0 - x1)*(y0 - y2) - (x0 - x2)*(y0 - y1)) 
+                     - (z1 - z2)*((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1))) / a012 / l12;
+
+            float lc = -((x1 - x2)*((x0 - x1)*(z0 - z2) - (x0 - x2)*(z0 - z1)) 
+                     + (y1 - y2)*((y0 - y1)*(z0 - z2) - (y0 - y2)*(z0 - z1))) / a012 / l12;
+
+            float ld2 = a012 / l12;
+
+            //unused
+            pointProj = pointSel;
+            pointProj.x -= la * ld2;
+            pointProj.y -= lb * ld2;
+            pointProj.z -= lc * ld2;
+
+            //权重系数计算
+            float s = 1 - 0.9 * fabs(ld2);
+
+            coeff.x = s * la;
+            coeff.y = s * lb;
+            coeff.z = s * lc;
+            coeff.intensity = s * ld2;
+
+            if (s > 0.1) {//距离足够小才使用
+              laserCloudOri->push_back(pointOri);
+              coeffSel->push_back(coeff);
+            }
+          }
+        }
 
-            for (int i = 0; i < laserCloudSurfStackNum; i++) {
-              pointOri = laserCloudSurfStack->points[i];
-              pointAssociateToMap(&pointOri, &pointSel); 
-              kdtreeSurfFromMap->nearestKSearch(pointSel, 5, pointSearchInd, pointSearchSqDis);
+        for (int i = 0; i < laserCloudSurfStackNum; i++) {
+          pointOri = laserCloudSurfStack->points[i];
+          pointSel = laserCloudSurfSel->points[i];
+          if (reassociate) {
+            surfMatched[i] = 0;
+            if (nearestKSearchCubes(MapCube::SURF, pointSel, *laserCloudNearest, pointNearestSqDis)) {
+              float pa, pb, pc;
+              if (useFixedSizeFit) {
+                //构建五个最近点的坐标矩阵，求解法方程
+                Eigen::Matrix<float, 5, 3> matA0Fixed;
+                for (int j = 0; j < 5; j++) {
+                  matA0Fixed(j, 0) = laserCloudNearest->points[j].x;
+                  matA0Fixed(j, 1) = laserCloudNearest->points[j].y;
+                  matA0Fixed(j, 2) = laserCloudNearest->points[j].z;
+                }
+                Eigen::Vector3f matX0Fixed;
+                fitPlaneNormalEquations(matA0Fixed, matX0Fixed);
 
-              if (pointSearchSqDis[4] < 1.0) {
+                pa = matX0Fixed(0);
+                pb = matX0Fixed(1);
+                pc = matX0Fixed(2);
+              } else {
                 //构建五个最近点的坐标矩阵
                 for (int j = 0; j < 5; j++) {
-                  matA0.at<float>(j, 0) = laserCloudSurfFromMap->points[pointSearchInd[j]].x;
-                  matA0.at<float>(j, 1) = laserCloudSurfFromMap->points[pointSearchInd[j]].y;
-                  matA0.at<float>(j, 2) = laserCloudSurfFromMap->points[pointSearchInd[j]].z;
+                  matA0.at<float>(j, 0) = laserCloudNearest->points[j].x;
+                  matA0.at<float>(j, 1) = laserCloudNearest->points[j].y;
+                  matA0.at<float>(j, 2) = laserCloudNearest->points[j].z;
                 }
                 //求解matA0*matX0=matB0
                 cv::solve(matA0, matB0, matX0, cv::DECOMP_QR);
 
-                float pa = matX0.at<float>(0, 0);
-                float pb = matX0.at<float>(1, 0);
-                float pc = matX0.at<float>(2, 0);
-                float pd = 1;
- 
-                float ps = sqrt(pa * pa + pb * pb + pc * pc);
-                pa /= ps;
-                pb /= ps;
-                pc /= ps;
-                pd /= ps;
-
-                bool planeValid = true;
-                for (int j = 0; j < 5; j++) {
-                  if (fabs(pa * laserCloudSurfFromMap->points[pointSearchInd[j]].x +
-                      pb * laserCloudSurfFromMap->points[pointSearchInd[j]].y +
-                      pc * laserCloudSurfFromMap->points[pointSearchInd[j]].z + pd) > 0.2) {
-                    planeValid = false;
-                    break;
-                  }
-                }
-
-                if (planeValid) {
-                  float pd2 = pa * pointSel.x + pb * pointSel.y + pc * pointSel.z + pd;
-
-                  //unused
-                  pointProj = pointSel;
-                  pointProj.x -= pa * pd2;
-                  pointProj.y -= pb * pd2;
-                  pointProj.z -= pc * pd2;
-
-                  float s = 1 - 0.9 * fabs(pd2) / sqrt(sqrt(pointSel.x * pointSel.x
-                          + pointSel.y * pointSel.y + pointSel.z * pointSel.z));
-
-                  coeff.x = s * pa;
-                  coeff.y = s * pb;
-                  coeff.z = s * pc;
-                  coeff.intensity = s * pd2;
-
-                  if (s > 0.1) {
-                    laserCloudOri->push_back(pointOri);
-                    coeffSel->push_back(coeff);
-                  }
-                }
+                pa = matX0.at<float>(0, 0);
+                pb = matX0.at<float>(1, 0);
+                pc = matX0.at<float>(2, 0);
               }
-            }
-
-            float srx = sin(transformTobeMapped[0]);
-            float crx = cos(transformTobeMapped[0]);
-            float sry = sin(transformTobeMapped[1]);
-            float cry = cos(transformTobeMapped[1]);
-            float srz = sin(transformTobeMapped[2]);
-            float crz = cos(transformTobeMapped[2]);
-
-            int laserCloudSelNum = laserCloudOri->points.size();
-            if (laserCloudSelNum < 50) {//如果特征点太少
-              continue;
-            }
-
-            cv::Mat matA(laserCloudSelNum, 6, CV_32F, cv::Scalar::all(0));
-            cv::Mat matAt(6, laserCloudSelNum, CV_32F, cv::Scalar::all(0));
-            cv::Mat matAtA(6, 6, CV_32F, cv::Scalar::all(0));
-            cv::Mat matB(laserCloudSelNum, 1, CV_32F, cv::Scalar::all(0));
-            cv::Mat matAtB(6, 1, CV_32F, cv::Scalar::all(0));
-            cv::Mat matX(6, 1, CV_32F, cv::Scalar::all(0));
-            for (int i = 0; i < laserCloudSelNum; i++) {
-              pointOri = laserCloudOri->points[i];
-              coeff = coeffSel->points[i];
-
-              float arx = (crx*sry*srz*pointOri.x + crx*crz*sry*pointOri.y - srx*sry*pointOri.z) * coeff.x
-                        + (-srx*srz*pointOri.x - crz*srx*pointOri.y - crx*pointOri.z) * coeff.y
-                        + (crx*cry*srz*pointOri.x + crx*cry*crz*pointOri.y - cry*srx*pointOri.z) * coeff.z;
-
-              float ary = ((cry*srx*srz - crz*sry)*pointOri.x 
-                        + (sry*srz + cry*crz*srx)*pointOri.y + crx*cry*pointOri.z) * coeff.x
-                        + ((-cry*crz - srx*sry*srz)*pointOri.x 
-                        + (cry*srz - crz*srx*sry)*pointOri.y - crx*sry*pointOri.z) * coeff.z;
-
-              float arz = ((crz*srx*sry - cry*srz)*pointOri.x + (-cry*crz-srx*sry*srz)*pointOri.y)*coeff.x
-                        + (crx*crz*pointOri.x - crx*srz*pointOri.y) * coeff.y
-                        + ((sry*srz + cry*crz*srx)*pointOri.x + (crz*sry-cry*srx*srz)*pointOri.y)*coeff.z;
-
-              matA.at<float>(i, 0) = arx;
-              matA.at<float>(i, 1) = ary;
-              matA.at<float>(i, 2) = arz;
-              matA.at<float>(i, 3) = coeff.x;
-              matA.at<float>(i, 4) = coeff.y;
-              matA.at<float>(i, 5) = coeff.z;
-              matB.at<float>(i, 0) = -coeff.intensity;
-            }
-            cv::transpose(matA, matAt);
-            matAtA = matAt * matA;
-            matAtB = matAt * matB;
-            cv::solve(matAtA, matAtB, matX, cv::DECOMP_QR);
-
-            //退化场景判断与处理
-            if (iterCount == 0) {
-              cv::Mat matE(1, 6, CV_32F, cv::Scalar::all(0));
-              cv::Mat matV(6, 6, CV_32F, cv::Scalar::all(0));
-              cv::Mat matV2(6, 6, CV_32F, cv::Scalar::all(0));
-
-              cv::eigen(matAtA, matE, matV);
-              matV.copyTo(matV2);
-
-              isDegenerate = false;
-              float eignThre[6] = {100, 100, 100, 100, 100, 100};
-              for (int i = 5; i >= 0; i--) {
-                if (matE.at<float>(0, i) < eignThre[i]) {
-                  for (int j = 0; j < 6; j++) {
-                    matV2.at<float>(i, j) = 0;
-                  }
-                  isDegenerate = true;
-                } else {
+              float pd = 1;
+ 
+              float ps = sqrt(pa * pa + pb * pb + pc * pc);
+              pa /= ps;
+              pb /= ps;
+              pc /= ps;
+              pd /= ps;
+
+              bool planeValid = true;
+              for (int j = 0; j < 5; j++) {
+                if (fabs(pa * laserCloudNearest->points[j].x +
+                    pb * laserCloudNearest->points[j].y +
+                    pc * laserCloudNearest->points[j].z + pd) > 0.2) {
+                  planeValid = false;
                   break;
                 }
               }
-              matP = matV.inv() * matV2;
-            }
-
-            if (isDegenerate) {
-              cv::Mat matX2(6, 1, CV_32F, cv::Scalar::all(0));
-              matX.copyTo(matX2);
-              matX = matP * matX2;
-            }
 
-            //积累每次的调整量
-            transformTobeMapped[0] += matX.at<float>(0, 0);
-            transformTobeMapped[1] += matX.at<float>(1, 0);
-            transformTobeMapped[2] += matX.at<float>(2, 0);
-            transformTobeMapped[3] += matX.at<float>(3, 0);
-            transformTobeMapped[4] += matX.at<float>(4, 0);
-            transformTobeMapped[5] += matX.at<float>(5, 0);
-
-            float deltaR = sqrt(
-                                pow(rad2deg(matX.at<float>(0, 0)), 2) +
-                                pow(rad2deg(matX.at<float>(1, 0)), 2) +
-                                pow(rad2deg(matX.at<float>(2, 0)), 2));
-            float deltaT = sqrt(
-                                pow(matX.at<float>(3, 0) * 100, 2) +
-                                pow(matX.at<float>(4, 0) * 100, 2) +
-                                pow(matX.at<float>(5, 0) * 100, 2));
-
-            //旋转平移量足够小就停止迭代
-            if (deltaR < 0.05 && deltaT < 0.05) {
-              break;
+              if (planeValid) {
+                //保存平面参数，位姿变化不大时之后的迭代直接使用
+                float* plane = &surfPlanes[4 * i];
+                plane[0] = pa;
+                plane[1] = pb;
+                plane[2] = pc;
+                plane[3] = pd;
+                surfMatched[i] = 1;
+              }
             }
           }
 
-          //迭代结束更新相关的转移矩阵
-          transformUpdate();
-        }
+          if (surfMatched[i]) {
+            const float* plane = &surfPlanes[4 * i];
+            float pa = plane[0];
+            float pb = plane[1];
+            float pc = plane[2];
+            float pd = plane[3];
 
-        //将corner points按距离（比例尺缩小）归入相应的立方体
-        for (int i = 0; i < laserCloudCornerStackNum; i++) {
-          //转移到世界坐标系
-          pointAssociateToMap(&laserCloudCornerStack->points[i], &pointSel);
-
-          //按50的比例尺缩小，四舍五入，偏移laserCloudCen*的量，计算索引
-          int cubeI = int((pointSel.x + 25.0) / 50.0) + laserCloudCenWidth;
-          int cubeJ = int((pointSel.y + 25.0) / 50.0) + laserCloudCenHeight;
-          int cubeK = int((pointSel.z + 25.0) / 50.0) + laserCloudCenDepth;
-
-          if (pointSel.x + 25.0 < 0) cubeI--;
-          if (pointSel.y + 25.0 < 0) cubeJ--;
-          if (pointSel.z + 25.0 < 0) cubeK--;
-
-          if (cubeI >= 0 && cubeI < laserCloudWidth && 
-              cubeJ >= 0 && cubeJ < laserCloudHeight && 
-              cubeK >= 0 && cubeK < laserCloudDepth) {//只挑选-laserCloudCenWidth * 50.0 < point.x < laserCloudCenWidth * 50.0范围内的点，y和z同理
-              //按照尺度放进不同的组，每个组的点数量各异
-            int cubeInd = cubeI + laserCloudWidth * cubeJ + laserCloudWidth * laserCloudHeight * cubeK;
-            laserCloudCornerArray[cubeInd]->push_back(pointSel);
-          }
-        }
+            float pd2 = pa * pointSel.x + pb * pointSel.y + pc * pointSel.z + pd;
 
-        //将surf points按距离（比例尺缩小）归入相应的立方体
-        for (int i = 0; i < laserCloudSurfStackNum; i++) {
-          pointAssociateToMap(&laserCloudSurfStack->points[i], &pointSel);
+            //unused
+            pointProj = pointSel;
+            pointProj.x -= pa * pd2;
+            pointProj.y -= pb * pd2;
+            pointProj.z -= pc * pd2;
 
-          int cubeI = int((pointSel.x + 25.0) / 50.0) + laserCloudCenWidth;
-          int cubeJ = int((pointSel.y + 25.0) / 50.0) + laserCloudCenHeight;
-          int cubeK = int((pointSel.z + 25.0) / 50.0) + laserCloudCenDepth;
+            float s = 1 - 0.9 * fabs(pd2) / sqrt(sqrt(pointSel.x * pointSel.x
+                    + pointSel.y * pointSel.y + pointSel.z * pointSel.z));
 
-          if (pointSel.x + 25.0 < 0) cubeI--;
-          if (pointSel.y + 25.0 < 0) cubeJ--;
-          if (pointSel.z + 25.0 < 0) cubeK--;
+            coeff.x = s * pa;
+            coeff.y = s * pb;
+            coeff.z = s * pc;
+            coeff.intensity = s * pd2;
 
-          if (cubeI >= 0 && cubeI < laserCloudWidth && 
-              cubeJ >= 0 && cubeJ < laserCloudHeight && 
-              cubeK >= 0 && cubeK < laserCloudDepth) {
-            int cubeInd = cubeI + laserCloudWidth * cubeJ + laserCloudWidth * laserCloudHeight * cubeK;
-            laserCloudSurfArray[cubeInd]->push_back(pointSel);
+            if (s > 0.1) {
+              laserCloudOri->push_back(pointOri);
+              coeffSel->push_back(coeff);
+            }
           }
         }
 
-        //特征点下采样
-        for (int i = 0; i < laserCloudValidNum; i++) {
-          int ind = laserCloudValidInd[i];
-
-          laserCloudCornerArray2[ind]->clear();
-          downSizeFilterCorner.setInputCloud(laserCloudCornerArray[ind]);
-          downSizeFilterCorner.filter(*laserCloudCornerArray2[ind]);//滤波输出到Array2
-
-          laserCloudSurfArray2[ind]->clear();
-          downSizeFilterSurf.setInputCloud(laserCloudSurfArray[ind]);
-          downSizeFilterSurf.filter(*laserCloudSurfArray2[ind]);
-
-          //Array与Array2交换，即滤波后自我更新
-          pcl::PointCloud<PointType>::Ptr laserCloudTemp = laserCloudCornerArray[ind];
-          laserCloudCornerArray[ind] = laserCloudCornerArray2[ind];
-          laserCloudCornerArray2[ind] = laserCloudTemp;
-
-          laserCloudTemp = laserCloudSurfArray[ind];
-          laserCloudSurfArray[ind] = laserCloudSurfArray2[ind];
-          laserCloudSurfArray2[ind] = laserCloudTemp;
+        int laserCloudSelNum = laserCloudOri->points.size();
+        if (laserCloudSelNum < 50) {//如果特征点太少
+          if (!reassociate) {
+            stopReason = SOLVER_TOO_FEW_POINTS;
+            break;
+          }
+          continue;
         }
 
-        mapFrameCount++;
-        //特征点汇总下采样，每隔五帧publish一次，从第一次开始
-        if (mapFrameCount >= mapFrameNum) {
-          mapFrameCount = 0;
-
-          laserCloudSurround2->clear();
-          for (int i = 0; i < laserCloudSurroundNum; i++) {
-            int ind = laserCloudSurroundInd[i];
-            *laserCloudSurround2 += *laserCloudCornerArray[ind];
-            *laserCloudSurround2 += *laserCloudSurfArray[ind];
+        //直接累加得到matAtA和matAtB，不需要构建N x 6的matA及其转置
+        Eigen::Matrix<float, 6, 6> matAtA;
+        Eigen::Matrix<float, 6, 1> matAtB;
+        accumulateNormalEquations(matAtA, matAtB);
+        Eigen::Matrix<float, 6, 1> matX = matAtA.colPivHouseholderQr().solve(matAtB);
+
+        //退化场景判断与处理
+        if (iterCount == 0) {
+          //特征值按从小到大排列，特征向量为对应的列
+          Eigen::SelfAdjointEigenSolver<Eigen::Matrix<float, 6, 6> > eigenSolver(matAtA);
+          Eigen::Matrix<float, 1, 6> matE = eigenSolver.eigenvalues().transpose();
+          Eigen::Matrix<float, 6, 6> matV = eigenSolver.eigenvectors().transpose();
+          Eigen::Matrix<float, 6, 6> matV2 = matV;
+
+          isDegenerate = false;
+          float eignThre[6] = {100, 100, 100, 100, 100, 100};
+          for (int i = 0; i < 6; i++) {
+            if (matE(0, i) < eignThre[i]) {
+              matV2.row(i).setZero();
+              isDegenerate = true;
+            } else {
+              break;
+            }
           }
-
-          laserCloudSurround->clear();
-          downSizeFilterCorner.setInputCloud(laserCloudSurround2);
-          downSizeFilterCorner.filter(*laserCloudSurround);
-
-          sensor_msgs::PointCloud2 laserCloudSurround3;
-          pcl::toROSMsg(*laserCloudSurround, laserCloudSurround3);
-          laserCloudSurround3.header.stamp = ros::Time().fromSec(timeLaserOdometry);
-          laserCloudSurround3.header.frame_id = "/camera_init";
-          pubLaserCloudSurround.publish(laserCloudSurround3);
+          matP = matV.inverse() * matV2;
         }
 
-        //将点云中全部点转移到世界坐标系下
-        int laserCloudFullResNum = laserCloudFullRes->points.size();
-        for (int i = 0; i < laserCloudFullResNum; i++) {
-          pointAssociateToMap(&laserCloudFullRes->points[i], &laserCloudFullRes->points[i]);
+        if (isDegenerate) {
+          Eigen::Matrix<float, 6, 1> matX2 = matX;
+          matX = matP * matX2;
         }
 
-        sensor_msgs::PointCloud2 laserCloudFullRes3;
-        pcl::toROSMsg(*laserCloudFullRes, laserCloudFullRes3);
-        laserCloudFullRes3.header.stamp = ros::Time().fromSec(timeLaserOdometry);
-        laserCloudFullRes3.header.frame_id = "/camera_init";
-        pubLaserCloudFullRes.publish(laserCloudFullRes3);
-
-        geometry_msgs::Quaternion geoQuat = tf::createQuaternionMsgFromRollPitchYaw
-                                  (transformAftMapped[2], -transformAftMapped[0], -transformAftMapped[1]);
-
-        odomAftMapped.header.stamp = ros::Time().fromSec(timeLaserOdometry);
-        odomAftMapped.pose.pose.orientation.x = -geoQuat.y;
-        odomAftMapped.pose.pose.orientation.y = -geoQuat.z;
-        odomAftMapped.pose.pose.orientation.z = geoQuat.x;
-        odomAftMapped.pose.pose.orientation.w = geoQuat.w;
-        odomAftMapped.pose.pose.position.x = transformAftMapped[3];
-        odomAftMapped.pose.pose.position.y = transformAftMapped[4];
-        odomAftMapped.pose.pose.position.z = transformAftMapped[5];
-        //扭转量
-        odomAftMapped.twist.twist.angular.x = transformBefMapped[0];
-        odomAftMapped.twist.twist.angular.y = transformBefMapped[1];
-        odomAftMapped.twist.twist.angular.z = transformBefMapped[2];
-        odomAftMapped.twist.twist.linear.x = transformBefMapped[3];
-        odomAftMapped.twist.twist.linear.y = transformBefMapped[4];
-        odomAftMapped.twist.twist.linear.z = transformBefMapped[5];
-        pubOdomAftMapped.publish(odomAftMapped);
-
-        //广播坐标系旋转平移参量
-        aftMappedTrans.stamp_ = ros::Time().fromSec(timeLaserOdometry);
-        aftMappedTrans.setRotation(tf::Quaternion(-geoQuat.y, -geoQuat.z, geoQuat.x, geoQuat.w));
-        aftMappedTrans.setOrigin(tf::Vector3(transformAftMapped[3], 
-                                             transformAftMapped[4], transformAftMapped[5]));
-        tfBroadcaster.sendTransform(aftMappedTrans);
+        //积累每次的调整量
+        transformTobeMapped[0] += matX(0);
+        transformTobeMapped[1] += matX(1);
+        transformTobeMapped[2] += matX(2);
+        transformTobeMapped[3] += matX(3);
+        transformTobeMapped[4] += matX(4);
+        transformTobeMapped[5] += matX(5);
+
+        float deltaR = sqrt(
+                            pow(rad2deg(matX(0)), 2) +
+                            pow(rad2deg(matX(1)), 2) +
+                            pow(rad2deg(matX(2)), 2));
+        float deltaT = sqrt(
+                            pow(matX(3) * 100, 2) +
+                            pow(matX(4) * 100, 2) +
+                            pow(matX(5) * 100, 2));
+
+        //旋转平移量足够小就停止迭代
+        if (deltaR < 0.05 && deltaT < 0.05) {
+          stopReason = SOLVER_CONVERGED;
+          break;
+        }
+      }
 
+      //迭代结束更新相关的转移矩阵
+      transformUpdate();
+    }
+    solverBudget.finish(iterations, stopReason);
+    currentUpdate.solverReport = solverBudget.getReport();
+    LOAM_DEBUG("laserMapping: %d iterations, %d associations, %s, %.1f ms", currentUpdate.solverReport.iterations,
+               currentUpdate.solverReport.associations, solverStopReasonName(currentUpdate.solverReport.reason),
+               currentUpdate.solverReport.elapsed * 1000);
+
+    //匹配结束，释放对cube的引用，同步更新地图时不需要写时复制
+    timer.next(STAGE_OUTPUT);
+    laserCloudValidViews.clear();
+
+    //特征点转移到世界坐标系，之后归入相应的立方体；只定位时不加入地图
+    currentUpdate.time = timeLaserOdometry;
+    if (localizationOnly) {
+      laserCloudCornerStackNum = 0;
+      laserCloudSurfStackNum = 0;
+    }
+    const EulerPose mappedPose(transformTobeMapped);
+    currentUpdate.cornerPoints->resize(laserCloudCornerStackNum);
+    transformPointsToMap(mappedPose, laserCloudCornerStack->points.data(),
+                         currentUpdate.cornerPoints->points.data(), laserCloudCornerStackNum);
+    currentUpdate.surfPoints->resize(laserCloudSurfStackNum);
+    transformPointsToMap(mappedPose, laserCloudSurfStack->points.data(),
+                         currentUpdate.surfPoints->points.data(), laserCloudSurfStackNum);
+
+    //同步更新地图的耗时计入地图更新的统计，流水线模式下记录等待上一次更新完成的时间
+    if (pipelineMapUpdate) {
+      timer.next(STAGE_UPDATE_WAIT);
+      submitMapUpdate();
+    } else {
+      timer.stop();
+      MapOutput mapOutput;
+      updateMap(currentUpdate, mapOutput);
+      finishMapUpdate(mapOutput);
+    }
+    timer.next(STAGE_OUTPUT);
+
+    //将点云中全部点转移到世界坐标系下，没有人需要或者帧中没有全部点时跳过
+    if (registeredCloudCallback && laserCloudFullRes && !laserCloudFullRes->empty()) {
+      RegistrationJob job;
+      job.time = timeLaserOdometry;
+      job.fullRes = laserCloudFullRes;
+      std::copy(transformTobeMapped, transformTobeMapped + 6, job.transformTobeMapped);
+      if (asyncRegistration) {
+        submitRegistration(job);
+      } else {
+        registeredCloudCallback(registerCloud(job));
       }
     }
 
-    status = ros::ok();
-    rate.sleep();
-  }
+    MappingOutput output;
+    output.time = timeLaserOdometry;
+    std::copy(transformAftMapped, transformAftMapped + 6, output.transformAftMapped);
+    std::copy(transformBefMapped, transformBefMapped + 6, output.transformBefMapped);
 
-  return 0;
+    timer.stop();
+    matchTimers.finishFrame();
+    if (mappingCallback) {
+      mappingCallback(output);
+    }
+  }
 }
 
+} // end namespace loam
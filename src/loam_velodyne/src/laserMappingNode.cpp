@@ -0,0 +1,348 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include <loam_velodyne/LaserMappingNode.h>
+#include <loam_velodyne/ros_conversions.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <pcl_ros/point_cloud.h>
+
+namespace loam {
+
+template <typename T>
+static void addDiagnosticValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, T value)
+{
+  diagnostic_msgs::KeyValue keyValue;
+  keyValue.key = key;
+  std::ostringstream stream;
+  stream << value;
+  keyValue.value = stream.str();
+  status.values.push_back(keyValue);
+}
+
+LaserMappingNode::LaserMappingNode()
+  : fullResSubscribed(false),
+    cubeSize(0)
+{
+  odomAftMapped.header.frame_id = "/camera_init";
+  odomAftMapped.child_frame_id = "/aft_mapped";
+
+  aftMappedTrans.frame_id_ = "/camera_init";
+  aftMappedTrans.child_frame_id_ = "/aft_mapped";
+}
+
+bool LaserMappingNode::setup(ros::NodeHandle& node, ros::NodeHandle& privateNode)
+{
+  setupRosLogging();
+
+  LaserMappingParams params;
+  privateNode.param("numThreads", params.numThreads, params.numThreads);
+  privateNode.param("cubeSize", params.cubeSize, params.cubeSize);
+  privateNode.param("mapMemoryBudgetMB", params.mapMemoryBudgetMB, params.mapMemoryBudgetMB);
+  privateNode.param("mapSpillDirectory", params.mapSpillDirectory, params.mapSpillDirectory);
+  privateNode.param("priorMapFile", params.priorMapFile, params.priorMapFile);
+  privateNode.param("localizationOnly", params.localizationOnly, params.localizationOnly);
+  privateNode.param("useFixedSizeFit", params.useFixedSizeFit, params.useFixedSizeFit);
+  privateNode.param("maxIterations", params.maxIterations, params.maxIterations);
+  privateNode.param("timeBudget", params.timeBudget, params.timeBudget);
+  privateNode.param("reassociateRotation", params.reassociateRotation, params.reassociateRotation);
+  privateNode.param("reassociateTranslation", params.reassociateTranslation, params.reassociateTranslation);
+  privateNode.param("asyncMapping", params.asyncMapping, params.asyncMapping);
+  privateNode.param("mappingQueueSize", params.mappingQueueSize, params.mappingQueueSize);
+  privateNode.param("mappingDropPolicy", params.mappingDropPolicy, params.mappingDropPolicy);
+  privateNode.param("pipelineMapUpdate", params.pipelineMapUpdate, params.pipelineMapUpdate);
+  privateNode.param("asyncRegistration", params.asyncRegistration, params.asyncRegistration);
+  privateNode.param("surroundDelta", params.surroundDelta, params.surroundDelta);
+  privateNode.param("surroundKeyframeInterval", params.surroundKeyframeInterval, params.surroundKeyframeInterval);
+  cubeSize = params.cubeSize;
+
+  //建图线程启动之前建立好发布者
+  using namespace std::placeholders;
+  //没有订阅者时不拼接周围的地图
+  ros::SubscriberStatusCallback surroundSubscribersChanged =
+      std::bind(&LaserMappingNode::updateSurroundOutput, this);
+  pubLaserCloudSurround = node.advertise<pcl::PointCloud<PointType> >
+                          ("/laser_cloud_surround", 1, surroundSubscribersChanged, surroundSubscribersChanged);
+  updateSurroundOutput();
+  if (params.surroundDelta) {
+    pubSurroundDelta = node.advertise<loam_velodyne::SurroundDelta> ("/laser_cloud_surround_delta", 5);
+  }
+
+  //订阅者变化时相应地订阅或取消订阅全部点
+  subscribeNode = node;
+  ros::SubscriberStatusCallback registeredSubscribersChanged =
+      std::bind(&LaserMappingNode::updateFullResSubscription, this);
+  pubLaserCloudFullRes = node.advertise<pcl::PointCloud<PointType> >
+                         ("/velodyne_cloud_registered", 2,
+                          registeredSubscribersChanged, registeredSubscribersChanged);
+
+  pubOdomAftMapped = node.advertise<nav_msgs::Odometry> ("/aft_mapped_to_init", 5);
+
+  pubDiagnostics = node.advertise<diagnostic_msgs::DiagnosticArray> ("/diagnostics", 1);
+
+  tfBroadcaster.reset(new tf::TransformBroadcaster());
+
+  //各阶段耗时按~timingPeriod周期发布到/diagnostics
+  matchTimingPublisher.setup(node, privateNode, "laserMapping: matching timing");
+  mapTimingPublisher.setup(node, privateNode, "laserMapping: map update timing");
+
+  //建图的结果在回调中发布，需在configure启动建图线程之前设置
+  laserMapping.setMappingCallback(std::bind(&LaserMappingNode::publishMapping, this, _1));
+  laserMapping.setRegisteredCloudCallback(std::bind(&LaserMappingNode::publishRegisteredCloud, this, _1));
+  laserMapping.setMapCallback(std::bind(&LaserMappingNode::publishMap, this, _1));
+  if (!laserMapping.configure(params)) {
+    return false;
+  }
+
+  //四路输入按时间戳对齐，最后一路到达时立即放入建图队列；没有订阅全部点时全部点为空
+  inputSynchronizer.registerCallback(std::bind(&LaserMappingNode::synchronizedHandler, this, _1, _2, _3, _4));
+  //里程计每帧都发布，特征点(与一起发布的全部点)每skipFrameNum + 1帧才发布一次，
+  //只有收到了特征点却没有对齐的帧才计为丢帧，只有里程计的帧不计
+  inputSynchronizer.setDropChannels((1u << 0) | (1u << 1));
+
+  //特征点云以pcl::PointCloud订阅，同一nodelet manager内直接共享laserOdometry发布的点云
+  subLaserCloudCornerLast = node.subscribe<pcl::PointCloud<PointType> >
+                            ("/laser_cloud_corner_last", 2, &LaserMappingNode::laserCloudCornerLastHandler, this);
+
+  subLaserCloudSurfLast = node.subscribe<pcl::PointCloud<PointType> >
+                          ("/laser_cloud_surf_last", 2, &LaserMappingNode::laserCloudSurfLastHandler, this);
+
+  subLaserOdometry = node.subscribe<nav_msgs::Odometry>
+                     ("/laser_odom_to_init", 5, &LaserMappingNode::laserOdometryHandler, this);
+
+  updateFullResSubscription();
+
+  subImu = node.subscribe<sensor_msgs::Imu> ("/imu/data", 50, &LaserMappingNode::imuHandler, this);
+
+  saveMapService = privateNode.advertiseService("save_map", &LaserMappingNode::saveMapHandler, this);
+
+  return true;
+}
+
+//在建图线程两帧之间写入，写完之后返回
+bool LaserMappingNode::saveMapHandler(loam_velodyne::SaveMap::Request& request,
+                                      loam_velodyne::SaveMap::Response& response)
+{
+  if (request.filename.empty()) {
+    response.success = false;
+    response.message = "empty filename";
+    return true;
+  }
+
+  response.success = laserMapping.exportMap(request.filename, request.quantize);
+  response.message = response.success ? "map saved to " + request.filename
+                                      : "failed to save map to " + request.filename;
+  return true;
+}
+
+//接收边沿点，只保存共享指针，不做拷贝
+void LaserMappingNode::laserCloudCornerLastHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudCornerLast2)
+{
+  inputSynchronizer.add<0>(laserCloudCornerLast2->header.stamp, laserCloudCornerLast2);
+}
+
+//接收平面点
+void LaserMappingNode::laserCloudSurfLastHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudSurfLast2)
+{
+  inputSynchronizer.add<1>(laserCloudSurfLast2->header.stamp, laserCloudSurfLast2);
+}
+
+//接收点云全部点
+void LaserMappingNode::laserCloudFullResHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudFullRes2)
+{
+  inputSynchronizer.add<2>(laserCloudFullRes2->header.stamp, laserCloudFullRes2);
+}
+
+//接收旋转平移信息
+void LaserMappingNode::laserOdometryHandler(const nav_msgs::Odometry::ConstPtr& laserOdometry)
+{
+  const uint64_t stamp = stampKeyOf(laserOdometry->header.stamp);
+  if (!fullResSubscribed) {
+    inputSynchronizer.add<2>(stamp, CloudConstPtr());
+  }
+  inputSynchronizer.add<3>(stamp, laserOdometry);
+}
+
+void LaserMappingNode::updateFullResSubscription()
+{
+  std::lock_guard<std::mutex> lock(fullResMutex);
+  bool wanted = pubLaserCloudFullRes.getNumSubscribers() > 0;
+  if (wanted && !fullResSubscribed) {
+    subLaserCloudFullRes = subscribeNode.subscribe<pcl::PointCloud<PointType> >
+                           ("/velodyne_cloud_3", 2, &LaserMappingNode::laserCloudFullResHandler, this);
+  } else if (!wanted && fullResSubscribed) {
+    subLaserCloudFullRes.shutdown();
+  }
+  fullResSubscribed = wanted;
+}
+
+void LaserMappingNode::imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn)
+{
+  laserMapping.processImu(imuSampleFromMsg(*imuIn));
+}
+
+//同一帧的四路输入到齐之后组成一帧交给建图
+void LaserMappingNode::synchronizedHandler(const CloudConstPtr& laserCloudCornerLast2,
+                                           const CloudConstPtr& laserCloudSurfLast2,
+                                           const CloudConstPtr& laserCloudFullRes2,
+                                           const nav_msgs::Odometry::ConstPtr& laserOdometry)
+{
+  MappingBundle bundle;
+  bundle.time = laserOdometry->header.stamp.toSec();
+  bundle.cornerLast = laserCloudCornerLast2;
+  bundle.surfLast = laserCloudSurfLast2;
+  bundle.fullRes = laserCloudFullRes2;
+  //四元数转换为欧拉角
+  poseToTransform(laserOdometry->pose.pose, bundle.transformSum);
+
+  laserMapping.process(bundle);
+}
+
+void LaserMappingNode::publishMapping(const MappingOutput& output)
+{
+  odomAftMapped.header.stamp = ros::Time().fromSec(output.time);
+  transformToPose(output.transformAftMapped, odomAftMapped.pose.pose);
+  //扭转量
+  odomAftMapped.twist.twist.angular.x = output.transformBefMapped[0];
+  odomAftMapped.twist.twist.angular.y = output.transformBefMapped[1];
+  odomAftMapped.twist.twist.angular.z = output.transformBefMapped[2];
+  odomAftMapped.twist.twist.linear.x = output.transformBefMapped[3];
+  odomAftMapped.twist.twist.linear.y = output.transformBefMapped[4];
+  odomAftMapped.twist.twist.linear.z = output.transformBefMapped[5];
+
+  pubOdomAftMapped.publish(odomAftMapped);
+
+  //广播坐标系旋转平移参量
+  const geometry_msgs::Quaternion& geoQuat = odomAftMapped.pose.pose.orientation;
+  aftMappedTrans.stamp_ = ros::Time().fromSec(output.time);
+  aftMappedTrans.setRotation(tf::Quaternion(geoQuat.x, geoQuat.y, geoQuat.z, geoQuat.w));
+  aftMappedTrans.setOrigin(tf::Vector3(output.transformAftMapped[3],
+                                       output.transformAftMapped[4], output.transformAftMapped[5]));
+  tfBroadcaster->sendTransform(aftMappedTrans);
+
+  matchTimingPublisher.update(laserMapping.getMatchTimers());
+}
+
+void LaserMappingNode::publishRegisteredCloud(const CloudConstPtr& registeredCloud)
+{
+  pubLaserCloudFullRes.publish(registeredCloud);
+}
+
+void LaserMappingNode::updateSurroundOutput()
+{
+  laserMapping.setSurroundOutput(pubLaserCloudSurround.getNumSubscribers() > 0);
+}
+
+void LaserMappingNode::publishMap(const MapOutput& output)
+{
+  if (output.surround) {
+    pubLaserCloudSurround.publish(output.surround);
+  }
+
+  if (output.surroundDelta) {
+    const SurroundDelta& delta = *output.surroundDelta;
+    loam_velodyne::SurroundDelta::Ptr deltaMsg(new loam_velodyne::SurroundDelta());
+    deltaMsg->header.stamp = ros::Time().fromSec(delta.time);
+    deltaMsg->header.frame_id = "/camera_init";
+    deltaMsg->keyframe = delta.keyframe;
+    deltaMsg->cubeSize = cubeSize;
+    deltaMsg->cubeIndices.resize(3 * delta.cubes.size());
+    for (size_t n = 0; n < delta.cubes.size(); n++) {
+      deltaMsg->cubeIndices[3 * n] = delta.cubes[n].i;
+      deltaMsg->cubeIndices[3 * n + 1] = delta.cubes[n].j;
+      deltaMsg->cubeIndices[3 * n + 2] = delta.cubes[n].k;
+    }
+    deltaMsg->pointStart = delta.pointStart;
+    deltaMsg->pointSize = delta.pointSize;
+    deltaMsg->points.resize(4 * delta.points.size());
+    for (size_t n = 0; n < delta.points.size(); n++) {
+      deltaMsg->points[4 * n] = delta.points.points[n].x;
+      deltaMsg->points[4 * n + 1] = delta.points.points[n].y;
+      deltaMsg->points[4 * n + 2] = delta.points.points[n].z;
+      deltaMsg->points[4 * n + 3] = delta.points.points[n].intensity;
+    }
+    pubSurroundDelta.publish(deltaMsg);
+  }
+
+  if (output.publishFrame) {
+    //地图内存使用情况
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "laserMapping: map";
+    status.hardware_id = "loam_velodyne";
+    if (output.memoryBudget > 0 && output.residentBytes > output.memoryBudget) {
+      status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      status.message = "Map memory exceeds the budget";
+    } else {
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = "OK";
+    }
+
+    addDiagnosticValue(status, "resident cubes", output.residentCubes);
+    addDiagnosticValue(status, "resident bytes", output.residentBytes);
+    addDiagnosticValue(status, "memory budget bytes", output.memoryBudget);
+    addDiagnosticValue(status, "spilled cubes", output.spilledCubes);
+    addDiagnosticValue(status, "spill count", output.spillCount);
+    addDiagnosticValue(status, "reload count", output.reloadCount);
+    addDiagnosticValue(status, "bundle queue capacity", output.bundleQueueCapacity);
+    addDiagnosticValue(status, "dropped bundles", output.droppedBundles);
+    addDiagnosticValue(status, "unmatched input frames", inputSynchronizer.getDroppedCount());
+
+    //最近一帧的位姿优化
+    diagnostic_msgs::DiagnosticStatus solverStatus;
+    solverStatus.name = "laserMapping: solver";
+    solverStatus.hardware_id = "loam_velodyne";
+    if (output.solverReport.reason == SOLVER_DEADLINE) {
+      solverStatus.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      solverStatus.message = "Solver stopped at the time budget";
+    } else {
+      solverStatus.level = diagnostic_msgs::DiagnosticStatus::OK;
+      solverStatus.message = "OK";
+    }
+    addDiagnosticValue(solverStatus, "iterations", output.solverReport.iterations);
+    addDiagnosticValue(solverStatus, "associations", output.solverReport.associations);
+    addDiagnosticValue(solverStatus, "stop reason", solverStopReasonName(output.solverReport.reason));
+    addDiagnosticValue(solverStatus, "elapsed ms", output.solverReport.elapsed * 1000);
+
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time().fromSec(output.time);
+    diagnostics.status.push_back(status);
+    diagnostics.status.push_back(solverStatus);
+    pubDiagnostics.publish(diagnostics);
+  }
+
+  mapTimingPublisher.update(laserMapping.getMapTimers());
+}
+
+} // end namespace loam
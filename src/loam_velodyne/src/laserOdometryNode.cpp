@@ -0,0 +1,243 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <functional>
+
+#include <loam_velodyne/LaserOdometryNode.h>
+#include <loam_velodyne/feature_frame.h>
+#include <loam_velodyne/ros_conversions.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl_ros/point_cloud.h>
+
+namespace loam {
+
+LaserOdometryNode::LaserOdometryNode()
+  : reportedDroppedFrames(0)
+{
+  laserOdometryMsg.header.frame_id = "/camera_init";
+  laserOdometryMsg.child_frame_id = "/laser_odom";
+
+  laserOdometryTrans.frame_id_ = "/camera_init";
+  laserOdometryTrans.child_frame_id_ = "/laser_odom";
+}
+
+bool LaserOdometryNode::setup(ros::NodeHandle& node, ros::NodeHandle& privateNode)
+{
+  setupRosLogging();
+
+  LaserOdometryParams params;
+  privateNode.param("numThreads", params.numThreads, params.numThreads);
+  privateNode.param("maxIterations", params.maxIterations, params.maxIterations);
+  privateNode.param("timeBudget", params.timeBudget, params.timeBudget);
+  privateNode.param("reassociateRotation", params.reassociateRotation, params.reassociateRotation);
+  privateNode.param("reassociateTranslation", params.reassociateTranslation, params.reassociateTranslation);
+  privateNode.param("correspondenceSearch", params.correspondenceSearch, params.correspondenceSearch);
+  privateNode.param("skipFrameNum", params.skipFrameNum, params.skipFrameNum);
+  privateNode.param("interpolationBins", params.interpolationBins, params.interpolationBins);
+  privateNode.param("fullResDecimation", params.fullResDecimation, params.fullResDecimation);
+  if (!laserOdometry.configure(params)) {
+    return false;
+  }
+
+  //六路输入按时间戳对齐，最后一路到达时立即处理
+  using namespace std::placeholders;
+  inputSynchronizer.registerCallback(std::bind(&LaserOdometryNode::synchronizedHandler, this,
+                                               _1, _2, _3, _4, _5, _6));
+
+  bool useFeatureFrame = false;
+  privateNode.param("useFeatureFrame", useFeatureFrame, useFeatureFrame);
+  if (useFeatureFrame) {
+    subFeatureFrame = node.subscribe<loam_velodyne::FeatureFrame>
+                      ("/feature_frame", 2, &LaserOdometryNode::featureFrameHandler, this);
+  } else {
+    //特征点云以pcl::PointCloud订阅，同一nodelet manager内直接共享scanRegistration发布的点云
+    subCornerPointsSharp = node.subscribe<pcl::PointCloud<PointType> >
+                           ("/laser_cloud_sharp", 2, &LaserOdometryNode::laserCloudSharpHandler, this);
+
+    subCornerPointsLessSharp = node.subscribe<pcl::PointCloud<PointType> >
+                               ("/laser_cloud_less_sharp", 2, &LaserOdometryNode::laserCloudLessSharpHandler, this);
+
+    subSurfPointsFlat = node.subscribe<pcl::PointCloud<PointType> >
+                        ("/laser_cloud_flat", 2, &LaserOdometryNode::laserCloudFlatHandler, this);
+
+    subSurfPointsLessFlat = node.subscribe<pcl::PointCloud<PointType> >
+                            ("/laser_cloud_less_flat", 2, &LaserOdometryNode::laserCloudLessFlatHandler, this);
+
+    subLaserCloudFullRes = node.subscribe<pcl::PointCloud<PointType> >
+                           ("/velodyne_cloud_2", 2, &LaserOdometryNode::laserCloudFullResHandler, this);
+
+    subImuTrans = node.subscribe<pcl::PointCloud<pcl::PointXYZ> >
+                  ("/imu_trans", 5, &LaserOdometryNode::imuTransHandler, this);
+  }
+
+  pubLaserCloudCornerLast = node.advertise<pcl::PointCloud<PointType> >
+                            ("/laser_cloud_corner_last", 2);
+
+  pubLaserCloudSurfLast = node.advertise<pcl::PointCloud<PointType> >
+                          ("/laser_cloud_surf_last", 2);
+
+  pubLaserCloudFullRes = node.advertise<pcl::PointCloud<PointType> >
+                         ("/velodyne_cloud_3", 2);
+
+  pubLaserOdometry = node.advertise<nav_msgs::Odometry> ("/laser_odom_to_init", 5);
+
+  tfBroadcaster.reset(new tf::TransformBroadcaster());
+
+  //各阶段耗时按~timingPeriod周期发布到/diagnostics
+  timingPublisher.setup(node, privateNode, "laserOdometry: timing");
+
+  return true;
+}
+
+//接收特征点云，只保存共享指针，不做拷贝
+void LaserOdometryNode::laserCloudSharpHandler(const pcl::PointCloud<PointType>::ConstPtr& cornerPointsSharp2)
+{
+  inputSynchronizer.add<0>(cornerPointsSharp2->header.stamp, cornerPointsSharp2);
+}
+
+void LaserOdometryNode::laserCloudLessSharpHandler(const pcl::PointCloud<PointType>::ConstPtr& cornerPointsLessSharp2)
+{
+  inputSynchronizer.add<1>(cornerPointsLessSharp2->header.stamp, cornerPointsLessSharp2);
+}
+
+void LaserOdometryNode::laserCloudFlatHandler(const pcl::PointCloud<PointType>::ConstPtr& surfPointsFlat2)
+{
+  inputSynchronizer.add<2>(surfPointsFlat2->header.stamp, surfPointsFlat2);
+}
+
+void LaserOdometryNode::laserCloudLessFlatHandler(const pcl::PointCloud<PointType>::ConstPtr& surfPointsLessFlat2)
+{
+  inputSynchronizer.add<3>(surfPointsLessFlat2->header.stamp, surfPointsLessFlat2);
+}
+
+void LaserOdometryNode::laserCloudFullResHandler(const pcl::PointCloud<PointType>::ConstPtr& laserCloudFullRes2)
+{
+  inputSynchronizer.add<4>(laserCloudFullRes2->header.stamp, laserCloudFullRes2);
+}
+
+void LaserOdometryNode::imuTransHandler(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr& imuTrans2)
+{
+  inputSynchronizer.add<5>(imuTrans2->header.stamp, imuTrans2);
+}
+
+//合并消息中的点集按索引范围拆回点云，IMU状态还原成/imu_trans的格式，之后与分开订阅时的处理相同
+void LaserOdometryNode::featureFrameHandler(const loam_velodyne::FeatureFrame::ConstPtr& featureFrame)
+{
+  const uint64_t cloudStamp = pcl_conversions::toPCL(featureFrame->header.stamp);
+  pcl::PointCloud<PointType>::Ptr clouds[loam_velodyne::FeatureFrame::SET_NUM];
+  for (int i = 0; i < loam_velodyne::FeatureFrame::SET_NUM; i++) {
+    clouds[i].reset(new pcl::PointCloud<PointType>());
+    if (!extractFeatureSet(*featureFrame, i, *clouds[i])) {
+      ROS_WARN("laserOdometry received a feature frame with an invalid point set range");
+      return;
+    }
+    clouds[i]->header.stamp = cloudStamp;
+    clouds[i]->header.frame_id = featureFrame->header.frame_id;
+  }
+
+  pcl::PointCloud<pcl::PointXYZ>::Ptr imuTrans2(new pcl::PointCloud<pcl::PointXYZ>());
+  imuTrans2->resize(4);
+  imuTrans2->points[0] = pcl::PointXYZ(featureFrame->imuAngleStart.x, featureFrame->imuAngleStart.y,
+                                       featureFrame->imuAngleStart.z);
+  imuTrans2->points[1] = pcl::PointXYZ(featureFrame->imuAngleLast.x, featureFrame->imuAngleLast.y,
+                                       featureFrame->imuAngleLast.z);
+  imuTrans2->points[2] = pcl::PointXYZ(featureFrame->imuShiftFromStart.x, featureFrame->imuShiftFromStart.y,
+                                       featureFrame->imuShiftFromStart.z);
+  imuTrans2->points[3] = pcl::PointXYZ(featureFrame->imuVeloFromStart.x, featureFrame->imuVeloFromStart.y,
+                                       featureFrame->imuVeloFromStart.z);
+  imuTrans2->header.stamp = cloudStamp;
+  imuTrans2->header.frame_id = featureFrame->header.frame_id;
+
+  synchronizedHandler(clouds[loam_velodyne::FeatureFrame::CORNER_SHARP],
+                      clouds[loam_velodyne::FeatureFrame::CORNER_LESS_SHARP],
+                      clouds[loam_velodyne::FeatureFrame::SURF_FLAT],
+                      clouds[loam_velodyne::FeatureFrame::SURF_LESS_FLAT],
+                      clouds[loam_velodyne::FeatureFrame::FULL_RES],
+                      imuTrans2);
+}
+
+//同一个点云的特征点以及IMU信息都收到之后立即处理
+void LaserOdometryNode::synchronizedHandler(const CloudConstPtr& cornerPointsSharp2,
+                                            const CloudConstPtr& cornerPointsLessSharp2,
+                                            const CloudConstPtr& surfPointsFlat2,
+                                            const CloudConstPtr& surfPointsLessFlat2,
+                                            const CloudConstPtr& laserCloudFullRes2,
+                                            const ImuTransConstPtr& imuTrans2)
+{
+  FeatureSweep sweep;
+  sweep.time = pcl_conversions::fromPCL(surfPointsLessFlat2->header.stamp).toSec();
+  sweep.fullRes = laserCloudFullRes2;
+  sweep.cornerSharp = cornerPointsSharp2;
+  sweep.cornerLessSharp = cornerPointsLessSharp2;
+  sweep.surfFlat = surfPointsFlat2;
+  sweep.surfLessFlat = surfPointsLessFlat2;
+  sweep.imuTrans = imuTrans2;
+
+  uint64_t droppedFrames = inputSynchronizer.getDroppedCount();
+  if (droppedFrames != reportedDroppedFrames) {
+    ROS_WARN_THROTTLE(10.0, "laserOdometry dropped %lu unmatched input frames",
+                      (unsigned long)droppedFrames);
+    reportedDroppedFrames = droppedFrames;
+  }
+
+  //laserMapping只在有人订阅/velodyne_cloud_registered时才订阅全部点
+  laserOdometry.setFullResOutput(pubLaserCloudFullRes.getNumSubscribers() > 0);
+
+  OdometryOutput output;
+  if (laserOdometry.process(sweep, output)) {
+    //publish四元数和平移量
+    laserOdometryMsg.header.stamp = ros::Time().fromSec(output.time);
+    transformToPose(output.transformSum, laserOdometryMsg.pose.pose);
+    pubLaserOdometry.publish(laserOdometryMsg);
+
+    //广播新的平移旋转之后的坐标系(rviz)
+    const geometry_msgs::Quaternion& geoQuat = laserOdometryMsg.pose.pose.orientation;
+    laserOdometryTrans.stamp_ = ros::Time().fromSec(output.time);
+    laserOdometryTrans.setRotation(tf::Quaternion(geoQuat.x, geoQuat.y, geoQuat.z, geoQuat.w));
+    laserOdometryTrans.setOrigin(tf::Vector3(output.transformSum[3], output.transformSum[4],
+                                             output.transformSum[5]));
+    tfBroadcaster->sendTransform(laserOdometryTrans);
+  }
+
+  //第一帧没有对应的里程计，laserMapping不会处理，但仍发出作为下一帧的匹配对象
+  if (output.cornerLast) {
+    pubLaserCloudCornerLast.publish(output.cornerLast);
+    pubLaserCloudSurfLast.publish(output.surfLast);
+  }
+  if (output.fullRes) {
+    pubLaserCloudFullRes.publish(output.fullRes);
+  }
+
+  timingPublisher.update(laserOdometry.getStageTimers());
+}
+
+} // end namespace loam
@@ -0,0 +1,85 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <loam_velodyne/LidarExtrinsic.h>
+#include <Eigen/Geometry>
+
+namespace loam {
+
+LidarExtrinsic::LidarExtrinsic()
+  : identity(true),
+    rotation(Eigen::Matrix3f::Identity()),
+    translation(Eigen::Vector3f::Zero())
+{
+}
+
+void LidarExtrinsic::set(const double extrinsic[6])
+{
+  Eigen::Matrix3d rotationRos = (Eigen::AngleAxisd(extrinsic[5], Eigen::Vector3d::UnitZ()) *
+                                 Eigen::AngleAxisd(extrinsic[4], Eigen::Vector3d::UnitY()) *
+                                 Eigen::AngleAxisd(extrinsic[3], Eigen::Vector3d::UnitX())).toRotationMatrix();
+  Eigen::Vector3d translationRos(extrinsic[0], extrinsic[1], extrinsic[2]);
+
+  //交换坐标轴：(x, y, z)_loam = (y, z, x)_ros
+  Eigen::Matrix3d swap;
+  swap << 0, 1, 0,
+          0, 0, 1,
+          1, 0, 0;
+  rotation = (swap * rotationRos * swap.transpose()).cast<float>();
+  translation = (swap * translationRos).cast<float>();
+
+  identity = rotation.isIdentity() && translation.isZero();
+}
+
+void LidarExtrinsic::transformCloud(const pcl::PointCloud<PointType>& cloudIn,
+                                    pcl::PointCloud<PointType>& cloudOut) const
+{
+  size_t cloudSize = cloudIn.points.size();
+  if (&cloudOut != &cloudIn) {
+    cloudOut.header = cloudIn.header;
+    cloudOut.resize(cloudSize);
+  }
+
+  //intensity中的线号与相对时间保持不变
+  for (size_t i = 0; i < cloudSize; i++) {
+    const PointType& pi = cloudIn.points[i];
+    Eigen::Vector3f point = rotation * Eigen::Vector3f(pi.x, pi.y, pi.z) + translation;
+
+    PointType& po = cloudOut.points[i];
+    po.x = point.x();
+    po.y = point.y();
+    po.z = point.z();
+    po.intensity = pi.intensity;
+  }
+}
+
+} // end namespace loam
@@ -0,0 +1,417 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+//离线基准测试：不连接ROS master，读取rosbag或按文件名排序的PCD序列，
+//以最快的速度依次经过scanRegistration -> laserOdometry -> laserMapping，
+//输出各阶段耗时、帧率、峰值内存与轨迹(TUM格式)，用于同时比较速度与漂移
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <loam_velodyne/LaserMapping.h>
+#include <loam_velodyne/LaserOdometry.h>
+#include <loam_velodyne/ScanRegistration.h>
+#include <loam_velodyne/ros_conversions.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/PointCloud2.h>
+
+namespace {
+
+struct BenchmarkOptions {
+  BenchmarkOptions()
+    : pointsTopic("/velodyne_points"),
+      imuTopic("/imu/data"),
+      scanPeriod(0.1),
+      maxFrames(0),
+      registeredCloud(false) {}
+
+  std::string input;
+  std::string pointsTopic;
+  std::string imuTopic;
+  //PCD文件名不是时间戳时，相邻两帧的时间间隔(秒)
+  double scanPeriod;
+  //最多处理的点云帧数，0为不限制
+  int maxFrames;
+  std::string trajectoryFile;
+  std::string odometryFile;
+  //是否投影并转换全部点，相当于有人订阅/velodyne_cloud_registered
+  bool registeredCloud;
+
+  loam::ScanRegistrationParams scanRegistration;
+  loam::LaserOdometryParams laserOdometry;
+  loam::LaserMappingParams laserMapping;
+};
+
+void printUsage(const char* program)
+{
+  printf("Usage: %s <bag file | pcd directory> [options]\n"
+         "  --points-topic <topic>     point cloud topic in the bag (default /velodyne_points)\n"
+         "  --imu-topic <topic>        imu topic in the bag, empty to ignore imu (default /imu/data)\n"
+         "  --scan-period <s>          stamp step for pcd files not named by stamp (default 0.1)\n"
+         "  --max-frames <n>           stop after n point clouds (default 0, all)\n"
+         "  --trajectory <file>        write the mapped poses in TUM format\n"
+         "  --odometry <file>          write the odometry poses in TUM format\n"
+         "  --sensor <model>           VLP-16, HDL-32, HDL-64, OS1-64 or OS1-128 (default VLP-16)\n"
+         "  --threads <n>              odometry and mapping threads (default 0, all cores)\n"
+         "  --correspondence <search>  kdtree or scanline (default kdtree)\n"
+         "  --interpolation-bins <n>   odometry motion compensation pose table size (default 0, per point)\n"
+         "  --pipeline-map-update      update the map in parallel with the next frame\n"
+         "  --registered-cloud         also re-project and register the full resolution clouds\n"
+         "  --surround-delta           build surround map deltas instead of the full surround cloud\n",
+         program);
+}
+
+bool parseOptions(int argc, char** argv, BenchmarkOptions& options)
+{
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--points-topic" && hasValue) {
+      options.pointsTopic = argv[++i];
+    } else if (arg == "--imu-topic" && hasValue) {
+      options.imuTopic = argv[++i];
+    } else if (arg == "--scan-period" && hasValue) {
+      options.scanPeriod = atof(argv[++i]);
+    } else if (arg == "--max-frames" && hasValue) {
+      options.maxFrames = atoi(argv[++i]);
+    } else if (arg == "--trajectory" && hasValue) {
+      options.trajectoryFile = argv[++i];
+    } else if (arg == "--odometry" && hasValue) {
+      options.odometryFile = argv[++i];
+    } else if (arg == "--sensor" && hasValue) {
+      options.scanRegistration.sensorModel = argv[++i];
+    } else if (arg == "--threads" && hasValue) {
+      options.laserOdometry.numThreads = atoi(argv[++i]);
+      options.laserMapping.numThreads = options.laserOdometry.numThreads;
+    } else if (arg == "--correspondence" && hasValue) {
+      options.laserOdometry.correspondenceSearch = argv[++i];
+    } else if (arg == "--interpolation-bins" && hasValue) {
+      options.laserOdometry.interpolationBins = atoi(argv[++i]);
+    } else if (arg == "--pipeline-map-update") {
+      options.laserMapping.pipelineMapUpdate = true;
+    } else if (arg == "--registered-cloud") {
+      options.registeredCloud = true;
+    } else if (arg == "--surround-delta") {
+      options.laserMapping.surroundDelta = true;
+    } else if (arg[0] != '-' && options.input.empty()) {
+      options.input = arg;
+    } else {
+      return false;
+    }
+  }
+  return !options.input.empty();
+}
+
+//按TUM格式写一行位姿：时间 tx ty tz qx qy qz qw
+void writePose(FILE* file, double time, const float transform[6])
+{
+  if (file == NULL) {
+    return;
+  }
+  //与话题中发布的位姿相同的四元数
+  geometry_msgs::Pose pose;
+  loam::transformToPose(transform, pose);
+  const geometry_msgs::Point& p = pose.position;
+  const geometry_msgs::Quaternion& q = pose.orientation;
+  fprintf(file, "%.6f %.6f %.6f %.6f %.9f %.9f %.9f %.9f\n",
+          time, p.x, p.y, p.z, q.x, q.y, q.z, q.w);
+}
+
+void printTimers(const char* title, const loam::StageTimers& timers)
+{
+  printf("%s\n", title);
+  for (size_t i = 0; i < timers.stageNum(); i++) {
+    const loam::LatencyHistogram& histogram = timers.histogram(i);
+    printf("  %-20s %8lu frames  mean %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f ms\n",
+           timers.stageName(i).c_str(), (unsigned long)histogram.count(), histogram.mean() * 1000,
+           histogram.percentile(0.5) * 1000, histogram.percentile(0.99) * 1000, histogram.max() * 1000);
+  }
+}
+
+//文件名(去掉扩展名)是数字时作为时间戳(秒)
+bool stampFromFileName(const std::string& name, double& stamp)
+{
+  std::string stem = name.substr(0, name.size() - 4);
+  char* end = NULL;
+  stamp = strtod(stem.c_str(), &end);
+  return !stem.empty() && end != NULL && *end == '\0';
+}
+
+//串起三个模块：每个模块的输出直接交给下一个模块，全部在调用线程中完成
+class BenchmarkPipeline {
+public:
+  BenchmarkPipeline()
+    : cloudFrames(0),
+      odometryFrames(0),
+      mappedFrames(0),
+      trajectory(NULL),
+      odometryTrajectory(NULL) {}
+
+  ~BenchmarkPipeline()
+  {
+    if (trajectory != NULL) {
+      fclose(trajectory);
+    }
+    if (odometryTrajectory != NULL) {
+      fclose(odometryTrajectory);
+    }
+  }
+
+  bool setup(const BenchmarkOptions& options)
+  {
+    if (!options.trajectoryFile.empty() && (trajectory = fopen(options.trajectoryFile.c_str(), "w")) == NULL) {
+      fprintf(stderr, "Cannot open %s\n", options.trajectoryFile.c_str());
+      return false;
+    }
+    if (!options.odometryFile.empty() && (odometryTrajectory = fopen(options.odometryFile.c_str(), "w")) == NULL) {
+      fprintf(stderr, "Cannot open %s\n", options.odometryFile.c_str());
+      return false;
+    }
+
+    laserMapping.setMappingCallback([this](const loam::MappingOutput& output) {
+      mappedFrames++;
+      writePose(trajectory, output.time, output.transformAftMapped);
+    });
+    //默认与没有订阅者的节点相同，不处理全部点
+    laserOdometry.setFullResOutput(options.registeredCloud);
+    if (options.registeredCloud) {
+      laserMapping.setRegisteredCloudCallback([](const pcl::PointCloud<PointType>::ConstPtr&) {});
+    }
+    laserMapping.setSurroundOutput(!options.laserMapping.surroundDelta);
+
+    return scanRegistration.configure(options.scanRegistration) &&
+           laserOdometry.configure(options.laserOdometry) &&
+           laserMapping.configure(options.laserMapping);
+  }
+
+  void addCloud(const sensor_msgs::PointCloud2& cloud)
+  {
+    cloudFrames++;
+    loam::rawSweepFromMsg(cloud, scanRegistration.getRingField(), scanRegistration.getTimeField(),
+                          laserCloudIn, laserCloudInIndices);
+
+    loam::FeatureSweep sweep;
+    if (!scanRegistration.process(laserCloudIn, sweep)) {
+      return;
+    }
+
+    loam::OdometryOutput odometry;
+    if (!laserOdometry.process(sweep, odometry)) {
+      return;
+    }
+    odometryFrames++;
+    writePose(odometryTrajectory, odometry.time, odometry.transformSum);
+
+    //按跳帧数每隔一帧交给建图
+    if (odometry.cornerLast) {
+      loam::MappingBundle bundle;
+      bundle.time = odometry.time;
+      bundle.cornerLast = odometry.cornerLast;
+      bundle.surfLast = odometry.surfLast;
+      bundle.fullRes = odometry.fullRes;
+      std::copy(odometry.transformSum, odometry.transformSum + 6, bundle.transformSum);
+      laserMapping.process(bundle);
+    }
+  }
+
+  void addImu(const sensor_msgs::Imu& imu)
+  {
+    loam::ImuSample sample = loam::imuSampleFromMsg(imu);
+    scanRegistration.processImu(sample);
+    laserMapping.processImu(sample);
+  }
+
+  void printReport(double seconds)
+  {
+    printTimers("scanRegistration", scanRegistration.getStageTimers());
+    printTimers("laserOdometry", laserOdometry.getStageTimers());
+    printTimers("laserMapping: matching", laserMapping.getMatchTimers());
+    printTimers("laserMapping: map update", laserMapping.getMapTimers());
+
+    //Linux下ru_maxrss的单位为KB
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("point clouds %d, odometry frames %d, mapped frames %d\n", cloudFrames, odometryFrames, mappedFrames);
+    printf("wall time %.3f s, %.2f clouds/s\n", seconds, seconds > 0 ? cloudFrames / seconds : 0.0);
+    printf("peak RSS %.1f MB\n", usage.ru_maxrss / 1024.0);
+  }
+
+  int getCloudFrames() const { return cloudFrames; }
+
+private:
+  loam::ScanRegistration scanRegistration;
+  loam::LaserOdometry laserOdometry;
+  loam::LaserMapping laserMapping;
+  //由消息转换得到的点云，每帧复用
+  loam::RawSweep laserCloudIn;
+  std::vector<int> laserCloudInIndices;
+
+  int cloudFrames;
+  int odometryFrames;
+  int mappedFrames;
+  FILE* trajectory;
+  FILE* odometryTrajectory;
+};
+
+bool replayBag(const BenchmarkOptions& options, BenchmarkPipeline& pipeline)
+{
+  rosbag::Bag bag;
+  try {
+    bag.open(options.input, rosbag::bagmode::Read);
+  } catch (const rosbag::BagException& e) {
+    fprintf(stderr, "Cannot open bag %s: %s\n", options.input.c_str(), e.what());
+    return false;
+  }
+
+  std::vector<std::string> topics(1, options.pointsTopic);
+  if (!options.imuTopic.empty()) {
+    topics.push_back(options.imuTopic);
+  }
+
+  //消息按记录时间的顺序交给各模块，与实时播放时的到达顺序相同
+  rosbag::View view(bag, rosbag::TopicQuery(topics));
+  for (rosbag::View::iterator it = view.begin(); it != view.end(); ++it) {
+    if (it->getTopic() == options.pointsTopic) {
+      sensor_msgs::PointCloud2ConstPtr cloud = it->instantiate<sensor_msgs::PointCloud2>();
+      if (cloud) {
+        pipeline.addCloud(*cloud);
+        if (options.maxFrames > 0 && pipeline.getCloudFrames() >= options.maxFrames) {
+          break;
+        }
+      }
+    } else {
+      sensor_msgs::Imu::ConstPtr imu = it->instantiate<sensor_msgs::Imu>();
+      if (imu) {
+        pipeline.addImu(*imu);
+      }
+    }
+  }
+
+  bag.close();
+  return true;
+}
+
+bool replayPcdDirectory(const BenchmarkOptions& options, BenchmarkPipeline& pipeline)
+{
+  DIR* dir = opendir(options.input.c_str());
+  if (dir == NULL) {
+    fprintf(stderr, "Cannot open directory %s\n", options.input.c_str());
+    return false;
+  }
+  std::vector<std::string> files;
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".pcd") == 0) {
+      files.push_back(name);
+    }
+  }
+  closedir(dir);
+  std::sort(files.begin(), files.end());
+
+  for (size_t i = 0; i < files.size(); i++) {
+    pcl::PCLPointCloud2 pclCloud;
+    std::string path = options.input + "/" + files[i];
+    if (pcl::io::loadPCDFile(path, pclCloud) != 0) {
+      fprintf(stderr, "Cannot read %s\n", path.c_str());
+      return false;
+    }
+
+    sensor_msgs::PointCloud2::Ptr cloud(new sensor_msgs::PointCloud2());
+    pcl_conversions::moveFromPCL(pclCloud, *cloud);
+    double stamp;
+    if (!stampFromFileName(files[i], stamp)) {
+      stamp = 1.0 + i * options.scanPeriod;
+    }
+    cloud->header.stamp = ros::Time().fromSec(stamp);
+    cloud->header.frame_id = "/velodyne";
+
+    pipeline.addCloud(*cloud);
+    if (options.maxFrames > 0 && pipeline.getCloudFrames() >= options.maxFrames) {
+      break;
+    }
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv)
+{
+  BenchmarkOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  //同步建图，每一帧都处理完再读入下一帧，结果与读入速度无关
+  options.laserMapping.asyncMapping = false;
+
+  //不调用ros::init，也不创建NodeHandle，只初始化时钟
+  ros::Time::init();
+
+  BenchmarkPipeline pipeline;
+  if (!pipeline.setup(options)) {
+    return 1;
+  }
+
+  struct stat inputStat;
+  if (stat(options.input.c_str(), &inputStat) != 0) {
+    fprintf(stderr, "Cannot find %s\n", options.input.c_str());
+    return 1;
+  }
+
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  bool replayed = S_ISDIR(inputStat.st_mode) ? replayPcdDirectory(options, pipeline)
+                                             : replayBag(options, pipeline);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  if (!replayed) {
+    return 1;
+  }
+
+  pipeline.printReport(seconds);
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+
+#include <loam_velodyne/logging.h>
+
+namespace loam {
+
+static void stderrLogHandler(LogLevel level, const char* message)
+{
+  static const char* const levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+  fprintf(stderr, "[%s] %s\n", levelNames[level], message);
+}
+
+static std::atomic<LogHandler> logHandler(stderrLogHandler);
+static std::atomic<int> logMinLevel(LOG_INFO);
+
+void setLogHandler(LogHandler handler, LogLevel minLevel)
+{
+  logHandler = handler != NULL ? handler : stderrLogHandler;
+  logMinLevel = minLevel;
+}
+
+void logMessage(LogLevel level, const char* format, ...)
+{
+  if (level < logMinLevel.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  char message[1024];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+  logHandler.load(std::memory_order_relaxed)(level, message);
+}
+
+bool logThrottle(double period, double& lastTime)
+{
+  double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  if (now - lastTime < period) {
+    return false;
+  }
+
+  lastTime = now;
+  return true;
+}
+
+} // end namespace loam
@@ -0,0 +1,350 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <loam_velodyne/MapFile.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace loam {
+
+static const uint32_t mapFileMagic = 0x50414d4c;//"LMAP"
+static const uint32_t mapFileVersion = 1;
+//flags：点以16位整数量化保存
+static const uint32_t mapFileQuantized = 1;
+
+struct MapFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  float cubeSize;
+  uint32_t flags;
+  uint64_t chunkNum;
+  //索引表在文件中的位置，索引表之后是文件末尾
+  uint64_t tableOffset;
+};
+
+//索引表中的一项
+struct MapChunkRecord {
+  int32_t i;
+  int32_t j;
+  int32_t k;
+  uint32_t pointNum[MapCube::FEATURE_NUM];
+  uint8_t filterDirty[MapCube::FEATURE_NUM];
+  uint8_t reserved[2];
+  uint64_t offset;
+};
+
+//量化之后的点，坐标以cube中心为原点
+struct QuantizedPoint {
+  int16_t x;
+  int16_t y;
+  int16_t z;
+  uint16_t intensity;
+};
+
+static_assert(sizeof(MapFileHeader) == 32, "unexpected map file header layout");
+static_assert(sizeof(MapChunkRecord) == 32, "unexpected map chunk record layout");
+static_assert(sizeof(QuantizedPoint) == 8, "unexpected quantized point layout");
+
+//量化的范围为cube中心前后各半个cube
+const int quantizedRange = 32767;
+const float intensityScale = 256.0f;
+
+static size_t pointBytes(bool quantized)
+{
+  return quantized ? sizeof(QuantizedPoint) : 4 * sizeof(float);
+}
+
+static int16_t quantizeCoordinate(float value, float scale)
+{
+  long q = std::lround(value * scale);
+  return int16_t(std::max(-long(quantizedRange), std::min(long(quantizedRange), q)));
+}
+
+MapFileWriter::MapFileWriter()
+  : cubeSize(0),
+    quantize(false),
+    offset(0)
+{
+}
+
+MapFileWriter::~MapFileWriter()
+{
+  discard();
+}
+
+void MapFileWriter::discard()
+{
+  if (file.is_open()) {
+    file.close();
+    std::remove(tempFileName.c_str());
+  }
+}
+
+bool MapFileWriter::open(const std::string& fileName, float cubeSize, bool quantize)
+{
+  discard();
+  this->fileName = fileName;
+  tempFileName = fileName + ".tmp";
+  this->cubeSize = cubeSize;
+  this->quantize = quantize;
+  chunks.clear();
+
+  //写入临时文件，文件头在close时写入，之前先占位
+  file.clear();
+  file.open(tempFileName.c_str(), std::ios::binary | std::ios::trunc);
+  MapFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  offset = sizeof(header);
+
+  return !file.fail();
+}
+
+bool MapFileWriter::write(const CubeIndex& index, const MapCube& cube)
+{
+  MapChunk chunk;
+  chunk.index = index;
+  chunk.offset = offset;
+
+  const float scale = quantizedRange / (0.5f * cubeSize);
+  const float center[3] = {index.i * cubeSize, index.j * cubeSize, index.k * cubeSize};
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    const pcl::PointCloud<PointType>::VectorType& points = cube.cloud[f]->points;
+    chunk.pointNum[f] = points.size();
+    chunk.filterDirty[f] = cube.filteredNum[f] < points.size();
+    if (points.empty()) {
+      continue;
+    }
+
+    if (quantize) {
+      std::vector<QuantizedPoint> buffer(points.size());
+      for (size_t n = 0; n < points.size(); n++) {
+        buffer[n].x = quantizeCoordinate(points[n].x - center[0], scale);
+        buffer[n].y = quantizeCoordinate(points[n].y - center[1], scale);
+        buffer[n].z = quantizeCoordinate(points[n].z - center[2], scale);
+        long intensity = std::lround(points[n].intensity * intensityScale);
+        buffer[n].intensity = uint16_t(std::max(0L, std::min(65535L, intensity)));
+      }
+      file.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size() * sizeof(QuantizedPoint));
+    } else {
+      std::vector<float> buffer(4 * points.size());
+      for (size_t n = 0; n < points.size(); n++) {
+        buffer[4 * n] = points[n].x;
+        buffer[4 * n + 1] = points[n].y;
+        buffer[4 * n + 2] = points[n].z;
+        buffer[4 * n + 3] = points[n].intensity;
+      }
+      file.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size() * sizeof(float));
+    }
+    offset += points.size() * pointBytes(quantize);
+  }
+
+  chunks.push_back(chunk);
+  return !file.fail();
+}
+
+bool MapFileWriter::close()
+{
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::vector<MapChunkRecord> table(chunks.size());
+  for (size_t n = 0; n < chunks.size(); n++) {
+    MapChunkRecord& record = table[n];
+    record.i = chunks[n].index.i;
+    record.j = chunks[n].index.j;
+    record.k = chunks[n].index.k;
+    for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+      record.pointNum[f] = chunks[n].pointNum[f];
+      record.filterDirty[f] = chunks[n].filterDirty[f];
+    }
+    record.reserved[0] = record.reserved[1] = 0;
+    record.offset = chunks[n].offset;
+  }
+  if (!table.empty()) {
+    file.write(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(MapChunkRecord));
+  }
+
+  MapFileHeader header;
+  header.magic = mapFileMagic;
+  header.version = mapFileVersion;
+  header.cubeSize = cubeSize;
+  header.flags = quantize ? mapFileQuantized : 0;
+  header.chunkNum = chunks.size();
+  header.tableOffset = offset;
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (file.fail()) {
+    discard();
+    return false;
+  }
+
+  //写完之后才替换目标文件，rename是原子的
+  file.close();
+  if (file.fail() || std::rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+    std::remove(tempFileName.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+MapFileReader::MapFileReader()
+  : data(NULL),
+    dataSize(0),
+    cubeSize(0),
+    quantized(false)
+{
+}
+
+MapFileReader::~MapFileReader()
+{
+  close();
+}
+
+void MapFileReader::close()
+{
+  if (data != NULL) {
+    munmap(const_cast<uint8_t*>(data), dataSize);
+  }
+  data = NULL;
+  dataSize = 0;
+  chunks.clear();
+}
+
+bool MapFileReader::open(const std::string& fileName)
+{
+  close();
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(MapFileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  //映射之后文件描述符不再需要
+  void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  data = static_cast<const uint8_t*>(mapped);
+  dataSize = info.st_size;
+
+  const MapFileHeader& header = *reinterpret_cast<const MapFileHeader*>(data);
+  if (header.magic != mapFileMagic || header.version != mapFileVersion || !(header.cubeSize > 0) ||
+      header.tableOffset < sizeof(MapFileHeader) || header.tableOffset > dataSize ||
+      header.chunkNum > (dataSize - header.tableOffset) / sizeof(MapChunkRecord)) {
+    close();
+    return false;
+  }
+  cubeSize = header.cubeSize;
+  quantized = (header.flags & mapFileQuantized) != 0;
+
+  //只解析索引表，检查每个数据块都在索引表之前
+  const MapChunkRecord* table = reinterpret_cast<const MapChunkRecord*>(data + header.tableOffset);
+  for (uint64_t n = 0; n < header.chunkNum; n++) {
+    MapChunk chunk;
+    chunk.index = CubeIndex(table[n].i, table[n].j, table[n].k);
+    chunk.offset = table[n].offset;
+    uint64_t bytes = 0;
+    for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+      chunk.pointNum[f] = table[n].pointNum[f];
+      chunk.filterDirty[f] = table[n].filterDirty[f] != 0;
+      bytes += uint64_t(chunk.pointNum[f]) * pointBytes(quantized);
+    }
+    if (chunk.offset < sizeof(MapFileHeader) || chunk.offset > header.tableOffset ||
+        bytes > header.tableOffset - chunk.offset) {
+      close();
+      return false;
+    }
+    chunks[chunk.index] = chunk;
+  }
+
+  return true;
+}
+
+bool MapFileReader::read(const CubeIndex& index, MapCube& cube) const
+{
+  ChunkTable::const_iterator it = chunks.find(index);
+  if (it == chunks.end()) {
+    return false;
+  }
+
+  const MapChunk& chunk = it->second;
+  const uint8_t* position = data + chunk.offset;
+  const float scale = (0.5f * cubeSize) / quantizedRange;
+  const float center[3] = {index.i * cubeSize, index.j * cubeSize, index.k * cubeSize};
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    pcl::PointCloud<PointType>& points = *cube.cloud[f];
+    points.resize(chunk.pointNum[f]);
+
+    //数据块的起点按8字节对齐，可以直接按点的类型读取
+    if (quantized) {
+      const QuantizedPoint* quantizedPoints = reinterpret_cast<const QuantizedPoint*>(position);
+      for (size_t n = 0; n < points.points.size(); n++) {
+        points.points[n].x = center[0] + quantizedPoints[n].x * scale;
+        points.points[n].y = center[1] + quantizedPoints[n].y * scale;
+        points.points[n].z = center[2] + quantizedPoints[n].z * scale;
+        points.points[n].intensity = quantizedPoints[n].intensity / intensityScale;
+      }
+    } else {
+      const float* floats = reinterpret_cast<const float*>(position);
+      for (size_t n = 0; n < points.points.size(); n++) {
+        points.points[n].x = floats[4 * n];
+        points.points[n].y = floats[4 * n + 1];
+        points.points[n].z = floats[4 * n + 2];
+        points.points[n].intensity = floats[4 * n + 3];
+      }
+    }
+    position += points.points.size() * pointBytes(quantized);
+
+    //有未下采样的点时重新对整个cube下采样
+    cube.filteredNum[f] = chunk.filterDirty[f] ? 0 : points.points.size();
+    cube.voxels[f].clear();
+    cube.kdtreeDirty[f] = true;
+  }
+
+  return true;
+}
+
+} // end namespace loam
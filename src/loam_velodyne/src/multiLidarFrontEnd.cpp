@@ -0,0 +1,313 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <loam_velodyne/MultiLidarFrontEnd.h>
+#include <loam_velodyne/logging.h>
+
+namespace loam {
+
+//主雷达最多等待合并的帧数，超过时不再等待处理落后或没有数据的雷达
+const size_t maxPendingFrames = 2;
+//每个雷达最多保留的等待合并的帧数
+const size_t maxLidarFrames = 8;
+
+//把多个点云合并成一个新的点云，使用第一个点云的时间戳与坐标系
+static pcl::PointCloud<PointType>::ConstPtr mergeClouds(const std::vector<pcl::PointCloud<PointType>::ConstPtr>& clouds)
+{
+  size_t pointNum = 0;
+  for (size_t i = 0; i < clouds.size(); i++) {
+    pointNum += clouds[i]->size();
+  }
+
+  pcl::PointCloud<PointType>::Ptr merged(new pcl::PointCloud<PointType>());
+  merged->reserve(pointNum);
+  for (size_t i = 0; i < clouds.size(); i++) {
+    *merged += *clouds[i];
+  }
+  //拼接时时间戳取较新的一个，重新设为主雷达的时间戳，laserMapping按时间戳与里程计对齐
+  merged->header = clouds[0]->header;
+  return merged;
+}
+
+MultiLidarFrontEnd::MultiLidarFrontEnd()
+  : threadStop(false),
+    droppedClouds(0),
+    unmergedFrames(0),
+    fullResOutput(true),
+    mergeWindow(0.05)
+{
+}
+
+MultiLidarFrontEnd::~MultiLidarFrontEnd()
+{
+  stopThreads();
+}
+
+void MultiLidarFrontEnd::stopThreads()
+{
+  threadStop = true;
+  for (size_t i = 0; i < frontEnds.size(); i++) {
+    FrontEnd& frontEnd = *frontEnds[i];
+    if (frontEnd.thread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(frontEnd.cloudMutex);
+      }
+      frontEnd.cloudCondition.notify_one();
+      frontEnd.thread.join();
+    }
+  }
+}
+
+bool MultiLidarFrontEnd::configure(const MultiLidarParams& params)
+{
+  if (params.lidars.empty()) {
+    LOAM_ERROR("Invalid lidar list (expected at least one lidar)");
+    return false;
+  }
+  if (params.mergeWindow < 0) {
+    LOAM_ERROR("Invalid mergeWindow parameter: %f (expected >= 0)", params.mergeWindow);
+    return false;
+  }
+  if (params.cloudQueueSize < 1) {
+    LOAM_ERROR("Invalid cloudQueueSize parameter: %d (expected >= 1)", params.cloudQueueSize);
+    return false;
+  }
+  mergeWindow = params.mergeWindow;
+
+  size_t lidarNum = params.lidars.size();
+  for (size_t i = 0; i < lidarNum; i++) {
+    std::unique_ptr<FrontEnd> frontEnd(new FrontEnd());
+    if (!frontEnd->scanRegistration.configure(params.lidars[i].scanRegistration)) {
+      return false;
+    }
+
+    //其他雷达每帧都给出特征点，合并时选与主雷达的帧时间最近的一帧
+    LaserOdometryParams odometryParams = params.lidars[i].laserOdometry;
+    if (i > 0) {
+      odometryParams.skipFrameNum = 0;
+      frontEnd->extrinsic.set(params.lidars[i].extrinsic);
+    }
+    if (!frontEnd->laserOdometry.configure(odometryParams)) {
+      return false;
+    }
+
+    frontEnd->cloudQueue.reset(params.cloudQueueSize);
+    frontEnds.push_back(std::move(frontEnd));
+  }
+
+  lidarFrames.resize(lidarNum);
+  lidarLatestTime.assign(lidarNum, std::numeric_limits<double>::lowest());
+
+  for (size_t i = 0; i < lidarNum; i++) {
+    frontEnds[i]->thread = std::thread(&MultiLidarFrontEnd::frontEndLoop, this, i);
+  }
+
+  return true;
+}
+
+void MultiLidarFrontEnd::processCloud(size_t lidar, const std::shared_ptr<const RawSweep>& cloud)
+{
+  FrontEnd& frontEnd = *frontEnds[lidar];
+
+  //队列满时丢弃最旧的帧，接收回调从不等待处理
+  while (!frontEnd.cloudQueue.push(cloud)) {
+    std::shared_ptr<const RawSweep> dropped;
+    if (frontEnd.cloudQueue.pop(dropped)) {
+      droppedClouds++;
+    }
+  }
+
+  //空的临界区保证处理线程要么还没检查队列，要么已经在等待，不会错过通知
+  {
+    std::lock_guard<std::mutex> lock(frontEnd.cloudMutex);
+  }
+  frontEnd.cloudCondition.notify_one();
+}
+
+void MultiLidarFrontEnd::processImu(const ImuSample& imu)
+{
+  //队列满时丢弃最旧的测量，scanRegistration本身也只保留最近的一段
+  FrontEnd& frontEnd = *frontEnds[0];
+  while (!frontEnd.imuQueue.push(imu)) {
+    ImuSample dropped;
+    frontEnd.imuQueue.pop(dropped);
+  }
+}
+
+void MultiLidarFrontEnd::frontEndLoop(size_t lidar)
+{
+  FrontEnd& frontEnd = *frontEnds[lidar];
+  while (!threadStop) {
+    {
+      std::unique_lock<std::mutex> lock(frontEnd.cloudMutex);
+      frontEnd.cloudCondition.wait_for(lock, std::chrono::milliseconds(100), [this, &frontEnd] {
+        return threadStop || !frontEnd.cloudQueue.empty();
+      });
+    }
+
+    std::shared_ptr<const RawSweep> cloud;
+    while (!threadStop && frontEnd.cloudQueue.pop(cloud)) {
+      processFrame(lidar, *cloud);
+    }
+  }
+}
+
+void MultiLidarFrontEnd::processFrame(size_t lidar, const RawSweep& cloud)
+{
+  FrontEnd& frontEnd = *frontEnds[lidar];
+
+  //点云之前到达的IMU测量先交给scanRegistration，与单雷达时回调的顺序相同
+  ImuSample imu;
+  while (frontEnd.imuQueue.pop(imu)) {
+    frontEnd.scanRegistration.processImu(imu);
+  }
+
+  FeatureSweep sweep;
+  if (frontEnd.scanRegistration.process(cloud, sweep)) {
+    frontEnd.laserOdometry.setFullResOutput(fullResOutput);
+    OdometryOutput output;
+    bool estimated = frontEnd.laserOdometry.process(sweep, output);
+
+    if (lidar == 0) {
+      if (estimated && odometryCallback) {
+        OdometryOutput pose;
+        pose.time = output.time;
+        std::copy(output.transformSum, output.transformSum + 6, pose.transformSum);
+        odometryCallback(pose);
+      }
+
+      if (output.cornerLast) {
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        pendingFrames.push_back(output);
+        releaseMerged();
+      }
+    } else {
+      //转换到主雷达坐标系，接收到的点云是共享的只读数据，结果写入新的点云
+      if (output.cornerLast && !frontEnd.extrinsic.isIdentity()) {
+        pcl::PointCloud<PointType>::ConstPtr* clouds[] = {&output.cornerLast, &output.surfLast, &output.fullRes};
+        for (size_t i = 0; i < 3; i++) {
+          if (*clouds[i]) {
+            pcl::PointCloud<PointType>::Ptr transformed(new pcl::PointCloud<PointType>());
+            frontEnd.extrinsic.transformCloud(**clouds[i], *transformed);
+            *clouds[i] = transformed;
+          }
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mergeMutex);
+      if (output.cornerLast) {
+        lidarFrames[lidar].push_back(output);
+        if (lidarFrames[lidar].size() > maxLidarFrames) {
+          lidarFrames[lidar].pop_front();
+        }
+      }
+      lidarLatestTime[lidar] = output.time;
+      releaseMerged();
+    }
+  }
+
+  if (frameCallback) {
+    frameCallback(lidar);
+  }
+}
+
+void MultiLidarFrontEnd::releaseMerged()
+{
+  while (!pendingFrames.empty()) {
+    const OdometryOutput& frame = pendingFrames.front();
+
+    //其他雷达都已处理到这一帧的时间之后，之后的帧不会比已有的帧离这一帧更近
+    bool ready = true;
+    for (size_t i = 1; i < frontEnds.size(); i++) {
+      if (lidarLatestTime[i] < frame.time) {
+        ready = false;
+      }
+    }
+    if (!ready && pendingFrames.size() <= maxPendingFrames) {
+      return;
+    }
+
+    std::vector<pcl::PointCloud<PointType>::ConstPtr> cornerClouds(1, frame.cornerLast);
+    std::vector<pcl::PointCloud<PointType>::ConstPtr> surfClouds(1, frame.surfLast);
+    std::vector<pcl::PointCloud<PointType>::ConstPtr> fullResClouds(1, frame.fullRes);
+    for (size_t i = 1; i < frontEnds.size(); i++) {
+      std::deque<OdometryOutput>& frames = lidarFrames[i];
+
+      //时间最近的一帧
+      size_t best = frames.size();
+      double bestDiff = mergeWindow;
+      for (size_t j = 0; j < frames.size(); j++) {
+        double diff = std::fabs(frames[j].time - frame.time);
+        if (diff <= bestDiff) {
+          best = j;
+          bestDiff = diff;
+        }
+      }
+
+      if (best == frames.size()) {
+        unmergedFrames++;
+        //太旧的帧之后也不会再用到
+        while (!frames.empty() && frames.front().time < frame.time - mergeWindow) {
+          frames.pop_front();
+        }
+        continue;
+      }
+
+      cornerClouds.push_back(frames[best].cornerLast);
+      surfClouds.push_back(frames[best].surfLast);
+      if (frame.fullRes && frames[best].fullRes) {
+        fullResClouds.push_back(frames[best].fullRes);
+      }
+      frames.erase(frames.begin(), frames.begin() + best + 1);
+    }
+
+    OdometryOutput merged;
+    merged.time = frame.time;
+    std::copy(frame.transformSum, frame.transformSum + 6, merged.transformSum);
+    //只有主雷达时直接使用原来的点云，不拷贝
+    merged.cornerLast = cornerClouds.size() > 1 ? mergeClouds(cornerClouds) : frame.cornerLast;
+    merged.surfLast = surfClouds.size() > 1 ? mergeClouds(surfClouds) : frame.surfLast;
+    merged.fullRes = fullResClouds.size() > 1 ? mergeClouds(fullResClouds) : frame.fullRes;
+    pendingFrames.pop_front();
+
+    if (featureCallback) {
+      featureCallback(merged);
+    }
+  }
+}
+
+} // end namespace loam
@@ -0,0 +1,212 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <loam_velodyne/MultiLidarNode.h>
+#include <loam_velodyne/ros_conversions.h>
+#include <pcl_ros/point_cloud.h>
+
+namespace loam {
+
+MultiLidarNode::MultiLidarNode()
+{
+  laserOdometryMsg.header.frame_id = "/camera_init";
+  laserOdometryMsg.child_frame_id = "/laser_odom";
+
+  laserOdometryTrans.frame_id_ = "/camera_init";
+  laserOdometryTrans.child_frame_id_ = "/laser_odom";
+}
+
+bool MultiLidarNode::setup(ros::NodeHandle& node, ros::NodeHandle& privateNode)
+{
+  setupRosLogging();
+
+  std::vector<std::string> lidarTopics;
+  if (!privateNode.getParam("lidarTopics", lidarTopics)) {
+    lidarTopics.push_back("/velodyne_points");
+  }
+  if (lidarTopics.empty()) {
+    ROS_ERROR("Invalid lidarTopics parameter (expected at least one topic)");
+    return false;
+  }
+  size_t lidarNum = lidarTopics.size();
+
+  //各雷达共用的参数
+  LidarFrontEndParams shared;
+  privateNode.param("sensorModel", shared.scanRegistration.sensorModel, shared.scanRegistration.sensorModel);
+  privateNode.param("useRingField", shared.scanRegistration.useRingField, shared.scanRegistration.useRingField);
+  privateNode.param("useTimeField", shared.scanRegistration.useTimeField, shared.scanRegistration.useTimeField);
+  privateNode.param("indexRelativeTime", shared.scanRegistration.indexRelativeTime,
+                    shared.scanRegistration.indexRelativeTime);
+  LaserOdometryParams& odometry = shared.laserOdometry;
+  privateNode.param("numThreads", odometry.numThreads, odometry.numThreads);
+  privateNode.param("maxIterations", odometry.maxIterations, odometry.maxIterations);
+  privateNode.param("timeBudget", odometry.timeBudget, odometry.timeBudget);
+  privateNode.param("reassociateRotation", odometry.reassociateRotation, odometry.reassociateRotation);
+  privateNode.param("reassociateTranslation", odometry.reassociateTranslation, odometry.reassociateTranslation);
+  privateNode.param("correspondenceSearch", odometry.correspondenceSearch, odometry.correspondenceSearch);
+  privateNode.param("skipFrameNum", odometry.skipFrameNum, odometry.skipFrameNum);
+  privateNode.param("interpolationBins", odometry.interpolationBins, odometry.interpolationBins);
+  privateNode.param("fullResDecimation", odometry.fullResDecimation, odometry.fullResDecimation);
+
+  std::vector<std::string> sensorModels;
+  if (privateNode.getParam("lidarSensorModels", sensorModels) && sensorModels.size() != lidarNum) {
+    ROS_ERROR("Invalid lidarSensorModels parameter (expected one model per lidar topic)");
+    return false;
+  }
+
+  //第一个雷达之后的每个雷达6个数：相对于第一个雷达的x, y, z, roll, pitch, yaw
+  std::vector<double> extrinsics;
+  privateNode.getParam("lidarExtrinsics", extrinsics);
+  if (extrinsics.size() != 6 * (lidarNum - 1)) {
+    ROS_ERROR("Invalid lidarExtrinsics parameter: %lu values (expected 6 per lidar after the first)",
+              (unsigned long)extrinsics.size());
+    return false;
+  }
+
+  MultiLidarParams params;
+  privateNode.param("mergeWindow", params.mergeWindow, params.mergeWindow);
+  privateNode.param("cloudQueueSize", params.cloudQueueSize, params.cloudQueueSize);
+  params.lidars.assign(lidarNum, shared);
+  for (size_t i = 0; i < lidarNum; i++) {
+    if (!sensorModels.empty()) {
+      params.lidars[i].scanRegistration.sensorModel = sensorModels[i];
+    }
+    if (i > 0) {
+      std::copy(extrinsics.begin() + 6 * (i - 1), extrinsics.begin() + 6 * i, params.lidars[i].extrinsic);
+    }
+  }
+
+  pubLaserCloudCornerLast = node.advertise<pcl::PointCloud<PointType> >
+                            ("/laser_cloud_corner_last", 2);
+
+  pubLaserCloudSurfLast = node.advertise<pcl::PointCloud<PointType> >
+                          ("/laser_cloud_surf_last", 2);
+
+  pubLaserCloudFullRes = node.advertise<pcl::PointCloud<PointType> >
+                         ("/velodyne_cloud_3", 2);
+
+  pubLaserOdometry = node.advertise<nav_msgs::Odometry> ("/laser_odom_to_init", 5);
+
+  tfBroadcaster.reset(new tf::TransformBroadcaster());
+
+  //各雷达的耗时按~timingPeriod周期发布到/diagnostics
+  scanTimingPublishers.resize(lidarNum);
+  odometryTimingPublishers.resize(lidarNum);
+  for (size_t i = 0; i < lidarNum; i++) {
+    std::ostringstream name;
+    name << "multiLidar: lidar " << i;
+    scanTimingPublishers[i].setup(node, privateNode, name.str() + " scanRegistration timing");
+    odometryTimingPublishers[i].setup(node, privateNode, name.str() + " laserOdometry timing");
+  }
+
+  //各雷达的线程启动之前设置好回调
+  using std::placeholders::_1;
+  frontEnd.setOdometryCallback(std::bind(&MultiLidarNode::publishOdometry, this, _1));
+  frontEnd.setFeatureCallback(std::bind(&MultiLidarNode::publishFeatures, this, _1));
+  frontEnd.setFrameCallback(std::bind(&MultiLidarNode::publishTimings, this, _1));
+  if (!frontEnd.configure(params)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < lidarNum; i++) {
+    boost::function<void(const sensor_msgs::PointCloud2ConstPtr&)> handler =
+        std::bind(&MultiLidarNode::laserCloudHandler, this, _1, i);
+    subLaserClouds.push_back(node.subscribe<sensor_msgs::PointCloud2>(lidarTopics[i], 2, handler));
+  }
+
+  subImu = node.subscribe<sensor_msgs::Imu> ("/imu/data", 50, &MultiLidarNode::imuHandler, this);
+
+  return true;
+}
+
+void MultiLidarNode::laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg, size_t lidar)
+{
+  //laserMapping只在有人订阅/velodyne_cloud_registered时才订阅全部点
+  frontEnd.setFullResOutput(pubLaserCloudFullRes.getNumSubscribers() > 0);
+
+  //在接收回调中转换，交给雷达的线程的点云之后只读
+  const ScanRegistration& scanRegistration = frontEnd.getScanRegistration(lidar);
+  std::shared_ptr<RawSweep> cloud(new RawSweep());
+  std::vector<int> indices;
+  rawSweepFromMsg(*laserCloudMsg, scanRegistration.getRingField(), scanRegistration.getTimeField(),
+                  *cloud, indices);
+  frontEnd.processCloud(lidar, cloud);
+}
+
+void MultiLidarNode::imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn)
+{
+  frontEnd.processImu(imuSampleFromMsg(*imuIn));
+}
+
+//在主雷达的线程中调用
+void MultiLidarNode::publishOdometry(const OdometryOutput& output)
+{
+  laserOdometryMsg.header.stamp = ros::Time().fromSec(output.time);
+  transformToPose(output.transformSum, laserOdometryMsg.pose.pose);
+  pubLaserOdometry.publish(laserOdometryMsg);
+
+  const geometry_msgs::Quaternion& geoQuat = laserOdometryMsg.pose.pose.orientation;
+  laserOdometryTrans.stamp_ = ros::Time().fromSec(output.time);
+  laserOdometryTrans.setRotation(tf::Quaternion(geoQuat.x, geoQuat.y, geoQuat.z, geoQuat.w));
+  laserOdometryTrans.setOrigin(tf::Vector3(output.transformSum[3], output.transformSum[4],
+                                           output.transformSum[5]));
+  tfBroadcaster->sendTransform(laserOdometryTrans);
+}
+
+//可能在任一雷达的线程中调用，调用之间互斥
+void MultiLidarNode::publishFeatures(const OdometryOutput& output)
+{
+  pubLaserCloudCornerLast.publish(output.cornerLast);
+  pubLaserCloudSurfLast.publish(output.surfLast);
+  if (output.fullRes) {
+    pubLaserCloudFullRes.publish(output.fullRes);
+  }
+
+  uint64_t unmergedFrames = frontEnd.getUnmergedFrames();
+  if (unmergedFrames > 0) {
+    ROS_WARN_THROTTLE(10.0, "multiLidar merged %lu frames without all lidars (%lu clouds dropped)",
+                      (unsigned long)unmergedFrames, (unsigned long)frontEnd.getDroppedClouds());
+  }
+}
+
+void MultiLidarNode::publishTimings(size_t lidar)
+{
+  scanTimingPublishers[lidar].update(frontEnd.getScanRegistrationTimers(lidar));
+  odometryTimingPublishers[lidar].update(frontEnd.getOdometryTimers(lidar));
+}
+
+} // end namespace loam
@@ -0,0 +1,125 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+/******************************读前须知*****************************************/
+/*四个模块的nodelet封装，运行在同一个nodelet manager中时，
+  模块之间以pcl::PointCloud的共享指针传递点云，省去了PointCloud2的序列化与反序列化以及拷贝
+*******************************************************************************/
+
+#include <boost/shared_ptr.hpp>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/ros.h>
+
+#include <loam_velodyne/LaserMappingNode.h>
+#include <loam_velodyne/LaserOdometryNode.h>
+#include <loam_velodyne/MultiLidarNode.h>
+#include <loam_velodyne/ScanRegistrationNode.h>
+#include <loam_velodyne/TransformMaintenanceNode.h>
+
+namespace loam {
+
+class ScanRegistrationNodelet : public nodelet::Nodelet {
+private:
+  virtual void onInit()
+  {
+    scanRegistration.reset(new ScanRegistrationNode());
+    if (!scanRegistration->setup(getNodeHandle(), getPrivateNodeHandle())) {
+      NODELET_ERROR("Failed to set up scanRegistration");
+    }
+  }
+
+  boost::shared_ptr<ScanRegistrationNode> scanRegistration;
+};
+
+class LaserOdometryNodelet : public nodelet::Nodelet {
+private:
+  virtual void onInit()
+  {
+    //输入按时间戳对齐后在最后一个到达的订阅回调中处理，回调在同一个单线程队列中执行，不需要加锁
+    laserOdometry.reset(new LaserOdometryNode());
+    if (!laserOdometry->setup(getNodeHandle(), getPrivateNodeHandle())) {
+      NODELET_ERROR("Failed to set up laserOdometry");
+    }
+  }
+
+  boost::shared_ptr<LaserOdometryNode> laserOdometry;
+};
+
+class LaserMappingNodelet : public nodelet::Nodelet {
+private:
+  virtual void onInit()
+  {
+    //同laserOdometry，异步建图时由laserMapping自己的建图线程处理
+    laserMapping.reset(new LaserMappingNode());
+    if (!laserMapping->setup(getNodeHandle(), getPrivateNodeHandle())) {
+      NODELET_ERROR("Failed to set up laserMapping");
+    }
+  }
+
+  boost::shared_ptr<LaserMappingNode> laserMapping;
+};
+
+class MultiLidarNodelet : public nodelet::Nodelet {
+private:
+  virtual void onInit()
+  {
+    //代替scanRegistration与laserOdometry，每个雷达在自己的线程中处理
+    multiLidar.reset(new MultiLidarNode());
+    if (!multiLidar->setup(getNodeHandle(), getPrivateNodeHandle())) {
+      NODELET_ERROR("Failed to set up multiLidar");
+    }
+  }
+
+  boost::shared_ptr<MultiLidarNode> multiLidar;
+};
+
+class TransformMaintenanceNodelet : public nodelet::Nodelet {
+private:
+  virtual void onInit()
+  {
+    transformMaintenance.reset(new TransformMaintenanceNode());
+    if (!transformMaintenance->setup(getNodeHandle(), getPrivateNodeHandle())) {
+      NODELET_ERROR("Failed to set up transformMaintenance");
+    }
+  }
+
+  boost::shared_ptr<TransformMaintenanceNode> transformMaintenance;
+};
+
+} // end namespace loam
+
+PLUGINLIB_EXPORT_CLASS(loam::ScanRegistrationNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(loam::LaserOdometryNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(loam::LaserMappingNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(loam::MultiLidarNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(loam::TransformMaintenanceNodelet, nodelet::Nodelet)
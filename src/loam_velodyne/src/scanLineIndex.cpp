@@ -0,0 +1,249 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <loam_velodyne/ScanLineIndex.h>
+
+namespace loam {
+
+//点绕camera坐标系y轴(竖直向上)的方位角
+static inline float azimuthOf(const PointType& point)
+{
+  return std::atan2(point.x, point.z);
+}
+
+static inline float squaredDistance(const PointType& a, const PointType& b)
+{
+  return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z);
+}
+
+ScanLineIndex::ScanLineIndex()
+  : scanStart(1, 0)
+{
+}
+
+void ScanLineIndex::setInputCloud(const pcl::PointCloud<PointType>::ConstPtr& input)
+{
+  cloud = input;
+  int pointNum = cloud->points.size();
+
+  //按线号计数排序
+  int scanNum = 0;
+  for (int i = 0; i < pointNum; i++) {
+    scanNum = std::max(scanNum, int(cloud->points[i].intensity) + 1);
+  }
+
+  scanStart.assign(scanNum + 1, 0);
+  for (int i = 0; i < pointNum; i++) {
+    int scanId = int(cloud->points[i].intensity);
+    if (scanId >= 0) {
+      scanStart[scanId + 1]++;
+    }
+  }
+  for (int i = 0; i < scanNum; i++) {
+    scanStart[i + 1] += scanStart[i];
+  }
+
+  std::vector<std::pair<float, int> > sorted(scanStart[scanNum]);
+  std::vector<int> writeInd(scanStart.begin(), scanStart.end() - 1);
+  for (int i = 0; i < pointNum; i++) {
+    int scanId = int(cloud->points[i].intensity);
+    if (scanId >= 0) {
+      sorted[writeInd[scanId]++] = std::make_pair(azimuthOf(cloud->points[i]), i);
+    }
+  }
+
+  //每条线内按方位角排序，同一方位角按点序
+  azimuths.resize(sorted.size());
+  pointIndices.resize(sorted.size());
+  for (int s = 0; s < scanNum; s++) {
+    std::sort(sorted.begin() + scanStart[s], sorted.begin() + scanStart[s + 1]);
+  }
+  for (size_t i = 0; i < sorted.size(); i++) {
+    azimuths[i] = sorted[i].first;
+    pointIndices[i] = sorted[i].second;
+  }
+}
+
+bool ScanLineIndex::nearestOnScan(int scanId, const PointType& point, float maxSqDis, int excludeInd,
+                                  int& pointInd, float& pointSqDis) const
+{
+  if (scanId < 0 || scanId >= getScanNum()) {
+    return false;
+  }
+
+  int start = scanStart[scanId];
+  int num = scanStart[scanId + 1] - start;
+  if (num == 0) {
+    return false;
+  }
+  const float* scanAzimuths = &azimuths[start];
+  const int* scanIndices = &pointIndices[start];
+
+  //线上的点都在方位角为a的竖直半平面内，与point的距离不小于rho * sin(min(|a - a0|, pi/2))
+  float azimuth = azimuthOf(point);
+  float rho = std::sqrt(point.x * point.x + point.z * point.z);
+  int pos = std::lower_bound(scanAzimuths, scanAzimuths + num, azimuth) - scanAzimuths;
+
+  bool found = false;
+  float minSqDis = maxSqDis;
+
+  //向方位角增大的方向找，越过-pi/pi时回绕，最多找半圈
+  for (int k = 0; k < num; k++) {
+    int j = pos + k;
+    float delta = (j < num ? scanAzimuths[j] : scanAzimuths[j - num] + 2 * M_PI) - azimuth;
+    if (j >= num) {
+      j -= num;
+    }
+    if (delta > M_PI) {
+      break;
+    }
+    float bound = delta < M_PI_2 ? rho * std::sin(delta) : rho;
+    if (bound * bound >= minSqDis) {
+      break;
+    }
+
+    int ind = scanIndices[j];
+    float sqDis = squaredDistance(cloud->points[ind], point);
+    if (ind != excludeInd && (sqDis < minSqDis || (sqDis == minSqDis && found && ind < pointInd))) {
+      minSqDis = sqDis;
+      pointInd = ind;
+      found = true;
+    }
+  }
+
+  //向方位角减小的方向找剩下的半圈
+  for (int k = 1; k < num; k++) {
+    int j = pos - k;
+    float delta = azimuth - (j >= 0 ? scanAzimuths[j] : scanAzimuths[j + num] - 2 * M_PI);
+    if (j < 0) {
+      j += num;
+    }
+    if (delta > M_PI) {
+      break;
+    }
+    float bound = delta < M_PI_2 ? rho * std::sin(delta) : rho;
+    if (bound * bound >= minSqDis) {
+      break;
+    }
+
+    int ind = scanIndices[j];
+    float sqDis = squaredDistance(cloud->points[ind], point);
+    if (ind != excludeInd && (sqDis < minSqDis || (sqDis == minSqDis && found && ind < pointInd))) {
+      minSqDis = sqDis;
+      pointInd = ind;
+      found = true;
+    }
+  }
+
+  if (found) {
+    pointSqDis = minSqDis;
+  }
+  return found;
+}
+
+bool ScanLineIndex::nearest(const PointType& point, float maxSqDis, int& pointInd, float& pointSqDis) const
+{
+  bool found = false;
+  float minSqDis = maxSqDis;
+  for (int s = 0; s < getScanNum(); s++) {
+    int ind;
+    float sqDis;
+    if (nearestOnScan(s, point, minSqDis, -1, ind, sqDis)) {
+      minSqDis = sqDis;
+      pointInd = ind;
+      found = true;
+    }
+  }
+
+  if (found) {
+    pointSqDis = minSqDis;
+  }
+  return found;
+}
+
+void ScanLineIndex::findLineCorrespondence(const PointType& point, float maxSqDis,
+                                           int& closestPointInd, int& minPointInd2) const
+{
+  closestPointInd = -1;
+  minPointInd2 = -1;
+
+  float pointSqDis;
+  if (!nearest(point, maxSqDis, closestPointInd, pointSqDis)) {
+    closestPointInd = -1;
+    return;
+  }
+
+  //与laserOdometry中的线性查找一致：只在线号相差1或2的线上找
+  int closestPointScan = int(cloud->points[closestPointInd].intensity);
+  float minPointSqDis2 = maxSqDis;
+  for (int s = closestPointScan - 2; s <= closestPointScan + 2; s++) {
+    int ind;
+    float sqDis;
+    if (s != closestPointScan && nearestOnScan(s, point, minPointSqDis2, -1, ind, sqDis)) {
+      minPointSqDis2 = sqDis;
+      minPointInd2 = ind;
+    }
+  }
+}
+
+void ScanLineIndex::findPlaneCorrespondence(const PointType& point, float maxSqDis,
+                                            int& closestPointInd, int& minPointInd2, int& minPointInd3) const
+{
+  closestPointInd = -1;
+  minPointInd2 = -1;
+  minPointInd3 = -1;
+
+  float pointSqDis;
+  if (!nearest(point, maxSqDis, closestPointInd, pointSqDis)) {
+    closestPointInd = -1;
+    return;
+  }
+
+  int closestPointScan = int(cloud->points[closestPointInd].intensity);
+  float sqDis;
+  nearestOnScan(closestPointScan, point, maxSqDis, closestPointInd, minPointInd2, sqDis);
+
+  float minPointSqDis3 = maxSqDis;
+  for (int s = closestPointScan - 2; s <= closestPointScan + 2; s++) {
+    int ind;
+    if (s != closestPointScan && nearestOnScan(s, point, minPointSqDis3, -1, ind, sqDis)) {
+      minPointSqDis3 = sqDis;
+      minPointInd3 = ind;
+    }
+  }
+}
+
+} // end namespace loam
@@ -40,23 +40,18 @@
   交换后：R = Ry(yaw)*Rx(pitch)*Rz(roll)
 *******************************************************************************/
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
-#include <loam_velodyne/common.h>
+#include <loam_velodyne/ScanRegistration.h>
+#include <loam_velodyne/imu_integration.h>
+#include <loam_velodyne/logging.h>
+#include <loam_velodyne/scan_kernels.h>
 #include <opencv/cv.h>
-#include <nav_msgs/Odometry.h>
-#include <opencv/cv.h>
-#include <pcl_conversions/pcl_conversions.h>
-#include <pcl/point_cloud.h>
-#include <pcl/point_types.h>
 #include <pcl/filters/voxel_grid.h>
-#include <pcl/kdtree/kdtree_flann.h>
-#include <ros/ros.h>
-#include <sensor_msgs/Imu.h>
-#include <sensor_msgs/PointCloud2.h>
-#include <tf/transform_datatypes.h>
-#include <tf/transform_broadcaster.h>
+
+namespace loam {
 
 using std::sin;
 using std::cos;
@@ -65,72 +60,57 @@ using std::atan2;
 //扫描周期, velodyne频率10Hz，周期0.1s
 const double scanPeriod = 0.1;
 
-//初始化控制变量
-const int systemDelay = 20;//弃用前20帧初始数据
-int systemInitCount = 0;
-bool systemInited = false;
-
-//激光雷达线数
-const int N_SCANS = 16;
-
-//点云曲率, 40000为一帧点云中点的最大数量
-float cloudCurvature[40000];
-//曲率点对应的序号
-int cloudSortInd[40000];
-//点是否筛选过标志：0-未筛选过，1-筛选过
-int cloudNeighborPicked[40000];
-//点分类标号:2-代表曲率很大，1-代表曲率比较大,-1-代表曲率很小，0-曲率比较小(其中1包含了2,0包含了1,0和1构成了点云全部的点)
-int cloudLabel[40000];
-
-//imu时间戳大于当前点云时间戳的位置
-int imuPointerFront = 0;
-//imu最新收到的点在数组中的位置
-int imuPointerLast = -1;
-//imu循环队列长度
-const int imuQueLength = 200;
-
-//点云数据开始第一个点的位移/速度/欧拉角
-float imuRollStart = 0, imuPitchStart = 0, imuYawStart = 0;
-float imuRollCur = 0, imuPitchCur = 0, imuYawCur = 0;
-
-float imuVeloXStart = 0, imuVeloYStart = 0, imuVeloZStart = 0;
-float imuShiftXStart = 0, imuShiftYStart = 0, imuShiftZStart = 0;
-
-//当前点的速度，位移信息
-float imuVeloXCur = 0, imuVeloYCur = 0, imuVeloZCur = 0;
-float imuShiftXCur = 0, imuShiftYCur = 0, imuShiftZCur = 0;
-
-//每次点云数据当前点相对于开始第一个点的畸变位移，速度
-float imuShiftFromStartXCur = 0, imuShiftFromStartYCur = 0, imuShiftFromStartZCur = 0;
-float imuVeloFromStartXCur = 0, imuVeloFromStartYCur = 0, imuVeloFromStartZCur = 0;
-
-//IMU信息
-double imuTime[imuQueLength] = {0};
-float imuRoll[imuQueLength] = {0};
-float imuPitch[imuQueLength] = {0};
-float imuYaw[imuQueLength] = {0};
-
-float imuAccX[imuQueLength] = {0};
-float imuAccY[imuQueLength] = {0};
-float imuAccZ[imuQueLength] = {0};
-
-float imuVeloX[imuQueLength] = {0};
-float imuVeloY[imuQueLength] = {0};
-float imuVeloZ[imuQueLength] = {0};
-
-float imuShiftX[imuQueLength] = {0};
-float imuShiftY[imuQueLength] = {0};
-float imuShiftZ[imuQueLength] = {0};
-
-ros::Publisher pubLaserCloud;
-ros::Publisher pubCornerPointsSharp;
-ros::Publisher pubCornerPointsLessSharp;
-ros::Publisher pubSurfPointsFlat;
-ros::Publisher pubSurfPointsLessFlat;
-ros::Publisher pubImuTrans;
+//弃用前20帧初始数据
+const int systemDelay = 20;
+
+const int ScanRegistration::imuQueLength;
+
+ScanRegistration::ScanRegistration()
+  : systemInitCount(0),
+    systemInited(false),
+    surfPointsLessFlatScan(new pcl::PointCloud<PointType>()),
+    laserCloudPool(4),
+    featureCloudPool(16),
+    imuTransPool(4, 4),
+    imuPointerFront(0),
+    imuBuffer(imuQueLength),
+    stageTimers({"ring split", "curvature", "feature selection", "downsample", "output"})
+{
+  downSizeFilter.setLeafSize(0.2, 0.2, 0.2);
+}
+
+bool ScanRegistration::configure(const ScanRegistrationParams& params)
+{
+  if (!sensorModel.setModel(params.sensorModel)) {
+    LOAM_ERROR("Invalid sensorModel parameter: %s (expected VLP-16, HDL-32, HDL-64, OS1-64 or OS1-128)",
+               params.sensorModel.c_str());
+    return false;
+  }
+
+  if (!params.ringElevations.empty() && !sensorModel.setElevations(params.ringElevations)) {
+    LOAM_ERROR("Invalid ringElevations parameter (expected at least 2 distinct angles in (-90, 90))");
+    return false;
+  }
+
+  useRingField = params.useRingField;
+  useTimeField = params.useTimeField;
+  indexRelativeTime = params.indexRelativeTime;
+
+  //按雷达一帧点数的上限预先分配缓存
+  int maxPointsPerSweep = sensorModel.maxPointsPerSweep();
+  reserveCloudBuffers(maxPointsPerSweep);
+  sweepPoints.reserve(maxPointsPerSweep);
+  sweepScanIds.reserve(maxPointsPerSweep);
+  if (indexRelativeTime) {
+    cloudScanIds.reserve(maxPointsPerSweep);
+  }
+  laserCloudPool.setReservePoints(maxPointsPerSweep);
+
+  return true;
+}
 
 //计算局部坐标系下点云中的点相对第一个开始点的由于加减速运动产生的位移畸变
-void ShiftToStartIMU(float pointTime)
+void ScanRegistration::ShiftToStartIMU(float pointTime)
 {
   //计算相对于第一个点由于加减速产生的畸变位移(全局坐标系下畸变位移量delta_Tg)
   //imuShiftFromStartCur = imuShiftCur - (imuShiftStart + imuVeloStart * pointTime)
@@ -160,7 +140,7 @@ void ShiftToStartIMU(float pointTime)
 }
 
 //计算局部坐标系下点云中的点相对第一个开始点由于加减速产生的的速度畸变（增量）
-void VeloToStartIMU()
+void ScanRegistration::VeloToStartIMU()
 {
   //计算相对于第一个点由于加减速产生的畸变速度(全局坐标系下畸变速度增量delta_Vg)
   imuVeloFromStartXCur = imuVeloXCur - imuVeloXStart;
@@ -189,7 +169,7 @@ void VeloToStartIMU()
 }
 
 //去除点云加减速产生的位移畸变
-void TransformToStartIMU(PointType *p)
+void ScanRegistration::TransformToStartIMU(PointType *p)
 {
   /********************************************************************************
     Ry*Rx*Rz*Pl, transform point to the global frame
@@ -231,74 +211,129 @@ void TransformToStartIMU(PointType *p)
 }
 
 //积分速度与位移
-void AccumulateIMUShift()
+void ScanRegistration::AccumulateIMUShift(ImuState& imu)
 {
-  float roll = imuRoll[imuPointerLast];
-  float pitch = imuPitch[imuPointerLast];
-  float yaw = imuYaw[imuPointerLast];
-  float accX = imuAccX[imuPointerLast];
-  float accY = imuAccY[imuPointerLast];
-  float accZ = imuAccZ[imuPointerLast];
-
-  //将当前时刻的加速度值绕交换过的ZXY固定轴（原XYZ）分别旋转(roll, pitch, yaw)角，转换得到世界坐标系下的加速度值(right hand rule)
-  //绕z轴旋转(roll)
-  float x1 = cos(roll) * accX - sin(roll) * accY;
-  float y1 = sin(roll) * accX + cos(roll) * accY;
-  float z1 = accZ;
-  //绕x轴旋转(pitch)
-  float x2 = x1;
-  float y2 = cos(pitch) * y1 - sin(pitch) * z1;
-  float z2 = sin(pitch) * y1 + cos(pitch) * z1;
-  //绕y轴旋转(yaw)
-  accX = cos(yaw) * x2 + sin(yaw) * z2;
-  accY = y2;
-  accZ = -sin(yaw) * x2 + cos(yaw) * z2;
-
-  //上一个imu点
-  int imuPointerBack = (imuPointerLast + imuQueLength - 1) % imuQueLength;
+  float roll = imu.roll;
+  float pitch = imu.pitch;
+  float yaw = imu.yaw;
+  float accX = imu.accX;
+  float accY = imu.accY;
+  float accZ = imu.accZ;
+
+  //将当前时刻的加速度值旋转到世界坐标系下
+  rotateImuToWorld(roll, pitch, yaw, accX, accY, accZ);
+
+  //上一个imu点，第一个点之前视为静止
+  ImuState back;
+  if (!imuBuffer.latest(back)) {
+    return;
+  }
   //上一个点到当前点所经历的时间，即计算imu测量周期
-  double timeDiff = imuTime[imuPointerLast] - imuTime[imuPointerBack];
+  double timeDiff = imu.time - back.time;
   //要求imu的频率至少比lidar高，这样的imu信息才使用，后面校正也才有意义
   if (timeDiff < scanPeriod) {//（隐含从静止开始运动）
     //求每个imu时间点的位移与速度,两点之间视为匀加速直线运动
-    imuShiftX[imuPointerLast] = imuShiftX[imuPointerBack] + imuVeloX[imuPointerBack] * timeDiff 
-                              + accX * timeDiff * timeDiff / 2;
-    imuShiftY[imuPointerLast] = imuShiftY[imuPointerBack] + imuVeloY[imuPointerBack] * timeDiff 
-                              + accY * timeDiff * timeDiff / 2;
-    imuShiftZ[imuPointerLast] = imuShiftZ[imuPointerBack] + imuVeloZ[imuPointerBack] * timeDiff 
-                              + accZ * timeDiff * timeDiff / 2;
-
-    imuVeloX[imuPointerLast] = imuVeloX[imuPointerBack] + accX * timeDiff;
-    imuVeloY[imuPointerLast] = imuVeloY[imuPointerBack] + accY * timeDiff;
-    imuVeloZ[imuPointerLast] = imuVeloZ[imuPointerBack] + accZ * timeDiff;
+    accumulateImuShift(back.shiftX, back.veloX, accX, timeDiff, imu.shiftX, imu.veloX);
+    accumulateImuShift(back.shiftY, back.veloY, accY, timeDiff, imu.shiftY, imu.veloY);
+    accumulateImuShift(back.shiftZ, back.veloZ, accZ, timeDiff, imu.shiftZ, imu.veloZ);
+  }
+}
+
+//点云缓存不够大时扩容，只增不减
+void ScanRegistration::reserveCloudBuffers(size_t size)
+{
+  if (cloudCurvature.size() >= size) {
+    return;
   }
+
+  cloudCurvature.resize(size);
+  cloudSortInd.resize(size);
+  cloudX.resize(size);
+  cloudY.resize(size);
+  cloudZ.resize(size);
+  cloudRangeSq.resize(size);
+  cloudRange.resize(size);
+  cloudGapSq.resize(size);
+  cloudNeighborPicked.resize(size);
+  cloudLabel.resize(size);
+}
+
+//根据点的旋转角计算点在一个扫描周期中的相对时间，halfPassed记录扫描线是否旋转过半
+float ScanRegistration::relativeTimeOf(const PointType& point, float startOri, float endOri, bool& halfPassed)
+{
+  //该点的旋转角
+  float ori = -atan2(point.x, point.z);
+  if (!halfPassed) {//根据扫描线是否旋转过半选择与起始位置还是终止位置进行差值计算，从而进行补偿
+      //确保-pi/2 < ori - startOri < 3*pi/2
+    if (ori < startOri - M_PI / 2) {
+      ori += 2 * M_PI;
+    } else if (ori > startOri + M_PI * 3 / 2) {
+      ori -= 2 * M_PI;
+    }
+
+    if (ori - startOri > M_PI) {
+      halfPassed = true;
+    }
+  } else {
+    ori += 2 * M_PI;
+
+    //确保-3*pi/2 < ori - endOri < pi/2
+    if (ori < endOri - M_PI * 3 / 2) {
+      ori += 2 * M_PI;
+    } else if (ori > endOri + M_PI / 2) {
+      ori -= 2 * M_PI;
+    } 
+  }
+
+  return (ori - startOri) / (endOri - startOri);
 }
 
 //接收点云数据，velodyne雷达坐标系安装为x轴向前，y轴向左，z轴向上的右手坐标系
-void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
+bool ScanRegistration::process(const RawSweep& laserCloudIn, FeatureSweep& sweep)
 {
+  bool processed = processSweep(laserCloudIn, sweep);
+
+  stageTimers.finishFrame();
+  return processed;
+}
+
+bool ScanRegistration::processSweep(const RawSweep& laserCloudIn, FeatureSweep& sweep)
+{
+  //全是空点的帧没有起止方位角，不处理
+  if (laserCloudIn.points.empty()) {
+    return false;
+  }
+
   if (!systemInited) {//丢弃前20个点云数据
     systemInitCount++;
     if (systemInitCount >= systemDelay) {
       systemInited = true;
     }
-    return;
+    return false;
   }
 
+  //按线号整理点云，直到写入整帧点云
+  ScopedTimer timer(stageTimers, STAGE_RING_SPLIT);
+
+  //激光线数
+  const int N_SCANS = sensorModel.numRings();
   //记录每个scan有曲率的点的开始和结束索引
-  std::vector<int> scanStartInd(N_SCANS, 0);
-  std::vector<int> scanEndInd(N_SCANS, 0);
+  scanStartInd.assign(N_SCANS, 0);
+  scanEndInd.assign(N_SCANS, 0);
   
   //当前点云时间
-  double timeScanCur = laserCloudMsg->header.stamp.toSec();
-  pcl::PointCloud<pcl::PointXYZ> laserCloudIn;
-  //消息转换成pcl数据存放
-  pcl::fromROSMsg(*laserCloudMsg, laserCloudIn);
-  std::vector<int> indices;
-  //移除空点
-  pcl::removeNaNFromPointCloud(laserCloudIn, laserCloudIn, indices);
-  //点云点的数量
+  double timeScanCur = laserCloudIn.time;
+  //点云点的数量，以下的缓存都是成员变量，每帧清空复用，不重新分配内存
   int cloudSize = laserCloudIn.points.size();
+  reserveCloudBuffers(cloudSize);
+
+  //驱动提供的逐点线号与时间
+  const bool hasRings = useRingField && !laserCloudIn.rings.empty();
+  const bool hasTimes = useTimeField && !laserCloudIn.times.empty();
+  double timeStart = 0;
+  if (hasTimes && cloudSize > 0) {
+    timeStart = laserCloudIn.times[0] * sensorModel.getTimeScale();
+  }
   //lidar scan开始点的旋转角,atan2范围[-pi,+pi],计算旋转角时取负号是因为velodyne是顺时针旋转
   float startOri = -atan2(laserCloudIn.points[0].y, laserCloudIn.points[0].x);
   //lidar scan结束点的旋转角，加2*pi使点云旋转周期为2*pi
@@ -314,111 +349,85 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
   }
   //lidar扫描线是否旋转过半
   bool halfPassed = false;
+
+  //按点序估计相对时间时先确定所有点的线号，统计每条线的点数
+  const bool relTimeFromIndex = !hasTimes && indexRelativeTime;
+  if (relTimeFromIndex) {
+    cloudScanIds.resize(cloudSize);
+    ringPointNum.assign(N_SCANS, 0);
+    ringPointInd.assign(N_SCANS, 0);
+    for (int i = 0; i < cloudSize; i++) {
+      int scanID;
+      if (hasRings) {
+        scanID = sensorModel.scanIdOfRing(laserCloudIn.rings[i]);
+      } else {
+        //与下面的坐标轴交换相同
+        const pcl::PointXYZ& inPoint = laserCloudIn.points[i];
+        scanID = sensorModel.scanIdOf(inPoint.y, inPoint.z, inPoint.x);
+      }
+      cloudScanIds[i] = scanID;
+      if (scanID >= 0) {
+        ringPointNum[scanID]++;
+      }
+    }
+  }
   int count = cloudSize;
   PointType point;
-  std::vector<pcl::PointCloud<PointType> > laserCloudScans(N_SCANS);
+  //矫正后的点及其线号按原始顺序暂存，之后按线号直接写入整帧点云中对应的位置
+  sweepPoints.clear();
+  sweepScanIds.clear();
+  scanPointNum.assign(N_SCANS, 0);
   for (int i = 0; i < cloudSize; i++) {
     //坐标轴交换，velodyne lidar的坐标系也转换到z轴向前，x轴向左的右手坐标系
     point.x = laserCloudIn.points[i].y;
     point.y = laserCloudIn.points[i].z;
     point.z = laserCloudIn.points[i].x;
 
-    //计算点的仰角(根据lidar文档垂直角计算公式),根据仰角排列激光线号，velodyne每两个scan之间间隔2度
-    float angle = atan(point.y / sqrt(point.x * point.x + point.z * point.z)) * 180 / M_PI;
+    //有ring字段时直接由驱动的线号得到scanID，否则根据仰角查表，超出视场的点滤除
     int scanID;
-    //仰角四舍五入(加减0.5截断效果等于四舍五入)
-    int roundedAngle = int(angle + (angle<0.0?-0.5:+0.5)); 
-    if (roundedAngle > 0){
-      scanID = roundedAngle;
-    }
-    else {
-      scanID = roundedAngle + (N_SCANS - 1);
+    if (relTimeFromIndex) {
+      scanID = cloudScanIds[i];
+    } else if (hasRings) {
+      scanID = sensorModel.scanIdOfRing(laserCloudIn.rings[i]);
+    } else {
+      scanID = sensorModel.scanIdOf(point.x, point.y, point.z);
     }
-    //过滤点，只挑选[-15度，+15度]范围内的点,scanID属于[0,15]
-    if (scanID > (N_SCANS - 1) || scanID < 0 ){
+    if (scanID < 0) {
       count--;
       continue;
     }
 
-    //该点的旋转角
-    float ori = -atan2(point.x, point.z);
-    if (!halfPassed) {//根据扫描线是否旋转过半选择与起始位置还是终止位置进行差值计算，从而进行补偿
-        //确保-pi/2 < ori - startOri < 3*pi/2
-      if (ori < startOri - M_PI / 2) {
-        ori += 2 * M_PI;
-      } else if (ori > startOri + M_PI * 3 / 2) {
-        ori -= 2 * M_PI;
-      }
-
-      if (ori - startOri > M_PI) {
-        halfPassed = true;
-      }
+    //-0.5 < relTime < 1.5（点旋转的角度与整个周期旋转角度的比率, 即点云中点的相对时间）
+    float relTime;
+    if (hasTimes) {
+      //驱动给出的点时间相对第一个点的时间
+      relTime = (laserCloudIn.times[i] * sensorModel.getTimeScale()
+                 - timeStart) / scanPeriod;
+    } else if (relTimeFromIndex) {
+      //匀速旋转时点在线内的位置与扫过的角度成正比
+      relTime = float(ringPointInd[scanID]++) / ringPointNum[scanID];
     } else {
-      ori += 2 * M_PI;
-
-      //确保-3*pi/2 < ori - endOri < pi/2
-      if (ori < endOri - M_PI * 3 / 2) {
-        ori += 2 * M_PI;
-      } else if (ori > endOri + M_PI / 2) {
-        ori -= 2 * M_PI;
-      } 
+      relTime = relativeTimeOf(point, startOri, endOri, halfPassed);
     }
-
-    //-0.5 < relTime < 1.5（点旋转的角度与整个周期旋转角度的比率, 即点云中点的相对时间）
-    float relTime = (ori - startOri) / (endOri - startOri);
     //点强度=线号+点相对时间（即一个整数+一个小数，整数部分是线号，小数部分是该点的相对时间）,匀速扫描：根据当前扫描的角度和扫描周期计算相对扫描起始位置的时间
     point.intensity = scanID + scanPeriod * relTime;
 
     //点时间=点云时间+周期时间
-    if (imuPointerLast >= 0) {//如果收到IMU数据,使用IMU矫正点云畸变
-      float pointTime = relTime * scanPeriod;//计算点的周期时间
-      //寻找是否有点云的时间戳小于IMU的时间戳的IMU位置:imuPointerFront
-      while (imuPointerFront != imuPointerLast) {
-        if (timeScanCur + pointTime < imuTime[imuPointerFront]) {
-          break;
-        }
-        imuPointerFront = (imuPointerFront + 1) % imuQueLength;
-      }
-
-      if (timeScanCur + pointTime > imuTime[imuPointerFront]) {//没找到,此时imuPointerFront==imtPointerLast,只能以当前收到的最新的IMU的速度，位移，欧拉角作为当前点的速度，位移，欧拉角使用
-        imuRollCur = imuRoll[imuPointerFront];
-        imuPitchCur = imuPitch[imuPointerFront];
-        imuYawCur = imuYaw[imuPointerFront];
-
-        imuVeloXCur = imuVeloX[imuPointerFront];
-        imuVeloYCur = imuVeloY[imuPointerFront];
-        imuVeloZCur = imuVeloZ[imuPointerFront];
-
-        imuShiftXCur = imuShiftX[imuPointerFront];
-        imuShiftYCur = imuShiftY[imuPointerFront];
-        imuShiftZCur = imuShiftZ[imuPointerFront];
-      } else {//找到了点云时间戳小于IMU时间戳的IMU位置,则该点必处于imuPointerBack和imuPointerFront之间，据此线性插值，计算点云点的速度，位移和欧拉角
-        int imuPointerBack = (imuPointerFront + imuQueLength - 1) % imuQueLength;
-        //按时间距离计算权重分配比率,也即线性插值
-        float ratioFront = (timeScanCur + pointTime - imuTime[imuPointerBack]) 
-                         / (imuTime[imuPointerFront] - imuTime[imuPointerBack]);
-        float ratioBack = (imuTime[imuPointerFront] - timeScanCur - pointTime) 
-                        / (imuTime[imuPointerFront] - imuTime[imuPointerBack]);
-
-        imuRollCur = imuRoll[imuPointerFront] * ratioFront + imuRoll[imuPointerBack] * ratioBack;
-        imuPitchCur = imuPitch[imuPointerFront] * ratioFront + imuPitch[imuPointerBack] * ratioBack;
-        if (imuYaw[imuPointerFront] - imuYaw[imuPointerBack] > M_PI) {
-          imuYawCur = imuYaw[imuPointerFront] * ratioFront + (imuYaw[imuPointerBack] + 2 * M_PI) * ratioBack;
-        } else if (imuYaw[imuPointerFront] - imuYaw[imuPointerBack] < -M_PI) {
-          imuYawCur = imuYaw[imuPointerFront] * ratioFront + (imuYaw[imuPointerBack] - 2 * M_PI) * ratioBack;
-        } else {
-          imuYawCur = imuYaw[imuPointerFront] * ratioFront + imuYaw[imuPointerBack] * ratioBack;
-        }
-
-        //本质:imuVeloXCur = imuVeloX[imuPointerback] + (imuVelX[imuPointerFront]-imuVelX[imuPoniterBack])*ratioFront
-        imuVeloXCur = imuVeloX[imuPointerFront] * ratioFront + imuVeloX[imuPointerBack] * ratioBack;
-        imuVeloYCur = imuVeloY[imuPointerFront] * ratioFront + imuVeloY[imuPointerBack] * ratioBack;
-        imuVeloZCur = imuVeloZ[imuPointerFront] * ratioFront + imuVeloZ[imuPointerBack] * ratioBack;
-
-        imuShiftXCur = imuShiftX[imuPointerFront] * ratioFront + imuShiftX[imuPointerBack] * ratioBack;
-        imuShiftYCur = imuShiftY[imuPointerFront] * ratioFront + imuShiftY[imuPointerBack] * ratioBack;
-        imuShiftZCur = imuShiftZ[imuPointerFront] * ratioFront + imuShiftZ[imuPointerBack] * ratioBack;
-      }
+    float pointTime = relTime * scanPeriod;//计算点的周期时间
+    //点时刻的IMU测量：晚于所有测量时为最新的测量，否则在前后两个测量之间按时间线性插值
+    ImuState imuCur;
+    if (imuBuffer.interpolate(timeScanCur + pointTime, imuPointerFront, imuCur)) {//如果收到IMU数据,使用IMU矫正点云畸变
+      imuRollCur = imuCur.roll;
+      imuPitchCur = imuCur.pitch;
+      imuYawCur = imuCur.yaw;
+
+      imuVeloXCur = imuCur.veloX;
+      imuVeloYCur = imuCur.veloY;
+      imuVeloZCur = imuCur.veloZ;
+
+      imuShiftXCur = imuCur.shiftX;
+      imuShiftYCur = imuCur.shiftY;
+      imuShiftZCur = imuCur.shiftZ;
 
       if (i == 0) {//如果是第一个点,记住点云起始位置的速度，位移，欧拉角
         imuRollStart = imuRollCur;
@@ -438,38 +447,42 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
         TransformToStartIMU(&point);
       }
     }
-    laserCloudScans[scanID].push_back(point);//将每个补偿矫正的点放入对应线号的容器
+    //记录每个补偿矫正的点及其线号
+    sweepPoints.push_back(point);
+    sweepScanIds.push_back(scanID);
+    scanPointNum[scanID]++;
   }
 
   //获得有效范围内的点的数量
   cloudSize = count;
 
-  pcl::PointCloud<PointType>::Ptr laserCloud(new pcl::PointCloud<PointType>());
-  for (int i = 0; i < N_SCANS; i++) {//将所有的点按照线号从小到大放入一个容器
-    *laserCloud += laserCloudScans[i];
+  //将所有的点按照线号从小到大放入一个容器：先由每条线的点数计算每条线的起始位置，再依次写入
+  pcl::PointCloud<PointType>::Ptr laserCloud = laserCloudPool.acquire();
+  laserCloud->resize(cloudSize);
+  scanWriteInd.resize(N_SCANS);
+  int scanOffset = 0;
+  for (int i = 0; i < N_SCANS; i++) {
+    scanWriteInd[i] = scanOffset;
+    scanOffset += scanPointNum[i];
+  }
+  for (int i = 0; i < cloudSize; i++) {
+    laserCloud->points[scanWriteInd[sweepScanIds[i]]++] = sweepPoints.points[i];
   }
+  timer.next(STAGE_CURVATURE);
+  //按x, y, z分开存放一份点云(SoA)，曲率与相邻点距离在其上批量计算
+  for (int i = 0; i < cloudSize; i++) {
+    cloudX[i] = laserCloud->points[i].x;
+    cloudY[i] = laserCloud->points[i].y;
+    cloudZ[i] = laserCloud->points[i].z;
+  }
+  //使用每个点的前后五个点计算曲率，因此前五个与最后五个点跳过
+  computeCurvature(cloudX.data(), cloudY.data(), cloudZ.data(), 5, cloudSize - 5, cloudCurvature.data());
+  //点的深度以及与后一个点的距离
+  computeRangeAndGap(cloudX.data(), cloudY.data(), cloudZ.data(), cloudSize,
+                     cloudRangeSq.data(), cloudRange.data(), cloudGapSq.data());
+
   int scanCount = -1;
-  for (int i = 5; i < cloudSize - 5; i++) {//使用每个点的前后五个点计算曲率，因此前五个与最后五个点跳过
-    float diffX = laserCloud->points[i - 5].x + laserCloud->points[i - 4].x 
-                + laserCloud->points[i - 3].x + laserCloud->points[i - 2].x 
-                + laserCloud->points[i - 1].x - 10 * laserCloud->points[i].x 
-                + laserCloud->points[i + 1].x + laserCloud->points[i + 2].x
-                + laserCloud->points[i + 3].x + laserCloud->points[i + 4].x
-                + laserCloud->points[i + 5].x;
-    float diffY = laserCloud->points[i - 5].y + laserCloud->points[i - 4].y 
-                + laserCloud->points[i - 3].y + laserCloud->points[i - 2].y 
-                + laserCloud->points[i - 1].y - 10 * laserCloud->points[i].y 
-                + laserCloud->points[i + 1].y + laserCloud->points[i + 2].y
-                + laserCloud->points[i + 3].y + laserCloud->points[i + 4].y
-                + laserCloud->points[i + 5].y;
-    float diffZ = laserCloud->points[i - 5].z + laserCloud->points[i - 4].z 
-                + laserCloud->points[i - 3].z + laserCloud->points[i - 2].z 
-                + laserCloud->points[i - 1].z - 10 * laserCloud->points[i].z 
-                + laserCloud->points[i + 1].z + laserCloud->points[i + 2].z
-                + laserCloud->points[i + 3].z + laserCloud->points[i + 4].z
-                + laserCloud->points[i + 5].z;
-    //曲率计算
-    cloudCurvature[i] = diffX * diffX + diffY * diffY + diffZ * diffZ;
+  for (int i = 5; i < cloudSize - 5; i++) {
     //记录曲率点的索引
     cloudSortInd[i] = i;
     //初始时，点全未筛选过
@@ -494,29 +507,22 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
 
   //挑选点，排除容易被斜面挡住的点以及离群点，有些点容易被斜面挡住，而离群点可能出现带有偶然性，这些情况都可能导致前后两次扫描不能被同时看到
   for (int i = 5; i < cloudSize - 6; i++) {//与后一个点差值，所以减6
-    float diffX = laserCloud->points[i + 1].x - laserCloud->points[i].x;
-    float diffY = laserCloud->points[i + 1].y - laserCloud->points[i].y;
-    float diffZ = laserCloud->points[i + 1].z - laserCloud->points[i].z;
     //计算有效曲率点与后一个点之间的距离平方和
-    float diff = diffX * diffX + diffY * diffY + diffZ * diffZ;
+    float diff = cloudGapSq[i];
 
     if (diff > 0.1) {//前提:两个点之间距离要大于0.1
 
-        //点的深度
-      float depth1 = sqrt(laserCloud->points[i].x * laserCloud->points[i].x + 
-                     laserCloud->points[i].y * laserCloud->points[i].y +
-                     laserCloud->points[i].z * laserCloud->points[i].z);
+      //点的深度
+      float depth1 = cloudRange[i];
 
       //后一个点的深度
-      float depth2 = sqrt(laserCloud->points[i + 1].x * laserCloud->points[i + 1].x + 
-                     laserCloud->points[i + 1].y * laserCloud->points[i + 1].y +
-                     laserCloud->points[i + 1].z * laserCloud->points[i + 1].z);
+      float depth2 = cloudRange[i + 1];
 
       //按照两点的深度的比例，将深度较大的点拉回后计算距离
       if (depth1 > depth2) {
-        diffX = laserCloud->points[i + 1].x - laserCloud->points[i].x * depth2 / depth1;
-        diffY = laserCloud->points[i + 1].y - laserCloud->points[i].y * depth2 / depth1;
-        diffZ = laserCloud->points[i + 1].z - laserCloud->points[i].z * depth2 / depth1;
+        float diffX = cloudX[i + 1] - cloudX[i] * depth2 / depth1;
+        float diffY = cloudY[i + 1] - cloudY[i] * depth2 / depth1;
+        float diffZ = cloudZ[i + 1] - cloudZ[i] * depth2 / depth1;
 
         //边长比也即是弧度值，若小于0.1，说明夹角比较小，斜面比较陡峭,点深度变化比较剧烈,点处在近似与激光束平行的斜面上
         if (sqrt(diffX * diffX + diffY * diffY + diffZ * diffZ) / depth2 < 0.1) {//排除容易被斜面挡住的点
@@ -529,9 +535,9 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
           cloudNeighborPicked[i] = 1;
         }
       } else {
-        diffX = laserCloud->points[i + 1].x * depth1 / depth2 - laserCloud->points[i].x;
-        diffY = laserCloud->points[i + 1].y * depth1 / depth2 - laserCloud->points[i].y;
-        diffZ = laserCloud->points[i + 1].z * depth1 / depth2 - laserCloud->points[i].z;
+        float diffX = cloudX[i + 1] * depth1 / depth2 - cloudX[i];
+        float diffY = cloudY[i + 1] * depth1 / depth2 - cloudY[i];
+        float diffZ = cloudZ[i + 1] * depth1 / depth2 - cloudZ[i];
 
         if (sqrt(diffX * diffX + diffY * diffY + diffZ * diffZ) / depth1 < 0.1) {
           cloudNeighborPicked[i + 1] = 1;
@@ -544,16 +550,11 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
       }
     }
 
-    float diffX2 = laserCloud->points[i].x - laserCloud->points[i - 1].x;
-    float diffY2 = laserCloud->points[i].y - laserCloud->points[i - 1].y;
-    float diffZ2 = laserCloud->points[i].z - laserCloud->points[i - 1].z;
     //与前一个点的距离平方和
-    float diff2 = diffX2 * diffX2 + diffY2 * diffY2 + diffZ2 * diffZ2;
+    float diff2 = cloudGapSq[i - 1];
 
     //点深度的平方和
-    float dis = laserCloud->points[i].x * laserCloud->points[i].x
-              + laserCloud->points[i].y * laserCloud->points[i].y
-              + laserCloud->points[i].z * laserCloud->points[i].z;
+    float dis = cloudRangeSq[i];
 
     //与前后点的平方和都大于深度平方和的万分之二，这些点视为离群点，包括陡斜面上的点，强烈凸凹点和空旷区域中的某些点，置为筛选过，弃用
     if (diff > 0.0002 * dis && diff2 > 0.0002 * dis) {
@@ -562,14 +563,15 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
   }
 
 
-  pcl::PointCloud<PointType> cornerPointsSharp;
-  pcl::PointCloud<PointType> cornerPointsLessSharp;
-  pcl::PointCloud<PointType> surfPointsFlat;
-  pcl::PointCloud<PointType> surfPointsLessFlat;
+  timer.next(STAGE_SELECTION);
+  pcl::PointCloud<PointType>::Ptr cornerPointsSharp = featureCloudPool.acquire();
+  pcl::PointCloud<PointType>::Ptr cornerPointsLessSharp = featureCloudPool.acquire();
+  pcl::PointCloud<PointType>::Ptr surfPointsFlat = featureCloudPool.acquire();
+  pcl::PointCloud<PointType>::Ptr surfPointsLessFlat = featureCloudPool.acquire();
 
   //将每条线上的点分入相应的类别：边沿点和平面点
   for (int i = 0; i < N_SCANS; i++) {
-    pcl::PointCloud<PointType>::Ptr surfPointsLessFlatScan(new pcl::PointCloud<PointType>);
+    surfPointsLessFlatScan->clear();
     //将每个scan的曲率点分成6等份处理,确保周围都有点被选作特征点
     for (int j = 0; j < 6; j++) {
         //六等份起点：sp = scanStartInd + (scanEndInd - scanStartInd)*j/6
@@ -577,116 +579,22 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
       //六等份终点：ep = scanStartInd - 1 + (scanEndInd - scanStartInd)*(j+1)/6
       int ep = (scanStartInd[i] * (5 - j)  + scanEndInd[i] * (j + 1)) / 6 - 1;
 
-      //按曲率从小到大冒泡排序
-      for (int k = sp + 1; k <= ep; k++) {
-        for (int l = k; l >= sp + 1; l--) {
-            //如果后面曲率点大于前面，则交换
-          if (cloudCurvature[cloudSortInd[l]] < cloudCurvature[cloudSortInd[l - 1]]) {
-            int temp = cloudSortInd[l - 1];
-            cloudSortInd[l - 1] = cloudSortInd[l];
-            cloudSortInd[l] = temp;
-          }
-        }
+      //点数很少的线上分段为空
+      if (ep < sp) {
+        continue;
       }
 
-      //挑选每个分段的曲率很大和比较大的点
-      int largestPickedNum = 0;
-      for (int k = ep; k >= sp; k--) {
-        int ind = cloudSortInd[k];  //曲率最大点的点序
-
-        //如果曲率大的点，曲率的确比较大，并且未被筛选过滤掉
-        if (cloudNeighborPicked[ind] == 0 &&
-            cloudCurvature[ind] > 0.1) {
-        
-          largestPickedNum++;
-          if (largestPickedNum <= 2) {//挑选曲率最大的前2个点放入sharp点集合
-            cloudLabel[ind] = 2;//2代表点曲率很大
-            cornerPointsSharp.push_back(laserCloud->points[ind]);
-            cornerPointsLessSharp.push_back(laserCloud->points[ind]);
-          } else if (largestPickedNum <= 20) {//挑选曲率最大的前20个点放入less sharp点集合
-            cloudLabel[ind] = 1;//1代表点曲率比较尖锐
-            cornerPointsLessSharp.push_back(laserCloud->points[ind]);
-          } else {
-            break;
-          }
-
-          cloudNeighborPicked[ind] = 1;//筛选标志置位
-
-          //将曲率比较大的点的前后各5个连续距离比较近的点筛选出去，防止特征点聚集，使得特征点在每个方向上尽量分布均匀
-          for (int l = 1; l <= 5; l++) {
-            float diffX = laserCloud->points[ind + l].x 
-                        - laserCloud->points[ind + l - 1].x;
-            float diffY = laserCloud->points[ind + l].y 
-                        - laserCloud->points[ind + l - 1].y;
-            float diffZ = laserCloud->points[ind + l].z 
-                        - laserCloud->points[ind + l - 1].z;
-            if (diffX * diffX + diffY * diffY + diffZ * diffZ > 0.05) {
-              break;
-            }
-
-            cloudNeighborPicked[ind + l] = 1;
-          }
-          for (int l = -1; l >= -5; l--) {
-            float diffX = laserCloud->points[ind + l].x 
-                        - laserCloud->points[ind + l + 1].x;
-            float diffY = laserCloud->points[ind + l].y 
-                        - laserCloud->points[ind + l + 1].y;
-            float diffZ = laserCloud->points[ind + l].z 
-                        - laserCloud->points[ind + l + 1].z;
-            if (diffX * diffX + diffY * diffY + diffZ * diffZ > 0.05) {
-              break;
-            }
-
-            cloudNeighborPicked[ind + l] = 1;
-          }
-        }
+      segmentFeatures.clear();
+      selectSegmentFeatures(sp, ep, cloudCurvature.data(), cloudGapSq.data(), cloudSortInd.data(),
+                            cloudNeighborPicked.data(), cloudLabel.data(), segmentFeatures);
+      for (size_t k = 0; k < segmentFeatures.sharp.size(); k++) {
+        cornerPointsSharp->push_back(laserCloud->points[segmentFeatures.sharp[k]]);
       }
-
-      //挑选每个分段的曲率很小比较小的点
-      int smallestPickedNum = 0;
-      for (int k = sp; k <= ep; k++) {
-        int ind = cloudSortInd[k];
-
-        //如果曲率的确比较小，并且未被筛选出
-        if (cloudNeighborPicked[ind] == 0 &&
-            cloudCurvature[ind] < 0.1) {
-
-          cloudLabel[ind] = -1;//-1代表曲率很小的点
-          surfPointsFlat.push_back(laserCloud->points[ind]);
-
-          smallestPickedNum++;
-          if (smallestPickedNum >= 4) {//只选最小的四个，剩下的Label==0,就都是曲率比较小的
-            break;
-          }
-
-          cloudNeighborPicked[ind] = 1;
-          for (int l = 1; l <= 5; l++) {//同样防止特征点聚集
-            float diffX = laserCloud->points[ind + l].x 
-                        - laserCloud->points[ind + l - 1].x;
-            float diffY = laserCloud->points[ind + l].y 
-                        - laserCloud->points[ind + l - 1].y;
-            float diffZ = laserCloud->points[ind + l].z 
-                        - laserCloud->points[ind + l - 1].z;
-            if (diffX * diffX + diffY * diffY + diffZ * diffZ > 0.05) {
-              break;
-            }
-
-            cloudNeighborPicked[ind + l] = 1;
-          }
-          for (int l = -1; l >= -5; l--) {
-            float diffX = laserCloud->points[ind + l].x 
-                        - laserCloud->points[ind + l + 1].x;
-            float diffY = laserCloud->points[ind + l].y 
-                        - laserCloud->points[ind + l + 1].y;
-            float diffZ = laserCloud->points[ind + l].z 
-                        - laserCloud->points[ind + l + 1].z;
-            if (diffX * diffX + diffY * diffY + diffZ * diffZ > 0.05) {
-              break;
-            }
-
-            cloudNeighborPicked[ind + l] = 1;
-          }
-        }
+      for (size_t k = 0; k < segmentFeatures.lessSharp.size(); k++) {
+        cornerPointsLessSharp->push_back(laserCloud->points[segmentFeatures.lessSharp[k]]);
+      }
+      for (size_t k = 0; k < segmentFeatures.flat.size(); k++) {
+        surfPointsFlat->push_back(laserCloud->points[segmentFeatures.flat[k]]);
       }
 
       //将剩余的点（包括之前被排除的点）全部归入平面点中less flat类别中
@@ -698,135 +606,85 @@ void laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
     }
 
     //由于less flat点最多，对每个分段less flat的点进行体素栅格滤波
-    pcl::PointCloud<PointType> surfPointsLessFlatScanDS;
-    pcl::VoxelGrid<PointType> downSizeFilter;
+    timer.next(STAGE_DOWNSAMPLE);
+    surfPointsLessFlatScanDS.clear();
     downSizeFilter.setInputCloud(surfPointsLessFlatScan);
-    downSizeFilter.setLeafSize(0.2, 0.2, 0.2);
     downSizeFilter.filter(surfPointsLessFlatScanDS);
 
     //less flat点汇总
-    surfPointsLessFlat += surfPointsLessFlatScanDS;
+    *surfPointsLessFlat += surfPointsLessFlatScanDS;
+    timer.next(STAGE_SELECTION);
   }
 
-  //publich消除非匀速运动畸变后的所有的点
-  sensor_msgs::PointCloud2 laserCloudOutMsg;
-  pcl::toROSMsg(*laserCloud, laserCloudOutMsg);
-  laserCloudOutMsg.header.stamp = laserCloudMsg->header.stamp;
-  laserCloudOutMsg.header.frame_id = "/camera";
-  pubLaserCloud.publish(laserCloudOutMsg);
-
-  //publich消除非匀速运动畸变后的平面点和边沿点
-  sensor_msgs::PointCloud2 cornerPointsSharpMsg;
-  pcl::toROSMsg(cornerPointsSharp, cornerPointsSharpMsg);
-  cornerPointsSharpMsg.header.stamp = laserCloudMsg->header.stamp;
-  cornerPointsSharpMsg.header.frame_id = "/camera";
-  pubCornerPointsSharp.publish(cornerPointsSharpMsg);
-
-  sensor_msgs::PointCloud2 cornerPointsLessSharpMsg;
-  pcl::toROSMsg(cornerPointsLessSharp, cornerPointsLessSharpMsg);
-  cornerPointsLessSharpMsg.header.stamp = laserCloudMsg->header.stamp;
-  cornerPointsLessSharpMsg.header.frame_id = "/camera";
-  pubCornerPointsLessSharp.publish(cornerPointsLessSharpMsg);
-
-  sensor_msgs::PointCloud2 surfPointsFlat2;
-  pcl::toROSMsg(surfPointsFlat, surfPointsFlat2);
-  surfPointsFlat2.header.stamp = laserCloudMsg->header.stamp;
-  surfPointsFlat2.header.frame_id = "/camera";
-  pubSurfPointsFlat.publish(surfPointsFlat2);
-
-  sensor_msgs::PointCloud2 surfPointsLessFlat2;
-  pcl::toROSMsg(surfPointsLessFlat, surfPointsLessFlat2);
-  surfPointsLessFlat2.header.stamp = laserCloudMsg->header.stamp;
-  surfPointsLessFlat2.header.frame_id = "/camera";
-  pubSurfPointsLessFlat.publish(surfPointsLessFlat2);
-
-  //publich IMU消息,由于循环到了最后，因此是Cur都是代表最后一个点，即最后一个点的欧拉角，畸变位移及一个点云周期增加的速度
-  pcl::PointCloud<pcl::PointXYZ> imuTrans(4, 1);
+  timer.next(STAGE_OUTPUT);
+  //消除非匀速运动畸变后的所有的点与平面点和边沿点
+  //pcl时间戳为微秒精度，与原始消息的时间戳保持一致
+  const uint64_t cloudStamp = laserCloudIn.stamp;
+
+  laserCloud->header.stamp = cloudStamp;
+  laserCloud->header.frame_id = "/camera";
+  cornerPointsSharp->header.stamp = cloudStamp;
+  cornerPointsSharp->header.frame_id = "/camera";
+  cornerPointsLessSharp->header.stamp = cloudStamp;
+  cornerPointsLessSharp->header.frame_id = "/camera";
+  surfPointsFlat->header.stamp = cloudStamp;
+  surfPointsFlat->header.frame_id = "/camera";
+  surfPointsLessFlat->header.stamp = cloudStamp;
+  surfPointsLessFlat->header.frame_id = "/camera";
+
+  sweep.time = secFromPclStamp(cloudStamp);
+  sweep.fullRes = laserCloud;
+  sweep.cornerSharp = cornerPointsSharp;
+  sweep.cornerLessSharp = cornerPointsLessSharp;
+  sweep.surfFlat = surfPointsFlat;
+  sweep.surfLessFlat = surfPointsLessFlat;
+  sweep.imuTrans = makeImuTrans(cloudStamp);
+  return true;
+}
+
+//IMU信息,由于循环到了最后，因此是Cur都是代表最后一个点，即最后一个点的欧拉角，畸变位移及一个点云周期增加的速度
+pcl::PointCloud<pcl::PointXYZ>::Ptr ScanRegistration::makeImuTrans(uint64_t cloudStamp)
+{
+  pcl::PointCloud<pcl::PointXYZ>::Ptr imuTrans = imuTransPool.acquire();
+  imuTrans->resize(4);
   //起始点欧拉角
-  imuTrans.points[0].x = imuPitchStart;
-  imuTrans.points[0].y = imuYawStart;
-  imuTrans.points[0].z = imuRollStart;
+  imuTrans->points[0].x = imuPitchStart;
+  imuTrans->points[0].y = imuYawStart;
+  imuTrans->points[0].z = imuRollStart;
 
   //最后一个点的欧拉角
-  imuTrans.points[1].x = imuPitchCur;
-  imuTrans.points[1].y = imuYawCur;
-  imuTrans.points[1].z = imuRollCur;
+  imuTrans->points[1].x = imuPitchCur;
+  imuTrans->points[1].y = imuYawCur;
+  imuTrans->points[1].z = imuRollCur;
 
   //最后一个点相对于第一个点的畸变位移和速度
-  imuTrans.points[2].x = imuShiftFromStartXCur;
-  imuTrans.points[2].y = imuShiftFromStartYCur;
-  imuTrans.points[2].z = imuShiftFromStartZCur;
-
-  imuTrans.points[3].x = imuVeloFromStartXCur;
-  imuTrans.points[3].y = imuVeloFromStartYCur;
-  imuTrans.points[3].z = imuVeloFromStartZCur;
-
-  sensor_msgs::PointCloud2 imuTransMsg;
-  pcl::toROSMsg(imuTrans, imuTransMsg);
-  imuTransMsg.header.stamp = laserCloudMsg->header.stamp;
-  imuTransMsg.header.frame_id = "/camera";
-  pubImuTrans.publish(imuTransMsg);
-}
+  imuTrans->points[2].x = imuShiftFromStartXCur;
+  imuTrans->points[2].y = imuShiftFromStartYCur;
+  imuTrans->points[2].z = imuShiftFromStartZCur;
 
-//接收imu消息，imu坐标系为x轴向前，y轴向右，z轴向上的右手坐标系
-void imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn)
-{
-  double roll, pitch, yaw;
-  tf::Quaternion orientation;
-  //convert Quaternion msg to Quaternion
-  tf::quaternionMsgToTF(imuIn->orientation, orientation);
-  //This will get the roll pitch and yaw from the matrix about fixed axes X, Y, Z respectively. That's R = Rz(yaw)*Ry(pitch)*Rx(roll).
-  //Here roll pitch yaw is in the global frame
-  tf::Matrix3x3(orientation).getRPY(roll, pitch, yaw);
+  imuTrans->points[3].x = imuVeloFromStartXCur;
+  imuTrans->points[3].y = imuVeloFromStartYCur;
+  imuTrans->points[3].z = imuVeloFromStartZCur;
 
-  //减去重力的影响,求出xyz方向的加速度实际值，并进行坐标轴交换，统一到z轴向前,x轴向左的右手坐标系, 交换过后RPY对应fixed axes ZXY(RPY---ZXY)。Now R = Ry(yaw)*Rx(pitch)*Rz(roll).
-  float accX = imuIn->linear_acceleration.y - sin(roll) * cos(pitch) * 9.81;
-  float accY = imuIn->linear_acceleration.z - cos(roll) * cos(pitch) * 9.81;
-  float accZ = imuIn->linear_acceleration.x + sin(pitch) * 9.81;
-
-  //循环移位效果，形成环形数组
-  imuPointerLast = (imuPointerLast + 1) % imuQueLength;
-
-  imuTime[imuPointerLast] = imuIn->header.stamp.toSec();
-  imuRoll[imuPointerLast] = roll;
-  imuPitch[imuPointerLast] = pitch;
-  imuYaw[imuPointerLast] = yaw;
-  imuAccX[imuPointerLast] = accX;
-  imuAccY[imuPointerLast] = accY;
-  imuAccZ[imuPointerLast] = accZ;
-
-  AccumulateIMUShift();
+  imuTrans->header.stamp = cloudStamp;
+  imuTrans->header.frame_id = "/camera";
+  return imuTrans;
 }
 
-int main(int argc, char** argv)
+//imu坐标系为x轴向前，y轴向右，z轴向上的右手坐标系，欧拉角为全局坐标系下的R = Rz(yaw)*Ry(pitch)*Rx(roll)
+void ScanRegistration::processImu(const ImuSample& imu)
 {
-  ros::init(argc, argv, "scanRegistration");
-  ros::NodeHandle nh;
-
-  ros::Subscriber subLaserCloud = nh.subscribe<sensor_msgs::PointCloud2> 
-                                  ("/velodyne_points", 2, laserCloudHandler);
-
-  ros::Subscriber subImu = nh.subscribe<sensor_msgs::Imu> ("/imu/data", 50, imuHandler);
-
-  pubLaserCloud = nh.advertise<sensor_msgs::PointCloud2>
-                                 ("/velodyne_cloud_2", 2);
-
-  pubCornerPointsSharp = nh.advertise<sensor_msgs::PointCloud2>
-                                        ("/laser_cloud_sharp", 2);
-
-  pubCornerPointsLessSharp = nh.advertise<sensor_msgs::PointCloud2>
-                                            ("/laser_cloud_less_sharp", 2);
-
-  pubSurfPointsFlat = nh.advertise<sensor_msgs::PointCloud2>
-                                       ("/laser_cloud_flat", 2);
-
-  pubSurfPointsLessFlat = nh.advertise<sensor_msgs::PointCloud2>
-                                           ("/laser_cloud_less_flat", 2);
-
-  pubImuTrans = nh.advertise<sensor_msgs::PointCloud2> ("/imu_trans", 5);
-
-  ros::spin();
-
-  return 0;
+  //减去重力的影响,求出xyz方向的加速度实际值，并进行坐标轴交换，统一到z轴向前,x轴向左的右手坐标系, 交换过后RPY对应fixed axes ZXY(RPY---ZXY)。Now R = Ry(yaw)*Rx(pitch)*Rz(roll).
+  ImuState imuState;
+  imuState.time = imu.time;
+  imuState.roll = imu.roll;
+  imuState.pitch = imu.pitch;
+  imuState.yaw = imu.yaw;
+  imuAccelerationToCamera(imu, imuState.accX, imuState.accY, imuState.accZ);
+
+  //积分之后放入队列，处理点云的线程可以同时查找
+  AccumulateIMUShift(imuState);
+  imuBuffer.push(imuState);
 }
 
+} // end namespace loam
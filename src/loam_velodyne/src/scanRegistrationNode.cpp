@@ -0,0 +1,186 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <string>
+
+#include <loam_velodyne/ScanRegistrationNode.h>
+#include <loam_velodyne/feature_frame.h>
+#include <loam_velodyne/ros_conversions.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl_ros/point_cloud.h>
+
+namespace loam {
+
+bool ScanRegistrationNode::setup(ros::NodeHandle& node, ros::NodeHandle& privateNode)
+{
+  setupRosLogging();
+
+  ScanRegistrationParams params;
+  privateNode.param("sensorModel", params.sensorModel, params.sensorModel);
+  privateNode.getParam("ringElevations", params.ringElevations);
+  privateNode.param("useRingField", params.useRingField, params.useRingField);
+  privateNode.param("useTimeField", params.useTimeField, params.useTimeField);
+  privateNode.param("indexRelativeTime", params.indexRelativeTime, params.indexRelativeTime);
+  if (!scanRegistration.configure(params)) {
+    return false;
+  }
+
+  //按雷达一帧点数的上限预先分配转换消息的缓存
+  int maxPointsPerSweep = scanRegistration.getSensorModel().maxPointsPerSweep();
+  laserCloudIn.points.reserve(maxPointsPerSweep);
+  laserCloudIn.rings.reserve(maxPointsPerSweep);
+  laserCloudIn.times.reserve(maxPointsPerSweep);
+  laserCloudInIndices.reserve(maxPointsPerSweep);
+
+  std::string featureOutput("clouds");
+  privateNode.param("featureOutput", featureOutput, featureOutput);
+  if (featureOutput == "clouds") {
+    publishClouds = true;
+    publishFrame = false;
+  } else if (featureOutput == "frame") {
+    publishClouds = false;
+    publishFrame = true;
+  } else if (featureOutput == "both") {
+    publishClouds = true;
+    publishFrame = true;
+  } else {
+    ROS_ERROR("Invalid featureOutput parameter: %s (expected clouds, frame or both)",
+              featureOutput.c_str());
+    return false;
+  }
+
+  subLaserCloud = node.subscribe<sensor_msgs::PointCloud2>
+                  ("/velodyne_points", 2, &ScanRegistrationNode::laserCloudHandler, this);
+
+  subImu = node.subscribe<sensor_msgs::Imu> ("/imu/data", 50, &ScanRegistrationNode::imuHandler, this);
+
+  if (publishClouds) {
+    //特征点云以pcl::PointCloud直接发布，同一nodelet manager内的订阅者拿到的是共享指针，不经过序列化
+    pubLaserCloud = node.advertise<pcl::PointCloud<PointType> >
+                                   ("/velodyne_cloud_2", 2);
+
+    pubCornerPointsSharp = node.advertise<pcl::PointCloud<PointType> >
+                                          ("/laser_cloud_sharp", 2);
+
+    pubCornerPointsLessSharp = node.advertise<pcl::PointCloud<PointType> >
+                                              ("/laser_cloud_less_sharp", 2);
+
+    pubSurfPointsFlat = node.advertise<pcl::PointCloud<PointType> >
+                                         ("/laser_cloud_flat", 2);
+
+    pubSurfPointsLessFlat = node.advertise<pcl::PointCloud<PointType> >
+                                             ("/laser_cloud_less_flat", 2);
+
+    pubImuTrans = node.advertise<pcl::PointCloud<pcl::PointXYZ> > ("/imu_trans", 5);
+  }
+
+  if (publishFrame) {
+    //一条消息携带全部点集与IMU状态，下游无需再按时间戳匹配
+    pubFeatureFrame = node.advertise<loam_velodyne::FeatureFrame> ("/feature_frame", 2);
+  }
+
+  //各阶段耗时按~timingPeriod周期发布到/diagnostics
+  timingPublisher.setup(node, privateNode, "scanRegistration: timing");
+
+  return true;
+}
+
+void ScanRegistrationNode::laserCloudHandler(const sensor_msgs::PointCloud2ConstPtr& laserCloudMsg)
+{
+  rawSweepFromMsg(*laserCloudMsg, scanRegistration.getRingField(), scanRegistration.getTimeField(),
+                  laserCloudIn, laserCloudInIndices);
+
+  FeatureSweep sweep;
+  if (scanRegistration.process(laserCloudIn, sweep)) {
+    if (publishFrame) {
+      publishFeatureFrame(sweep);
+    }
+
+    if (publishClouds) {
+      pubLaserCloud.publish(sweep.fullRes);
+
+      //publich消除非匀速运动畸变后的平面点和边沿点
+      pubCornerPointsSharp.publish(sweep.cornerSharp);
+      pubCornerPointsLessSharp.publish(sweep.cornerLessSharp);
+      pubSurfPointsFlat.publish(sweep.surfFlat);
+      pubSurfPointsLessFlat.publish(sweep.surfLessFlat);
+
+      pubImuTrans.publish(sweep.imuTrans);
+    }
+  }
+
+  timingPublisher.update(scanRegistration.getStageTimers());
+}
+
+void ScanRegistrationNode::imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn)
+{
+  scanRegistration.processImu(imuSampleFromMsg(*imuIn));
+}
+
+//把五类点集按顺序写入同一缓存，连同IMU状态作为一条消息发布
+void ScanRegistrationNode::publishFeatureFrame(const FeatureSweep& sweep)
+{
+  loam_velodyne::FeatureFrame::Ptr frame(new loam_velodyne::FeatureFrame);
+  pcl_conversions::fromPCL(sweep.fullRes->header.stamp, frame->header.stamp);
+  frame->header.frame_id = sweep.fullRes->header.frame_id;
+
+  frame->points.reserve(4 * (sweep.fullRes->size() + sweep.cornerSharp->size() +
+                             sweep.cornerLessSharp->size() + sweep.surfFlat->size() +
+                             sweep.surfLessFlat->size()));
+  appendFeatureSet(*frame, loam_velodyne::FeatureFrame::FULL_RES, *sweep.fullRes);
+  appendFeatureSet(*frame, loam_velodyne::FeatureFrame::CORNER_SHARP, *sweep.cornerSharp);
+  appendFeatureSet(*frame, loam_velodyne::FeatureFrame::CORNER_LESS_SHARP, *sweep.cornerLessSharp);
+  appendFeatureSet(*frame, loam_velodyne::FeatureFrame::SURF_FLAT, *sweep.surfFlat);
+  appendFeatureSet(*frame, loam_velodyne::FeatureFrame::SURF_LESS_FLAT, *sweep.surfLessFlat);
+
+  //与/imu_trans相同的含义：起始点与最后一个点的欧拉角，最后一个点相对于第一个点的畸变位移和速度
+  const pcl::PointCloud<pcl::PointXYZ>& imuTrans = *sweep.imuTrans;
+  frame->imuAngleStart.x = imuTrans.points[0].x;
+  frame->imuAngleStart.y = imuTrans.points[0].y;
+  frame->imuAngleStart.z = imuTrans.points[0].z;
+
+  frame->imuAngleLast.x = imuTrans.points[1].x;
+  frame->imuAngleLast.y = imuTrans.points[1].y;
+  frame->imuAngleLast.z = imuTrans.points[1].z;
+
+  frame->imuShiftFromStart.x = imuTrans.points[2].x;
+  frame->imuShiftFromStart.y = imuTrans.points[2].y;
+  frame->imuShiftFromStart.z = imuTrans.points[2].z;
+
+  frame->imuVeloFromStart.x = imuTrans.points[3].x;
+  frame->imuVeloFromStart.y = imuTrans.points[3].y;
+  frame->imuVeloFromStart.z = imuTrans.points[3].z;
+
+  pubFeatureFrame.publish(frame);
+}
+
+} // end namespace loam
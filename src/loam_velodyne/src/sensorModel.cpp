@@ -0,0 +1,200 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <loam_velodyne/SensorModel.h>
+#include <algorithm>
+#include <cmath>
+
+namespace loam {
+
+//等间隔排列的仰角
+static std::vector<float> uniformElevations(float lowest, float highest, int num)
+{
+  std::vector<float> elevations(num);
+  for (int i = 0; i < num; i++) {
+    elevations[i] = lowest + (highest - lowest) * i / (num - 1);
+  }
+
+  return elevations;
+}
+
+SensorModel::SensorModel()
+{
+  setModel("VLP-16");
+}
+
+bool SensorModel::setModel(const std::string& modelName)
+{
+  std::vector<float> modelElevations;
+  bool modelLegacyInterleave = false;
+  bool modelRingTopDown = false;
+  int modelPointsPerRing = 2048;
+  std::string modelTimeField;
+  double modelTimeScale = 1.0;
+
+  if (modelName == "VLP-16") {
+    //-15度到15度，间隔2度
+    modelElevations = uniformElevations(-15.0, 15.0, 16);
+    modelLegacyInterleave = true;
+    modelPointsPerRing = 1900;
+    modelTimeField = "time";
+  } else if (modelName == "HDL-32") {
+    //-30.67度到10.67度，间隔约1.33度
+    modelElevations = uniformElevations(-30.67, 10.67, 32);
+    modelPointsPerRing = 2200;
+    modelTimeField = "time";
+  } else if (modelName == "HDL-64") {
+    //下半部分32条线-24.33度到-8.83度间隔0.5度，上半部分32条线-8.33度到2度间隔约0.33度
+    modelElevations = uniformElevations(-24.33, -8.83, 32);
+    std::vector<float> upper = uniformElevations(-8.33, 2.0, 32);
+    modelElevations.insert(modelElevations.end(), upper.begin(), upper.end());
+    modelPointsPerRing = 2100;
+    modelTimeField = "time";
+  } else if (modelName == "OS1-64") {
+    //垂直视场33.2度
+    modelElevations = uniformElevations(-16.6, 16.6, 64);
+    modelRingTopDown = true;
+    modelTimeField = "t";
+    modelTimeScale = 1e-9;
+  } else if (modelName == "OS1-128") {
+    //垂直视场45度
+    modelElevations = uniformElevations(-22.5, 22.5, 128);
+    modelRingTopDown = true;
+    modelTimeField = "t";
+    modelTimeScale = 1e-9;
+  } else {
+    return false;
+  }
+
+  name = modelName;
+  elevations = modelElevations;
+  legacyInterleave = modelLegacyInterleave;
+  ringTopDown = modelRingTopDown;
+  pointsPerRing = modelPointsPerRing;
+  timeField = modelTimeField;
+  timeScale = modelTimeScale;
+  buildTables();
+  return true;
+}
+
+bool SensorModel::setElevations(const std::vector<float>& ringElevations)
+{
+  if (ringElevations.size() < 2) {
+    return false;
+  }
+
+  std::vector<float> sorted = ringElevations;
+  std::sort(sorted.begin(), sorted.end());
+  if (sorted.front() <= -90 || sorted.back() >= 90 ||
+      std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+    return false;
+  }
+
+  elevations = sorted;
+  //自定义的仰角不再沿用VLP-16的交错线号
+  legacyInterleave = false;
+  buildTables();
+  return true;
+}
+
+void SensorModel::buildTables()
+{
+  int ringNum = numRings();
+
+  //分界取相邻两条线仰角的中点，视场的上下界向外延伸半个间隔
+  std::vector<float> boundaries(ringNum + 1);
+  boundaries[0] = elevations[0] - 0.5 * (elevations[1] - elevations[0]);
+  for (int i = 1; i < ringNum; i++) {
+    boundaries[i] = 0.5 * (elevations[i - 1] + elevations[i]);
+  }
+  boundaries[ringNum] = elevations[ringNum - 1] + 0.5 * (elevations[ringNum - 1] - elevations[ringNum - 2]);
+
+  boundaryTanSq.resize(ringNum + 1);
+  boundaryNegative.resize(ringNum + 1);
+  for (int i = 0; i <= ringNum; i++) {
+    float boundary = std::max(-89.9f, std::min(89.9f, boundaries[i]));
+    float tangent = std::tan(boundary * M_PI / 180);
+    boundaryTanSq[i] = tangent * tangent;
+    boundaryNegative[i] = tangent < 0;
+  }
+
+  scanIds.resize(ringNum);
+  for (int i = 0; i < ringNum; i++) {
+    if (legacyInterleave) {
+      //与原来四舍五入仰角的计算方式一致：正仰角的线号为仰角，其余为仰角 + (线数 - 1)
+      int roundedAngle = int(elevations[i] + (elevations[i] < 0.0 ? -0.5 : +0.5));
+      scanIds[i] = roundedAngle > 0 ? roundedAngle : roundedAngle + (ringNum - 1);
+    } else {
+      scanIds[i] = i;
+    }
+  }
+}
+
+int SensorModel::scanIdOf(float x, float y, float z) const
+{
+  //仰角大于分界 <=> y > tan(分界) * sqrt(x^2 + z^2)，两边平方后比较，不需要开方与反三角函数
+  float horizontalSq = x * x + z * z;
+  float ySq = y * y;
+
+  //二分查找点在其上方的分界数量
+  int low = 0;
+  int high = int(boundaryTanSq.size());
+  while (low < high) {
+    int mid = (low + high) / 2;
+    float boundarySq = boundaryTanSq[mid] * horizontalSq;
+    bool above = boundaryNegative[mid] ? (y >= 0 || ySq < boundarySq) : (y > 0 && ySq > boundarySq);
+    if (above) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  //在下界以下或者上界以上
+  if (low == 0 || low > numRings()) {
+    return -1;
+  }
+
+  return scanIds[low - 1];
+}
+
+int SensorModel::scanIdOfRing(int ring) const
+{
+  int ringNum = numRings();
+  if (ring < 0 || ring >= ringNum) {
+    return -1;
+  }
+
+  return scanIds[ringTopDown ? ringNum - 1 - ring : ring];
+}
+
+} // end namespace loam
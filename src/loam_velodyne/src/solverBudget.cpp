@@ -0,0 +1,131 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <cmath>
+
+#include <loam_velodyne/SolverBudget.h>
+#include <loam_velodyne/common.h>
+
+namespace loam {
+
+const char* solverStopReasonName(SolverStopReason reason)
+{
+  switch (reason) {
+    case SOLVER_NOT_RUN:
+      return "not run";
+    case SOLVER_CONVERGED:
+      return "converged";
+    case SOLVER_MAX_ITERATIONS:
+      return "max iterations";
+    case SOLVER_DEADLINE:
+      return "deadline";
+    case SOLVER_TOO_FEW_POINTS:
+      return "too few points";
+  }
+  return "unknown";
+}
+
+SolverBudget::SolverBudget(int maxIterations, int reassociateInterval)
+  : maxIterations(maxIterations),
+    reassociateInterval(reassociateInterval),
+    timeBudget(0),
+    reassociateRotation(0),
+    reassociateTranslation(0),
+    associatedTransform{0}
+{
+  report.iterations = 0;
+  report.associations = 0;
+  report.reason = SOLVER_NOT_RUN;
+  report.elapsed = 0;
+}
+
+void SolverBudget::setReassociateThreshold(float rotation, float translation)
+{
+  reassociateRotation = rotation;
+  reassociateTranslation = translation;
+}
+
+void SolverBudget::start()
+{
+  startTime = std::chrono::steady_clock::now();
+  report.iterations = 0;
+  report.associations = 0;
+  report.reason = SOLVER_NOT_RUN;
+  report.elapsed = 0;
+}
+
+bool SolverBudget::needReassociate(int iterCount, const float transform[6])
+{
+  bool reassociate;
+  if (!adaptiveReassociation()) {
+    reassociate = iterCount % reassociateInterval == 0;
+  } else if (iterCount == 0) {
+    reassociate = true;
+  } else {
+    //与迭代终止条件相同的度量：旋转变化量(度)与平移变化量(米)
+    float deltaR = sqrt(pow(rad2deg(transform[0] - associatedTransform[0]), 2) +
+                        pow(rad2deg(transform[1] - associatedTransform[1]), 2) +
+                        pow(rad2deg(transform[2] - associatedTransform[2]), 2));
+    float deltaT = sqrt(pow(transform[3] - associatedTransform[3], 2) +
+                        pow(transform[4] - associatedTransform[4], 2) +
+                        pow(transform[5] - associatedTransform[5], 2));
+    reassociate = (reassociateRotation > 0 && deltaR > reassociateRotation) ||
+                  (reassociateTranslation > 0 && deltaT > reassociateTranslation);
+  }
+
+  if (reassociate) {
+    for (int i = 0; i < 6; i++) {
+      associatedTransform[i] = transform[i];
+    }
+    report.associations++;
+  }
+  return reassociate;
+}
+
+bool SolverBudget::deadlineReached() const
+{
+  if (timeBudget <= 0) {
+    return false;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+  return elapsed.count() > timeBudget;
+}
+
+void SolverBudget::finish(int iterations, SolverStopReason reason)
+{
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+  report.iterations = iterations;
+  report.reason = reason;
+  report.elapsed = elapsed.count();
+}
+
+} // end namespace loam
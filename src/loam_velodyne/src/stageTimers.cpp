@@ -0,0 +1,190 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <loam_velodyne/StageTimers.h>
+
+namespace loam {
+
+//桶k的上界为1us * 2^((k + 1) / 4)，最后一个桶存放更大的值
+static inline int bucketOf(uint64_t nanoseconds, int bucketNum)
+{
+  if (nanoseconds <= 1000) {
+    return 0;
+  }
+  int bucket = int(std::floor(4 * std::log2(nanoseconds / 1000.0)));
+  return bucket < bucketNum - 1 ? bucket : bucketNum - 1;
+}
+
+static inline double bucketUpperBound(int bucket)
+{
+  return 1e-6 * std::pow(2.0, (bucket + 1) / 4.0);
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void LatencyHistogram::record(double seconds)
+{
+  uint64_t nanoseconds = seconds > 0 ? uint64_t(seconds * 1e9) : 0;
+  buckets[bucketOf(nanoseconds, bucketNum)].fetch_add(1, std::memory_order_relaxed);
+  pointNum.fetch_add(1, std::memory_order_relaxed);
+  sumNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+  uint64_t maxValue = maxNanoseconds.load(std::memory_order_relaxed);
+  while (nanoseconds > maxValue &&
+         !maxNanoseconds.compare_exchange_weak(maxValue, nanoseconds, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::reset()
+{
+  for (int i = 0; i < bucketNum; i++) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+  pointNum.store(0, std::memory_order_relaxed);
+  sumNanoseconds.store(0, std::memory_order_relaxed);
+  maxNanoseconds.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::percentile(double quantile) const
+{
+  uint64_t total = count();
+  if (total == 0) {
+    return 0;
+  }
+
+  //第ceil(quantile * total)个值所在的桶
+  uint64_t rank = uint64_t(std::ceil(quantile * total));
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t accumulated = 0;
+  for (int i = 0; i < bucketNum; i++) {
+    accumulated += buckets[i].load(std::memory_order_relaxed);
+    if (accumulated >= rank) {
+      //分位数不超过最大值
+      return std::min(bucketUpperBound(i), max());
+    }
+  }
+  return max();
+}
+
+double LatencyHistogram::max() const
+{
+  return maxNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+}
+
+double LatencyHistogram::mean() const
+{
+  uint64_t total = count();
+  return total > 0 ? sumNanoseconds.load(std::memory_order_relaxed) * 1e-9 / total : 0;
+}
+
+StageTimers::StageTimers(std::initializer_list<const char*> stageNames)
+  : names(stageNames.begin(), stageNames.end()),
+    histograms(names.size()),
+    frameSeconds(names.size(), 0),
+    frameTouched(names.size(), 0)
+{
+}
+
+void StageTimers::add(int stage, double seconds)
+{
+  frameSeconds[stage] += seconds;
+  frameTouched[stage] = 1;
+}
+
+void StageTimers::finishFrame()
+{
+  //本帧没有执行的阶段不计入
+  for (size_t i = 0; i < names.size(); i++) {
+    if (frameTouched[i]) {
+      histograms[i].record(frameSeconds[i]);
+      frameSeconds[i] = 0;
+      frameTouched[i] = 0;
+    }
+  }
+}
+
+void StageTimers::resetHistograms()
+{
+  for (size_t i = 0; i < histograms.size(); i++) {
+    histograms[i].reset();
+  }
+}
+
+std::string StageTimers::summary() const
+{
+  std::string text;
+  char buffer[128];
+  for (size_t i = 0; i < names.size(); i++) {
+    const LatencyHistogram& histogram = histograms[i];
+    if (histogram.count() == 0) {
+      continue;
+    }
+    snprintf(buffer, sizeof(buffer), "%s%s: p50 %.2f p99 %.2f max %.2f ms (%lu)", text.empty() ? "" : ", ",
+             names[i].c_str(), histogram.percentile(0.5) * 1000, histogram.percentile(0.99) * 1000,
+             histogram.max() * 1000, (unsigned long)histogram.count());
+    text += buffer;
+  }
+  return text;
+}
+
+ScopedTimer::ScopedTimer(StageTimers& timers, int stage)
+  : timers(timers),
+    stage(stage),
+    startTime(std::chrono::steady_clock::now())
+{
+}
+
+void ScopedTimer::next(int nextStage)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (stage >= 0) {
+    timers.add(stage, std::chrono::duration<double>(now - startTime).count());
+  }
+  stage = nextStage;
+  startTime = now;
+}
+
+void ScopedTimer::stop()
+{
+  next(-1);
+}
+
+} // end namespace loam
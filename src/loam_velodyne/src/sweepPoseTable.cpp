@@ -0,0 +1,108 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <cmath>
+
+#include <loam_velodyne/SweepPoseTable.h>
+
+namespace loam {
+
+//插值位姿(rx, ry, rz)的逆旋转：绕z轴旋转（-rz），绕x轴旋转（-rx），绕y轴旋转（-ry）
+static void rotateToStart(float rx, float ry, float rz, float x, float y, float z,
+                          float& ox, float& oy, float& oz)
+{
+  float x1 = cos(rz) * x + sin(rz) * y;
+  float y1 = -sin(rz) * x + cos(rz) * y;
+  float z1 = z;
+
+  float x2 = x1;
+  float y2 = cos(rx) * y1 + sin(rx) * z1;
+  float z2 = -sin(rx) * y1 + cos(rx) * z1;
+
+  ox = cos(ry) * x2 - sin(ry) * z2;
+  oy = y2;
+  oz = sin(ry) * x2 + cos(ry) * z2;
+}
+
+void SweepPoseTable::reset(const float transform[6])
+{
+  for (int i = 0; i < 6; i++) {
+    this->transform[i] = transform[i];
+  }
+  if (bins <= 0) {
+    return;
+  }
+
+  //依次旋转三个坐标轴得到旋转矩阵的各列
+  rotations.resize(9 * (bins + 1));
+  for (int b = 0; b <= bins; b++) {
+    float s = float(b) / bins;
+    float* r = &rotations[9 * b];
+    for (int col = 0; col < 3; col++) {
+      rotateToStart(s * transform[0], s * transform[1], s * transform[2],
+                    col == 0, col == 1, col == 2, r[col], r[3 + col], r[6 + col]);
+    }
+  }
+}
+
+//逐点按插值系数计算插值位姿，与laserOdometry原来的TransformToStart相同
+void SweepPoseTable::exactToStart(const PointType& pi, PointType& po) const
+{
+  //插值系数计算，云中每个点的相对时间/点云周期10
+  float s = 10 * (pi.intensity - int(pi.intensity));
+
+  //线性插值：根据每个点在点云中的相对位置关系，乘以相应的旋转平移系数
+  float rx = s * transform[0];
+  float ry = s * transform[1];
+  float rz = s * transform[2];
+  float tx = s * transform[3];
+  float ty = s * transform[4];
+  float tz = s * transform[5];
+
+  //平移后绕z轴旋转（-rz）
+  float x1 = cos(rz) * (pi.x - tx) + sin(rz) * (pi.y - ty);
+  float y1 = -sin(rz) * (pi.x - tx) + cos(rz) * (pi.y - ty);
+  float z1 = (pi.z - tz);
+
+  //绕x轴旋转（-rx）
+  float x2 = x1;
+  float y2 = cos(rx) * y1 + sin(rx) * z1;
+  float z2 = -sin(rx) * y1 + cos(rx) * z1;
+
+  //绕y轴旋转（-ry）
+  po.x = cos(ry) * x2 - sin(ry) * z2;
+  po.y = y2;
+  po.z = sin(ry) * x2 + cos(ry) * z2;
+  po.intensity = pi.intensity;
+}
+
+} // end namespace loam
@@ -0,0 +1,113 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <cstdio>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <loam_velodyne/TimingPublisher.h>
+
+namespace loam {
+
+static void addTimingValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, double value)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.3f", value);
+  diagnostic_msgs::KeyValue keyValue;
+  keyValue.key = key;
+  keyValue.value = buffer;
+  status.values.push_back(keyValue);
+}
+
+//每个阶段的p50/p99/max(毫秒)与帧数
+static void appendTimingValues(const StageTimers& timers, diagnostic_msgs::DiagnosticStatus& status)
+{
+  for (size_t i = 0; i < timers.stageNum(); i++) {
+    const LatencyHistogram& histogram = timers.histogram(i);
+    if (histogram.count() == 0) {
+      continue;
+    }
+    addTimingValue(status, timers.stageName(i) + " p50 ms", histogram.percentile(0.5) * 1000);
+    addTimingValue(status, timers.stageName(i) + " p99 ms", histogram.percentile(0.99) * 1000);
+    addTimingValue(status, timers.stageName(i) + " max ms", histogram.max() * 1000);
+    addTimingValue(status, timers.stageName(i) + " count", histogram.count());
+  }
+}
+
+TimingPublisher::TimingPublisher()
+  : period(0),
+    logTimings(false)
+{
+}
+
+void TimingPublisher::setup(ros::NodeHandle& node, ros::NodeHandle& privateNode, const std::string& name)
+{
+  statusName = name;
+  privateNode.param("timingPeriod", period, 1.0);
+  privateNode.param("logTimings", logTimings, false);
+  if (period > 0) {
+    pubDiagnostics = node.advertise<diagnostic_msgs::DiagnosticArray> ("/diagnostics", 1);
+  }
+  lastPublish = ros::WallTime::now();
+}
+
+void TimingPublisher::update(StageTimers& timers)
+{
+  if (period <= 0) {
+    return;
+  }
+  ros::WallTime now = ros::WallTime::now();
+  if ((now - lastPublish).toSec() < period) {
+    return;
+  }
+  lastPublish = now;
+
+  diagnostic_msgs::DiagnosticStatus status;
+  status.name = statusName;
+  status.hardware_id = "loam_velodyne";
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = "OK";
+  appendTimingValues(timers, status);
+
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = ros::Time::now();
+  diagnostics.status.push_back(status);
+  pubDiagnostics.publish(diagnostics);
+
+  if (logTimings) {
+    ROS_INFO("%s: %s", statusName.c_str(), timers.summary().c_str());
+  }
+
+  //每个周期的统计相互独立
+  timers.resetHistograms();
+}
+
+} // end namespace loam
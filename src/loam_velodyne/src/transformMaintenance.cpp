@@ -30,40 +30,67 @@
 //   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
 //     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
 
+#include <algorithm>
 #include <cmath>
 
-#include <loam_velodyne/common.h>
-#include <nav_msgs/Odometry.h>
-#include <opencv/cv.h>
-#include <pcl_conversions/pcl_conversions.h>
-#include <pcl/point_cloud.h>
-#include <pcl/point_types.h>
-#include <pcl/filters/voxel_grid.h>
-#include <pcl/kdtree/kdtree_flann.h>
-#include <ros/ros.h>
-#include <sensor_msgs/Imu.h>
-#include <sensor_msgs/PointCloud2.h>
-#include <tf/transform_datatypes.h>
-#include <tf/transform_broadcaster.h>
-
-//odometry计算的转移矩阵(实时高频量)
-float transformSum[6] = {0};
-//平移增量
-float transformIncre[6] = {0};
-//经过mapping矫正过后的最终的世界坐标系下的位姿
-float transformMapped[6] = {0};
-//mapping传递过来的优化前的位姿
-float transformBefMapped[6] = {0};
-//mapping传递过来的优化后的位姿
-float transformAftMapped[6] = {0};
-
-ros::Publisher *pubLaserOdometry2Pointer = NULL;
-tf::TransformBroadcaster *tfBroadcaster2Pointer = NULL;
-nav_msgs::Odometry laserOdometry2;
-tf::StampedTransform laserOdometryTrans2;
+#include <loam_velodyne/TransformMaintenance.h>
+#include <loam_velodyne/imu_integration.h>
+#include <loam_velodyne/logging.h>
+#include <Eigen/Geometry>
+
+namespace loam {
+
+//相邻两个IMU测量的间隔不小于扫描周期时不积分（与scanRegistration相同）
+const double scanPeriod = 0.1;
+
+//位姿(rx, ry, rz)的旋转矩阵，R = Ry(ry)*Rx(rx)*Rz(rz)
+static Eigen::Matrix3f rotationOf(float rx, float ry, float rz)
+{
+  return (Eigen::AngleAxisf(ry, Eigen::Vector3f::UnitY()) *
+          Eigen::AngleAxisf(rx, Eigen::Vector3f::UnitX()) *
+          Eigen::AngleAxisf(rz, Eigen::Vector3f::UnitZ())).toRotationMatrix();
+}
+
+//rotationOf的逆变换
+static void eulerOf(const Eigen::Matrix3f& rotation, float& rx, float& ry, float& rz)
+{
+  rx = -std::asin(std::max(-1.0f, std::min(1.0f, rotation(1, 2))));
+  ry = std::atan2(rotation(0, 2), rotation(2, 2));
+  rz = std::atan2(rotation(1, 0), rotation(1, 1));
+}
+
+const int TransformMaintenance::imuQueLength;
+
+TransformMaintenance::TransformMaintenance()
+  : imuMaxPropagation(0.5),
+    imuBuffer(imuQueLength),
+    hasLastMapped(false),
+    lastMappedTime(0),
+    lastMappedPosition{0},
+    propagating(false),
+    propagationStart(0),
+    startPosition{0},
+    startVelocity{0},
+    imuToMap(Eigen::Matrix3f::Identity()),
+    propagatedTime(0),
+    imuShift{0},
+    imuVelo{0}
+{
+}
+
+bool TransformMaintenance::configure(const TransformMaintenanceParams& params)
+{
+  if (params.imuMaxPropagation <= 0) {
+    LOAM_ERROR("Invalid imuMaxPropagation parameter: %f (expected > 0)", params.imuMaxPropagation);
+    return false;
+  }
+  imuMaxPropagation = params.imuMaxPropagation;
+
+  return true;
+}
 
 //odometry的运动估计和mapping矫正量融合之后得到的最终的位姿transformMapped
-void transformAssociateToMap()
+void TransformMaintenance::transformAssociateToMap()
 {
   //平移后绕y轴旋转（-transformSum[1]）
   float x1 = cos(transformSum[1]) * (transformBefMapped[3] - transformSum[3]) 
@@ -153,90 +180,121 @@ void transformAssociateToMap()
                      - (-sin(transformMapped[1]) * x2 + cos(transformMapped[1]) * z2);
 }
 
-//接收laserOdometry的信息
-void laserOdometryHandler(const nav_msgs::Odometry::ConstPtr& laserOdometry)
+void TransformMaintenance::processOdometry(double time, const float transformSum[6], float transformMapped[6])
 {
-  double roll, pitch, yaw;
-  geometry_msgs::Quaternion geoQuat = laserOdometry->pose.pose.orientation;
-  tf::Matrix3x3(tf::Quaternion(geoQuat.z, -geoQuat.x, -geoQuat.y, geoQuat.w)).getRPY(roll, pitch, yaw);
-
-  //得到旋转平移矩阵
-  transformSum[0] = -pitch;
-  transformSum[1] = -yaw;
-  transformSum[2] = roll;
-
-  transformSum[3] = laserOdometry->pose.pose.position.x;
-  transformSum[4] = laserOdometry->pose.pose.position.y;
-  transformSum[5] = laserOdometry->pose.pose.position.z;
+  std::copy(transformSum, transformSum + 6, this->transformSum);
 
   transformAssociateToMap();
 
-  geoQuat = tf::createQuaternionMsgFromRollPitchYaw
-            (transformMapped[2], -transformMapped[0], -transformMapped[1]);
-
-  laserOdometry2.header.stamp = laserOdometry->header.stamp;
-  laserOdometry2.pose.pose.orientation.x = -geoQuat.y;
-  laserOdometry2.pose.pose.orientation.y = -geoQuat.z;
-  laserOdometry2.pose.pose.orientation.z = geoQuat.x;
-  laserOdometry2.pose.pose.orientation.w = geoQuat.w;
-  laserOdometry2.pose.pose.position.x = transformMapped[3];
-  laserOdometry2.pose.pose.position.y = transformMapped[4];
-  laserOdometry2.pose.pose.position.z = transformMapped[5];
-  pubLaserOdometry2Pointer->publish(laserOdometry2);
-
-  //发送旋转平移量
-  laserOdometryTrans2.stamp_ = laserOdometry->header.stamp;
-  laserOdometryTrans2.setRotation(tf::Quaternion(-geoQuat.y, -geoQuat.z, geoQuat.x, geoQuat.w));
-  laserOdometryTrans2.setOrigin(tf::Vector3(transformMapped[3], transformMapped[4], transformMapped[5]));
-  tfBroadcaster2Pointer->sendTransform(laserOdometryTrans2);
+  std::copy(this->transformMapped, this->transformMapped + 6, transformMapped);
+
+  resetPropagation(time);
 }
 
-//接收laserMapping的转换信息
-void odomAftMappedHandler(const nav_msgs::Odometry::ConstPtr& odomAftMapped)
+void TransformMaintenance::processMapping(const float transformAftMapped[6], const float transformBefMapped[6])
 {
-  double roll, pitch, yaw;
-  geometry_msgs::Quaternion geoQuat = odomAftMapped->pose.pose.orientation;
-  tf::Matrix3x3(tf::Quaternion(geoQuat.z, -geoQuat.x, -geoQuat.y, geoQuat.w)).getRPY(roll, pitch, yaw);
-
-  transformAftMapped[0] = -pitch;
-  transformAftMapped[1] = -yaw;
-  transformAftMapped[2] = roll;
-
-  transformAftMapped[3] = odomAftMapped->pose.pose.position.x;
-  transformAftMapped[4] = odomAftMapped->pose.pose.position.y;
-  transformAftMapped[5] = odomAftMapped->pose.pose.position.z;
-
-  transformBefMapped[0] = odomAftMapped->twist.twist.angular.x;
-  transformBefMapped[1] = odomAftMapped->twist.twist.angular.y;
-  transformBefMapped[2] = odomAftMapped->twist.twist.angular.z;
-
-  transformBefMapped[3] = odomAftMapped->twist.twist.linear.x;
-  transformBefMapped[4] = odomAftMapped->twist.twist.linear.y;
-  transformBefMapped[5] = odomAftMapped->twist.twist.linear.z;
+  std::copy(transformAftMapped, transformAftMapped + 6, this->transformAftMapped);
+  std::copy(transformBefMapped, transformBefMapped + 6, this->transformBefMapped);
 }
 
-int main(int argc, char** argv)
+bool TransformMaintenance::processImu(const ImuSample& imu, float transformPropagated[6], float velocity[3])
 {
-  ros::init(argc, argv, "transformMaintenance");
-  ros::NodeHandle nh;
-
-  ros::Subscriber subLaserOdometry = nh.subscribe<nav_msgs::Odometry> 
-                                     ("/laser_odom_to_init", 5, laserOdometryHandler);
-
-  ros::Subscriber subOdomAftMapped = nh.subscribe<nav_msgs::Odometry> 
-                                     ("/aft_mapped_to_init", 5, odomAftMappedHandler);
-
-  ros::Publisher pubLaserOdometry2 = nh.advertise<nav_msgs::Odometry> ("/integrated_to_init", 5);
-  pubLaserOdometry2Pointer = &pubLaserOdometry2;
-  laserOdometry2.header.frame_id = "/camera_init";
-  laserOdometry2.child_frame_id = "/camera";
-
-  tf::TransformBroadcaster tfBroadcaster2;
-  tfBroadcaster2Pointer = &tfBroadcaster2;
-  laserOdometryTrans2.frame_id_ = "/camera_init";
-  laserOdometryTrans2.child_frame_id_ = "/camera";
+  //与scanRegistration相同，加速度去除重力、交换坐标轴之后旋转到IMU的世界坐标系下
+  float accX, accY, accZ;
+  imuAccelerationToCamera(imu, accX, accY, accZ);
+
+  ImuState state;
+  state.time = imu.time;
+  state.roll = imu.roll;
+  state.pitch = imu.pitch;
+  state.yaw = imu.yaw;
+  rotateImuToWorld(state.roll, state.pitch, state.yaw, accX, accY, accZ);
+  state.accX = accX;
+  state.accY = accY;
+  state.accZ = accZ;
+  imuBuffer.push(state);
+
+  if (!propagating || imu.time <= propagationStart || imu.time - propagationStart > imuMaxPropagation) {
+    return false;
+  }
+
+  propagateTo(state);
+
+  //旋转直接使用IMU的姿态，平移为起点加上积分的位移
+  Eigen::Matrix3f rotation = imuToMap * rotationOf(state.pitch, state.yaw, state.roll);
+  eulerOf(rotation, transformPropagated[0], transformPropagated[1], transformPropagated[2]);
+  for (int i = 0; i < 3; i++) {
+    transformPropagated[3 + i] = startPosition[i] + imuShift[i];
+    velocity[i] = imuVelo[i];
+  }
+
+  return true;
+}
 
-  ros::spin();
+void TransformMaintenance::resetPropagation(double time)
+{
+  //初速度由相邻两次融合的位姿估计(匀速模型)
+  const float* position = transformMapped + 3;
+  if (hasLastMapped && time > lastMappedTime) {
+    for (int i = 0; i < 3; i++) {
+      startVelocity[i] = (position[i] - lastMappedPosition[i]) / (time - lastMappedTime);
+    }
+  }
+  hasLastMapped = true;
+  lastMappedTime = time;
+  std::copy(position, position + 3, lastMappedPosition);
+
+  //融合位姿时刻的IMU姿态：不晚于该时刻的最后一个测量；odometry有延迟，之后的测量已经收到
+  //odometry的时间不一定递增，每次都在整个缓冲区中查找
+  uint64_t startPos = 0;
+  ImuState front, start;
+  ImuRingBuffer<ImuState>::LookupResult imuLookup = imuBuffer.lookup(time, startPos, front, start);
+  if (imuLookup == ImuRingBuffer<ImuState>::LOOKUP_EMPTY) {
+    propagating = false;
+    return;
+  }
+  if (front.time <= time) {
+    //所有的测量都不晚于该时刻
+    start = front;
+  } else if (startPos > 0 && imuBuffer.read(startPos - 1, start)) {
+    startPos--;
+  } else {
+    //front之前的测量不存在或者已被覆盖时不传播
+    propagating = false;
+    return;
+  }
+  propagating = true;
+
+  //IMU世界坐标系与地图世界坐标系的偏航不同，由融合位姿与同一时刻的IMU姿态得到两者之间的旋转
+  imuToMap = rotationOf(transformMapped[0], transformMapped[1], transformMapped[2]) *
+             rotationOf(start.pitch, start.yaw, start.roll).transpose();
+  propagationStart = time;
+  propagatedTime = time;
+  std::copy(position, position + 3, startPosition);
+  std::fill(imuShift, imuShift + 3, 0.0f);
+  std::copy(startVelocity, startVelocity + 3, imuVelo);
+
+  ImuState imu;
+  for (uint64_t pos = startPos + 1; pos < imuBuffer.end() && imuBuffer.read(pos, imu); pos++) {
+    propagateTo(imu);
+  }
+}
 
-  return 0;
+void TransformMaintenance::propagateTo(const ImuState& imu)
+{
+  double timeDiff = imu.time - propagatedTime;
+  if (timeDiff <= 0) {
+    return;
+  }
+
+  //要求imu的频率至少比lidar高，间隔过长时只更新时间
+  if (timeDiff < scanPeriod) {
+    Eigen::Vector3f acc = imuToMap * Eigen::Vector3f(imu.accX, imu.accY, imu.accZ);
+    for (int i = 0; i < 3; i++) {
+      accumulateImuShift(imuShift[i], imuVelo[i], acc[i], timeDiff, imuShift[i], imuVelo[i]);
+    }
+  }
+  propagatedTime = imu.time;
 }
+
+} // end namespace loam
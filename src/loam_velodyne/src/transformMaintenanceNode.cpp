@@ -0,0 +1,153 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <loam_velodyne/TransformMaintenanceNode.h>
+#include <loam_velodyne/ros_conversions.h>
+
+namespace loam {
+
+TransformMaintenanceNode::TransformMaintenanceNode()
+  : latencyTimers({"end to end latency"})
+{
+  laserOdometry2.header.frame_id = "/camera_init";
+  laserOdometry2.child_frame_id = "/camera";
+
+  laserOdometryTrans2.frame_id_ = "/camera_init";
+  laserOdometryTrans2.child_frame_id_ = "/camera";
+
+  imuOdometry.header.frame_id = "/camera_init";
+  imuOdometry.child_frame_id = "/camera";
+}
+
+bool TransformMaintenanceNode::setup(ros::NodeHandle& node, ros::NodeHandle& privateNode)
+{
+  setupRosLogging();
+
+  TransformMaintenanceParams params;
+  bool imuPropagation = false;
+  privateNode.param("imuPropagation", imuPropagation, imuPropagation);
+  privateNode.param("imuMaxPropagation", params.imuMaxPropagation, params.imuMaxPropagation);
+  if (!transformMaintenance.configure(params)) {
+    return false;
+  }
+
+  subLaserOdometry = node.subscribe<nav_msgs::Odometry>
+                     ("/laser_odom_to_init", 5, &TransformMaintenanceNode::laserOdometryHandler, this);
+
+  subOdomAftMapped = node.subscribe<nav_msgs::Odometry>
+                     ("/aft_mapped_to_init", 5, &TransformMaintenanceNode::odomAftMappedHandler, this);
+
+  pubLaserOdometry2 = node.advertise<nav_msgs::Odometry> ("/integrated_to_init", 5);
+
+  //IMU传播的位姿时间戳为IMU的时间，比/integrated_to_init新，不发布tf
+  if (imuPropagation) {
+    subImu = node.subscribe<sensor_msgs::Imu> ("/imu/data", 50, &TransformMaintenanceNode::imuHandler, this);
+    pubImuOdometry = node.advertise<nav_msgs::Odometry> ("/imu_integrated_to_init", 50);
+  }
+
+  tfBroadcaster2.reset(new tf::TransformBroadcaster());
+
+  //端到端延迟按~timingPeriod周期发布到/diagnostics
+  timingPublisher.setup(node, privateNode, "transformMaintenance: timing");
+
+  return true;
+}
+
+//接收laserOdometry的信息
+void TransformMaintenanceNode::laserOdometryHandler(const nav_msgs::Odometry::ConstPtr& laserOdometry)
+{
+  //得到旋转平移矩阵
+  float transformSum[6];
+  poseToTransform(laserOdometry->pose.pose, transformSum);
+
+  float transformMapped[6];
+  {
+    std::lock_guard<std::mutex> lock(transformMutex);
+    transformMaintenance.processOdometry(laserOdometry->header.stamp.toSec(), transformSum, transformMapped);
+  }
+
+  laserOdometry2.header.stamp = laserOdometry->header.stamp;
+  transformToPose(transformMapped, laserOdometry2.pose.pose);
+  pubLaserOdometry2.publish(laserOdometry2);
+
+  //发送旋转平移量
+  const geometry_msgs::Quaternion& geoQuat = laserOdometry2.pose.pose.orientation;
+  laserOdometryTrans2.stamp_ = laserOdometry->header.stamp;
+  laserOdometryTrans2.setRotation(tf::Quaternion(geoQuat.x, geoQuat.y, geoQuat.z, geoQuat.w));
+  laserOdometryTrans2.setOrigin(tf::Vector3(transformMapped[3], transformMapped[4], transformMapped[5]));
+  tfBroadcaster2->sendTransform(laserOdometryTrans2);
+
+  //消息时间戳即为雷达点云的时间戳，回放数据时需要使用仿真时间
+  latencyTimers.record(0, (ros::Time::now() - laserOdometry->header.stamp).toSec());
+  timingPublisher.update(latencyTimers);
+}
+
+//接收laserMapping的转换信息，优化前的位姿放在扭转量中
+void TransformMaintenanceNode::odomAftMappedHandler(const nav_msgs::Odometry::ConstPtr& odomAftMapped)
+{
+  float transformAftMapped[6];
+  poseToTransform(odomAftMapped->pose.pose, transformAftMapped);
+
+  float transformBefMapped[6];
+  transformBefMapped[0] = odomAftMapped->twist.twist.angular.x;
+  transformBefMapped[1] = odomAftMapped->twist.twist.angular.y;
+  transformBefMapped[2] = odomAftMapped->twist.twist.angular.z;
+
+  transformBefMapped[3] = odomAftMapped->twist.twist.linear.x;
+  transformBefMapped[4] = odomAftMapped->twist.twist.linear.y;
+  transformBefMapped[5] = odomAftMapped->twist.twist.linear.z;
+
+  std::lock_guard<std::mutex> lock(transformMutex);
+  transformMaintenance.processMapping(transformAftMapped, transformBefMapped);
+}
+
+//速度为/camera_init坐标系下的线速度
+void TransformMaintenanceNode::imuHandler(const sensor_msgs::Imu::ConstPtr& imuIn)
+{
+  float transformPropagated[6];
+  float velocity[3];
+  {
+    std::lock_guard<std::mutex> lock(transformMutex);
+    if (!transformMaintenance.processImu(imuSampleFromMsg(*imuIn), transformPropagated, velocity)) {
+      return;
+    }
+  }
+
+  imuOdometry.header.stamp = imuIn->header.stamp;
+  transformToPose(transformPropagated, imuOdometry.pose.pose);
+  imuOdometry.twist.twist.linear.x = velocity[0];
+  imuOdometry.twist.twist.linear.y = velocity[1];
+  imuOdometry.twist.twist.linear.z = velocity[2];
+  pubImuOdometry.publish(imuOdometry);
+}
+
+} // end namespace loam
@@ -0,0 +1,253 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <loam_velodyne/VoxelFilter.h>
+#include <loam_velodyne/logging.h>
+#include <algorithm>
+#include <cmath>
+
+namespace loam {
+
+namespace {
+
+//每一维编码的位数，偏移之后的无符号数按大小排序与有符号的体素坐标顺序一致
+const int voxelKeyBits = 21;
+const int64_t voxelKeyOffset = int64_t(1) << (voxelKeyBits - 1);
+
+inline bool isFinitePoint(const PointType& point)
+{
+  return std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z);
+}
+
+//一维的体素坐标加上偏移，超出编码范围[-voxelKeyOffset, voxelKeyOffset)时返回false
+inline bool voxelCoordinateOf(float value, float inverseLeafSize, uint64_t& coordinate)
+{
+  //先在浮点数上检查范围，很远的点转换为整数时也不会溢出
+  float index = std::floor(value * inverseLeafSize);
+  if (!(index >= -float(voxelKeyOffset) && index < float(voxelKeyOffset))) {
+    return false;
+  }
+  coordinate = uint64_t(int64_t(index) + voxelKeyOffset);
+  return true;
+}
+
+inline void addPoint(float& x, float& y, float& z, float& intensity, const PointType& point)
+{
+  x += point.x;
+  y += point.y;
+  z += point.z;
+  intensity += point.intensity;
+}
+
+} // end anonymous namespace
+
+VoxelFilter::VoxelFilter(float size)
+{
+  setLeafSize(size);
+}
+
+void VoxelFilter::setLeafSize(float size)
+{
+  leafSize = size;
+  inverseLeafSize = 1.0f / size;
+}
+
+bool VoxelFilter::voxelKeyOf(const PointType& point, uint64_t& key) const
+{
+  //与pcl::VoxelGrid相同，栅格以原点为基准，先乘以边长的倒数再向下取整
+  uint64_t i, j, k;
+  if (!voxelCoordinateOf(point.x, inverseLeafSize, i) ||
+      !voxelCoordinateOf(point.y, inverseLeafSize, j) ||
+      !voxelCoordinateOf(point.z, inverseLeafSize, k)) {
+    return false;
+  }
+
+  key = (k << (2 * voxelKeyBits)) | (j << voxelKeyBits) | i;
+  return true;
+}
+
+void VoxelFilter::warnOutOfRange(size_t pointNum) const
+{
+  //截断编码会把很远的点算进其他体素的均值，这里丢弃这些点
+  LOAM_WARN_THROTTLE(10.0, "VoxelFilter dropped %lu points outside the voxel key range "
+                     "(leaf size %f, at most %ld voxels from the origin per axis)",
+                     (unsigned long)pointNum, leafSize, (long)voxelKeyOffset);
+}
+
+VoxelFilter::VoxelSum& VoxelFilter::voxelSumOf(uint64_t key, const PointType* seed, long target)
+{
+  std::pair<std::unordered_map<uint64_t, size_t>::iterator, bool> inserted =
+    voxelSlots.insert(std::make_pair(key, voxelSums.size()));
+  if (inserted.second) {
+    VoxelSum sum;
+    sum.x = sum.y = sum.z = sum.intensity = 0;
+    sum.pointNum = 0;
+    sum.target = target;
+    if (seed != NULL) {
+      addPoint(sum.x, sum.y, sum.z, sum.intensity, *seed);
+      sum.pointNum = 1;
+    }
+    voxelSums.push_back(sum);
+  }
+
+  return voxelSums[inserted.first->second];
+}
+
+void VoxelFilter::sortVoxels(bool newOnly)
+{
+  voxelOrder.clear();
+  for (std::unordered_map<uint64_t, size_t>::const_iterator it = voxelSlots.begin();
+       it != voxelSlots.end(); ++it) {
+    if (!newOnly || voxelSums[it->second].target < 0) {
+      voxelOrder.push_back(*it);
+    }
+  }
+  std::sort(voxelOrder.begin(), voxelOrder.end());
+}
+
+void VoxelFilter::filter(const pcl::PointCloud<PointType>& input, pcl::PointCloud<PointType>& output)
+{
+  voxelSlots.clear();
+  voxelSums.clear();
+
+  size_t cloudSize = input.points.size();
+  size_t outOfRangeNum = 0;
+  for (size_t n = 0; n < cloudSize; n++) {
+    const PointType& point = input.points[n];
+    if (!isFinitePoint(point)) {
+      continue;
+    }
+
+    uint64_t key;
+    if (!voxelKeyOf(point, key)) {
+      outOfRangeNum++;
+      continue;
+    }
+    VoxelSum& sum = voxelSumOf(key, NULL, -1);
+    addPoint(sum.x, sum.y, sum.z, sum.intensity, point);
+    sum.pointNum++;
+  }
+  if (outOfRangeNum > 0) {
+    warnOutOfRange(outOfRangeNum);
+  }
+
+  sortVoxels(false);
+
+  output.header = input.header;
+  output.resize(voxelOrder.size());
+  for (size_t n = 0; n < voxelOrder.size(); n++) {
+    const VoxelSum& sum = voxelSums[voxelOrder[n].second];
+    float pointNum = sum.pointNum;
+    PointType& point = output.points[n];
+    point.x = sum.x / pointNum;
+    point.y = sum.y / pointNum;
+    point.z = sum.z / pointNum;
+    point.intensity = sum.intensity / pointNum;
+  }
+  output.is_dense = true;
+}
+
+size_t VoxelFilter::merge(pcl::PointCloud<PointType>& cloud, size_t filteredNum, VoxelIndex& voxels)
+{
+  size_t cloudSize = cloud.points.size();
+  filteredNum = std::min(filteredNum, cloudSize);
+
+  //体素索引丢失(如cube从磁盘读回)时由已滤波的点重建
+  if (voxels.empty()) {
+    for (size_t n = 0; n < filteredNum; n++) {
+      uint64_t key;
+      if (voxelKeyOf(cloud.points[n], key)) {
+        voxels.insert(std::make_pair(key, n));
+      }
+    }
+  }
+
+  voxelSlots.clear();
+  voxelSums.clear();
+
+  //新加入的点累加到所在的体素，体素已有点时以已有的点作为第一个点
+  size_t outOfRangeNum = 0;
+  for (size_t n = filteredNum; n < cloudSize; n++) {
+    const PointType& point = cloud.points[n];
+    if (!isFinitePoint(point)) {
+      continue;
+    }
+
+    uint64_t key;
+    if (!voxelKeyOf(point, key)) {
+      outOfRangeNum++;
+      continue;
+    }
+    VoxelIndex::const_iterator existing = voxels.find(key);
+    VoxelSum& sum = existing != voxels.end()
+                    ? voxelSumOf(key, &cloud.points[existing->second], long(existing->second))
+                    : voxelSumOf(key, NULL, -1);
+    addPoint(sum.x, sum.y, sum.z, sum.intensity, point);
+    sum.pointNum++;
+  }
+  if (outOfRangeNum > 0) {
+    warnOutOfRange(outOfRangeNum);
+  }
+
+  //更新已有的体素
+  for (size_t n = 0; n < voxelSums.size(); n++) {
+    const VoxelSum& sum = voxelSums[n];
+    if (sum.target >= 0) {
+      float pointNum = sum.pointNum;
+      PointType& point = cloud.points[sum.target];
+      point.x = sum.x / pointNum;
+      point.y = sum.y / pointNum;
+      point.z = sum.z / pointNum;
+      point.intensity = sum.intensity / pointNum;
+    }
+  }
+
+  //新的体素按编码排序写在已滤波的点之后，覆盖已经累加过的新点
+  sortVoxels(true);
+  size_t pointNum = filteredNum;
+  for (size_t n = 0; n < voxelOrder.size(); n++) {
+    const VoxelSum& sum = voxelSums[voxelOrder[n].second];
+    float num = sum.pointNum;
+    PointType& point = cloud.points[pointNum];
+    point.x = sum.x / num;
+    point.y = sum.y / num;
+    point.z = sum.z / num;
+    point.intensity = sum.intensity / num;
+    voxels[voxelOrder[n].first] = pointNum;
+    pointNum++;
+  }
+  cloud.resize(pointNum);
+
+  return pointNum;
+}
+
+} // end namespace loam
@@ -0,0 +1,176 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include <loam_velodyne/feature_selection.h>
+
+using namespace loam;
+
+//原来的实现：整个分段按曲率插入排序之后从两端挑选
+static void selectBySorting(int sp, int ep, const float* curvature, const float* gapSq,
+                            int* sortInd, int* neighborPicked, int* label, SegmentFeatures& features)
+{
+  for (int k = sp + 1; k <= ep; k++) {
+    for (int l = k; l >= sp + 1; l--) {
+      if (curvature[sortInd[l]] < curvature[sortInd[l - 1]]) {
+        int temp = sortInd[l - 1];
+        sortInd[l - 1] = sortInd[l];
+        sortInd[l] = temp;
+      }
+    }
+  }
+
+  int largestPickedNum = 0;
+  for (int k = ep; k >= sp; k--) {
+    int ind = sortInd[k];
+    if (neighborPicked[ind] == 0 && curvature[ind] > 0.1) {
+      largestPickedNum++;
+      if (largestPickedNum <= 2) {
+        label[ind] = 2;
+        features.sharp.push_back(ind);
+        features.lessSharp.push_back(ind);
+      } else if (largestPickedNum <= 20) {
+        label[ind] = 1;
+        features.lessSharp.push_back(ind);
+      } else {
+        break;
+      }
+
+      neighborPicked[ind] = 1;
+      markFeatureNeighbors(ind, gapSq, neighborPicked);
+    }
+  }
+
+  int smallestPickedNum = 0;
+  for (int k = sp; k <= ep; k++) {
+    int ind = sortInd[k];
+    if (neighborPicked[ind] == 0 && curvature[ind] < 0.1) {
+      label[ind] = -1;
+      features.flat.push_back(ind);
+
+      smallestPickedNum++;
+      if (smallestPickedNum >= 4) {
+        break;
+      }
+
+      neighborPicked[ind] = 1;
+      markFeatureNeighbors(ind, gapSq, neighborPicked);
+    }
+  }
+}
+
+//一个随机的分段，曲率取少数几个值，包括阈值0.1本身，产生大量相同的曲率
+struct RandomSegment {
+  explicit RandomSegment(int pointNum)
+    : size(pointNum + 12),
+      curvature(size),
+      gapSq(size),
+      sortInd(size),
+      neighborPicked(size),
+      label(size, 0)
+  {
+    static const float curvatureValues[] = {0, 0.01, 0.05, 0.1, 0.1, 0.2, 0.5, 1.0, 3.0};
+    for (int i = 0; i < size; i++) {
+      curvature[i] = curvatureValues[std::rand() % 9];
+      gapSq[i] = std::rand() % 4 == 0 ? 0.1 : 0.01;
+      sortInd[i] = i;
+      neighborPicked[i] = std::rand() % 10 == 0 ? 1 : 0;
+    }
+  }
+
+  int size;
+  std::vector<float> curvature;
+  std::vector<float> gapSq;
+  std::vector<int> sortInd;
+  std::vector<int> neighborPicked;
+  std::vector<int> label;
+};
+
+TEST(FeatureSelection, MatchesSortedSelection)
+{
+  std::srand(1);
+  for (int n = 0; n < 3000; n++) {
+    int pointNum = 1 + std::rand() % 120;
+    RandomSegment heap(pointNum);
+    RandomSegment sorted = heap;
+    int sp = 6;
+    int ep = sp + pointNum - 1;
+
+    SegmentFeatures heapFeatures, sortedFeatures;
+    selectSegmentFeatures(sp, ep, heap.curvature.data(), heap.gapSq.data(), heap.sortInd.data(),
+                          heap.neighborPicked.data(), heap.label.data(), heapFeatures);
+    selectBySorting(sp, ep, sorted.curvature.data(), sorted.gapSq.data(), sorted.sortInd.data(),
+                    sorted.neighborPicked.data(), sorted.label.data(), sortedFeatures);
+
+    ASSERT_EQ(sortedFeatures.sharp, heapFeatures.sharp);
+    ASSERT_EQ(sortedFeatures.lessSharp, heapFeatures.lessSharp);
+    ASSERT_EQ(sortedFeatures.flat, heapFeatures.flat);
+    ASSERT_EQ(sorted.label, heap.label);
+    ASSERT_EQ(sorted.neighborPicked, heap.neighborPicked);
+  }
+}
+
+TEST(FeatureSelection, PicksAtMostTwentyCornersAndFourFlatPoints)
+{
+  const int pointNum = 100;
+  RandomSegment segment(pointNum);
+  for (int i = 0; i < segment.size; i++) {
+    //曲率交替为大与小，点间距离都很大，不筛选相邻的点
+    segment.curvature[i] = i % 2 == 0 ? 1.0 + i : 0.001 * i;
+    segment.gapSq[i] = 1.0;
+    segment.neighborPicked[i] = 0;
+  }
+
+  SegmentFeatures features;
+  selectSegmentFeatures(6, 6 + pointNum - 1, segment.curvature.data(), segment.gapSq.data(),
+                        segment.sortInd.data(), segment.neighborPicked.data(), segment.label.data(),
+                        features);
+
+  ASSERT_EQ(2u, features.sharp.size());
+  ASSERT_EQ(20u, features.lessSharp.size());
+  ASSERT_EQ(4u, features.flat.size());
+  //曲率从大到小与从小到大
+  EXPECT_EQ(104, features.sharp[0]);
+  EXPECT_EQ(102, features.sharp[1]);
+  EXPECT_EQ(7, features.flat[0]);
+  EXPECT_EQ(9, features.flat[1]);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
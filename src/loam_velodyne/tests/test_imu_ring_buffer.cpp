@@ -0,0 +1,242 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include <loam_velodyne/ImuRingBuffer.h>
+
+using namespace loam;
+
+//带序号的测量，便于检查查找到的是哪一个
+struct Sample {
+  Sample() : time(0), id(-1) {}
+  Sample(double time_, int id_) : time(time_), id(id_) {}
+
+  double time;
+  int id;
+};
+
+//插值得到的测量序号为-1，只有时间是插值的结果
+static Sample interpolateSample(const Sample& back, const Sample& front, float ratioFront, float ratioBack)
+{
+  return Sample(front.time * ratioFront + back.time * ratioBack, -1);
+}
+
+typedef ImuRingBuffer<Sample> SampleBuffer;
+
+TEST(ImuRingBuffer, EmptyAndLatest)
+{
+  SampleBuffer buffer(8);
+  uint64_t cursor = 0;
+  Sample front, back;
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(SampleBuffer::LOOKUP_EMPTY, buffer.lookup(1.0, cursor, front, back));
+  EXPECT_FALSE(buffer.latest(front));
+
+  buffer.push(Sample(1.0, 0));
+  buffer.push(Sample(2.0, 1));
+  EXPECT_EQ(SampleBuffer::LOOKUP_LATEST, buffer.lookup(2.5, cursor, front, back));
+  EXPECT_EQ(1, front.id);
+  EXPECT_EQ(1u, cursor);
+  ASSERT_TRUE(buffer.latest(front));
+  EXPECT_EQ(1, front.id);
+
+  //与最新的测量同时刻时可以插值
+  cursor = 0;
+  EXPECT_EQ(SampleBuffer::LOOKUP_BRACKET, buffer.lookup(2.0, cursor, front, back));
+  EXPECT_EQ(1, front.id);
+  EXPECT_EQ(0, back.id);
+}
+
+TEST(ImuRingBuffer, BeforeFirstSample)
+{
+  SampleBuffer buffer(8);
+  buffer.push(Sample(1.0, 0));
+  buffer.push(Sample(2.0, 1));
+
+  //早于所有的测量时front为第一个测量，之前没有测量
+  uint64_t cursor = 0;
+  Sample front, back(5.0, 5);
+  EXPECT_EQ(SampleBuffer::LOOKUP_BRACKET, buffer.lookup(0.5, cursor, front, back));
+  EXPECT_EQ(0, front.id);
+  EXPECT_EQ(-1, back.id);
+  EXPECT_EQ(0u, cursor);
+}
+
+TEST(ImuRingBuffer, EqualTimestamps)
+{
+  SampleBuffer buffer(8);
+  buffer.push(Sample(1.0, 0));
+  buffer.push(Sample(2.0, 1));
+  buffer.push(Sample(2.0, 2));
+  buffer.push(Sample(3.0, 3));
+
+  //front为第一个晚于该时刻的测量，back为不晚于该时刻的最后一个测量
+  uint64_t cursor = 0;
+  Sample front, back;
+  EXPECT_EQ(SampleBuffer::LOOKUP_BRACKET, buffer.lookup(2.0, cursor, front, back));
+  EXPECT_EQ(3, front.id);
+  EXPECT_EQ(2, back.id);
+  EXPECT_EQ(3u, cursor);
+}
+
+TEST(ImuRingBuffer, Interpolate)
+{
+  SampleBuffer buffer(8);
+  uint64_t cursor = 0;
+  Sample sample;
+  EXPECT_FALSE(buffer.interpolate(1.0, cursor, sample));
+
+  buffer.push(Sample(1.0, 0));
+  buffer.push(Sample(2.0, 1));
+  buffer.push(Sample(2.0, 2));
+  buffer.push(Sample(3.0, 3));
+
+  ASSERT_TRUE(buffer.interpolate(1.25, cursor, sample));
+  EXPECT_EQ(-1, sample.id);
+  EXPECT_FLOAT_EQ(1.25, sample.time);
+  EXPECT_EQ(1u, cursor);
+
+  ASSERT_TRUE(buffer.interpolate(2.5, cursor, sample));
+  EXPECT_EQ(-1, sample.id);
+  EXPECT_FLOAT_EQ(2.5, sample.time);
+
+  //晚于所有的测量时为最新的测量
+  ASSERT_TRUE(buffer.interpolate(3.5, cursor, sample));
+  EXPECT_EQ(3, sample.id);
+
+  //与两个相同时间戳的测量同时刻时不插值
+  SampleBuffer equal(8);
+  equal.push(Sample(1.0, 0));
+  equal.push(Sample(1.0, 1));
+  cursor = 0;
+  ASSERT_TRUE(equal.interpolate(1.0, cursor, sample));
+  EXPECT_EQ(1, sample.id);
+}
+
+TEST(ImuRingBuffer, MatchesLinearScan)
+{
+  SampleBuffer buffer(64);
+  for (int n = 0; n < 40; n++) {
+    buffer.push(Sample(0.01 * (n / 2), n));
+  }
+
+  //时间递增地查找，与原来逐个向后比较的结果相同
+  uint64_t cursor = 0;
+  int pointer = 0;
+  for (double time = -0.005; time < 0.25; time += 0.0025) {
+    while (pointer < 39 && !(time < 0.01 * (pointer / 2))) {
+      pointer++;
+    }
+
+    Sample front, back;
+    SampleBuffer::LookupResult result = buffer.lookup(time, cursor, front, back);
+    EXPECT_EQ(pointer, front.id) << "time " << time;
+    EXPECT_EQ(time > 0.01 * (pointer / 2) ? SampleBuffer::LOOKUP_LATEST : SampleBuffer::LOOKUP_BRACKET, result);
+    if (result == SampleBuffer::LOOKUP_BRACKET) {
+      EXPECT_EQ(pointer - 1, back.id);
+    }
+  }
+}
+
+TEST(ImuRingBuffer, WrapAround)
+{
+  //容量向上取整为2的幂，只保留最近的4个测量
+  SampleBuffer buffer(3);
+  EXPECT_EQ(4u, buffer.capacity());
+  for (int n = 0; n < 10; n++) {
+    buffer.push(Sample(n, n));
+  }
+  EXPECT_EQ(10u, buffer.end());
+
+  Sample sample;
+  EXPECT_FALSE(buffer.read(5, sample));
+  ASSERT_TRUE(buffer.read(6, sample));
+  EXPECT_EQ(6, sample.id);
+
+  //cursor指向已被覆盖的测量时从最旧的测量开始，最旧的测量之前没有可用的测量
+  uint64_t cursor = 2;
+  Sample front, back;
+  EXPECT_EQ(SampleBuffer::LOOKUP_BRACKET, buffer.lookup(3.0, cursor, front, back));
+  EXPECT_EQ(6, front.id);
+  EXPECT_EQ(-1, back.id);
+  EXPECT_EQ(6u, cursor);
+
+  EXPECT_EQ(SampleBuffer::LOOKUP_BRACKET, buffer.lookup(7.5, cursor, front, back));
+  EXPECT_EQ(8, front.id);
+  EXPECT_EQ(7, back.id);
+}
+
+TEST(ImuRingBuffer, OverwriteWhileReading)
+{
+  //生产者不停地覆盖很小的缓冲区，查找到的测量要么完整且相邻，要么之前的测量不可用
+  SampleBuffer buffer(4);
+  std::atomic<bool> stop(false);
+  std::thread producer([&buffer, &stop] {
+    for (int n = 0; !stop; n++) {
+      buffer.push(Sample(n, n));
+    }
+  });
+
+  while (buffer.empty()) {
+  }
+  uint64_t cursor = 0;
+  for (int lookup = 0; lookup < 100000; lookup++) {
+    double time = double(buffer.end()) - 2.5;
+    Sample front, back;
+    SampleBuffer::LookupResult result = buffer.lookup(time, cursor, front, back);
+    ASSERT_NE(SampleBuffer::LOOKUP_EMPTY, result);
+    ASSERT_EQ(front.time, double(front.id));
+    ASSERT_EQ(cursor, uint64_t(front.id));
+    if (result == SampleBuffer::LOOKUP_LATEST) {
+      ASSERT_LT(front.time, time);
+    } else {
+      ASSERT_GE(front.time, time);
+      if (back.id >= 0) {
+        ASSERT_EQ(front.id - 1, back.id);
+        ASSERT_EQ(back.time, double(back.id));
+      }
+    }
+  }
+
+  stop = true;
+  producer.join();
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,275 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include <loam_velodyne/MapFile.h>
+
+#include "test_helpers.h"
+
+using namespace loam;
+
+static const char* const mapFileName = "test_map_file.map";
+static const float cubeSize = 10.0f;
+
+//在cube(index)的范围内随机生成点，全部算作下采样过的
+static void fillCube(const CubeIndex& index, size_t cornerNum, size_t surfNum, MapCube& cube)
+{
+  const size_t pointNum[MapCube::FEATURE_NUM] = {cornerNum, surfNum};
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    cube.cloud[f]->clear();
+    for (size_t n = 0; n < pointNum[f]; n++) {
+      PointType point;
+      point.x = index.i * cubeSize + randomUniform(-0.5f, 0.5f) * cubeSize;
+      point.y = index.j * cubeSize + randomUniform(-0.5f, 0.5f) * cubeSize;
+      point.z = index.k * cubeSize + randomUniform(-0.5f, 0.5f) * cubeSize;
+      point.intensity = randomUniform(0.0f, 16.0f);
+      cube.cloud[f]->push_back(point);
+    }
+    cube.filteredNum[f] = pointNum[f];
+  }
+}
+
+static bool writeMapFile(const std::string& fileName, bool quantize, const CubeIndex& index, const MapCube& cube)
+{
+  MapFileWriter writer;
+  return writer.open(fileName, cubeSize, quantize) && writer.write(index, cube) && writer.close();
+}
+
+static bool fileExists(const std::string& fileName)
+{
+  return access(fileName.c_str(), F_OK) == 0;
+}
+
+static long fileSize(const std::string& fileName)
+{
+  std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+  return file.tellg();
+}
+
+//覆盖文件中offset处的字节
+template <typename T>
+static void patchFile(const std::string& fileName, long offset, const T& value)
+{
+  std::fstream file(fileName.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+TEST(MapFile, FloatRoundTrip)
+{
+  const CubeIndex index(1, -2, 3);
+  MapCube cube;
+  fillCube(index, 100, 300, cube);
+  //平面点有未下采样的点
+  cube.filteredNum[MapCube::SURF] = 200;
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  EXPECT_FALSE(fileExists(std::string(mapFileName) + ".tmp"));
+
+  MapFileReader reader;
+  ASSERT_TRUE(reader.open(mapFileName));
+  EXPECT_EQ(cubeSize, reader.getCubeSize());
+  EXPECT_FALSE(reader.isQuantized());
+  EXPECT_EQ(1u, reader.size());
+
+  MapCube decoded;
+  ASSERT_TRUE(reader.read(index, decoded));
+  EXPECT_FALSE(reader.read(CubeIndex(0, 0, 0), decoded));
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    ASSERT_EQ(cube.cloud[f]->size(), decoded.cloud[f]->size());
+    for (size_t n = 0; n < cube.cloud[f]->size(); n++) {
+      const PointType& expected = cube.cloud[f]->points[n];
+      const PointType& actual = decoded.cloud[f]->points[n];
+      EXPECT_EQ(expected.x, actual.x);
+      EXPECT_EQ(expected.y, actual.y);
+      EXPECT_EQ(expected.z, actual.z);
+      EXPECT_EQ(expected.intensity, actual.intensity);
+    }
+  }
+  EXPECT_EQ(100u, decoded.filteredNum[MapCube::CORNER]);
+  EXPECT_EQ(0u, decoded.filteredNum[MapCube::SURF]);
+
+  reader.close();
+  std::remove(mapFileName);
+}
+
+TEST(MapFile, QuantizedRoundTrip)
+{
+  const CubeIndex index(-4, 0, 7);
+  MapCube cube;
+  fillCube(index, 500, 500, cube);
+  ASSERT_TRUE(writeMapFile(mapFileName, true, index, cube));
+
+  MapFileReader reader;
+  ASSERT_TRUE(reader.open(mapFileName));
+  EXPECT_TRUE(reader.isQuantized());
+
+  MapCube decoded;
+  ASSERT_TRUE(reader.read(index, decoded));
+  //坐标误差不超过半个量化步长，intensity不超过1/512
+  const float coordinateError = 0.5f * cubeSize / 65534 + 1e-5f;
+  for (int f = 0; f < MapCube::FEATURE_NUM; f++) {
+    ASSERT_EQ(cube.cloud[f]->size(), decoded.cloud[f]->size());
+    for (size_t n = 0; n < cube.cloud[f]->size(); n++) {
+      const PointType& expected = cube.cloud[f]->points[n];
+      const PointType& actual = decoded.cloud[f]->points[n];
+      EXPECT_NEAR(expected.x, actual.x, coordinateError);
+      EXPECT_NEAR(expected.y, actual.y, coordinateError);
+      EXPECT_NEAR(expected.z, actual.z, coordinateError);
+      EXPECT_NEAR(expected.intensity, actual.intensity, 1.0f / 512 + 1e-5f);
+    }
+  }
+
+  reader.close();
+  std::remove(mapFileName);
+}
+
+TEST(MapFile, RejectsTruncatedFile)
+{
+  const CubeIndex index(0, 1, 0);
+  MapCube cube;
+  fillCube(index, 50, 50, cube);
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  const long size = fileSize(mapFileName);
+
+  MapFileReader reader;
+  //截断在索引表中间、数据块中间与文件头中间
+  const long truncatedSizes[] = {size - 1, size - 32, 64, 31, 0};
+  for (size_t n = 0; n < sizeof(truncatedSizes) / sizeof(truncatedSizes[0]); n++) {
+    ASSERT_EQ(0, truncate(mapFileName, truncatedSizes[n]));
+    EXPECT_FALSE(reader.open(mapFileName)) << "size " << truncatedSizes[n];
+  }
+
+  std::remove(mapFileName);
+  EXPECT_FALSE(reader.open(mapFileName));
+}
+
+TEST(MapFile, RejectsBadHeader)
+{
+  const CubeIndex index(0, 0, 1);
+  MapCube cube;
+  fillCube(index, 50, 50, cube);
+  MapFileReader reader;
+
+  //文件头：magic, version, cubeSize, flags, chunkNum, tableOffset
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  patchFile(mapFileName, 0, uint32_t(0x12345678));
+  EXPECT_FALSE(reader.open(mapFileName));
+
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  patchFile(mapFileName, 4, uint32_t(2));
+  EXPECT_FALSE(reader.open(mapFileName));
+
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  patchFile(mapFileName, 8, -1.0f);
+  EXPECT_FALSE(reader.open(mapFileName));
+
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  patchFile(mapFileName, 16, uint64_t(2));
+  EXPECT_FALSE(reader.open(mapFileName));
+
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  patchFile(mapFileName, 24, uint64_t(fileSize(mapFileName) + 1));
+  EXPECT_FALSE(reader.open(mapFileName));
+
+  //索引表中数据块的位置超出索引表
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  patchFile(mapFileName, fileSize(mapFileName) - 8, uint64_t(fileSize(mapFileName)));
+  EXPECT_FALSE(reader.open(mapFileName));
+
+  std::remove(mapFileName);
+}
+
+TEST(MapFile, OverwritesOpenMap)
+{
+  const CubeIndex index(2, 2, 2);
+  MapCube oldCube;
+  fillCube(index, 10, 10, oldCube);
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, oldCube));
+
+  //保存地图时覆盖正在使用的先验地图，已映射的内容不变
+  MapFileReader reader;
+  ASSERT_TRUE(reader.open(mapFileName));
+  MapCube newCube;
+  fillCube(index, 2000, 3000, newCube);
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, newCube));
+
+  MapCube decoded;
+  ASSERT_TRUE(reader.read(index, decoded));
+  ASSERT_EQ(10u, decoded.cloud[MapCube::CORNER]->size());
+  EXPECT_EQ(oldCube.cloud[MapCube::CORNER]->points[9].x, decoded.cloud[MapCube::CORNER]->points[9].x);
+
+  MapFileReader newReader;
+  ASSERT_TRUE(newReader.open(mapFileName));
+  ASSERT_TRUE(newReader.read(index, decoded));
+  EXPECT_EQ(3000u, decoded.cloud[MapCube::SURF]->size());
+
+  reader.close();
+  newReader.close();
+  std::remove(mapFileName);
+}
+
+TEST(MapFile, UnfinishedWriteKeepsOldFile)
+{
+  const CubeIndex index(0, 0, 0);
+  MapCube cube;
+  fillCube(index, 10, 10, cube);
+  ASSERT_TRUE(writeMapFile(mapFileName, false, index, cube));
+  const long size = fileSize(mapFileName);
+
+  //没有close的写入不替换原来的文件，也不留下临时文件
+  {
+    MapFileWriter writer;
+    ASSERT_TRUE(writer.open(mapFileName, cubeSize, false));
+    fillCube(index, 1000, 1000, cube);
+    ASSERT_TRUE(writer.write(index, cube));
+  }
+  EXPECT_EQ(size, fileSize(mapFileName));
+  EXPECT_FALSE(fileExists(std::string(mapFileName) + ".tmp"));
+
+  MapFileReader reader;
+  EXPECT_TRUE(reader.open(mapFileName));
+  reader.close();
+  std::remove(mapFileName);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
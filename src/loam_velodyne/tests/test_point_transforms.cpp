@@ -0,0 +1,143 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <loam_velodyne/point_transforms.h>
+
+using namespace loam;
+
+//原来laserMapping中逐点变换的pointAssociateToMap与pointAssociateTobeMapped
+static PointType legacyToMap(const float transform[6], const PointType& pi)
+{
+  float x1 = std::cos(transform[2]) * pi.x
+           - std::sin(transform[2]) * pi.y;
+  float y1 = std::sin(transform[2]) * pi.x
+           + std::cos(transform[2]) * pi.y;
+  float z1 = pi.z;
+
+  float x2 = x1;
+  float y2 = std::cos(transform[0]) * y1 - std::sin(transform[0]) * z1;
+  float z2 = std::sin(transform[0]) * y1 + std::cos(transform[0]) * z1;
+
+  PointType po;
+  po.x = std::cos(transform[1]) * x2 + std::sin(transform[1]) * z2
+       + transform[3];
+  po.y = y2 + transform[4];
+  po.z = -std::sin(transform[1]) * x2 + std::cos(transform[1]) * z2
+       + transform[5];
+  po.intensity = pi.intensity;
+  return po;
+}
+
+static PointType legacyFromMap(const float transform[6], const PointType& pi)
+{
+  float x1 = std::cos(transform[1]) * (pi.x - transform[3])
+           - std::sin(transform[1]) * (pi.z - transform[5]);
+  float y1 = pi.y - transform[4];
+  float z1 = std::sin(transform[1]) * (pi.x - transform[3])
+           + std::cos(transform[1]) * (pi.z - transform[5]);
+
+  float x2 = x1;
+  float y2 = std::cos(transform[0]) * y1 + std::sin(transform[0]) * z1;
+  float z2 = -std::sin(transform[0]) * y1 + std::cos(transform[0]) * z1;
+
+  PointType po;
+  po.x = std::cos(transform[2]) * x2
+       + std::sin(transform[2]) * y2;
+  po.y = -std::sin(transform[2]) * x2
+       + std::cos(transform[2]) * y2;
+  po.z = z2;
+  po.intensity = pi.intensity;
+  return po;
+}
+
+static std::vector<PointType> randomPoints(std::mt19937& rng, int size)
+{
+  std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+  std::vector<PointType> points(size);
+  for (int i = 0; i < size; i++) {
+    points[i].x = coordinate(rng);
+    points[i].y = coordinate(rng);
+    points[i].z = coordinate(rng);
+    points[i].intensity = i + 0.5f;
+  }
+  return points;
+}
+
+static void expectSamePoints(const std::vector<PointType>& expected, const std::vector<PointType>& actual)
+{
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(expected[i].x, actual[i].x) << "point " << i;
+    EXPECT_EQ(expected[i].y, actual[i].y) << "point " << i;
+    EXPECT_EQ(expected[i].z, actual[i].z) << "point " << i;
+    EXPECT_EQ(expected[i].intensity, actual[i].intensity) << "point " << i;
+  }
+}
+
+//点数覆盖不足一组、整组与整组加余数的情况，并包括原地变换(in与out相同)
+TEST(PointTransforms, MatchPerPointFormulas)
+{
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> angle(-3.1f, 3.1f);
+  std::uniform_real_distribution<float> shift(-100.0f, 100.0f);
+
+  for (int size = 0; size <= 9; size++) {
+    float transform[6] = {angle(rng), angle(rng), angle(rng), shift(rng), shift(rng), shift(rng)};
+    EulerPose pose(transform);
+    std::vector<PointType> points = randomPoints(rng, size);
+
+    std::vector<PointType> expectedToMap(size), expectedFromMap(size);
+    for (int i = 0; i < size; i++) {
+      expectedToMap[i] = legacyToMap(transform, points[i]);
+      expectedFromMap[i] = legacyFromMap(transform, points[i]);
+    }
+
+    std::vector<PointType> out(size);
+    transformPointsToMap(pose, points.data(), out.data(), size);
+    expectSamePoints(expectedToMap, out);
+    transformPointsFromMap(pose, points.data(), out.data(), size);
+    expectSamePoints(expectedFromMap, out);
+
+    std::vector<PointType> inPlace = points;
+    transformPointsToMap(pose, inPlace.data(), inPlace.data(), size);
+    expectSamePoints(expectedToMap, inPlace);
+    inPlace = points;
+    transformPointsFromMap(pose, inPlace.data(), inPlace.data(), size);
+    expectSamePoints(expectedFromMap, inPlace);
+  }
+}
@@ -0,0 +1,135 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <loam_velodyne/scan_kernels.h>
+
+using namespace loam;
+
+//原来在整帧点云(AoS)上逐点计算的表达式
+struct Point {
+  float x, y, z;
+};
+
+static float legacyCurvature(const std::vector<Point>& cloud, int i)
+{
+  float diffX = cloud[i - 5].x + cloud[i - 4].x + cloud[i - 3].x + cloud[i - 2].x + cloud[i - 1].x
+              - 10 * cloud[i].x
+              + cloud[i + 1].x + cloud[i + 2].x + cloud[i + 3].x + cloud[i + 4].x + cloud[i + 5].x;
+  float diffY = cloud[i - 5].y + cloud[i - 4].y + cloud[i - 3].y + cloud[i - 2].y + cloud[i - 1].y
+              - 10 * cloud[i].y
+              + cloud[i + 1].y + cloud[i + 2].y + cloud[i + 3].y + cloud[i + 4].y + cloud[i + 5].y;
+  float diffZ = cloud[i - 5].z + cloud[i - 4].z + cloud[i - 3].z + cloud[i - 2].z + cloud[i - 1].z
+              - 10 * cloud[i].z
+              + cloud[i + 1].z + cloud[i + 2].z + cloud[i + 3].z + cloud[i + 4].z + cloud[i + 5].z;
+  return diffX * diffX + diffY * diffY + diffZ * diffZ;
+}
+
+//随机的点云，同时按x[], y[], z[]分开存放
+static void randomCloud(std::mt19937& generator, int size, std::vector<Point>& cloud,
+                        std::vector<float>& x, std::vector<float>& y, std::vector<float>& z)
+{
+  std::uniform_real_distribution<float> coordinate(-60.0f, 60.0f);
+  cloud.resize(size);
+  x.resize(size);
+  y.resize(size);
+  z.resize(size);
+  for (int i = 0; i < size; i++) {
+    cloud[i].x = x[i] = coordinate(generator);
+    cloud[i].y = y[i] = coordinate(generator);
+    cloud[i].z = z[i] = coordinate(generator);
+  }
+}
+
+TEST(ScanKernels, CurvatureMatchesScalarStencil)
+{
+  //点数与起点都不是批量宽度的整数倍，覆盖SIMD部分与剩余的标量部分
+  std::mt19937 generator(7);
+  std::vector<Point> cloud;
+  std::vector<float> x, y, z;
+  for (int size = 11; size <= 50; size++) {
+    randomCloud(generator, size, cloud, x, y, z);
+    for (int begin = 5; begin <= 8 && begin <= size - 5; begin++) {
+      int end = size - 5;
+      std::vector<float> curvature(size, -1.0f);
+      computeCurvature(x.data(), y.data(), z.data(), begin, end, curvature.data());
+
+      for (int i = 0; i < size; i++) {
+        if (i < begin || i >= end) {
+          EXPECT_EQ(-1.0f, curvature[i]) << "size " << size << " begin " << begin << " point " << i;
+        } else {
+          EXPECT_EQ(legacyCurvature(cloud, i), curvature[i]) << "size " << size << " begin " << begin << " point " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(ScanKernels, RangeAndGapMatchScalarExpressions)
+{
+  std::mt19937 generator(11);
+  std::vector<Point> cloud;
+  std::vector<float> x, y, z;
+  for (int size = 0; size <= 40; size++) {
+    randomCloud(generator, size, cloud, x, y, z);
+    std::vector<float> rangeSq(size), range(size), gapSq(size + 1, -1.0f);
+    computeRangeAndGap(x.data(), y.data(), z.data(), size, rangeSq.data(), range.data(), gapSq.data());
+
+    for (int i = 0; i < size; i++) {
+      float squared = cloud[i].x * cloud[i].x + cloud[i].y * cloud[i].y + cloud[i].z * cloud[i].z;
+      EXPECT_EQ(squared, rangeSq[i]) << "size " << size << " point " << i;
+      EXPECT_EQ(std::sqrt(squared), range[i]) << "size " << size << " point " << i;
+
+      if (i + 1 < size) {
+        float diffX = cloud[i + 1].x - cloud[i].x;
+        float diffY = cloud[i + 1].y - cloud[i].y;
+        float diffZ = cloud[i + 1].z - cloud[i].z;
+        EXPECT_EQ(diffX * diffX + diffY * diffY + diffZ * diffZ, gapSq[i]) << "size " << size << " point " << i;
+      }
+    }
+    //最后一个点没有后一个点，不写入
+    if (size > 0) {
+      EXPECT_EQ(-1.0f, gapSq[size - 1]) << "size " << size;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
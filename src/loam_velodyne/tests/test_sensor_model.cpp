@@ -0,0 +1,136 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include <loam_velodyne/SensorModel.h>
+
+#include "test_helpers.h"
+
+using namespace loam;
+
+//原来VLP-16的线号计算：仰角四舍五入为整数度，正仰角的线号为仰角，其余为仰角 + 15
+static int legacyScanIdOf(float x, float y, float z)
+{
+  float angle = std::atan(y / std::sqrt(x * x + z * z)) * 180 / M_PI;
+  int roundedAngle = int(angle + (angle < 0.0 ? -0.5 : +0.5));
+  int scanID = roundedAngle > 0 ? roundedAngle : roundedAngle + 15;
+  return scanID > 15 || scanID < 0 ? -1 : scanID;
+}
+
+//仰角为elevation(度)、方位角与距离随机的点，z轴向前，x轴向左，y轴向上
+static void randomPoint(float elevation, float& x, float& y, float& z)
+{
+  float azimuth = randomUniform(-M_PI, M_PI);
+  float range = randomUniform(1.0, 80.0);
+  float horizontal = range * std::cos(elevation * M_PI / 180);
+  x = horizontal * std::sin(azimuth);
+  y = range * std::sin(elevation * M_PI / 180);
+  z = horizontal * std::cos(azimuth);
+}
+
+TEST(SensorModel, Vlp16MatchesRoundedElevation)
+{
+  SensorModel model;
+  ASSERT_EQ(16, model.numRings());
+
+  std::srand(1);
+  for (int n = 0; n < 100000; n++) {
+    //四舍五入与查表在激光线仰角附近半度以内给出相同的线
+    int ring = std::rand() % 16;
+    float elevation = -15 + 2 * ring + randomUniform(-0.45, 0.45);
+    float x, y, z;
+    randomPoint(elevation, x, y, z);
+
+    ASSERT_EQ(legacyScanIdOf(x, y, z), model.scanIdOf(x, y, z)) << "elevation " << elevation;
+  }
+}
+
+TEST(SensorModel, RejectsPointsOutsideTheFieldOfView)
+{
+  SensorModel model;
+  float x, y, z;
+  randomPoint(20.0, x, y, z);
+  EXPECT_EQ(-1, model.scanIdOf(x, y, z));
+  randomPoint(-20.0, x, y, z);
+  EXPECT_EQ(-1, model.scanIdOf(x, y, z));
+}
+
+TEST(SensorModel, CustomElevationsAreOrderedBottomUp)
+{
+  SensorModel model;
+  ASSERT_TRUE(model.setModel("HDL-32"));
+  std::vector<float> elevations;
+  elevations.push_back(10.0);
+  elevations.push_back(-10.0);
+  elevations.push_back(0.0);
+  ASSERT_TRUE(model.setElevations(elevations));
+  ASSERT_EQ(3, model.numRings());
+
+  float x, y, z;
+  randomPoint(-9.0, x, y, z);
+  EXPECT_EQ(0, model.scanIdOf(x, y, z));
+  randomPoint(1.0, x, y, z);
+  EXPECT_EQ(1, model.scanIdOf(x, y, z));
+  randomPoint(11.0, x, y, z);
+  EXPECT_EQ(2, model.scanIdOf(x, y, z));
+
+  //重复或超出范围的仰角
+  elevations[2] = 10.0;
+  EXPECT_FALSE(model.setElevations(elevations));
+  elevations[2] = 90.0;
+  EXPECT_FALSE(model.setElevations(elevations));
+}
+
+TEST(SensorModel, RingField)
+{
+  SensorModel model;
+  //VLP-16的驱动线号与原来的交错线号一致
+  EXPECT_EQ(0, model.scanIdOfRing(0));
+  EXPECT_EQ(15, model.scanIdOfRing(15));
+  EXPECT_EQ(-1, model.scanIdOfRing(16));
+
+  //Ouster从最上面的一条线开始编号
+  ASSERT_TRUE(model.setModel("OS1-64"));
+  EXPECT_EQ(63, model.scanIdOfRing(0));
+  EXPECT_EQ(0, model.scanIdOfRing(63));
+  EXPECT_EQ(-1, model.scanIdOfRing(-1));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
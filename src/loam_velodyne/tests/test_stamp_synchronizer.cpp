@@ -0,0 +1,183 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <loam_velodyne/StampSynchronizer.h>
+#include <loam_velodyne/common.h>
+
+using namespace loam;
+
+//三路消息：两路特征点与一路里程计，记录每次对齐的结果
+class StampSynchronizerTest : public testing::Test {
+protected:
+  StampSynchronizerTest()
+  {
+    synchronizer.registerCallback(std::bind(&StampSynchronizerTest::matched, this,
+                                            std::placeholders::_1, std::placeholders::_2,
+                                            std::placeholders::_3));
+  }
+
+  void matched(const std::string& corner, const std::string& surf, int odometry)
+  {
+    matches.push_back(corner + "/" + surf + "/" + std::to_string(odometry));
+  }
+
+  void addFrame(uint64_t stamp)
+  {
+    synchronizer.add<0>(stamp, "c" + std::to_string(stamp));
+    synchronizer.add<1>(stamp, "s" + std::to_string(stamp));
+    synchronizer.add<2>(stamp, int(stamp));
+  }
+
+  StampSynchronizer<std::string, std::string, int> synchronizer;
+  std::vector<std::string> matches;
+};
+
+TEST_F(StampSynchronizerTest, MatchesInAnyOrder)
+{
+  synchronizer.add<2>(10, 10);
+  synchronizer.add<1>(20, "s20");
+  synchronizer.add<0>(10, "c10");
+  EXPECT_TRUE(matches.empty());
+  synchronizer.add<1>(10, "s10");
+  ASSERT_EQ(1u, matches.size());
+  EXPECT_EQ("c10/s10/10", matches[0]);
+
+  synchronizer.add<0>(20, "c20");
+  synchronizer.add<2>(20, 20);
+  ASSERT_EQ(2u, matches.size());
+  EXPECT_EQ("c20/s20/20", matches[1]);
+  EXPECT_EQ(2u, synchronizer.getMatchedCount());
+  EXPECT_EQ(0u, synchronizer.getDroppedCount());
+}
+
+TEST_F(StampSynchronizerTest, EvictsIncompleteFramesBeforeAMatch)
+{
+  synchronizer.add<0>(10, "c10");
+  synchronizer.add<2>(10, 10);
+  addFrame(20);
+  ASSERT_EQ(1u, matches.size());
+  EXPECT_EQ("c20/s20/20", matches[0]);
+  EXPECT_EQ(1u, synchronizer.getDroppedCount());
+
+  //比已对齐的帧更早的消息迟到，不再对齐
+  synchronizer.add<1>(10, "s10");
+  EXPECT_EQ(1u, matches.size());
+  EXPECT_EQ(2u, synchronizer.getDroppedCount());
+  synchronizer.add<1>(20, "s20");
+  EXPECT_EQ(3u, synchronizer.getDroppedCount());
+}
+
+TEST_F(StampSynchronizerTest, DropsTheOldestSlotWhenFull)
+{
+  synchronizer.setQueueSize(2);
+  synchronizer.add<0>(20, "c20");
+  synchronizer.add<0>(30, "c30");
+  //比队列中所有槽位都早的新槽位直接丢弃
+  synchronizer.add<0>(10, "c10");
+  EXPECT_EQ(1u, synchronizer.getDroppedCount());
+
+  synchronizer.add<0>(40, "c40");
+  EXPECT_EQ(2u, synchronizer.getDroppedCount());
+  synchronizer.add<1>(20, "s20");
+  synchronizer.add<2>(20, 20);
+  EXPECT_TRUE(matches.empty());
+
+  synchronizer.add<1>(30, "s30");
+  synchronizer.add<2>(30, 30);
+  ASSERT_EQ(1u, matches.size());
+  EXPECT_EQ("c30/s30/30", matches[0]);
+}
+
+TEST_F(StampSynchronizerTest, OdometryOnlyFramesAreNotDrops)
+{
+  //里程计每帧都有，特征点隔一帧才有(skipFrameNum = 1)
+  synchronizer.setDropChannels((1u << 0) | (1u << 1));
+  for (uint64_t frame = 0; frame < 20; frame++) {
+    uint64_t stamp = 100 + 10 * frame;
+    if (frame % 2 == 0) {
+      synchronizer.add<2>(stamp, int(stamp));
+    } else {
+      addFrame(stamp);
+    }
+  }
+  EXPECT_EQ(10u, synchronizer.getMatchedCount());
+  EXPECT_EQ(0u, synchronizer.getDroppedCount());
+
+  //收到了特征点却没有对齐的帧仍然计数
+  synchronizer.add<0>(300, "c300");
+  synchronizer.add<2>(300, 300);
+  addFrame(310);
+  EXPECT_EQ(11u, synchronizer.getMatchedCount());
+  EXPECT_EQ(1u, synchronizer.getDroppedCount());
+
+  //迟到的里程计不计数，迟到的特征点计数
+  synchronizer.add<2>(305, 305);
+  EXPECT_EQ(1u, synchronizer.getDroppedCount());
+  synchronizer.add<1>(300, "s300");
+  EXPECT_EQ(2u, synchronizer.getDroppedCount());
+}
+
+TEST_F(StampSynchronizerTest, OdometryAndCloudKeysMatchAtEpochScale)
+{
+  //laserOdometry由点云的pcl时间戳得到秒，点云以pclStampFromSec重新设置时间戳，
+  //里程计消息的时间戳为ros::Time().fromSec，laserMapping对两者取键之后需要相同
+  std::mt19937_64 generator(42);
+  std::uniform_int_distribution<uint64_t> step(1, 200000);
+  uint64_t sourceStamp = 1700000000000000ull;
+  for (int frame = 0; frame < 10000; frame++) {
+    sourceStamp += step(generator);
+    double time = secFromPclStamp(sourceStamp);
+
+    uint64_t cloudStamp = pclStampFromSec(time);
+    uint64_t odometryStamp = stampKeyOf(ros::Time().fromSec(time));
+    ASSERT_EQ(cloudStamp, odometryStamp) << "stamp " << sourceStamp;
+
+    synchronizer.add<2>(odometryStamp, frame);
+    synchronizer.add<0>(cloudStamp, "c");
+    synchronizer.add<1>(cloudStamp, "s");
+  }
+  EXPECT_EQ(10000u, synchronizer.getMatchedCount());
+  EXPECT_EQ(0u, synchronizer.getDroppedCount());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,201 @@
+// Copyright 2013, Ji Zhang, Carnegie Mellon University
+// Further contributions copyright (c) 2016, Southwest Research Institute
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// This is an implementation of the algorithm described in the following paper:
+//   J. Zhang and S. Singh. LOAM: Lidar Odometry and Mapping in Real-time.
+//     Robotics: Science and Systems Conference (RSS). Berkeley, CA, July 2014.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <loam_velodyne/VoxelFilter.h>
+
+#include "test_helpers.h"
+
+using namespace loam;
+
+//测试中的点都在编码范围之内
+static uint64_t keyOf(const VoxelFilter& filter, const PointType& point)
+{
+  uint64_t key = 0;
+  EXPECT_TRUE(filter.voxelKeyOf(point, key));
+  return key;
+}
+
+static void addRandomPoints(size_t num, pcl::PointCloud<PointType>& cloud)
+{
+  for (size_t n = 0; n < num; n++) {
+    PointType point;
+    point.x = randomUniform(-1.0, 1.0);
+    point.y = randomUniform(-1.0, 1.0);
+    point.z = randomUniform(-0.5, 0.5);
+    point.intensity = randomUniform(0.0, 16.0);
+    cloud.push_back(point);
+  }
+}
+
+//按体素编码排列的点，merge输出的体素顺序与filter不同
+static std::vector<std::pair<uint64_t, PointType> > sortedByVoxel(const VoxelFilter& filter,
+                                                                   const pcl::PointCloud<PointType>& cloud)
+{
+  std::vector<std::pair<uint64_t, PointType> > points;
+  for (size_t n = 0; n < cloud.points.size(); n++) {
+    points.push_back(std::make_pair(keyOf(filter, cloud.points[n]), cloud.points[n]));
+  }
+  std::sort(points.begin(), points.end(),
+            [](const std::pair<uint64_t, PointType>& a, const std::pair<uint64_t, PointType>& b) {
+              return a.first < b.first;
+            });
+  return points;
+}
+
+static void expectSameVoxels(const VoxelFilter& filter, const pcl::PointCloud<PointType>& expected,
+                             const pcl::PointCloud<PointType>& actual)
+{
+  std::vector<std::pair<uint64_t, PointType> > expectedPoints = sortedByVoxel(filter, expected);
+  std::vector<std::pair<uint64_t, PointType> > actualPoints = sortedByVoxel(filter, actual);
+  ASSERT_EQ(expectedPoints.size(), actualPoints.size());
+  for (size_t n = 0; n < expectedPoints.size(); n++) {
+    //与全量滤波的累加顺序相同，结果逐位一致
+    ASSERT_EQ(expectedPoints[n].first, actualPoints[n].first);
+    ASSERT_EQ(expectedPoints[n].second.x, actualPoints[n].second.x);
+    ASSERT_EQ(expectedPoints[n].second.y, actualPoints[n].second.y);
+    ASSERT_EQ(expectedPoints[n].second.z, actualPoints[n].second.z);
+    ASSERT_EQ(expectedPoints[n].second.intensity, actualPoints[n].second.intensity);
+  }
+}
+
+TEST(VoxelFilter, FilterAveragesEachVoxelInKeyOrder)
+{
+  VoxelFilter filter(1.0);
+  pcl::PointCloud<PointType> input, output;
+  PointType point;
+  point.x = 0.25; point.y = 0.25; point.z = 0.25; point.intensity = 1;
+  input.push_back(point);
+  point.x = 0.75; point.y = 0.75; point.z = 0.75; point.intensity = 3;
+  input.push_back(point);
+  point.x = -0.5; point.y = 0.5; point.z = 0.5; point.intensity = 5;
+  input.push_back(point);
+  point.x = std::numeric_limits<float>::quiet_NaN();
+  input.push_back(point);
+
+  filter.filter(input, output);
+  ASSERT_EQ(2u, output.points.size());
+  EXPECT_FLOAT_EQ(-0.5, output.points[0].x);
+  EXPECT_FLOAT_EQ(5, output.points[0].intensity);
+  EXPECT_FLOAT_EQ(0.5, output.points[1].x);
+  EXPECT_FLOAT_EQ(0.5, output.points[1].z);
+  EXPECT_FLOAT_EQ(2, output.points[1].intensity);
+}
+
+TEST(VoxelFilter, MergeMatchesFullFilter)
+{
+  std::srand(1);
+  VoxelFilter filter(0.2);
+  pcl::PointCloud<PointType> raw, cloud;
+  addRandomPoints(2000, raw);
+  filter.filter(raw, cloud);
+  VoxelIndex voxels;
+
+  //每次加入一批新点，增量滤波与对已滤波的点和新点一起全量滤波的结果相同
+  for (int batch = 0; batch < 10; batch++) {
+    size_t filteredNum = cloud.points.size();
+    addRandomPoints(500, cloud);
+    pcl::PointCloud<PointType> expected;
+    filter.filter(cloud, expected);
+
+    //第一次合并时体素索引为空，由已滤波的点重建
+    size_t pointNum = filter.merge(cloud, filteredNum, voxels);
+    ASSERT_EQ(pointNum, cloud.points.size());
+    ASSERT_EQ(pointNum, voxels.size());
+    expectSameVoxels(filter, expected, cloud);
+  }
+}
+
+TEST(VoxelFilter, MergeKeepsFilteredPointsInPlace)
+{
+  std::srand(2);
+  VoxelFilter filter(0.2);
+  pcl::PointCloud<PointType> raw, cloud;
+  addRandomPoints(1000, raw);
+  filter.filter(raw, cloud);
+  VoxelIndex voxels;
+  filter.merge(cloud, cloud.points.size(), voxels);
+  std::vector<uint64_t> keys;
+  for (size_t n = 0; n < cloud.points.size(); n++) {
+    keys.push_back(keyOf(filter, cloud.points[n]));
+  }
+
+  //已有体素的点原地更新，新的体素追加在后面
+  addRandomPoints(1000, cloud);
+  filter.merge(cloud, keys.size(), voxels);
+  for (size_t n = 0; n < keys.size(); n++) {
+    EXPECT_EQ(keys[n], keyOf(filter, cloud.points[n]));
+    EXPECT_EQ(n, voxels[keys[n]]);
+  }
+}
+
+TEST(VoxelFilter, DropsPointsOutsideTheKeyRange)
+{
+  //边长1毫米时每一维只能编码约±1048米，更远的点不能回绕到原点附近的体素
+  VoxelFilter filter(0.001);
+  PointType near, far;
+  near.x = 1000; near.y = -1000; near.z = 0.5; near.intensity = 1;
+  far.x = 2000; far.y = 0; far.z = 0; far.intensity = 2;
+  uint64_t key;
+  EXPECT_TRUE(filter.voxelKeyOf(near, key));
+  EXPECT_FALSE(filter.voxelKeyOf(far, key));
+  far.x = 0; far.z = -1e30;
+  EXPECT_FALSE(filter.voxelKeyOf(far, key));
+
+  pcl::PointCloud<PointType> input, output;
+  input.push_back(near);
+  input.push_back(far);
+  filter.filter(input, output);
+  ASSERT_EQ(1u, output.points.size());
+  EXPECT_EQ(1, output.points[0].intensity);
+
+  //增量滤波同样丢弃新加入的超出范围的点
+  VoxelIndex voxels;
+  far.z = 1049;
+  output.push_back(far);
+  EXPECT_EQ(1u, filter.merge(output, 1, voxels));
+  ASSERT_EQ(1u, output.points.size());
+  EXPECT_EQ(1, output.points[0].intensity);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}